@@ -15,6 +15,9 @@
  ******************************************************************************/
 
 #include "can.h"  // Include header file for CAN driver functions
+#include "metrics.h"  // TX outcome counters
+#include "log_limit.h"  // Per-frame logs, rate-limited and compiled out in production
+#include <stdio.h>
 
 static bool can_active = false;
 
@@ -93,33 +96,33 @@ uint32_t can_read_alerts()
 
     if (alerts_triggered & TWAI_ALERT_ERR_PASS)
     {
-        ESP_LOGI(CAN_TAG, "Alert: TWAI controller is in error passive state.");
+        LOG_LIMIT_W(CAN_TAG, "Alert: TWAI controller is in error passive state.");
         return TWAI_ALERT_ERR_PASS;
     }
 
     if (alerts_triggered & TWAI_ALERT_BUS_ERROR)
     {
-        ESP_LOGI(CAN_TAG, "Alert: Bus error occurred.");
-        ESP_LOGI(CAN_TAG, "Bus error count: %" PRIu32, twaistatus.bus_error_count);
+        LOG_LIMIT_W(CAN_TAG, "Alert: Bus error occurred, count %" PRIu32,
+                    twaistatus.bus_error_count);
         return TWAI_ALERT_BUS_ERROR;
     }
 
     if (alerts_triggered & TWAI_ALERT_TX_FAILED)
     {
-        ESP_LOGI(CAN_TAG, "Alert: Transmission failed.");
-        ESP_LOGI(CAN_TAG, "TX buffered: %" PRIu32, twaistatus.msgs_to_tx);
+        LOG_LIMIT_W(CAN_TAG, "Alert: Transmission failed, TX buffered %" PRIu32,
+                    twaistatus.msgs_to_tx);
         return TWAI_ALERT_TX_FAILED;
     }
 
     if (alerts_triggered & TWAI_ALERT_TX_SUCCESS)
     {
-        ESP_LOGI(CAN_TAG, "Alert: Transmission successful.");
+        LOG_LIMIT_D(CAN_TAG, "Alert: Transmission successful.");
         return TWAI_ALERT_TX_SUCCESS;
     }
 
     if (alerts_triggered & TWAI_ALERT_RX_QUEUE_FULL)
     {
-        ESP_LOGI(CAN_TAG, "Alert: RX queue full, frame lost.");
+        LOG_LIMIT_W(CAN_TAG, "Alert: RX queue full, frame lost.");
         return TWAI_ALERT_RX_QUEUE_FULL;
     }
 
@@ -146,11 +149,14 @@ esp_err_t can_write_Byte(can_message_t message)
     esp_err_t ret = twai_transmit(&message, portMAX_DELAY);
     if (ret == ESP_OK)
     {
-        printf("Message queued for transmission\n"); // Log success
+        metrics_inc(METRIC_CAN_TX);
+        LOG_LIMIT_D(CAN_TAG, "Message queued for transmission");
     }
     else
     {
-        printf("Failed to queue message for transmission\n"); // Log failure
+        metrics_inc(METRIC_CAN_TX_FAIL);
+        LOG_LIMIT_E(CAN_TAG, "Failed to queue message for transmission: %s",
+                    esp_err_to_name(ret));
     }
     return ret;
 }
@@ -167,23 +173,18 @@ can_message_t can_read_Byte()
     can_message_t message; // Variable to hold received message
     while (twai_receive(&message, 0) == ESP_OK)
     {
-        if (message.extd)
+        /* One line per frame, only in builds that keep debug logs */
+        if (LOG_LIMIT_ENABLED(ESP_LOG_DEBUG))
         {
-            ESP_LOGI(CAN_TAG, "Message is in Extended Format");
-        }
-        else
-        {
-            ESP_LOGI(CAN_TAG, "Message is in Standard Format");
-        }
-
-        printf("ID: %lx\nByte:", message.identifier);
-        if (!message.rtr)
-        {
-            for (int i = 0; i < message.data_length_code; i++)
+            char bytes[3 * TWAI_FRAME_MAX_DLC + 1] = "";
+            for (int i = 0; !message.rtr && i < message.data_length_code &&
+                            i < TWAI_FRAME_MAX_DLC; i++)
             {
-                printf(" %d = %02x,", i, message.data[i]);
+                snprintf(bytes + 3 * i, 4, " %02x", message.data[i]);
             }
-            printf("\n");
+            LOG_LIMIT_D(CAN_TAG, "RX %s ID %" PRIx32 "%s%s",
+                        message.extd ? "ext" : "std", message.identifier,
+                        message.rtr ? " RTR" : "", bytes);
         }
     }
     return message;
@@ -1,6 +1,7 @@
 #include "env_control.h"
 #include "sensors.h"
 #include "gpio.h"
+#include "trace.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
@@ -51,6 +52,7 @@ static void heat_task(void *arg)
 static void timer_cb(TimerHandle_t t)
 {
     (void)t;
+    TRACE_BEGIN("env_timer_cb");
     float temp = sensors_read_temperature();
     float hum  = sensors_read_humidity();
     s_state.temperature = temp;
@@ -81,6 +83,7 @@ static void timer_cb(TimerHandle_t t)
     }
 
     notify_state();
+    TRACE_END("env_timer_cb");
 }
 
 esp_err_t reptile_env_start(const reptile_env_thresholds_t *thr,
@@ -1,6 +1,8 @@
 #include "gpio.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "metrics.h"
 
 static void gpio_real_mode(uint16_t Pin, uint16_t Mode)
 {
@@ -52,25 +54,31 @@ static uint8_t gpio_real_read(uint16_t Pin)
     return gpio_get_level(Pin);
 }
 
+/* Drive an actuator for ms, counting the run and its measured on-time */
+static void gpio_real_pulse(uint16_t Pin, uint32_t ms, metric_counter_t runs,
+                            metric_counter_t on_ms)
+{
+    int64_t t0 = esp_timer_get_time();
+    gpio_set_level(Pin, 1);
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    gpio_set_level(Pin, 0);
+    metrics_inc(runs);
+    metrics_add(on_ms, (uint32_t)((esp_timer_get_time() - t0) / 1000));
+}
+
 static void gpio_real_feed(void)
 {
-    gpio_set_level(SERVO_FEED_PIN, 1);
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    gpio_set_level(SERVO_FEED_PIN, 0);
+    gpio_real_pulse(SERVO_FEED_PIN, 1000, METRIC_FEED_RUNS, METRIC_FEED_ON_MS);
 }
 
 static void gpio_real_water(void)
 {
-    gpio_set_level(WATER_PUMP_PIN, 1);
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    gpio_set_level(WATER_PUMP_PIN, 0);
+    gpio_real_pulse(WATER_PUMP_PIN, 1000, METRIC_PUMP_RUNS, METRIC_PUMP_ON_MS);
 }
 
 static void gpio_real_heat(void)
 {
-    gpio_set_level(HEAT_RES_PIN, 1);
-    vTaskDelay(pdMS_TO_TICKS(5000));
-    gpio_set_level(HEAT_RES_PIN, 0);
+    gpio_real_pulse(HEAT_RES_PIN, 5000, METRIC_HEAT_RUNS, METRIC_HEAT_ON_MS);
 }
 
 static esp_err_t gpio_real_init(void)
@@ -12,6 +12,7 @@
 *
 ******************************************************************************/ 
 #include "gui_bmp.h"
+#include "storage.h"
 
 // Function to extract pixel color based on the bit depth of the BMP image
 UWORD ExtractPixelColor(UBYTE *row_data, int col, int bBitCount, BMPINF *bmpInfoHeader) {
@@ -76,31 +77,40 @@ UWORD ExtractPixelColor(UBYTE *row_data, int col, int bBitCount, BMPINF *bmpInfo
 
 // Function to read and display BMP image from file
 UBYTE GUI_ReadBmp(UWORD Xstart, UWORD Ystart, const char *path) {
-    FILE *fp;
+    storage_file_t *fp;
     
     // Open the BMP file for reading
-    if ((fp = fopen(path, "rb")) == NULL) {
+    if (storage_open(path, STORAGE_READ, &fp) != ESP_OK) {
         Debug("Cannot open the file: %s\n", path);  // Print error if file can't be opened
         return 0;
     }
     printf("open: %s\n", path);  // Print the file path
     
     // Load the entire BMP file into memory
-    fseek(fp, 0, SEEK_END);  // Seek to the end of the file to get the size
-    size_t file_size = ftell(fp);  // Get the file size
-    fseek(fp, 0, SEEK_SET);  // Seek back to the beginning of the file
+    uint32_t file_size = 0;
+    if (storage_size(fp, &file_size) != ESP_OK ||
+        file_size < sizeof(BMPFILEHEADER) + sizeof(BMPINF)) {
+        Debug("Invalid BMP file: %s\n", path);
+        storage_close(fp);
+        return 0;
+    }
 
     // Allocate memory to store the file content
     UBYTE *file_buffer = malloc(file_size);
     if (!file_buffer) {
         Debug("Memory allocation failed\n");  // Print error if memory allocation fails
-        fclose(fp);
+        storage_close(fp);
         return 0;
     }
     
     // Read the file content into memory
-    fread(file_buffer, file_size, 1, fp);
-    fclose(fp);  // Close the file after reading
+    esp_err_t err = storage_pread(fp, file_buffer, file_size, 0, NULL);
+    storage_close(fp);  // Close the file after reading
+    if (err != ESP_OK) {
+        Debug("Cannot read the file: %s\n", path);
+        free(file_buffer);
+        return 0;
+    }
 
     // Parse BMP headers
     BMPFILEHEADER *bmpFileHeader = (BMPFILEHEADER *)file_buffer;
@@ -12,11 +12,28 @@
  ******************************************************************************/
 
 #include "i2c.h"  // Include I2C driver header for I2C functions
+#include "trace.h"  // Spans around the bus transfers
+#include "metrics.h"  // Transfer times and errors
+#include "log_limit.h"  // Rate-limited errors: a flaky bus fails every call
+#include "esp_timer.h"
 static const char *TAG = "i2c";  // Define a tag for logging
 
 // Global handle for the I2C master bus
 // i2c_master_bus_handle_t bus_handle = NULL;
 DEV_I2C_Port handle;
+
+/* Time and outcome of a bus transfer started at t0 (esp_timer us) */
+static void count_transfer(esp_err_t ret, int64_t t0)
+{
+    metrics_record(METRIC_I2C_XFER_US, (uint32_t)(esp_timer_get_time() - t0));
+    if (ret != ESP_OK) {
+        metrics_inc(METRIC_I2C_ERRORS);
+        if (ret == ESP_ERR_TIMEOUT) {
+            metrics_inc(METRIC_I2C_TIMEOUTS);
+        }
+    }
+}
+
 /**
  * @brief Initialize the I2C master interface.
  *
@@ -71,7 +88,7 @@ esp_err_t DEV_I2C_Probe(uint8_t addr)
 
     esp_err_t ret = i2c_master_probe(handle.bus, addr, 100);
     if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "I2C device 0x%02X not found: %s", addr, esp_err_to_name(ret));
+        LOG_LIMIT_W(TAG, "I2C device 0x%02X not found: %s", addr, esp_err_to_name(ret));
     }
     return ret;
 }
@@ -112,9 +129,13 @@ esp_err_t DEV_I2C_Set_Slave_Addr(i2c_master_dev_handle_t *dev_handle, uint8_t Ad
 esp_err_t DEV_I2C_Write_Byte(i2c_master_dev_handle_t dev_handle, uint8_t Cmd, uint8_t value)
 {
     uint8_t data[2] = {Cmd, value};  // Create an array with command and value
+    int64_t t0 = esp_timer_get_time();
+    TRACE_BEGIN("i2c_write_byte");
     esp_err_t ret = i2c_master_transmit(dev_handle, data, sizeof(data), 100);  // Send the data to the device
+    TRACE_END("i2c_write_byte");
+    count_transfer(ret, t0);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2C write byte failed: %s", esp_err_to_name(ret));
+        LOG_LIMIT_E(TAG, "I2C write byte failed: %s", esp_err_to_name(ret));
     }
     return ret;
 }
@@ -132,9 +153,13 @@ esp_err_t DEV_I2C_Read_Byte(i2c_master_dev_handle_t dev_handle, uint8_t *value)
     if (value == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
+    int64_t t0 = esp_timer_get_time();
+    TRACE_BEGIN("i2c_read_byte");
     esp_err_t ret = i2c_master_receive(dev_handle, value, 1, 100);  // Read a byte from the device
+    TRACE_END("i2c_read_byte");
+    count_transfer(ret, t0);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2C read byte failed: %s", esp_err_to_name(ret));
+        LOG_LIMIT_E(TAG, "I2C read byte failed: %s", esp_err_to_name(ret));
     }
     return ret;  // Return status
 }
@@ -155,11 +180,15 @@ esp_err_t DEV_I2C_Read_Word(i2c_master_dev_handle_t dev_handle, uint8_t Cmd, uin
         return ESP_ERR_INVALID_ARG;
     }
     uint8_t data[2] = {Cmd};  // Create an array with the command byte
+    int64_t t0 = esp_timer_get_time();
+    TRACE_BEGIN("i2c_read_word");
     esp_err_t ret = i2c_master_transmit_receive(dev_handle, data, 1, data, 2, 100);  // Send command and receive two bytes
+    TRACE_END("i2c_read_word");
+    count_transfer(ret, t0);
     if (ret == ESP_OK) {
         *value = (data[1] << 8) | data[0];  // Combine the two bytes into a word (16-bit)
     } else {
-        ESP_LOGE(TAG, "I2C read word failed: %s", esp_err_to_name(ret));
+        LOG_LIMIT_E(TAG, "I2C read word failed: %s", esp_err_to_name(ret));
     }
     return ret;
 }
@@ -175,9 +204,13 @@ esp_err_t DEV_I2C_Read_Word(i2c_master_dev_handle_t dev_handle, uint8_t Cmd, uin
  */
 esp_err_t DEV_I2C_Write_Nbyte(i2c_master_dev_handle_t dev_handle, uint8_t *pdata, uint8_t len)
 {
+    int64_t t0 = esp_timer_get_time();
+    TRACE_BEGIN("i2c_write_n");
     esp_err_t ret = i2c_master_transmit(dev_handle, pdata, len, 100);  // Transmit the data block
+    TRACE_END("i2c_write_n");
+    count_transfer(ret, t0);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2C write %d bytes failed: %s", len, esp_err_to_name(ret));
+        LOG_LIMIT_E(TAG, "I2C write %d bytes failed: %s", len, esp_err_to_name(ret));
     }
     return ret;
 }
@@ -195,9 +228,13 @@ esp_err_t DEV_I2C_Write_Nbyte(i2c_master_dev_handle_t dev_handle, uint8_t *pdata
  */
 esp_err_t DEV_I2C_Read_Nbyte(i2c_master_dev_handle_t dev_handle, uint8_t Cmd, uint8_t *pdata, uint8_t len)
 {
+    int64_t t0 = esp_timer_get_time();
+    TRACE_BEGIN("i2c_read_n");
     esp_err_t ret = i2c_master_transmit_receive(dev_handle, &Cmd, 1, pdata, len, 100);  // Send command and receive data
+    TRACE_END("i2c_read_n");
+    count_transfer(ret, t0);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2C read %d bytes failed: %s", len, esp_err_to_name(ret));
+        LOG_LIMIT_E(TAG, "I2C read %d bytes failed: %s", len, esp_err_to_name(ret));
     }
     return ret;
 }
@@ -0,0 +1,51 @@
+#include "log_limit.h"
+
+#ifndef ESP_PLATFORM
+#include <time.h>
+#endif
+
+/*
+ * The bucket is kept as the time at which it will be full again (generic
+ * cell rate algorithm): each message pushes it one period later, and a
+ * message is refused when that would put it more than a burst of periods
+ * ahead of now. A time in the past means a full bucket.
+ */
+#define PERIOD_MS ((uint32_t)CONFIG_LOG_LIMIT_PERIOD_MS)
+#define WINDOW_MS (PERIOD_MS * (uint32_t)CONFIG_LOG_LIMIT_BURST)
+
+bool log_limit_take_at(log_limit_t *site, uint32_t now_ms,
+                       uint32_t *suppressed)
+{
+    uint32_t tat = atomic_load_explicit(&site->tat, memory_order_relaxed);
+    for (;;) {
+        uint32_t ahead = tat - now_ms;
+        if (tat == 0 || ahead > WINDOW_MS) {
+            ahead = 0; /* never used, or in the past, wrap included */
+        }
+        if (ahead + PERIOD_MS > WINDOW_MS) {
+            atomic_fetch_add_explicit(&site->suppressed, 1,
+                                      memory_order_relaxed);
+            return false;
+        }
+        if (atomic_compare_exchange_weak_explicit(
+                &site->tat, &tat, now_ms + ahead + PERIOD_MS,
+                memory_order_relaxed, memory_order_relaxed)) {
+            break;
+        }
+    }
+    *suppressed =
+        atomic_exchange_explicit(&site->suppressed, 0, memory_order_relaxed);
+    return true;
+}
+
+bool log_limit_take(log_limit_t *site, uint32_t *suppressed)
+{
+#ifdef ESP_PLATFORM
+    uint32_t now_ms = esp_log_timestamp();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint32_t now_ms = (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+#endif
+    return log_limit_take_at(site, now_ms, suppressed);
+}
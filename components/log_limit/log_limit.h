@@ -0,0 +1,92 @@
+#ifndef LOG_LIMIT_H
+#define LOG_LIMIT_H
+
+#include "esp_log.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Rate-limited ESP_LOGx for hot paths: driver errors that repeat on every
+ * call while a bus is flaky, per-frame traces.
+ *
+ * Each LOG_LIMIT_x call site owns a token bucket of CONFIG_LOG_LIMIT_BURST
+ * messages refilled at one per CONFIG_LOG_LIMIT_PERIOD_MS. A message beyond
+ * it is dropped and counted; the next one let through carries the count, e.g.
+ * "I2C read 6 bytes failed: ESP_ERR_TIMEOUT (+41 supprimés)". The bucket is
+ * a single atomic word, so call sites shared by several tasks never lock.
+ *
+ * A call site above LOG_LOCAL_LEVEL (CONFIG_LOG_MAXIMUM_LEVEL unless a file
+ * defines it before including esp_log.h) compiles to nothing, its bucket
+ * and arguments included; wrap any work done only for a message in
+ * `if (LOG_LIMIT_ENABLED(level))` to compile it out as well.
+ */
+
+#ifndef CONFIG_LOG_LIMIT_BURST
+#define CONFIG_LOG_LIMIT_BURST 5
+#endif
+#ifndef CONFIG_LOG_LIMIT_PERIOD_MS
+#define CONFIG_LOG_LIMIT_PERIOD_MS 1000
+#endif
+
+/** Token bucket of one call site; zero-initialised is full. */
+typedef struct {
+    _Atomic uint32_t tat;        /* ms at which the bucket is full again */
+    _Atomic uint32_t suppressed; /* messages dropped since the last one */
+} log_limit_t;
+
+/**
+ * @brief Take a token from @p site.
+ *
+ * @param[out] suppressed Messages dropped since the last one let through,
+ *                        when a token was taken.
+ * @return true when the message may be logged.
+ */
+bool log_limit_take(log_limit_t *site, uint32_t *suppressed);
+
+/** ::log_limit_take at @p now_ms, a millisecond clock that may wrap. */
+bool log_limit_take_at(log_limit_t *site, uint32_t now_ms,
+                       uint32_t *suppressed);
+
+#define LOG_LIMIT_ENABLED(level) (LOG_LOCAL_LEVEL >= (level))
+
+#define LOG_LIMIT_LEVEL(level, tag, format, ...)                               \
+    do {                                                                       \
+        if (LOG_LIMIT_ENABLED(level)) {                                        \
+            static log_limit_t log_limit_site_;                                \
+            uint32_t log_limit_n_;                                             \
+            if (log_limit_take(&log_limit_site_, &log_limit_n_)) {             \
+                if (log_limit_n_) {                                            \
+                    ESP_LOG_LEVEL_LOCAL(level, tag, format " (+%" PRIu32       \
+                                        " supprimés)", ##__VA_ARGS__,          \
+                                        log_limit_n_);                         \
+                } else {                                                       \
+                    ESP_LOG_LEVEL_LOCAL(level, tag, format, ##__VA_ARGS__);    \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
+    } while (0)
+
+#define LOG_LIMIT_E(tag, format, ...)                                          \
+    LOG_LIMIT_LEVEL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define LOG_LIMIT_W(tag, format, ...)                                          \
+    LOG_LIMIT_LEVEL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define LOG_LIMIT_I(tag, format, ...)                                          \
+    LOG_LIMIT_LEVEL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define LOG_LIMIT_D(tag, format, ...)                                          \
+    LOG_LIMIT_LEVEL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_LIMIT_H
@@ -0,0 +1,316 @@
+#include "log_codec.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_rom_crc.h"
+#define log_crc32(buf, len) esp_rom_crc32_le(0, (buf), (len))
+#else
+/* Same CRC as esp_rom_crc32_le(0, ...), for host tools */
+static uint32_t log_crc32(const uint8_t *buf, uint32_t len)
+{
+    uint32_t crc = 0xFFFFFFFFU;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+#endif
+
+#define HDR_MAGIC 0
+#define HDR_VERSION 2
+#define HDR_COLUMNS 3
+#define HDR_COUNT 4
+#define HDR_FIRST_TS 6
+#define HDR_CRC 10
+#define HDR_ENDS 14
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1U);
+}
+
+static inline unsigned varint_len(uint64_t v)
+{
+    unsigned n = 1;
+    while (v >= 0x80U) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static void put_varint(log_stream_t *s, uint64_t v)
+{
+    while (v >= 0x80U) {
+        s->buf[s->len++] = (uint8_t)(v | 0x80U);
+        v >>= 7;
+    }
+    s->buf[s->len++] = (uint8_t)v;
+}
+
+/* Tokens: a difference (bit 0 clear) or a run of zero differences */
+static inline uint64_t diff_token(int64_t d)
+{
+    return zigzag(d) << 1;
+}
+
+static inline uint64_t run_token(uint32_t run)
+{
+    return ((uint64_t)(run - 1U) << 1) | 1U;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+void log_encoder_init(log_encoder_t *enc)
+{
+    memset(enc, 0, sizeof(*enc));
+}
+
+/* Differences of @p s against the open block, the time one included */
+static void sample_diffs(const log_encoder_t *enc, const log_sample_t *s,
+                         int64_t *d)
+{
+    if (enc->count == 0) {
+        d[0] = 0; /* the header holds the first timestamp */
+    } else {
+        int64_t delta = (int64_t)s->timestamp - enc->last_ts;
+        d[0] = delta - enc->col[0].prev;
+    }
+    for (int c = 1; c < LOG_COLUMNS; ++c) {
+        d[c] = (int64_t)s->values[c - 1] - enc->col[c].prev;
+    }
+}
+
+/* Payload bytes added by differences @p d */
+static unsigned diffs_cost(const log_encoder_t *enc, const int64_t *d)
+{
+    unsigned cost = 0;
+    for (int c = 0; c < LOG_COLUMNS; ++c) {
+        const log_stream_t *s = &enc->col[c];
+        if (d[c] != 0) {
+            cost += varint_len(diff_token(d[c]));
+        } else {
+            /* Extend the open run, which is charged at its final length */
+            cost += varint_len(run_token(s->run + 1U));
+            cost -= s->run ? varint_len(run_token(s->run)) : 0U;
+        }
+    }
+    return cost;
+}
+
+bool log_encoder_add(log_encoder_t *enc, const log_sample_t *s, uint8_t *out)
+{
+    int64_t d[LOG_COLUMNS];
+    sample_diffs(enc, s, d);
+    unsigned cost = diffs_cost(enc, d);
+    bool closed = false;
+    if (enc->count == UINT16_MAX ||
+        (enc->count && enc->size + cost > LOG_BLOCK_PAYLOAD)) {
+        closed = log_encoder_flush(enc, out);
+        sample_diffs(enc, s, d);
+        cost = diffs_cost(enc, d);
+    }
+
+    for (int c = 0; c < LOG_COLUMNS; ++c) {
+        log_stream_t *st = &enc->col[c];
+        if (d[c] == 0) {
+            st->run++;
+            continue;
+        }
+        if (st->run) {
+            put_varint(st, run_token(st->run));
+            st->run = 0;
+        }
+        put_varint(st, diff_token(d[c]));
+    }
+    if (enc->count == 0) {
+        enc->first_ts = s->timestamp;
+    } else {
+        enc->col[0].prev = (int64_t)s->timestamp - enc->last_ts;
+    }
+    for (int c = 1; c < LOG_COLUMNS; ++c) {
+        enc->col[c].prev = s->values[c - 1];
+    }
+    enc->last_ts = s->timestamp;
+    enc->count++;
+    enc->size = (uint16_t)(enc->size + cost);
+    return closed;
+}
+
+/* Serialize the open block; the open runs are written to @p out only */
+static void encode_block(const log_encoder_t *enc, uint8_t *out)
+{
+    memset(out, 0, LOG_BLOCK_SIZE);
+    put_u16(out + HDR_MAGIC, LOG_BLOCK_MAGIC);
+    out[HDR_VERSION] = LOG_BLOCK_VERSION;
+    out[HDR_COLUMNS] = LOG_COLUMNS;
+    put_u16(out + HDR_COUNT, enc->count);
+    put_u32(out + HDR_FIRST_TS, enc->first_ts);
+    log_stream_t tail;
+    size_t pos = LOG_BLOCK_HEADER_SIZE;
+    for (int c = 0; c < LOG_COLUMNS; ++c) {
+        const log_stream_t *st = &enc->col[c];
+        memcpy(out + pos, st->buf, st->len);
+        pos += st->len;
+        if (st->run) {
+            tail.len = 0;
+            put_varint(&tail, run_token(st->run));
+            memcpy(out + pos, tail.buf, tail.len);
+            pos += tail.len;
+        }
+        out[HDR_ENDS + c] = (uint8_t)(pos - LOG_BLOCK_HEADER_SIZE);
+    }
+    put_u32(out + HDR_CRC, log_crc32(out, LOG_BLOCK_SIZE));
+}
+
+bool log_encoder_flush(log_encoder_t *enc, uint8_t *out)
+{
+    if (enc->count == 0) {
+        return false;
+    }
+    encode_block(enc, out);
+    log_encoder_init(enc);
+    return true;
+}
+
+bool log_encoder_peek(const log_encoder_t *enc, uint8_t *out)
+{
+    if (enc->count == 0) {
+        return false;
+    }
+    encode_block(enc, out);
+    return true;
+}
+
+bool log_block_open(log_block_reader_t *r, const uint8_t *block)
+{
+    if (get_u16(block + HDR_MAGIC) != LOG_BLOCK_MAGIC ||
+        block[HDR_VERSION] != LOG_BLOCK_VERSION ||
+        block[HDR_COLUMNS] != LOG_COLUMNS) {
+        return false;
+    }
+    uint8_t copy[LOG_BLOCK_SIZE];
+    memcpy(copy, block, sizeof(copy));
+    put_u32(copy + HDR_CRC, 0);
+    if (log_crc32(copy, sizeof(copy)) != get_u32(block + HDR_CRC)) {
+        return false;
+    }
+    memset(r, 0, sizeof(*r));
+    r->block = block;
+    uint16_t start = LOG_BLOCK_HEADER_SIZE;
+    for (int c = 0; c < LOG_COLUMNS; ++c) {
+        uint16_t end = (uint16_t)(LOG_BLOCK_HEADER_SIZE + block[HDR_ENDS + c]);
+        if (end < start || end > LOG_BLOCK_SIZE) {
+            return false;
+        }
+        r->pos[c] = start;
+        r->end[c] = end;
+        start = end;
+    }
+    r->prev_time = get_u32(block + HDR_FIRST_TS);
+    r->left = get_u16(block + HDR_COUNT);
+    return true;
+}
+
+static bool next_diff(log_block_reader_t *r, int c, int64_t *d)
+{
+    if (r->run[c]) {
+        r->run[c]--;
+        *d = 0;
+        return true;
+    }
+    uint64_t v = 0;
+    unsigned shift = 0;
+    for (;;) {
+        if (r->pos[c] >= r->end[c] || shift > 63) {
+            return false;
+        }
+        uint8_t b = r->block[r->pos[c]++];
+        v |= (uint64_t)(b & 0x7FU) << shift;
+        shift += 7;
+        if (!(b & 0x80U)) {
+            break;
+        }
+    }
+    if (v & 1U) {
+        r->run[c] = (uint32_t)(v >> 1); /* this zero excluded */
+        *d = 0;
+    } else {
+        *d = unzigzag(v >> 1);
+    }
+    return true;
+}
+
+bool log_block_next(log_block_reader_t *r, log_sample_t *out)
+{
+    if (r->left == 0) {
+        return false;
+    }
+    int64_t d[LOG_COLUMNS];
+    for (int c = 0; c < LOG_COLUMNS; ++c) {
+        if (!next_diff(r, c, &d[c])) {
+            r->left = 0;
+            return false;
+        }
+    }
+    r->prev[0] += d[0];
+    r->prev_time += r->prev[0];
+    out->timestamp = (uint32_t)r->prev_time;
+    for (int c = 1; c < LOG_COLUMNS; ++c) {
+        r->prev[c] += d[c];
+        out->values[c - 1] = (int32_t)r->prev[c];
+    }
+    r->left--;
+    return true;
+}
+
+uint16_t log_block_count(const uint8_t *block)
+{
+    return get_u16(block + HDR_COUNT);
+}
+
+uint32_t log_block_first_ts(const uint8_t *block)
+{
+    return get_u32(block + HDR_FIRST_TS);
+}
+
+int log_sample_format(const log_sample_t *s, char *buf, size_t size)
+{
+    return snprintf(buf, size,
+                    "%" PRIu32 ",%" PRId32 ",%" PRId32 ",%" PRId32 ",%" PRId32
+                    ",%" PRId32 ",%" PRId32 "\n",
+                    s->timestamp, s->values[LOG_COL_FAIM],
+                    s->values[LOG_COL_EAU], s->values[LOG_COL_TEMPERATURE],
+                    s->values[LOG_COL_HUMIDITE], s->values[LOG_COL_HUMEUR],
+                    s->values[LOG_COL_EVENT]);
+}
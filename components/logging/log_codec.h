@@ -0,0 +1,143 @@
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Columnar binary format of the reptile log.
+ *
+ * The log is a sequence of fixed-size blocks of ::LOG_BLOCK_SIZE bytes.
+ * Each block starts with a header (magic, version, sample count, timestamp
+ * of the first sample, CRC32, column offsets), followed by one stream per
+ * column. A stream holds, for each sample, the difference from the previous
+ * value of the column (difference of differences for the timestamp),
+ * zigzag-mapped and written as a varint. The lowest bit of each varint tells
+ * a single difference (0) from a run of zero differences (1), so a column
+ * that does not move costs one byte per block. Unused bytes at the end of a
+ * block are zero. The open block is written at each sync by
+ * ::log_encoder_peek and rewritten in place until it is full, so the last
+ * block of a file may hold fewer samples.
+ *
+ * Header layout, little-endian:
+ *   0  magic "RL" (u16)     2  version (u8)     3  columns (u8)
+ *   4  count (u16)          6  first timestamp (u32)
+ *  10  CRC32 of the block, this field taken as zero (u32)
+ *  14  end offset of streams 0 to LOG_COLUMNS - 1 (u8 each)
+ *
+ * This file has no ESP-IDF dependency so that host tools (tools/log2csv.c)
+ * read the log with the same code as the firmware.
+ */
+
+#define LOG_BLOCK_SIZE 128
+#define LOG_BLOCK_MAGIC 0x4C52 /* "RL" */
+#define LOG_BLOCK_VERSION 1
+
+/* Columns after the timestamp, in CSV order */
+typedef enum {
+    LOG_COL_FAIM,
+    LOG_COL_EAU,
+    LOG_COL_TEMPERATURE,
+    LOG_COL_HUMIDITE,
+    LOG_COL_HUMEUR,
+    LOG_COL_EVENT,
+    LOG_VALUES,
+} log_column_t;
+
+#define LOG_COLUMNS (LOG_VALUES + 1) /* timestamp included */
+#define LOG_BLOCK_HEADER_SIZE (14 + LOG_COLUMNS)
+#define LOG_BLOCK_PAYLOAD (LOG_BLOCK_SIZE - LOG_BLOCK_HEADER_SIZE)
+
+/** CSV header matching ::log_sample_format */
+#define LOG_CSV_HEADER "timestamp,faim,eau,temperature,humidite,humeur,event\n"
+
+typedef struct {
+    uint32_t timestamp; /* seconds, Unix time */
+    int32_t values[LOG_VALUES];
+} log_sample_t;
+
+/** Per-column state of the block being filled */
+typedef struct {
+    int64_t prev;       /* previous value; previous difference for the time */
+    uint32_t run;       /* zero differences not yet written */
+    uint16_t len;       /* bytes written to buf */
+    uint8_t buf[LOG_BLOCK_PAYLOAD];
+} log_stream_t;
+
+typedef struct {
+    log_stream_t col[LOG_COLUMNS];
+    uint32_t first_ts;
+    uint32_t last_ts;
+    uint16_t count;
+    uint16_t size; /* payload bytes once the open runs are written */
+} log_encoder_t;
+
+typedef struct {
+    const uint8_t *block;
+    uint16_t pos[LOG_COLUMNS];
+    uint16_t end[LOG_COLUMNS];
+    uint32_t run[LOG_COLUMNS]; /* zero differences left in the current run */
+    int64_t prev[LOG_COLUMNS];
+    int64_t prev_time;
+    uint16_t left;             /* samples not yet read */
+} log_block_reader_t;
+
+void log_encoder_init(log_encoder_t *enc);
+
+/**
+ * @brief Add a sample to the open block.
+ *
+ * @param out Receives the previous block, ::LOG_BLOCK_SIZE bytes, when the
+ *            sample does not fit in it; the sample then opens a new block.
+ * @return true when @p out was filled.
+ */
+bool log_encoder_add(log_encoder_t *enc, const log_sample_t *s, uint8_t *out);
+
+/**
+ * @brief Close the open block early, e.g. at the end of a file.
+ *
+ * @return true when @p out was filled, false if the block was empty.
+ */
+bool log_encoder_flush(log_encoder_t *enc, uint8_t *out);
+
+/**
+ * @brief Serialize the open block without closing it, to be written in place
+ * of its previous copy; later samples keep filling it.
+ *
+ * @return true when @p out was filled, false if the block is empty.
+ */
+bool log_encoder_peek(const log_encoder_t *enc, uint8_t *out);
+
+/** Samples in the open block. */
+static inline uint16_t log_encoder_count(const log_encoder_t *enc)
+{
+    return enc->count;
+}
+
+/**
+ * @brief Check a block (magic, version, CRC) and prepare to read it.
+ *
+ * @return false for an unused (all zero) or damaged block.
+ */
+bool log_block_open(log_block_reader_t *r, const uint8_t *block);
+
+/** Next sample of the block, false once all were read. */
+bool log_block_next(log_block_reader_t *r, log_sample_t *out);
+
+/** Sample count and first timestamp of a block already checked. */
+uint16_t log_block_count(const uint8_t *block);
+uint32_t log_block_first_ts(const uint8_t *block);
+
+/** Format @p s as a CSV line; returns its length as snprintf. */
+int log_sample_format(const log_sample_t *s, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_CODEC_H
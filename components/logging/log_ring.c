@@ -0,0 +1,133 @@
+#include "log_ring.h"
+#include <string.h>
+
+/*
+ * Record layout: a 32-bit header, then the payload, padded to 4 bytes. The
+ * header is zero until the producer publishes it; a padding record fills the
+ * end of the buffer when the next record does not fit before the wrap. The
+ * consumer zeroes every byte it releases, so that any aligned word a producer
+ * reserves reads as an unpublished header.
+ */
+#define HDR_SIZE 4U
+#define HDR_READY 0x80000000U
+#define HDR_PAD 0x40000000U
+#define HDR_LEN_MASK 0x00FFFFFFU
+
+static inline uint32_t rec_size(uint32_t len)
+{
+    return (HDR_SIZE + len + 3U) & ~3U;
+}
+
+static inline uint32_t *hdr_at(const log_ring_t *ring, uint32_t pos)
+{
+    return (uint32_t *)(ring->buf + (pos & (ring->size - 1U)));
+}
+
+esp_err_t log_ring_init(log_ring_t *ring, void *buf, size_t size)
+{
+    if (!ring || !buf || size < 64 || ((uintptr_t)buf & 3U)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t pow2 = 64;
+    while (pow2 <= size / 2 && pow2 < 0x01000000U) {
+        pow2 <<= 1;
+    }
+    ring->buf = buf;
+    ring->size = pow2;
+    memset(ring->buf, 0, pow2);
+    atomic_init(&ring->reserve, 0);
+    atomic_init(&ring->tail, 0);
+    ring->read = 0;
+    atomic_init(&ring->records, 0);
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->peak, 0);
+    return ESP_OK;
+}
+
+esp_err_t log_ring_push(log_ring_t *ring, const void *data, size_t len)
+{
+    if (len == 0 || len > ring->size / 4) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint32_t need = rec_size((uint32_t)len);
+    uint32_t pos = atomic_load_explicit(&ring->reserve, memory_order_relaxed);
+    uint32_t pad;
+    uint32_t used;
+    for (;;) {
+        uint32_t room = ring->size - (pos & (ring->size - 1U));
+        pad = (room < need) ? room : 0;
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        used = pos + pad + need - tail;
+        if (used > ring->size) {
+            /* pos may be older than tail: full only if nobody reserved since */
+            uint32_t now = atomic_load_explicit(&ring->reserve, memory_order_relaxed);
+            if (now != pos) {
+                pos = now;
+                continue;
+            }
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return ESP_ERR_NO_MEM;
+        }
+        if (atomic_compare_exchange_weak_explicit(&ring->reserve, &pos,
+                                                  pos + pad + need,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed)) {
+            break;
+        }
+    }
+    if (pad) {
+        __atomic_store_n(hdr_at(ring, pos), HDR_READY | HDR_PAD | pad,
+                         __ATOMIC_RELEASE);
+        pos += pad;
+    }
+    uint32_t *hdr = hdr_at(ring, pos);
+    memcpy(hdr + 1, data, len);
+    __atomic_store_n(hdr, HDR_READY | (uint32_t)len, __ATOMIC_RELEASE);
+
+    atomic_fetch_add_explicit(&ring->records, 1, memory_order_relaxed);
+    uint32_t peak = atomic_load_explicit(&ring->peak, memory_order_relaxed);
+    while (used > peak &&
+           !atomic_compare_exchange_weak_explicit(&ring->peak, &peak, used,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+    return ESP_OK;
+}
+
+size_t log_ring_pop(log_ring_t *ring, void *dst, size_t max)
+{
+    uint8_t *out = dst;
+    size_t n = 0;
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while (n < max) {
+        uint32_t *hdr = hdr_at(ring, tail);
+        uint32_t h = __atomic_load_n(hdr, __ATOMIC_ACQUIRE);
+        if (!(h & HDR_READY)) {
+            break; /* empty, or reserved and not yet published */
+        }
+        uint32_t len = h & HDR_LEN_MASK;
+        uint32_t size = len;
+        if (!(h & HDR_PAD)) {
+            size_t take = len - ring->read;
+            take = (take < max - n) ? take : max - n;
+            memcpy(out + n, (const uint8_t *)(hdr + 1) + ring->read, take);
+            n += take;
+            ring->read += (uint32_t)take;
+            if (ring->read < len) {
+                break;
+            }
+            ring->read = 0;
+            size = rec_size(len);
+        }
+        memset(hdr, 0, size);
+        tail += size;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    return n;
+}
+
+uint32_t log_ring_used(const log_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->reserve, memory_order_relaxed) -
+           atomic_load_explicit(&ring->tail, memory_order_relaxed);
+}
@@ -0,0 +1,72 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include "esp_err.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Lock-free multi-producer, single-consumer ring of variable-size records.
+ *
+ * Producers reserve room with a compare-and-swap on the reserve counter,
+ * copy their record and publish it by storing its header; they never wait on
+ * each other nor on the consumer, and a record that does not fit is dropped
+ * and counted. The consumer reads the published records in reservation order
+ * as one byte stream, possibly splitting a record across two pops, and
+ * releases their room once read.
+ *
+ * Only the counters need atomic read-modify-write, so the structure itself
+ * must sit in internal RAM; the record storage may be in PSRAM, where it only
+ * sees aligned loads and stores.
+ */
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t size;              /* power of two */
+    _Atomic uint32_t reserve;   /* bytes ever reserved, producers */
+    _Atomic uint32_t tail;      /* bytes ever released, consumer */
+    uint32_t read;              /* bytes of the oldest record already popped */
+    _Atomic uint32_t records;   /* records pushed */
+    _Atomic uint32_t dropped;   /* records refused, ring full */
+    _Atomic uint32_t peak;      /* highest use, bytes, headers included */
+} log_ring_t;
+
+/**
+ * @brief Use @p size bytes at @p buf (4-byte aligned), rounded down to a
+ * power of two.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG below 64 bytes.
+ */
+esp_err_t log_ring_init(log_ring_t *ring, void *buf, size_t size);
+
+/**
+ * @brief Append a record; any task, never blocks.
+ *
+ * @return ESP_OK, ESP_ERR_NO_MEM when full (record dropped),
+ *         ESP_ERR_INVALID_SIZE for an empty record or above a quarter of
+ *         the ring.
+ */
+esp_err_t log_ring_push(log_ring_t *ring, const void *data, size_t len);
+
+/**
+ * @brief Copy up to @p max bytes of published records into @p dst, oldest
+ * first, and release what was fully read. Consumer only.
+ *
+ * @return Bytes copied; fewer than @p max when the ring runs dry or the
+ *         oldest record is still being written.
+ */
+size_t log_ring_pop(log_ring_t *ring, void *dst, size_t max);
+
+/** Bytes reserved and not yet released, headers included. */
+uint32_t log_ring_used(const log_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_RING_H
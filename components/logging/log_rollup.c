@@ -0,0 +1,317 @@
+#include "log_rollup.h"
+#include "log_segment.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define READ_CHUNK_RECORDS 16 /* one 512-byte sector per read */
+
+static const uint32_t k_span[LOG_ROLLUP_LEVELS] = {60U, 3600U, 86400U};
+static const char *const k_ext[LOG_ROLLUP_LEVELS] = {"min", "hr", "day"};
+
+/* Sample columns aggregated, by log_rollup_field_t */
+static const log_column_t k_column[LOG_ROLLUP_FIELDS] = {
+    LOG_COL_TEMPERATURE,
+    LOG_COL_HUMIDITE,
+    LOG_COL_FAIM,
+    LOG_COL_EAU,
+    LOG_COL_HUMEUR,
+};
+
+uint32_t log_rollup_span(log_rollup_level_t level)
+{
+    return k_span[level];
+}
+
+log_column_t log_rollup_column(log_rollup_field_t f)
+{
+    return k_column[f];
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static int16_t clamp16(int64_t v)
+{
+    return (int16_t)((v < INT16_MIN) ? INT16_MIN : (v > INT16_MAX) ? INT16_MAX : v);
+}
+
+static int8_t clamp8(int32_t v)
+{
+    return (int8_t)((v < INT8_MIN) ? INT8_MIN : (v > INT8_MAX) ? INT8_MAX : v);
+}
+
+/* a / b rounded to nearest, b > 0 */
+static int64_t div_round(int64_t a, int64_t b)
+{
+    return (a >= 0) ? (a + b / 2) / b : -((-a + b / 2) / b);
+}
+
+/* Start of the UTC year holding @p ts, from 1970 */
+static uint32_t year_of(uint32_t ts, uint32_t *start)
+{
+    time_t t = (time_t)ts;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    uint32_t y = (uint32_t)tm.tm_year + 1900U;
+    uint32_t days = 365U * (y - 1970U) + (y - 1969U) / 4U - (y - 1901U) / 100U +
+                    (y - 1601U) / 400U;
+    *start = days * 86400U;
+    return y;
+}
+
+/*
+ * File holding the bucket of @p level that starts at @p start: its id (day
+ * or year), the slot of the bucket and the start of the next file.
+ */
+static uint32_t locate(log_rollup_level_t level, uint32_t start,
+                       uint32_t *slot, uint32_t *next)
+{
+    if (level == LOG_ROLLUP_MINUTE) {
+        uint32_t day = log_segment_of(start);
+        *slot = (start % LOG_SEGMENT_S) / k_span[level];
+        *next = (day + 1U) * LOG_SEGMENT_S;
+        return day;
+    }
+    uint32_t year_start;
+    uint32_t year = year_of(start, &year_start);
+    *slot = (start - year_start) / k_span[level];
+    year_of(year_start + 366U * 86400U, next); /* 2 January at the latest */
+    return year;
+}
+
+static void rollup_path(log_rollup_level_t level, uint32_t id, char *buf,
+                        size_t size)
+{
+    if (level == LOG_ROLLUP_MINUTE) {
+        log_segment_path(id, k_ext[level], buf, size);
+    } else {
+        snprintf(buf, size, "%s/%04u.%s", LOG_SEGMENT_DIR, (unsigned)id,
+                 k_ext[level]);
+    }
+}
+
+static void encode(const log_bucket_t *b, uint8_t *rec)
+{
+    memset(rec, 0, LOG_ROLLUP_RECORD_SIZE);
+    put_u32(rec, b->start);
+    put_u32(rec + 4, b->count);
+    for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+        uint8_t *p = rec + 8 + 4 * f;
+        int64_t tenths = div_round(b->sum[f] * 10, (int64_t)b->count);
+        p[0] = (uint8_t)clamp8(b->min[f]);
+        p[1] = (uint8_t)clamp8(b->max[f]);
+        put_u16(p + 2, (uint16_t)clamp16(tenths));
+    }
+    put_u32(rec + 8 + 4 * LOG_ROLLUP_FIELDS, LOG_ROLLUP_TAG);
+}
+
+static bool decode(const uint8_t *rec, log_rollup_level_t level,
+                   uint32_t start, log_bucket_t *b)
+{
+    if (get_u32(rec) != start || get_u32(rec + 4) == 0) {
+        return false; /* unused or stale slot */
+    }
+    if (get_u32(rec + 8 + 4 * LOG_ROLLUP_FIELDS) != LOG_ROLLUP_TAG) {
+        return false; /* older layout */
+    }
+    memset(b, 0, sizeof(*b));
+    b->start = start;
+    b->count = get_u32(rec + 4);
+    b->level = (uint8_t)level;
+    for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+        const uint8_t *p = rec + 8 + 4 * f;
+        b->min[f] = (int8_t)p[0];
+        b->max[f] = (int8_t)p[1];
+        int64_t tenths = (int16_t)get_u16(p + 2);
+        b->sum[f] = div_round(tenths * (int64_t)b->count, 10);
+    }
+    return true;
+}
+
+void log_rollup_init(log_rollup_t *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+size_t log_rollup_add(log_rollup_t *r, const log_sample_t *s,
+                      log_bucket_t *closed)
+{
+    size_t n = 0;
+    for (int l = 0; l < LOG_ROLLUP_LEVELS; ++l) {
+        log_bucket_t *b = &r->open[l];
+        uint32_t start = s->timestamp - s->timestamp % k_span[l];
+        if (b->count && start > b->start) {
+            closed[n++] = *b;
+            b->count = 0;
+        }
+        if (b->count == 0) {
+            b->start = start;
+            b->level = (uint8_t)l;
+            for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+                b->min[f] = INT32_MAX;
+                b->max[f] = INT32_MIN;
+                b->sum[f] = 0;
+            }
+        }
+        for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+            int32_t v = s->values[k_column[f]];
+            b->min[f] = (v < b->min[f]) ? v : b->min[f];
+            b->max[f] = (v > b->max[f]) ? v : b->max[f];
+            b->sum[f] += v;
+        }
+        b->count++;
+    }
+    return n;
+}
+
+const log_bucket_t *log_rollup_open(const log_rollup_t *r,
+                                    log_rollup_level_t level)
+{
+    return r->open[level].count ? &r->open[level] : NULL;
+}
+
+void log_rollup_resume(log_rollup_t *r, const log_bucket_t *b)
+{
+    r->open[b->level] = *b;
+}
+
+static esp_err_t open_rw(const char *path, storage_file_t **out)
+{
+    esp_err_t err = storage_open(path, STORAGE_RDWR, out);
+    if (err == ESP_ERR_NOT_FOUND) {
+        err = storage_mkdir(LOG_SEGMENT_DIR);
+        if (err == ESP_OK) {
+            err = storage_open(path, STORAGE_CREATE, out);
+        }
+    }
+    return err;
+}
+
+esp_err_t log_rollup_store(log_rollup_files_t *f, const log_bucket_t *b)
+{
+    log_rollup_level_t level = (log_rollup_level_t)b->level;
+    uint32_t slot, next;
+    uint32_t id = locate(level, b->start, &slot, &next);
+    if (f->file[level] && f->id[level] != id) {
+        storage_close(f->file[level]);
+        f->file[level] = NULL;
+    }
+    if (!f->file[level]) {
+        char path[48];
+        rollup_path(level, id, path, sizeof(path));
+        esp_err_t err = open_rw(path, &f->file[level]);
+        if (err != ESP_OK) {
+            f->file[level] = NULL;
+            return err;
+        }
+        f->id[level] = id;
+    }
+    uint8_t rec[LOG_ROLLUP_RECORD_SIZE];
+    encode(b, rec);
+    return storage_pwrite(f->file[level], rec, sizeof(rec),
+                          slot * LOG_ROLLUP_RECORD_SIZE);
+}
+
+esp_err_t log_rollup_sync(log_rollup_files_t *f)
+{
+    for (int l = 0; l < LOG_ROLLUP_LEVELS; ++l) {
+        if (f->file[l] && storage_fsync(f->file[l]) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t log_rollup_close(log_rollup_files_t *f)
+{
+    esp_err_t err = ESP_OK;
+    for (int l = 0; l < LOG_ROLLUP_LEVELS; ++l) {
+        if (f->file[l] && storage_close(f->file[l]) != ESP_OK) {
+            err = ESP_FAIL;
+        }
+        f->file[l] = NULL;
+    }
+    return err;
+}
+
+esp_err_t log_rollup_load(log_rollup_level_t level, uint32_t start,
+                          log_bucket_t *out)
+{
+    size_t n = 0;
+    esp_err_t err = log_rollup_read(level, start, start, out, 1, &n);
+    if (err == ESP_OK && n == 0) {
+        err = ESP_ERR_NOT_FOUND;
+    }
+    return err;
+}
+
+esp_err_t log_rollup_read(log_rollup_level_t level, uint32_t t0, uint32_t t1,
+                          log_bucket_t *out, size_t max, size_t *n)
+{
+    *n = 0;
+    if (t1 < t0 || level >= LOG_ROLLUP_LEVELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t span = k_span[level];
+    uint64_t t = (uint64_t)t0 + (span - t0 % span) % span;
+    while (t <= t1 && *n < max) {
+        uint32_t slot, next;
+        uint32_t id = locate(level, (uint32_t)t, &slot, &next);
+        char path[48];
+        rollup_path(level, id, path, sizeof(path));
+        storage_file_t *f;
+        esp_err_t err = storage_open(path, STORAGE_READ, &f);
+        if (err == ESP_ERR_NOT_FOUND) {
+            t = next;
+            continue;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        /* Slots of this file from t to t1, a sector at a time */
+        while (err == ESP_OK && t < next && t <= t1 && *n < max) {
+            uint8_t buf[READ_CHUNK_RECORDS * LOG_ROLLUP_RECORD_SIZE];
+            size_t got = 0;
+            err = storage_pread(f, buf, sizeof(buf),
+                                slot * LOG_ROLLUP_RECORD_SIZE, &got);
+            if (err != ESP_OK || got < LOG_ROLLUP_RECORD_SIZE) {
+                t = next; /* past the last slot written */
+                break;
+            }
+            for (size_t i = 0; i + LOG_ROLLUP_RECORD_SIZE <= got &&
+                               t < next && t <= t1 && *n < max;
+                 i += LOG_ROLLUP_RECORD_SIZE) {
+                if (decode(buf + i, level, (uint32_t)t, &out[*n])) {
+                    (*n)++;
+                }
+                slot++;
+                t += span;
+            }
+        }
+        storage_close(f);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
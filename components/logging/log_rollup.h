@@ -0,0 +1,145 @@
+#ifndef LOG_ROLLUP_H
+#define LOG_ROLLUP_H
+
+#include "esp_err.h"
+#include "log_codec.h"
+#include "storage.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Minute, hour and day aggregates of the reptile log.
+ *
+ * The logging task passes every sample to ::log_rollup_add, which updates
+ * the open bucket of each level (count, min, max, sum of temperature,
+ * humidity, hunger, water and mood) in constant time and hands back the
+ * buckets the sample closes. Buckets are stored as 32-byte records at a slot
+ * given by their start time, so that one can be written again in place while
+ * it is open and read without searching:
+ *
+ *   minute  LOG_SEGMENT_DIR/YYYYMMDD.min  slot = minute of the day
+ *   hour    LOG_SEGMENT_DIR/YYYY.hr       slot = hour of the year
+ *   day     LOG_SEGMENT_DIR/YYYY.day      slot = day of the year
+ *
+ * Record, little-endian: start (u32), count (u32), then per field min (i8),
+ * max (i8) and mean in tenths (i16), then the tag (u32) "RLP" followed by
+ * the layout version; the stats all fit in a signed byte. An unused slot is
+ * all zero; a record whose start does not match its slot, or without the
+ * tag of this version, is ignored. Version 1 records (four fields, i16 min
+ * and max, no tag) cannot hold the mood and are dropped that way: their
+ * slot is written again in the new layout. Records never straddle a
+ * 512-byte sector. A year of days is 12 KB, read at once by
+ * ::log_rollup_read.
+ */
+
+#define LOG_ROLLUP_RECORD_SIZE 32
+#define LOG_ROLLUP_VERSION 2
+/* Byte 1 ('L') is never the high byte of a version 1 stat, 0x00 or 0xFF */
+#define LOG_ROLLUP_TAG (0x504C52U | ((uint32_t)LOG_ROLLUP_VERSION << 24))
+
+typedef enum {
+    LOG_ROLLUP_MINUTE,
+    LOG_ROLLUP_HOUR,
+    LOG_ROLLUP_DAY,
+    LOG_ROLLUP_LEVELS,
+} log_rollup_level_t;
+
+typedef enum {
+    LOG_ROLLUP_TEMPERATURE,
+    LOG_ROLLUP_HUMIDITE,
+    LOG_ROLLUP_FAIM,
+    LOG_ROLLUP_EAU,
+    LOG_ROLLUP_HUMEUR,
+    LOG_ROLLUP_FIELDS,
+} log_rollup_field_t;
+
+/** Aggregates of one bucket; also the accumulator of an open bucket */
+typedef struct {
+    uint32_t start; /* Unix time of the bucket start */
+    uint32_t count; /* samples, 0 for an empty bucket */
+    uint8_t level;  /* log_rollup_level_t */
+    int32_t min[LOG_ROLLUP_FIELDS];
+    int32_t max[LOG_ROLLUP_FIELDS];
+    int64_t sum[LOG_ROLLUP_FIELDS];
+} log_bucket_t;
+
+typedef struct {
+    log_bucket_t open[LOG_ROLLUP_LEVELS];
+} log_rollup_t;
+
+/** Open files of the writer, one per level */
+typedef struct {
+    storage_file_t *file[LOG_ROLLUP_LEVELS];
+    uint32_t id[LOG_ROLLUP_LEVELS]; /* day or year of the open file */
+} log_rollup_files_t;
+
+/** Bucket length of @p level in seconds. */
+uint32_t log_rollup_span(log_rollup_level_t level);
+
+/** Sample column aggregated in field @p f. */
+log_column_t log_rollup_column(log_rollup_field_t f);
+
+/** Mean of field @p f of a bucket that holds samples. */
+static inline int32_t log_bucket_mean(const log_bucket_t *b,
+                                      log_rollup_field_t f)
+{
+    return (int32_t)(b->sum[f] / (int64_t)b->count);
+}
+
+void log_rollup_init(log_rollup_t *r);
+
+/**
+ * @brief Add a sample to the open bucket of each level.
+ *
+ * A sample outside an open bucket closes it and opens the next one; samples
+ * going back in time are counted in the bucket they find open.
+ *
+ * @param closed Receives the closed buckets, room for ::LOG_ROLLUP_LEVELS.
+ * @return Number of buckets written to @p closed.
+ */
+size_t log_rollup_add(log_rollup_t *r, const log_sample_t *s,
+                      log_bucket_t *closed);
+
+/** Open bucket of @p level, NULL before its first sample. */
+const log_bucket_t *log_rollup_open(const log_rollup_t *r,
+                                    log_rollup_level_t level);
+
+/**
+ * @brief Continue a bucket stored before a restart: it becomes the open
+ * bucket of its level, so that later samples add to it.
+ */
+void log_rollup_resume(log_rollup_t *r, const log_bucket_t *b);
+
+/** Write @p b at its slot, opening the file of its level if needed. */
+esp_err_t log_rollup_store(log_rollup_files_t *f, const log_bucket_t *b);
+esp_err_t log_rollup_sync(log_rollup_files_t *f);
+/** Close the files; fails like storage_close once the card is gone. */
+esp_err_t log_rollup_close(log_rollup_files_t *f);
+
+/**
+ * @brief Read the stored bucket of @p level starting at @p start.
+ *
+ * @return ESP_ERR_NOT_FOUND when the slot is empty.
+ */
+esp_err_t log_rollup_load(log_rollup_level_t level, uint32_t start,
+                          log_bucket_t *out);
+
+/**
+ * @brief Read the stored buckets of @p level starting in [t0, t1], in time
+ * order; empty slots are skipped.
+ *
+ * @param n Buckets written to @p out, at most @p max.
+ */
+esp_err_t log_rollup_read(log_rollup_level_t level, uint32_t t0, uint32_t t1,
+                          log_bucket_t *out, size_t max, size_t *n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_ROLLUP_H
@@ -0,0 +1,236 @@
+#include "log_segment.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define QUERY_CHUNK_BLOCKS 4 /* one 512-byte sector per read */
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int log_segment_path(uint32_t seg, const char *ext, char *buf, size_t size)
+{
+    time_t t = (time_t)seg * LOG_SEGMENT_S;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    /* 8.3 names: FATFS may be built without long file names */
+    return snprintf(buf, size, "%s/%04d%02d%02d.%s", LOG_SEGMENT_DIR,
+                    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, ext);
+}
+
+esp_err_t log_segment_open(uint32_t seg, const char *ext,
+                           storage_file_t **out)
+{
+    char path[48];
+    log_segment_path(seg, ext, path, sizeof(path));
+    /* Not STORAGE_APPEND: the open block is rewritten at its offset */
+    esp_err_t err = storage_open(path, STORAGE_RDWR, out);
+    if (err == ESP_ERR_NOT_FOUND) {
+        err = storage_mkdir(LOG_SEGMENT_DIR);
+        if (err == ESP_OK) {
+            err = storage_open(path, STORAGE_CREATE, out);
+        }
+    }
+    return err;
+}
+
+esp_err_t log_index_open(log_index_t *ix, uint32_t seg)
+{
+    memset(ix, 0, sizeof(*ix));
+    esp_err_t err = log_segment_open(seg, "idx", &ix->file);
+    if (err != ESP_OK) {
+        return err;
+    }
+    uint32_t size = 0;
+    err = storage_size(ix->file, &size);
+    /* A torn last entry is overwritten by the next one */
+    ix->entries = size / LOG_INDEX_ENTRY_SIZE;
+    if (err == ESP_OK && ix->entries) {
+        uint8_t e[LOG_INDEX_ENTRY_SIZE];
+        err = storage_pread(ix->file, e, sizeof(e),
+                            (ix->entries - 1U) * LOG_INDEX_ENTRY_SIZE, NULL);
+        ix->next_block = get_u32(e + 4) + 1U;
+    }
+    if (err != ESP_OK) {
+        log_index_close(ix);
+    }
+    return err;
+}
+
+esp_err_t log_index_add(log_index_t *ix, const uint8_t *blocks,
+                        uint32_t first, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t b = first + (uint32_t)i;
+        if (b < ix->next_block || b % LOG_INDEX_STRIDE) {
+            continue;
+        }
+        uint8_t e[LOG_INDEX_ENTRY_SIZE];
+        put_u32(e, log_block_first_ts(blocks + i * LOG_BLOCK_SIZE));
+        put_u32(e + 4, b);
+        esp_err_t err = storage_pwrite(ix->file, e, sizeof(e),
+                                       ix->entries * LOG_INDEX_ENTRY_SIZE);
+        if (err != ESP_OK) {
+            return err;
+        }
+        ix->entries++;
+        ix->next_block = b + 1U;
+    }
+    return ESP_OK;
+}
+
+esp_err_t log_index_close(log_index_t *ix)
+{
+    esp_err_t err = ESP_OK;
+    if (ix->file) {
+        err = storage_close(ix->file);
+        ix->file = NULL;
+    }
+    return err;
+}
+
+esp_err_t log_segment_last(uint32_t seg, uint32_t *ts)
+{
+    char path[48];
+    log_segment_path(seg, "bin", path, sizeof(path));
+    storage_file_t *f;
+    esp_err_t err = storage_open(path, STORAGE_READ, &f);
+    if (err != ESP_OK) {
+        return err;
+    }
+    uint32_t size = 0;
+    err = storage_size(f, &size);
+    bool found = false;
+    /* Unused or torn blocks at the end are skipped */
+    for (uint32_t b = size / LOG_BLOCK_SIZE; err == ESP_OK && !found && b--;) {
+        uint8_t block[LOG_BLOCK_SIZE];
+        err = storage_pread(f, block, sizeof(block), b * LOG_BLOCK_SIZE, NULL);
+        log_block_reader_t r;
+        if (err != ESP_OK || !log_block_open(&r, block)) {
+            continue;
+        }
+        log_sample_t s;
+        while (log_block_next(&r, &s)) {
+            *ts = s.timestamp;
+            found = true;
+        }
+    }
+    storage_close(f);
+    return (err == ESP_OK && !found) ? ESP_ERR_NOT_FOUND : err;
+}
+
+/*
+ * First block of segment @p seg to read for samples from @p t0: that of the
+ * last index entry before t0, among the @p blocks of the segment file.
+ */
+static esp_err_t index_start(uint32_t seg, uint32_t t0, uint32_t blocks,
+                             uint32_t *start)
+{
+    *start = 0;
+    char path[48];
+    log_segment_path(seg, "idx", path, sizeof(path));
+    storage_file_t *f;
+    esp_err_t err = storage_open(path, STORAGE_READ, &f);
+    if (err == ESP_ERR_NOT_FOUND) {
+        return ESP_OK; /* scan the whole segment */
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    uint32_t size = 0;
+    err = storage_size(f, &size);
+    /* Entries grow in time and block; those past the file are ignored */
+    uint32_t lo = 0;
+    uint32_t hi = size / LOG_INDEX_ENTRY_SIZE;
+    while (err == ESP_OK && lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2U;
+        uint8_t e[LOG_INDEX_ENTRY_SIZE];
+        err = storage_pread(f, e, sizeof(e), mid * LOG_INDEX_ENTRY_SIZE, NULL);
+        if (err == ESP_OK && get_u32(e) < t0 && get_u32(e + 4) < blocks) {
+            *start = get_u32(e + 4);
+            lo = mid + 1U;
+        } else {
+            hi = mid;
+        }
+    }
+    storage_close(f);
+    return err;
+}
+
+/* Query one segment; *more is cleared once past t1 or stopped by @p cb */
+static esp_err_t query_segment(uint32_t seg, uint32_t t0, uint32_t t1,
+                               log_query_cb_t cb, void *ctx, bool *more)
+{
+    char path[48];
+    log_segment_path(seg, "bin", path, sizeof(path));
+    storage_file_t *f;
+    esp_err_t err = storage_open(path, STORAGE_READ, &f);
+    if (err == ESP_ERR_NOT_FOUND) {
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    uint32_t size = 0;
+    uint32_t b = 0;
+    err = storage_size(f, &size);
+    uint32_t blocks = size / LOG_BLOCK_SIZE;
+    if (err == ESP_OK) {
+        err = index_start(seg, t0, blocks, &b);
+    }
+
+    uint8_t buf[QUERY_CHUNK_BLOCKS * LOG_BLOCK_SIZE];
+    while (err == ESP_OK && *more && b < blocks) {
+        uint32_t n = blocks - b;
+        if (n > QUERY_CHUNK_BLOCKS) {
+            n = QUERY_CHUNK_BLOCKS;
+        }
+        err = storage_pread(f, buf, n * LOG_BLOCK_SIZE, b * LOG_BLOCK_SIZE,
+                            NULL);
+        for (uint32_t i = 0; err == ESP_OK && *more && i < n; ++i) {
+            const uint8_t *block = buf + i * LOG_BLOCK_SIZE;
+            log_block_reader_t r;
+            if (!log_block_open(&r, block)) {
+                continue; /* unused or torn */
+            }
+            log_sample_t s;
+            while (*more && log_block_next(&r, &s)) {
+                if (s.timestamp > t1) {
+                    *more = false;
+                } else if (s.timestamp >= t0 && !cb(&s, ctx)) {
+                    *more = false;
+                }
+            }
+        }
+        b += n;
+    }
+    storage_close(f);
+    return err;
+}
+
+esp_err_t log_query(uint32_t t0, uint32_t t1, log_query_cb_t cb, void *ctx)
+{
+    if (t1 < t0 || !cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool more = true;
+    esp_err_t err = ESP_OK;
+    uint32_t last = log_segment_of(t1);
+    for (uint32_t seg = log_segment_of(t0); err == ESP_OK && more; ++seg) {
+        err = query_segment(seg, t0, t1, cb, ctx, &more);
+        if (seg == last) {
+            break;
+        }
+    }
+    return err;
+}
@@ -0,0 +1,97 @@
+#ifndef LOG_SEGMENT_H
+#define LOG_SEGMENT_H
+
+#include "esp_err.h"
+#include "log_codec.h"
+#include "storage.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Daily segments of the reptile log and their time index.
+ *
+ * Samples are stored by UTC day in LOG_SEGMENT_DIR/YYYYMMDD.bin, a sequence
+ * of log_codec.h blocks in time order. Next to it, YYYYMMDD.idx holds one
+ * entry every ::LOG_INDEX_STRIDE blocks: first timestamp of the block and
+ * block number, two little-endian u32. ::log_query binary-searches the index
+ * of the first day of the range and reads blocks from there until they pass
+ * its end, so a query costs a few index reads plus the blocks it returns
+ * instead of the whole history. An index cut short by a power loss only makes
+ * the scan start earlier; a missing one makes it start at the first block.
+ */
+
+#define LOG_SEGMENT_DIR "/sdcard/log"
+#define LOG_SEGMENT_S 86400U
+#define LOG_INDEX_STRIDE 8 /* blocks per index entry, 1 KB of log */
+#define LOG_INDEX_ENTRY_SIZE 8
+
+/** Segment (UTC day number) holding timestamp @p ts. */
+static inline uint32_t log_segment_of(uint32_t ts)
+{
+    return ts / LOG_SEGMENT_S;
+}
+
+/** Path of a file of segment @p seg; @p ext is "bin" or "idx". */
+int log_segment_path(uint32_t seg, const char *ext, char *buf, size_t size);
+
+/**
+ * @brief Open a file of segment @p seg to read and write in place, created
+ * if missing along with LOG_SEGMENT_DIR.
+ */
+esp_err_t log_segment_open(uint32_t seg, const char *ext,
+                           storage_file_t **out);
+
+/** Index of the segment being written */
+typedef struct {
+    storage_file_t *file;
+    uint32_t entries;    /* whole entries in the file */
+    uint32_t next_block; /* blocks below this one are indexed */
+} log_index_t;
+
+/** Open the index of @p seg and find where it stops. */
+esp_err_t log_index_open(log_index_t *ix, uint32_t seg);
+
+/**
+ * @brief Index the @p n blocks just written at block number @p first of the
+ * segment. Blocks already indexed, e.g. an open block written again in
+ * place, are skipped.
+ */
+esp_err_t log_index_add(log_index_t *ix, const uint8_t *blocks,
+                        uint32_t first, size_t n);
+
+/** Close the index; fails like storage_close once the card is gone. */
+esp_err_t log_index_close(log_index_t *ix);
+
+/**
+ * @brief Timestamp of the last sample of segment @p seg on the card.
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if the segment has no sample, an error
+ *         of the card otherwise.
+ */
+esp_err_t log_segment_last(uint32_t seg, uint32_t *ts);
+
+/** Called for each sample of a query; return false to stop. */
+typedef bool (*log_query_cb_t)(const log_sample_t *s, void *ctx);
+
+/**
+ * @brief Call @p cb for each logged sample with t0 <= timestamp <= t1, in
+ * time order.
+ *
+ * Reads what is on the card: samples newer than the last sync of the
+ * logging task are not seen. Days without a segment are skipped.
+ *
+ * @return ESP_OK, also when nothing matched or @p cb stopped the query;
+ *         ESP_ERR_INVALID_ARG if t1 < t0; an error of the card otherwise.
+ */
+esp_err_t log_query(uint32_t t0, uint32_t t1, log_query_cb_t cb, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_SEGMENT_H
@@ -0,0 +1,182 @@
+#include "log_series.h"
+#include "log_segment.h"
+
+#define READ_BUCKETS 128 /* rollup buckets per log_rollup_read call */
+
+typedef struct {
+    uint32_t span;
+    log_rollup_level_t level; /* LOG_ROLLUP_LEVELS: raw samples */
+} window_def_t;
+
+static const window_def_t k_window[LOG_WINDOWS] = {
+    {3600U, LOG_ROLLUP_LEVELS},
+    {86400U, LOG_ROLLUP_MINUTE},
+    {30U * 86400U, LOG_ROLLUP_HOUR},
+};
+
+/* Source points of a window, in scratch */
+typedef struct {
+    uint32_t *t;
+    int32_t *v[LOG_ROLLUP_FIELDS];
+    size_t n;
+    size_t cap;
+} source_t;
+
+uint32_t log_window_span(log_window_t w)
+{
+    return k_window[w].span;
+}
+
+/* Most points a window can read: both ends included */
+static size_t window_cap(log_window_t w)
+{
+    const window_def_t *d = &k_window[w];
+    if (d->level == LOG_ROLLUP_LEVELS) {
+        return d->span + 1U; /* 1 Hz at most */
+    }
+    return d->span / log_rollup_span(d->level) + 1U;
+}
+
+size_t log_series_scratch_size(log_window_t w, size_t max)
+{
+    if (w >= LOG_WINDOWS) {
+        return 0;
+    }
+    size_t cap = window_cap(w);
+    return sizeof(log_bucket_t) * READ_BUCKETS +
+           (sizeof(uint32_t) + sizeof(int32_t) * LOG_ROLLUP_FIELDS) * cap +
+           sizeof(uint32_t) * max;
+}
+
+static bool add_sample(const log_sample_t *s, void *ctx)
+{
+    source_t *src = ctx;
+    if (src->n == src->cap) {
+        return false; /* clock set back: more samples than seconds */
+    }
+    src->t[src->n] = s->timestamp;
+    for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+        src->v[f][src->n] = s->values[log_rollup_column((log_rollup_field_t)f)] * 10;
+    }
+    src->n++;
+    return true;
+}
+
+/* Mean of field f in tenths, rounded to nearest */
+static int32_t mean_tenths(const log_bucket_t *b, int f)
+{
+    int64_t s = b->sum[f] * 10, c = (int64_t)b->count;
+    return (int32_t)((s >= 0) ? (s + c / 2) / c : -((-s + c / 2) / c));
+}
+
+/* Bucket means, at the middle of each bucket or at t1 for the open one */
+static esp_err_t read_buckets(log_rollup_level_t level, uint32_t t0,
+                              uint32_t t1, log_bucket_t *chunk, source_t *src)
+{
+    uint32_t span = log_rollup_span(level);
+    uint64_t t = t0;
+    while (t <= t1 && src->n < src->cap) {
+        size_t n = 0;
+        esp_err_t err = log_rollup_read(level, (uint32_t)t, t1, chunk,
+                                        READ_BUCKETS, &n);
+        if (err != ESP_OK) {
+            return err;
+        }
+        for (size_t i = 0; i < n && src->n < src->cap; ++i) {
+            const log_bucket_t *b = &chunk[i];
+            uint32_t mid = b->start + span / 2U;
+            src->t[src->n] = (mid < t1) ? mid : t1;
+            for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+                src->v[f][src->n] = mean_tenths(b, f);
+            }
+            src->n++;
+        }
+        if (n < READ_BUCKETS) {
+            break; /* the rest of the window is empty */
+        }
+        t = (uint64_t)chunk[n - 1].start + span;
+    }
+    return ESP_OK;
+}
+
+esp_err_t log_series_load(log_window_t w, uint32_t now, log_series_t *s,
+                          void *scratch)
+{
+    if (w >= LOG_WINDOWS || !s || !scratch || s->max == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const window_def_t *d = &k_window[w];
+    source_t src = {.cap = window_cap(w)};
+    log_bucket_t *chunk = scratch;
+    src.t = (uint32_t *)(chunk + READ_BUCKETS);
+    int32_t *v = (int32_t *)(src.t + src.cap);
+    for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+        src.v[f] = v + (size_t)f * src.cap;
+    }
+    uint32_t *keep = (uint32_t *)(v + LOG_ROLLUP_FIELDS * src.cap);
+
+    s->n = 0;
+    s->points = 0;
+    s->t1 = now;
+    s->t0 = (now > d->span) ? now - d->span : 0U;
+    esp_err_t err = (d->level == LOG_ROLLUP_LEVELS)
+                        ? log_query(s->t0, s->t1, add_sample, &src)
+                        : read_buckets(d->level, s->t0, s->t1, chunk, &src);
+    if (err != ESP_OK) {
+        return err;
+    }
+    s->points = src.n;
+    for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+        s->n = log_lttb(src.t, src.v[f], src.n, s->max, keep);
+        for (size_t i = 0; i < s->n; ++i) {
+            s->t[f][i] = src.t[keep[i]];
+            s->v[f][i] = src.v[f][keep[i]];
+        }
+    }
+    return ESP_OK;
+}
+
+size_t log_lttb(const uint32_t *t, const int32_t *v, size_t n, size_t max,
+                uint32_t *keep)
+{
+    if (n <= max || max < 3) {
+        size_t k = (n < max) ? n : max;
+        for (size_t i = 0; i < k; ++i) {
+            keep[i] = (uint32_t)((i + 1 == k && k < n) ? n - 1 : i);
+        }
+        return k;
+    }
+    /* Bucket b of the n - 2 inner points is [edge(b), edge(b + 1)) */
+    size_t inner = n - 2, buckets = max - 2;
+#define EDGE(b) (1U + (size_t)((uint64_t)(b) * inner / buckets))
+    size_t k = 0;
+    size_t a = 0; /* last point kept */
+    keep[k++] = 0;
+    for (size_t b = 0; b < buckets; ++b) {
+        /* Mean of the next bucket, the last point after the last bucket */
+        size_t lo = EDGE(b + 1), hi = (b + 2 <= buckets) ? EDGE(b + 2) : n;
+        int64_t st = 0, sv = 0;
+        for (size_t j = lo; j < hi; ++j) {
+            st += (int64_t)(t[j] - t[a]);
+            sv += (int64_t)v[j] - v[a];
+        }
+        /* Twice the triangle area times hi - lo, relative to point a */
+        int64_t best = -1;
+        size_t pick = EDGE(b);
+        for (size_t j = EDGE(b); j < EDGE(b + 1); ++j) {
+            int64_t dt = (int64_t)(t[j] - t[a]);
+            int64_t dv = (int64_t)v[j] - v[a];
+            int64_t area = dt * sv - st * dv;
+            area = (area < 0) ? -area : area;
+            if (area > best) {
+                best = area;
+                pick = j;
+            }
+        }
+        keep[k++] = (uint32_t)pick;
+        a = pick;
+    }
+#undef EDGE
+    keep[k++] = (uint32_t)(n - 1);
+    return k;
+}
@@ -0,0 +1,76 @@
+#ifndef LOG_SERIES_H
+#define LOG_SERIES_H
+
+#include "esp_err.h"
+#include "log_rollup.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Chart series of the reptile log over the last hour, day or 30 days.
+ *
+ * A window only reads what it shows: the last hour comes from the raw
+ * samples (::log_query), the last day from the minute rollups and the last
+ * 30 days from the hour rollups (log_rollup.h, means), so a window reads at
+ * most 3601 points whatever the length of the history. Each stat is then
+ * reduced with Largest-Triangle-Three-Buckets (::log_lttb) to the number of
+ * points the chart can draw, which keeps the peaks that plain subsampling
+ * drops. Values are in tenths of the logged unit, like the rollup means.
+ */
+
+typedef enum {
+    LOG_WINDOW_HOUR,
+    LOG_WINDOW_DAY,
+    LOG_WINDOW_MONTH,
+    LOG_WINDOWS,
+} log_window_t;
+
+/** One series per log_rollup_field_t, in caller buffers of @c max points */
+typedef struct {
+    size_t max;
+    uint32_t *t[LOG_ROLLUP_FIELDS]; /* Unix time, bucket middle for rollups */
+    int32_t *v[LOG_ROLLUP_FIELDS];  /* tenths */
+    size_t n;                       /* points per series, at most max */
+    size_t points;                  /* samples or buckets read */
+    uint32_t t0, t1;                /* window loaded */
+} log_series_t;
+
+/** Length of @p w in seconds. */
+uint32_t log_window_span(log_window_t w);
+
+/** Bytes of scratch ::log_series_load needs for @p w and @p max points. */
+size_t log_series_scratch_size(log_window_t w, size_t max);
+
+/**
+ * @brief Load window @p w ending at @p now into @p s.
+ *
+ * @param scratch ::log_series_scratch_size bytes aligned like malloc; may
+ *        be in PSRAM, it is only used during the call.
+ * @return ESP_OK, also for an empty window (s->n == 0);
+ *         ESP_ERR_INVALID_ARG; an error of the card otherwise.
+ */
+esp_err_t log_series_load(log_window_t w, uint32_t now, log_series_t *s,
+                          void *scratch);
+
+/**
+ * @brief Largest-Triangle-Three-Buckets downsampling of (t, v).
+ *
+ * Keeps the first and last points and, in each of @p max - 2 buckets, the
+ * point forming the largest triangle with the point kept before it and the
+ * mean of the next bucket. @p t must be non-decreasing.
+ *
+ * @param keep Receives the indices kept, in order; room for @p max.
+ * @return Number of indices written, min(@p n, @p max).
+ */
+size_t log_lttb(const uint32_t *t, const int32_t *v, size_t n, size_t max,
+                uint32_t *keep);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_SERIES_H
@@ -0,0 +1,359 @@
+#include "log_writer.h"
+#include "metrics.h"
+#include "trace.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <inttypes.h>
+#include <string.h>
+
+#define LOG_TAG "logging"
+
+static void stats_lock(log_writer_t *w, bool take)
+{
+    if (w->io.lock) {
+        w->io.lock(w->io.ctx, take);
+    }
+}
+
+static bool card_ready(log_writer_t *w, uint32_t *epoch)
+{
+    *epoch = 0;
+    return !w->io.card || w->io.card(w->io.ctx, epoch);
+}
+
+void log_writer_close(log_writer_t *w)
+{
+    if (!w->file) {
+        return;
+    }
+    /* Fails once the card is gone; the handle is released anyway */
+    storage_close(w->file);
+    log_index_close(&w->index);
+    log_rollup_close(&w->rollup_files);
+    w->file = NULL;
+    w->unsynced = false;
+}
+
+static void file_error(log_writer_t *w, const char *what)
+{
+    ESP_LOGE(LOG_TAG, "%s failed on log segment", what);
+    log_writer_close(w);
+    stats_lock(w, true);
+    w->stats.write_errors++;
+    stats_lock(w, false);
+    metrics_inc(METRIC_LOG_WRITE_ERRORS);
+    if (w->io.error) {
+        w->io.error(w->io.ctx);
+    }
+}
+
+/*
+ * Segment w->seg open on the current card mount; false while the card is
+ * absent. Blocks go after those found in the file, unless it is the file
+ * this writer was writing before a remount: its open block is then
+ * rewritten in place.
+ */
+static bool file_ready(log_writer_t *w)
+{
+    uint32_t epoch;
+    if (!card_ready(w, &epoch)) {
+        log_writer_close(w);
+        return false;
+    }
+    if (w->file && w->file_epoch != epoch) {
+        log_writer_close(w);
+    }
+    if (w->file) {
+        return true;
+    }
+    storage_file_t *f;
+    if (log_segment_open(w->seg, "bin", &f) != ESP_OK) {
+        file_error(w, "Open");
+        return false;
+    }
+    uint32_t size = 0;
+    w->file = f;
+    if (storage_size(f, &size) != ESP_OK) {
+        file_error(w, "Size");
+        return false;
+    }
+    if (log_index_open(&w->index, w->seg) != ESP_OK) {
+        file_error(w, "Index open");
+        return false;
+    }
+    if (!w->file_known || size < w->file_size) {
+        w->file_size = (size + LOG_BLOCK_SIZE - 1U) / LOG_BLOCK_SIZE * LOG_BLOCK_SIZE;
+        w->file_known = true;
+    }
+    w->file_epoch = epoch;
+    return true;
+}
+
+static esp_err_t write_at(log_writer_t *w, const uint8_t *buf, size_t len,
+                          bool full)
+{
+    TRACE_BEGIN("sd_write");
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t err = storage_pwrite(w->file, buf, len, w->file_size);
+    uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+    TRACE_END("sd_write");
+    metrics_record(METRIC_LOG_WRITE_US, us);
+    if (err != ESP_OK) {
+        /* The data stays in RAM until the card is back */
+        file_error(w, "Write");
+        return err;
+    }
+    w->unsynced = true;
+    if (log_index_add(&w->index, buf, w->file_size / LOG_BLOCK_SIZE,
+                      len / LOG_BLOCK_SIZE) != ESP_OK) {
+        file_error(w, "Index write");
+        return ESP_FAIL;
+    }
+
+    stats_lock(w, true);
+    if (full) {
+        w->stats.blocks++;
+    } else {
+        w->stats.partial_writes++;
+    }
+    w->stats.bytes_written += (uint32_t)len;
+    if (us > w->stats.max_write_us) {
+        w->stats.max_write_us = us;
+    }
+    stats_lock(w, false);
+    return ESP_OK;
+}
+
+void log_writer_sync(log_writer_t *w)
+{
+    if (!w->file || !w->unsynced) {
+        return;
+    }
+    TRACE_BEGIN("sd_fsync");
+    int64_t t0 = esp_timer_get_time();
+    bool ok = storage_fsync(w->file) == ESP_OK &&
+              storage_fsync(w->index.file) == ESP_OK &&
+              log_rollup_sync(&w->rollup_files) == ESP_OK;
+    metrics_record(METRIC_LOG_SYNC_US,
+                   (uint32_t)(esp_timer_get_time() - t0));
+    TRACE_END("sd_fsync");
+    if (!ok) {
+        file_error(w, "Sync");
+        return;
+    }
+    w->unsynced = false;
+    stats_lock(w, true);
+    w->stats.fsyncs++;
+    stats_lock(w, false);
+}
+
+static bool next_sample(log_writer_t *w, log_sample_t *smp)
+{
+    if (w->held_valid) {
+        *smp = w->held;
+        w->held_valid = false;
+        return true;
+    }
+    return w->io.next(w->io.ctx, smp);
+}
+
+/*
+ * Samples go to the segments and the rollup in time order: log_query stops
+ * at the first sample past its range and an open bucket only moves forward.
+ * One older than the last sample (clock set back, or restarted behind the
+ * card) is dropped and counted. The first one after start is checked against
+ * the end of its segment on the card, if the card is there.
+ */
+static bool sample_in_order(log_writer_t *w, const log_sample_t *smp)
+{
+    if (!w->last_known) {
+        uint32_t last, epoch;
+        if (card_ready(w, &epoch) &&
+            log_segment_last(log_segment_of(smp->timestamp), &last) == ESP_OK) {
+            w->last_ts = last;
+        }
+        w->last_known = true;
+    }
+    if (smp->timestamp < w->last_ts) {
+        stats_lock(w, true);
+        bool first = w->stats.out_of_order++ == 0;
+        stats_lock(w, false);
+        if (first) {
+            ESP_LOGW(LOG_TAG, "Sample at %" PRIu32 " before %" PRIu32
+                     ", dropped", smp->timestamp, w->last_ts);
+        }
+        return false;
+    }
+    w->last_ts = smp->timestamp;
+    return true;
+}
+
+/* Card away for long: minute buckets go first, hours and days are kept */
+static void rollup_make_room(log_writer_t *w)
+{
+    size_t i = 0;
+    uint32_t dropped = 0;
+    while (w->nbuckets + LOG_ROLLUP_LEVELS > w->max_buckets &&
+           i < w->nbuckets) {
+        if (w->buckets[i].level != LOG_ROLLUP_MINUTE) {
+            i++;
+            continue;
+        }
+        w->nbuckets--;
+        memmove(&w->buckets[i], &w->buckets[i + 1],
+                (w->nbuckets - i) * sizeof(w->buckets[0]));
+        dropped++;
+    }
+    if (dropped) {
+        stats_lock(w, true);
+        w->stats.buckets_dropped += dropped;
+        stats_lock(w, false);
+    }
+}
+
+/*
+ * Aggregate a sample. The first one after start continues the buckets
+ * stored before a restart, if the card has them.
+ */
+static void rollup_add(log_writer_t *w, const log_sample_t *smp)
+{
+    uint32_t epoch;
+    if (!w->rollup_resumed && card_ready(w, &epoch)) {
+        for (int l = 0; l < LOG_ROLLUP_LEVELS; ++l) {
+            uint32_t span = log_rollup_span((log_rollup_level_t)l);
+            log_bucket_t b;
+            if (log_rollup_load((log_rollup_level_t)l,
+                                smp->timestamp - smp->timestamp % span,
+                                &b) == ESP_OK) {
+                log_rollup_resume(&w->rollup, &b);
+            }
+        }
+    }
+    w->rollup_resumed = true;
+    rollup_make_room(w);
+    w->nbuckets += log_rollup_add(&w->rollup, smp, w->buckets + w->nbuckets);
+}
+
+/* Store the closed buckets, and with @p all the open ones in place */
+static bool rollup_store(log_writer_t *w, bool all)
+{
+    size_t done = 0;
+    esp_err_t err = ESP_OK;
+    while (err == ESP_OK && done < w->nbuckets) {
+        err = log_rollup_store(&w->rollup_files, &w->buckets[done]);
+        done += (err == ESP_OK) ? 1U : 0U;
+    }
+    for (int l = 0; all && err == ESP_OK && l < LOG_ROLLUP_LEVELS; ++l) {
+        const log_bucket_t *b = log_rollup_open(&w->rollup, (log_rollup_level_t)l);
+        if (b) {
+            err = log_rollup_store(&w->rollup_files, b);
+        }
+    }
+    w->nbuckets -= done;
+    memmove(w->buckets, w->buckets + done, w->nbuckets * sizeof(w->buckets[0]));
+    stats_lock(w, true);
+    w->stats.buckets += (uint32_t)done;
+    stats_lock(w, false);
+    if (err != ESP_OK) {
+        file_error(w, "Rollup write");
+        return false;
+    }
+    w->unsynced = true;
+    return true;
+}
+
+esp_err_t log_writer_init(log_writer_t *w, const log_writer_io_t *io,
+                          uint32_t block_size, uint8_t *block,
+                          log_bucket_t *buckets, size_t max_buckets)
+{
+    if (!w || !io || !io->next || !block || !buckets ||
+        block_size < LOG_BLOCK_SIZE || block_size % LOG_BLOCK_SIZE ||
+        max_buckets < 2U * LOG_ROLLUP_LEVELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(w, 0, sizeof(*w));
+    w->io = *io;
+    w->block_size = block_size;
+    w->block = block;
+    w->buckets = buckets;
+    w->max_buckets = max_buckets;
+    log_encoder_init(&w->enc);
+    log_rollup_init(&w->rollup);
+    return ESP_OK;
+}
+
+/*
+ * Encode the samples waiting and write the closed blocks. Each write ends on
+ * a multiple of block_size in the file, so that the card is written a whole
+ * allocation unit at a time; with @p all, the closed blocks short of it and
+ * a copy of the open block are written too. A sample of a new day closes the
+ * segment: its last block is written and the next file opened.
+ */
+void log_writer_flush(log_writer_t *w, bool all)
+{
+    for (;;) {
+        log_sample_t smp;
+        while (!w->seg_end && w->fill + LOG_BLOCK_SIZE <= w->block_size &&
+               w->nbuckets + LOG_ROLLUP_LEVELS <= w->max_buckets &&
+               next_sample(w, &smp)) {
+            if (!sample_in_order(w, &smp)) {
+                continue;
+            }
+            uint32_t seg = log_segment_of(smp.timestamp);
+            if (seg != w->seg && (w->fill || log_encoder_count(&w->enc))) {
+                w->held = smp;
+                w->held_valid = true;
+                w->seg_end = true;
+                if (log_encoder_flush(&w->enc, w->block + w->fill)) {
+                    w->fill += LOG_BLOCK_SIZE;
+                }
+                break;
+            }
+            w->seg = seg;
+            if (log_encoder_add(&w->enc, &smp, w->block + w->fill)) {
+                w->fill += LOG_BLOCK_SIZE;
+            }
+            rollup_add(w, &smp);
+        }
+        if (w->fill == 0 && !w->seg_end && w->nbuckets == 0 &&
+            (!all || log_encoder_count(&w->enc) == 0)) {
+            return; /* nothing to write */
+        }
+        if (!file_ready(w) || !rollup_store(w, false)) {
+            return;
+        }
+        bool drain = all || w->seg_end;
+        size_t room = w->block_size - w->file_size % w->block_size;
+        size_t len = (w->fill < room) ? w->fill : room;
+        if (len == 0 && w->seg_end) {
+            /* Segment written out: the held sample opens the next one */
+            log_writer_sync(w);
+            log_writer_close(w);
+            w->file_known = false;
+            w->seg_end = false;
+            continue;
+        }
+        if (len == 0 || (len < room && !drain)) {
+            break;
+        }
+        if (write_at(w, w->block, len, len == room) != ESP_OK) {
+            return;
+        }
+        w->file_size += (uint32_t)len;
+        w->fill -= len;
+        memmove(w->block, w->block + len, w->fill);
+    }
+    /* Rewritten in place at each sync until it is full */
+    if (all && w->fill == 0) {
+        if (log_encoder_peek(&w->enc, w->open) &&
+            write_at(w, w->open, LOG_BLOCK_SIZE, false) != ESP_OK) {
+            return;
+        }
+        rollup_store(w, true);
+    }
+}
+
+bool log_writer_pending(const log_writer_t *w)
+{
+    return w->fill || w->held_valid || w->nbuckets;
+}
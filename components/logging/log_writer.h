@@ -0,0 +1,125 @@
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include "esp_err.h"
+#include "log_codec.h"
+#include "log_rollup.h"
+#include "log_segment.h"
+#include "storage.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Segment, block and rollup writer of the logging task (logging.h), kept
+ * apart from its ring and task so that host tests write the log with the
+ * same code.
+ *
+ * ::log_writer_flush pulls samples from @c io.next in time order, drops
+ * those older than the last one, encodes them into LOG_BLOCK_SIZE blocks
+ * and aggregates them (log_rollup.h). Closed blocks are written
+ * @c block_size bytes at a time, ending on a multiple of it in the segment
+ * file; with @c all, the closed blocks short of it, a copy of the open block
+ * and the open buckets are written too. A sample of a new day closes the
+ * segment. Nothing blocks on the card: while @c io.card reports it absent,
+ * blocks wait in the block buffer and closed buckets in the bucket queue,
+ * the oldest minute buckets going first when it is full.
+ *
+ * After a restart the writer continues the segment and the buckets found on
+ * the card: blocks go after those in the file, rounded up to a block.
+ */
+
+/** Environment of a writer; the callbacks run on the writer's task. */
+typedef struct {
+    /** Next sample to write; false when none is waiting. */
+    bool (*next)(void *ctx, log_sample_t *s);
+    /**
+     * Whether the card is mounted, and its mount count in @p epoch: files
+     * of an older mount are reopened. NULL: always mounted.
+     */
+    bool (*card)(void *ctx, uint32_t *epoch);
+    /** A card operation failed; the files are already closed. May be NULL. */
+    void (*error)(void *ctx);
+    /**
+     * Take (@p take true) or give the lock of the stats, read by other
+     * tasks. May be NULL.
+     */
+    void (*lock)(void *ctx, bool take);
+    void *ctx;
+} log_writer_io_t;
+
+/** Counters of a writer, under @c io.lock. */
+typedef struct {
+    uint32_t blocks;         /* full block_size writes */
+    uint32_t partial_writes; /* shorter writes and open block copies */
+    uint32_t bytes_written;
+    uint32_t fsyncs;
+    uint32_t write_errors;
+    uint32_t max_write_us;    /* longest block write */
+    uint32_t buckets;         /* closed rollup buckets stored */
+    uint32_t buckets_dropped; /* minute buckets lost, card away too long */
+    uint32_t out_of_order;    /* samples older than the last one, dropped */
+} log_writer_stats_t;
+
+typedef struct {
+    log_writer_io_t io;
+    uint32_t block_size;
+    log_writer_stats_t stats;
+
+    log_encoder_t enc;
+    uint32_t seg;        /* segment of the encoded samples */
+    bool seg_end;        /* seg is complete, to be written out */
+    log_sample_t held;   /* first sample of the next segment */
+    bool held_valid;
+    log_rollup_t rollup;
+    bool rollup_resumed; /* open buckets reloaded after start */
+    uint32_t last_ts;    /* last sample encoded */
+    bool last_known;     /* last_ts read back after start */
+    log_bucket_t *buckets; /* closed, not yet stored */
+    size_t nbuckets;
+    size_t max_buckets;
+    log_rollup_files_t rollup_files;
+    uint8_t open[LOG_BLOCK_SIZE]; /* copy of the open block */
+    uint8_t *block; /* closed blocks not yet written, block_size bytes */
+    size_t fill;
+    storage_file_t *file; /* segment seg */
+    log_index_t index;
+    uint32_t file_size;  /* end of the closed blocks in the file */
+    bool file_known;     /* file_size is ours, not read back */
+    uint32_t file_epoch; /* card mount file belongs to */
+    bool unsynced;
+} log_writer_t;
+
+/**
+ * @brief Start a writer with no file open.
+ *
+ * @param block Block buffer of @p block_size bytes, a multiple of
+ *              LOG_BLOCK_SIZE; DMA-capable on the target.
+ * @param buckets Queue of @p max_buckets closed buckets, at least
+ *                2 * LOG_ROLLUP_LEVELS.
+ */
+esp_err_t log_writer_init(log_writer_t *w, const log_writer_io_t *io,
+                          uint32_t block_size, uint8_t *block,
+                          log_bucket_t *buckets, size_t max_buckets);
+
+/** Write what the samples waiting allow; with @p all, everything. */
+void log_writer_flush(log_writer_t *w, bool all);
+
+/** fsync the segment, its index and the rollup files if written since. */
+void log_writer_sync(log_writer_t *w);
+
+/** Close the files; the next flush reopens them. */
+void log_writer_close(log_writer_t *w);
+
+/** True while samples or buckets taken from @c io.next are not written. */
+bool log_writer_pending(const log_writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_WRITER_H
@@ -1,18 +1,232 @@
 #include "logging.h"
-#include "sd.h"
+#include "log_codec.h"
+#include "log_limit.h"
+#include "log_ring.h"
+#include "log_writer.h"
+#include "storage_supervisor.h"
+#include "metrics.h"
+#include "trace.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "lvgl.h"
-#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
-#include <sys/stat.h>
 #include <stdbool.h>
 
 #define LOG_TAG "logging"
+#define ROLLUP_QUEUE 256 /* closed buckets waiting for the card */
 
 static const reptile_t *(*state_cb)(void);
 static lv_timer_t *log_timer;
 
-static const char *LOG_FILE = "/sdcard/reptile_log.csv";
+static logging_config_t s_cfg = LOGGING_CONFIG_DEFAULT();
+static log_ring_t s_ring; /* internal RAM: its counters take atomic RMW */
+static TaskHandle_t s_task;
+static SemaphoreHandle_t s_lock;    /* guards s_flush_req, s_flush_err, stats */
+static SemaphoreHandle_t s_flushed; /* given when a flush request is served */
+static bool s_flush_req;
+static esp_err_t s_flush_err;
+
+/* Flush task only, but for its stats under s_lock */
+static log_writer_t s_writer;
+
+static bool ring_next(void *ctx, log_sample_t *smp)
+{
+    (void)ctx;
+    return log_ring_pop(&s_ring, smp, sizeof(*smp)) == sizeof(*smp);
+}
+
+static bool card_ready(void *ctx, uint32_t *epoch)
+{
+    (void)ctx;
+    *epoch = storage_supervisor_epoch();
+    return storage_supervisor_card_ready();
+}
+
+static void card_error(void *ctx)
+{
+    (void)ctx;
+    storage_supervisor_report_error();
+}
+
+static void stats_lock(void *ctx, bool take)
+{
+    (void)ctx;
+    if (take) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+    } else {
+        xSemaphoreGive(s_lock);
+    }
+}
+
+static const log_writer_io_t k_io = {
+    .next = ring_next,
+    .card = card_ready,
+    .error = card_error,
+    .lock = stats_lock,
+};
+
+static void flush_task(void *arg)
+{
+    (void)arg;
+    TickType_t last_sync = xTaskGetTickCount();
+    for (;;) {
+        /* Woken when a block is ready, by a flush, or at the sync period */
+        TickType_t period = pdMS_TO_TICKS(s_cfg.fsync_ms);
+        TickType_t since = xTaskGetTickCount() - last_sync;
+        ulTaskNotifyTake(pdTRUE, (since < period) ? period - since : 0);
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        bool flush = s_flush_req;
+        xSemaphoreGive(s_lock);
+        bool sync = flush || xTaskGetTickCount() - last_sync >= period;
+
+        TRACE_COUNTER("log_ring_used", log_ring_used(&s_ring));
+        metrics_set(METRIC_LOG_RING_USED, (int32_t)log_ring_used(&s_ring));
+        log_writer_flush(&s_writer, sync);
+        if (sync) {
+            log_writer_sync(&s_writer);
+            last_sync = xTaskGetTickCount();
+        }
+        if (flush) {
+            bool left = log_writer_pending(&s_writer) || log_ring_used(&s_ring);
+            log_writer_close(&s_writer);
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            s_flush_req = false;
+            s_flush_err = left ? ESP_FAIL : ESP_OK;
+            xSemaphoreGive(s_lock);
+            xSemaphoreGive(s_flushed);
+        }
+    }
+}
+
+esp_err_t logging_start(const logging_config_t *cfg)
+{
+    if (s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    logging_config_t c = LOGGING_CONFIG_DEFAULT();
+    if (cfg) {
+        c = *cfg;
+    }
+    if (c.block_size < LOG_BLOCK_SIZE || c.block_size % LOG_BLOCK_SIZE ||
+        c.fsync_ms == 0 || c.period_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        s_flushed = xSemaphoreCreateBinary();
+        if (!s_lock || !s_flushed) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    /* Records wait in PSRAM; the block goes to the SD driver, internal RAM */
+    void *ring = heap_caps_malloc(c.ring_size, MALLOC_CAP_SPIRAM);
+    if (!ring) {
+        ring = malloc(c.ring_size);
+    }
+    size_t queue_size = ROLLUP_QUEUE * sizeof(log_bucket_t);
+    log_bucket_t *buckets = heap_caps_malloc(queue_size, MALLOC_CAP_SPIRAM);
+    if (!buckets) {
+        buckets = malloc(queue_size);
+    }
+    uint8_t *block = heap_caps_malloc(c.block_size, MALLOC_CAP_DMA);
+    if (!block) {
+        block = malloc(c.block_size);
+    }
+    esp_err_t err = (ring && block && buckets)
+                        ? log_ring_init(&s_ring, ring, c.ring_size)
+                        : ESP_ERR_NO_MEM;
+    if (err != ESP_OK) {
+        free(ring);
+        free(block);
+        free(buckets);
+        return err;
+    }
+    s_cfg = c;
+    log_writer_init(&s_writer, &k_io, c.block_size, block, buckets,
+                    ROLLUP_QUEUE);
+    if (xTaskCreate(flush_task, "logging", LOGGING_TASK_STACK_SIZE, NULL,
+                    LOGGING_TASK_PRIORITY, &s_task) != pdPASS) {
+        s_task = NULL;
+        s_ring.buf = NULL;
+        free(ring);
+        free(block);
+        free(buckets);
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(LOG_TAG, "Ring %" PRIu32 " o, blocs %" PRIu32 " o, sync %" PRIu32
+             " ms", s_ring.size, s_cfg.block_size, s_cfg.fsync_ms);
+    return ESP_OK;
+}
+
+esp_err_t logging_write(const log_sample_t *s)
+{
+    if (!s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = log_ring_push(&s_ring, s, sizeof(*s));
+    /* Samples are encoded by the task: wake it well before the ring fills */
+    if (err == ESP_OK && log_ring_used(&s_ring) >= s_ring.size / 2) {
+        xTaskNotifyGive(s_task);
+    } else if (err == ESP_ERR_NO_MEM) {
+        metrics_inc(METRIC_LOG_DROPPED);
+    }
+    return err;
+}
+
+esp_err_t logging_flush(uint32_t timeout_ms)
+{
+    if (!s_task) {
+        return ESP_OK;
+    }
+    xSemaphoreTake(s_flushed, 0); /* drop the completion of a timed-out flush */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_flush_req = true;
+    xSemaphoreGive(s_lock);
+
+    xTaskNotifyGive(s_task);
+    if (xSemaphoreTake(s_flushed, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = s_flush_err;
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+void logging_get_stats(logging_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    if (!s_task) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    log_writer_stats_t w = s_writer.stats;
+    xSemaphoreGive(s_lock);
+    *out = (logging_stats_t){
+        .blocks = w.blocks,
+        .partial_writes = w.partial_writes,
+        .bytes_written = w.bytes_written,
+        .fsyncs = w.fsyncs,
+        .write_errors = w.write_errors,
+        .max_write_us = w.max_write_us,
+        .buckets = w.buckets,
+        .buckets_dropped = w.buckets_dropped,
+        .out_of_order = w.out_of_order,
+    };
+    out->samples = atomic_load(&s_ring.records);
+    out->dropped = atomic_load(&s_ring.dropped);
+    out->ring_size = s_ring.size;
+    out->ring_peak = atomic_load(&s_ring.peak);
+}
 
 static void logging_timer_cb(lv_timer_t *t)
 {
@@ -24,49 +238,31 @@ static void logging_timer_cb(lv_timer_t *t)
     if (!r) {
         return;
     }
-    FILE *f = fopen(LOG_FILE, "a");
-    if (!f) {
-        ESP_LOGE(LOG_TAG, "Failed to open log file");
-        return;
-    }
-    fprintf(f,
-            "%ld,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
-            (long)r->last_update, r->faim, r->eau,
-            r->temperature, r->humeur, (uint32_t)r->event);
-    fflush(f);
-    if (ferror(f)) {
-        ESP_LOGE(LOG_TAG, "Failed to write log file");
-        fclose(f);
-        sd_mmc_unmount();
-        sd_mmc_init();
-        return;
+    log_sample_t s = {
+        .timestamp = (uint32_t)r->last_update,
+        .values = {
+            [LOG_COL_FAIM] = (int32_t)r->faim,
+            [LOG_COL_EAU] = (int32_t)r->eau,
+            [LOG_COL_TEMPERATURE] = (int32_t)r->temperature,
+            [LOG_COL_HUMIDITE] = (int32_t)r->humidite,
+            [LOG_COL_HUMEUR] = (int32_t)r->humeur,
+            [LOG_COL_EVENT] = (int32_t)r->event,
+        },
+    };
+    /* Queued: the LVGL task never waits on the card. A full ring drops a
+     * sample per period until the card comes back: one line per burst,
+     * the rest counted in the next one and in the ring stats. */
+    if (logging_write(&s) == ESP_ERR_NO_MEM) {
+        LOG_LIMIT_W(LOG_TAG, "Anneau du journal plein, échantillon perdu");
     }
-    fclose(f);
 }
 
 void logging_init(const reptile_t *(*cb)(void))
 {
     state_cb = cb;
-    struct stat st;
-    bool need_header = stat(LOG_FILE, &st) != 0;
-    FILE *f = fopen(LOG_FILE, "a");
-    if (!f) {
-        ESP_LOGE(LOG_TAG, "Failed to create log file");
-        return;
+    if (!log_timer) {
+        log_timer = lv_timer_create(logging_timer_cb, s_cfg.period_ms, NULL);
     }
-    if (need_header) {
-        fputs("timestamp,faim,eau,temperature,humeur,event\n", f);
-        fflush(f);
-        if (ferror(f)) {
-            ESP_LOGE(LOG_TAG, "Failed to write header to log file");
-            fclose(f);
-            sd_mmc_unmount();
-            sd_mmc_init();
-            return;
-        }
-    }
-    fclose(f);
-    log_timer = lv_timer_create(logging_timer_cb, 60000, NULL);
 }
 
 void logging_pause(void)
@@ -82,4 +278,3 @@ void logging_resume(void)
         lv_timer_resume(log_timer);
     }
 }
-
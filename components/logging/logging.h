@@ -2,13 +2,97 @@
 #define LOGGING_H
 
 #include "reptile_logic.h"
+#include "log_codec.h"
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief Initialize periodic logging of reptile state to CSV.
+ * Buffered log of the reptile state on the SD card.
+ *
+ * Samples are pushed with ::logging_write from any task into a lock-free
+ * ring allocated in PSRAM when available: producers never wait on each
+ * other nor on the card, and a sample that does not fit is dropped and
+ * counted. A flush task encodes them into the columnar blocks of
+ * log_codec.h with the writer of log_writer.h, keeps the segment of the day open (log_segment.h) and writes
+ * @c block_size bytes of closed blocks at a time, ending on a multiple of it
+ * in the file, i.e. on FAT allocation units. Every @c fsync_ms, the closed
+ * blocks left and a copy of the open block are written and the file is
+ * synced; the open block is rewritten in place until it is full. The first
+ * sample of a new day closes the segment and opens the next one. The file is
+ * reopened after a card remount, see storage_supervisor.h. ::log_query reads
+ * a time range back; on a PC, tools/log2csv.c converts segments to CSV and
+ * tools/log_stats.cpp computes daily statistics over them.
+ */
+
+#define LOGGING_TASK_STACK_SIZE (4 * 1024)
+#define LOGGING_TASK_PRIORITY 1 /* below the LVGL task */
+
+typedef struct {
+    size_t ring_size;    /* bytes of queued samples, headers included */
+    uint32_t block_size; /* write unit, the card allocation unit */
+    uint32_t fsync_ms;   /* longest time a sample stays in RAM */
+    uint32_t period_ms;  /* state sampling period, see ::logging_init */
+} logging_config_t;
+
+#define LOGGING_CONFIG_DEFAULT()                                               \
+    {                                                                          \
+        .ring_size = 64 * 1024,                                                \
+        .block_size = 16 * 1024,                                               \
+        .fsync_ms = 60000,                                                     \
+        .period_ms = 60000,                                                    \
+    }
+
+typedef struct {
+    uint32_t samples;        /* samples accepted */
+    uint32_t dropped;        /* samples refused, ring full */
+    uint32_t ring_size;      /* usable ring bytes */
+    uint32_t ring_peak;      /* highest ring use, bytes */
+    uint32_t blocks;         /* full block_size writes */
+    uint32_t partial_writes; /* shorter writes and open block copies */
+    uint32_t bytes_written;
+    uint32_t fsyncs;
+    uint32_t write_errors;
+    uint32_t max_write_us;   /* longest block write */
+    uint32_t buckets;        /* closed rollup buckets stored */
+    uint32_t buckets_dropped; /* minute buckets lost, card away too long */
+    uint32_t out_of_order;   /* samples older than the last one, dropped */
+} logging_stats_t;
+
+/**
+ * @brief Allocate the ring and start the flush task.
+ *
+ * @param cfg NULL for ::LOGGING_CONFIG_DEFAULT.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if already running,
+ *         ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM.
+ */
+esp_err_t logging_start(const logging_config_t *cfg);
+
+/**
+ * @brief Queue one sample; never blocks.
+ *
+ * @return ESP_OK, ESP_ERR_NO_MEM when the ring is full (sample dropped),
+ *         ESP_ERR_INVALID_STATE before ::logging_start.
+ */
+esp_err_t logging_write(const log_sample_t *s);
+
+/**
+ * @brief Write everything queued, sync and close the file, e.g. before the
+ * card is unmounted. The next write reopens it.
+ *
+ * @return ESP_OK, ESP_FAIL if samples are left (card absent),
+ *         ESP_ERR_TIMEOUT after @p timeout_ms.
+ */
+esp_err_t logging_flush(uint32_t timeout_ms);
+
+void logging_get_stats(logging_stats_t *out);
+
+/**
+ * @brief Sample the reptile state to the log periodically (LVGL timer).
  *
  * @param cb Callback returning pointer to current reptile state.
  */
@@ -6,6 +6,7 @@
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "lvgl_port.h"
+#include "trace.h"
 #define LGFX_USE_V1
 #define LGFX_RGB_PARALLEL
 #include <LovyanGFX.hpp>
@@ -26,8 +27,10 @@ static void flush_callback(lv_display_t *disp, const lv_area_t *area, uint8_t *p
     int32_t width = area->x2 - area->x1 + 1;
     int32_t height = area->y2 - area->y1 + 1;
 
+    TRACE_BEGIN("flush");
     gfx.pushImageDMA(offsetx1, offsety1, width, height, (const uint16_t *)px_map);
     gfx.waitDMA();
+    TRACE_END("flush");
 
     lv_display_flush_ready(disp);
 }
@@ -107,7 +110,9 @@ static void lvgl_port_task(void *arg)
     uint32_t task_delay_ms = LVGL_PORT_TASK_MAX_DELAY_MS;
     while (1) {
         if (lvgl_port_lock(-1)) {
+            TRACE_BEGIN("lv_timer_handler");
             task_delay_ms = lv_timer_handler();
+            TRACE_END("lv_timer_handler");
             lvgl_port_unlock();
         }
         if (task_delay_ms > LVGL_PORT_TASK_MAX_DELAY_MS) {
@@ -0,0 +1,307 @@
+#include "metrics.h"
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static uint32_t uptime_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+#else
+#include <time.h>
+#define IRAM_ATTR
+#define ESP_LOGI(tag, fmt, ...) printf("I (%s) " fmt "\n", tag, __VA_ARGS__)
+
+static uint32_t uptime_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+#endif
+
+#define SUB (1U << METRICS_SUB_BITS)
+#define BINARY_VERSION 1
+
+enum { KIND_COUNTER, KIND_GAUGE, KIND_HISTOGRAM };
+
+static const char TAG[] = "metrics";
+
+#define METRICS_NAME(id, name) name,
+static const char *const k_counter_names[] = {METRICS_COUNTERS(METRICS_NAME)};
+static const char *const k_gauge_names[] = {METRICS_GAUGES(METRICS_NAME)};
+static const char *const k_histogram_names[] = {
+    METRICS_HISTOGRAMS(METRICS_NAME)};
+#undef METRICS_NAME
+
+typedef struct {
+    _Atomic uint32_t buckets[METRICS_BUCKETS];
+    _Atomic uint32_t max;
+} histogram_t;
+
+/* Plain statics: internal RAM, where the atomic instructions work */
+static _Atomic uint32_t s_counters[METRIC_COUNTERS];
+static _Atomic int32_t s_gauges[METRIC_GAUGES];
+static histogram_t s_histograms[METRIC_HISTOGRAMS];
+
+unsigned IRAM_ATTR metrics_bucket(uint32_t value)
+{
+    if (value < SUB) {
+        return value;
+    }
+    unsigned e = 31U - (unsigned)__builtin_clz(value); /* >= METRICS_SUB_BITS */
+    unsigned shift = e - METRICS_SUB_BITS;
+    return ((shift + 1U) << METRICS_SUB_BITS) + ((value >> shift) & (SUB - 1U));
+}
+
+uint32_t metrics_bucket_low(unsigned b)
+{
+    if (b < SUB) {
+        return b;
+    }
+    unsigned shift = (b >> METRICS_SUB_BITS) - 1U;
+    return (SUB + (b & (SUB - 1U))) << shift;
+}
+
+void IRAM_ATTR metrics_inc(metric_counter_t c)
+{
+    atomic_fetch_add_explicit(&s_counters[c], 1U, memory_order_relaxed);
+}
+
+void IRAM_ATTR metrics_add(metric_counter_t c, uint32_t n)
+{
+    atomic_fetch_add_explicit(&s_counters[c], n, memory_order_relaxed);
+}
+
+void IRAM_ATTR metrics_set(metric_gauge_t g, int32_t value)
+{
+    atomic_store_explicit(&s_gauges[g], value, memory_order_relaxed);
+}
+
+void IRAM_ATTR metrics_record(metric_histogram_t h, uint32_t value)
+{
+    histogram_t *hist = &s_histograms[h];
+    atomic_fetch_add_explicit(&hist->buckets[metrics_bucket(value)], 1U,
+                              memory_order_relaxed);
+    uint32_t max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+    while (value > max &&
+           !atomic_compare_exchange_weak_explicit(&hist->max, &max, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+uint32_t metrics_counter(metric_counter_t c)
+{
+    return atomic_load_explicit(&s_counters[c], memory_order_relaxed);
+}
+
+int32_t metrics_gauge(metric_gauge_t g)
+{
+    return atomic_load_explicit(&s_gauges[g], memory_order_relaxed);
+}
+
+void metrics_histogram(metric_histogram_t h, metrics_histogram_t *out)
+{
+    histogram_t *hist = &s_histograms[h];
+    out->count = 0;
+    for (unsigned b = 0; b < METRICS_BUCKETS; ++b) {
+        out->buckets[b] =
+            atomic_load_explicit(&hist->buckets[b], memory_order_relaxed);
+        out->count += out->buckets[b];
+    }
+    out->max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+}
+
+uint32_t metrics_quantile(const metrics_histogram_t *hist, float q)
+{
+    if (hist->count == 0) {
+        return 0;
+    }
+    q = (q < 0.0f) ? 0.0f : (q > 1.0f) ? 1.0f : q;
+    /* Rank of the value, 1-based */
+    uint32_t rank = (uint32_t)(q * (float)hist->count + 0.5f);
+    rank = (rank == 0) ? 1 : (rank > hist->count) ? hist->count : rank;
+    uint32_t seen = 0;
+    for (unsigned b = 0; b < METRICS_BUCKETS; ++b) {
+        seen += hist->buckets[b];
+        if (seen >= rank) {
+            uint32_t high = (b + 1U < METRICS_BUCKETS)
+                                ? metrics_bucket_low(b + 1U) - 1U
+                                : UINT32_MAX;
+            return (high < hist->max) ? high : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+/* Bounded output: counts what would have been written past the end */
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+} out_t;
+
+static void put(out_t *o, const void *data, size_t n)
+{
+    if (o->len + n <= o->size) {
+        memcpy(o->buf + o->len, data, n);
+    }
+    o->len += n;
+}
+
+static void put_u8(out_t *o, uint8_t v)
+{
+    put(o, &v, 1);
+}
+
+static void put_u16(out_t *o, uint16_t v)
+{
+    uint8_t p[2] = {(uint8_t)v, (uint8_t)(v >> 8)};
+    put(o, p, sizeof(p));
+}
+
+static void put_u32(out_t *o, uint32_t v)
+{
+    uint8_t p[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16),
+                    (uint8_t)(v >> 24)};
+    put(o, p, sizeof(p));
+}
+
+static void put_name(out_t *o, uint8_t kind, const char *name)
+{
+    size_t n = strlen(name);
+    put_u8(o, kind);
+    put_u8(o, (uint8_t)n);
+    put(o, name, n);
+}
+
+static esp_err_t finish(const out_t *o, size_t *len)
+{
+    if (len) {
+        *len = o->len;
+    }
+    return (o->len <= o->size) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t metrics_export_binary(uint8_t *buf, size_t size, size_t *len)
+{
+    out_t o = {buf, buf ? size : 0, 0};
+    put(&o, "MTRC", 4);
+    put_u16(&o, BINARY_VERSION);
+    put_u8(&o, METRICS_SUB_BITS);
+    put_u8(&o, 0);
+    put_u16(&o, METRIC_COUNTERS + METRIC_GAUGES + METRIC_HISTOGRAMS);
+    put_u16(&o, 0);
+    put_u32(&o, uptime_ms());
+
+    for (int c = 0; c < METRIC_COUNTERS; ++c) {
+        put_name(&o, KIND_COUNTER, k_counter_names[c]);
+        put_u32(&o, metrics_counter((metric_counter_t)c));
+    }
+    for (int g = 0; g < METRIC_GAUGES; ++g) {
+        put_name(&o, KIND_GAUGE, k_gauge_names[g]);
+        put_u32(&o, (uint32_t)metrics_gauge((metric_gauge_t)g));
+    }
+    metrics_histogram_t hist;
+    for (int h = 0; h < METRIC_HISTOGRAMS; ++h) {
+        metrics_histogram((metric_histogram_t)h, &hist);
+        uint8_t used = 0;
+        for (unsigned b = 0; b < METRICS_BUCKETS; ++b) {
+            used += hist.buckets[b] != 0;
+        }
+        put_name(&o, KIND_HISTOGRAM, k_histogram_names[h]);
+        put_u32(&o, hist.max);
+        put_u8(&o, used);
+        for (unsigned b = 0; b < METRICS_BUCKETS; ++b) {
+            if (hist.buckets[b]) {
+                put_u8(&o, (uint8_t)b);
+                put_u32(&o, hist.buckets[b]);
+            }
+        }
+    }
+    return finish(&o, len);
+}
+
+/* One text line, without its newline */
+static void format_line(char *line, size_t size, int kind, int i)
+{
+    if (kind == KIND_COUNTER) {
+        snprintf(line, size, "%s counter %" PRIu32, k_counter_names[i],
+                 metrics_counter((metric_counter_t)i));
+    } else if (kind == KIND_GAUGE) {
+        snprintf(line, size, "%s gauge %" PRId32, k_gauge_names[i],
+                 metrics_gauge((metric_gauge_t)i));
+    } else {
+        metrics_histogram_t hist;
+        metrics_histogram((metric_histogram_t)i, &hist);
+        snprintf(line, size,
+                 "%s histogram count=%" PRIu32 " p50=%" PRIu32 " p90=%" PRIu32
+                 " p99=%" PRIu32 " max=%" PRIu32,
+                 k_histogram_names[i], hist.count,
+                 metrics_quantile(&hist, 0.50f), metrics_quantile(&hist, 0.90f),
+                 metrics_quantile(&hist, 0.99f), hist.max);
+    }
+}
+
+static const int k_kind_count[] = {METRIC_COUNTERS, METRIC_GAUGES,
+                                   METRIC_HISTOGRAMS};
+
+esp_err_t metrics_export_text(char *buf, size_t size, size_t *len)
+{
+    out_t o = {(uint8_t *)buf, buf ? size : 0, 0};
+    char line[128];
+    for (int kind = KIND_COUNTER; kind <= KIND_HISTOGRAM; ++kind) {
+        for (int i = 0; i < k_kind_count[kind]; ++i) {
+            format_line(line, sizeof(line) - 1, kind, i);
+            size_t n = strlen(line);
+            line[n++] = '\n';
+            put(&o, line, n);
+        }
+    }
+    if (len) {
+        *len = o.len;
+    }
+    if (o.len >= o.size) {
+        if (o.size) {
+            buf[0] = '\0';
+        }
+        return ESP_ERR_INVALID_SIZE;
+    }
+    buf[o.len] = '\0';
+    return ESP_OK;
+}
+
+void metrics_log(void)
+{
+    char line[128];
+    for (int kind = KIND_COUNTER; kind <= KIND_HISTOGRAM; ++kind) {
+        for (int i = 0; i < k_kind_count[kind]; ++i) {
+            format_line(line, sizeof(line), kind, i);
+            ESP_LOGI(TAG, "%s", line);
+        }
+    }
+}
+
+void metrics_reset(void)
+{
+    for (int c = 0; c < METRIC_COUNTERS; ++c) {
+        atomic_store_explicit(&s_counters[c], 0, memory_order_relaxed);
+    }
+    for (int g = 0; g < METRIC_GAUGES; ++g) {
+        atomic_store_explicit(&s_gauges[g], 0, memory_order_relaxed);
+    }
+    for (int h = 0; h < METRIC_HISTOGRAMS; ++h) {
+        for (unsigned b = 0; b < METRICS_BUCKETS; ++b) {
+            atomic_store_explicit(&s_histograms[h].buckets[b], 0,
+                                  memory_order_relaxed);
+        }
+        atomic_store_explicit(&s_histograms[h].max, 0, memory_order_relaxed);
+    }
+}
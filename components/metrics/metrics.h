@@ -0,0 +1,152 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Operational counters, gauges and histograms of the firmware.
+ *
+ * The registry is static: every metric is listed below and lives in a fixed
+ * array of 32-bit atomics in internal RAM, so updates are lock-free and safe
+ * from any task or interrupt, IRAM handlers included. Names carry their unit
+ * (_ms, _us, _bytes) and are exported with the values.
+ *
+ * Histograms are log-linear: values below 4 have their own bucket, above
+ * that each power of two is split into 4 equal buckets, so a bucket spans at
+ * most a quarter of its lower bound. 124 buckets cover all of uint32_t.
+ *
+ * A snapshot reads each value atomically but not all of them at once: a
+ * metric updated while it is exported may show the update or not.
+ */
+
+#define METRICS_COUNTERS(X)                                                    \
+    X(CAN_TX, "can_tx")                 /* frames queued */                    \
+    X(CAN_TX_FAIL, "can_tx_fail")       /* twai_transmit errors */             \
+    X(I2C_ERRORS, "i2c_errors")         /* failed transfers, timeouts incl. */ \
+    X(I2C_TIMEOUTS, "i2c_timeouts")                                            \
+    X(SD_MOUNTS, "sd_mounts")           /* successful (re)mounts */            \
+    X(SD_MOUNT_FAILS, "sd_mount_fails")                                        \
+    X(SD_LOSSES, "sd_losses")           /* card lost while mounted */          \
+    X(LOG_WRITE_ERRORS, "log_write_errors")                                    \
+    X(LOG_DROPPED, "log_dropped")       /* samples refused, ring full */       \
+    X(FEED_RUNS, "feed_runs")                                                  \
+    X(FEED_ON_MS, "feed_on_ms")                                                \
+    X(PUMP_RUNS, "pump_runs")                                                  \
+    X(PUMP_ON_MS, "pump_on_ms")                                                \
+    X(HEAT_RUNS, "heat_runs")                                                  \
+    X(HEAT_ON_MS, "heat_on_ms")
+
+#define METRICS_GAUGES(X)                                                      \
+    X(LOG_RING_USED, "log_ring_used_bytes")                                    \
+    X(SD_STATE, "sd_state") /* storage_card_state_t */
+
+#define METRICS_HISTOGRAMS(X)                                                  \
+    X(I2C_XFER_US, "i2c_xfer_us")                                              \
+    X(LOG_WRITE_US, "log_write_us")     /* one block write to the card */     \
+    X(LOG_SYNC_US, "log_sync_us")       /* fsync of the log files */
+
+typedef enum {
+#define METRICS_ENUM(id, name) METRIC_##id,
+    METRICS_COUNTERS(METRICS_ENUM)
+    METRIC_COUNTERS
+} metric_counter_t;
+
+typedef enum {
+    METRICS_GAUGES(METRICS_ENUM)
+    METRIC_GAUGES
+} metric_gauge_t;
+
+typedef enum {
+    METRICS_HISTOGRAMS(METRICS_ENUM)
+#undef METRICS_ENUM
+    METRIC_HISTOGRAMS
+} metric_histogram_t;
+
+#define METRICS_SUB_BITS 2
+#define METRICS_BUCKETS ((32 - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS)
+
+/** Add 1 to counter @p c. */
+void metrics_inc(metric_counter_t c);
+
+/** Add @p n to counter @p c; counters wrap at 2^32. */
+void metrics_add(metric_counter_t c, uint32_t n);
+
+/** Set gauge @p g. */
+void metrics_set(metric_gauge_t g, int32_t value);
+
+/** Count @p value in histogram @p h. */
+void metrics_record(metric_histogram_t h, uint32_t value);
+
+/** Current value of counter @p c. */
+uint32_t metrics_counter(metric_counter_t c);
+
+/** Current value of gauge @p g. */
+int32_t metrics_gauge(metric_gauge_t g);
+
+/** Histogram @p h: values counted, largest value, bucket counts. */
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint32_t buckets[METRICS_BUCKETS];
+} metrics_histogram_t;
+
+void metrics_histogram(metric_histogram_t h, metrics_histogram_t *out);
+
+/** Bucket of @p value and the smallest value of bucket @p b. */
+unsigned metrics_bucket(uint32_t value);
+uint32_t metrics_bucket_low(unsigned b);
+
+/**
+ * @brief Value at quantile @p q (0..1) of @p hist: the upper bound of the
+ * bucket holding it, capped at the largest value; 0 when empty.
+ */
+uint32_t metrics_quantile(const metrics_histogram_t *hist, float q);
+
+/**
+ * @brief Binary snapshot of every metric, little-endian:
+ *
+ *     "MTRC", u16 version (1), u8 METRICS_SUB_BITS, u8 0,
+ *     u16 metric count, u16 0, u32 uptime ms
+ *     then per metric: u8 kind (0 counter, 1 gauge, 2 histogram),
+ *     u8 name length, name, and
+ *       counter: u32 value; gauge: i32 value;
+ *       histogram: u32 max, u8 non-empty buckets, then per bucket
+ *                  u8 index, u32 count.
+ *
+ * @param[out] len Bytes written, or needed when @p size is too small.
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE when @p size is too small.
+ */
+esp_err_t metrics_export_binary(uint8_t *buf, size_t size, size_t *len);
+
+/**
+ * @brief Text snapshot, one metric per line:
+ *
+ *     can_tx_fail counter 3
+ *     sd_state gauge 2
+ *     log_write_us histogram count=120 p50=3071 p90=4095 p99=5210 max=5210
+ *
+ * Quantiles are bucket upper bounds, capped at the largest sample.
+ *
+ * @param[out] len Characters written without the final NUL, or needed when
+ *                 @p size is too small.
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE when @p size is too small.
+ */
+esp_err_t metrics_export_text(char *buf, size_t size, size_t *len);
+
+/** Log the text snapshot, one ESP_LOGI line per metric. */
+void metrics_log(void);
+
+/** Zero every metric. */
+void metrics_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
@@ -0,0 +1,65 @@
+#include "prng.h"
+#include <stdbool.h>
+
+typedef struct {
+    uint32_t s[4];
+} xoshiro128_t;
+
+static xoshiro128_t s_streams[PRNG_STREAM_COUNT];
+static uint32_t s_seed;
+static bool s_seeded;
+
+static inline uint32_t rotl(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+/* SplitMix32 spreads one seed over the 128-bit state of each stream */
+static uint32_t splitmix32(uint32_t *x)
+{
+    uint32_t z = (*x += 0x9E3779B9U);
+    z = (z ^ (z >> 16)) * 0x85EBCA6BU;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35U;
+    return z ^ (z >> 16);
+}
+
+void prng_seed(uint32_t seed)
+{
+    s_seed = seed;
+    for (int i = 0; i < PRNG_STREAM_COUNT; ++i) {
+        uint32_t x = seed ^ (0x632BE5ABU * (uint32_t)(i + 1));
+        for (int j = 0; j < 4; ++j) {
+            s_streams[i].s[j] = splitmix32(&x);
+        }
+    }
+    s_seeded = true;
+}
+
+uint32_t prng_get_seed(void)
+{
+    return s_seed;
+}
+
+uint32_t prng_next(prng_stream_t stream)
+{
+    if (!s_seeded) {
+        prng_seed(0);
+    }
+    uint32_t *s = s_streams[stream].s;
+    uint32_t result = rotl(s[1] * 5U, 7) * 9U;
+    uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+
+    return result;
+}
+
+uint32_t prng_range(prng_stream_t stream, uint32_t n)
+{
+    return (uint32_t)(((uint64_t)prng_next(stream) * n) >> 32);
+}
@@ -0,0 +1,47 @@
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Independent pseudo-random streams, one per subsystem.
+ *
+ * Each stream has its own xoshiro128** state derived from the common seed, so
+ * drawing more values in one subsystem never shifts the sequence of another.
+ * Streams are not thread-safe: each one must be used from a single task.
+ */
+typedef enum {
+    PRNG_STREAM_REPTILE = 0, /* reptile_logic */
+    PRNG_STREAM_SENSORS,     /* sensors_sim */
+    PRNG_STREAM_COUNT
+} prng_stream_t;
+
+/**
+ * @brief Reseed every stream from a single 32-bit seed.
+ *
+ * The same seed always yields the same sequences, on device and on host.
+ */
+void prng_seed(uint32_t seed);
+
+/** Seed passed to the last ::prng_seed call. */
+uint32_t prng_get_seed(void);
+
+/** Next 32-bit value of @p stream. */
+uint32_t prng_next(prng_stream_t stream);
+
+/**
+ * @brief Uniform value in [0, @p n) drawn from @p stream.
+ *
+ * Uses a multiply-shift reduction instead of a modulo.
+ */
+uint32_t prng_range(prng_stream_t stream, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PRNG_H
@@ -0,0 +1,157 @@
+#include "reptile_batch.h"
+#include "reptile_species_impl.h"
+#include <stdlib.h>
+#include <string.h>
+
+esp_err_t reptile_batch_init(reptile_batch_t *b, size_t capacity) {
+  if (!b || capacity == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memset(b, 0, sizeof(*b));
+
+  /* One block: five uint32_t arrays followed by the event bytes */
+  uint8_t *mem = calloc(capacity, 5 * sizeof(uint32_t) + sizeof(uint8_t));
+  reptile_rule_state_t *rules = calloc(capacity, sizeof(*rules));
+  if (!mem || !rules) {
+    free(mem);
+    free(rules);
+    return ESP_ERR_NO_MEM;
+  }
+  uint32_t *words = (uint32_t *)mem;
+  b->faim_q = words;
+  b->eau_q = words + capacity;
+  b->humeur_q = words + 2 * capacity;
+  b->temperature = words + 3 * capacity;
+  b->humidite = words + 4 * capacity;
+  b->event = (uint8_t *)(words + 5 * capacity);
+  b->rules = rules;
+  b->capacity = capacity;
+  b->count = 0;
+  b->last_update = time(NULL);
+  return ESP_OK;
+}
+
+void reptile_batch_free(reptile_batch_t *b) {
+  if (!b) {
+    return;
+  }
+  free(b->faim_q);
+  free(b->rules);
+  memset(b, 0, sizeof(*b));
+}
+
+esp_err_t reptile_batch_add(reptile_batch_t *b, const reptile_t *r,
+                            size_t *index) {
+  if (!b || !r) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (b->count == 0) {
+    b->species = r->species;
+  } else if (r->species != b->species) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (b->count >= b->capacity) {
+    return ESP_ERR_NO_MEM;
+  }
+  size_t i = b->count++;
+  reptile_batch_set(b, i, r);
+  if (index) {
+    *index = i;
+  }
+  return ESP_OK;
+}
+
+void reptile_batch_get(const reptile_batch_t *b, size_t i, reptile_t *out) {
+  if (!b || !out || i >= b->count) {
+    return;
+  }
+  out->faim_q = b->faim_q[i];
+  out->eau_q = b->eau_q[i];
+  out->humeur_q = b->humeur_q[i];
+  out->faim = reptile_q_view(b->faim_q[i]);
+  out->eau = reptile_q_view(b->eau_q[i]);
+  out->humeur = reptile_q_view(b->humeur_q[i]);
+  out->temperature = b->temperature[i];
+  out->humidite = b->humidite[i];
+  out->event = (reptile_event_t)b->event[i];
+  out->last_update = b->last_update;
+  out->clock_ms = b->clock_ms;
+  out->seed = 0;
+  out->species = b->species;
+  out->rules = b->rules[i];
+}
+
+void reptile_batch_set(reptile_batch_t *b, size_t i, const reptile_t *r) {
+  if (!b || !r || i >= b->count) {
+    return;
+  }
+  b->faim_q[i] = r->faim_q;
+  b->eau_q[i] = r->eau_q;
+  b->humeur_q[i] = r->humeur_q;
+  b->temperature[i] = r->temperature;
+  b->humidite[i] = r->humidite;
+  b->event[i] = (uint8_t)r->event;
+  b->rules[i] = r->rules;
+}
+
+static inline uint32_t clamp_u32(uint64_t v) {
+  return (v > UINT32_MAX) ? UINT32_MAX : (uint32_t)v;
+}
+
+/* Saturating subtraction written so the compiler emits a select, not a branch */
+static inline void decay_array(uint32_t *restrict v, size_t n, uint32_t d) {
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t x = v[i];
+    v[i] = (x > d) ? (x - d) : 0;
+  }
+}
+
+void reptile_update_batch(reptile_batch_t *b, uint32_t elapsed_ms) {
+  if (!b || elapsed_ms == 0) {
+    return;
+  }
+  uint64_t d_faim = 0, d_eau = 0, d_humeur = 0;
+  REPTILE_SPECIES_SWITCH(b->species, {
+    d_faim = (uint64_t)SP->faim_rate_q * elapsed_ms;
+    d_eau = (uint64_t)SP->eau_rate_q * elapsed_ms;
+    d_humeur = (uint64_t)SP->humeur_rate_q * elapsed_ms;
+  });
+  decay_array(b->faim_q, b->count, clamp_u32(d_faim));
+  decay_array(b->eau_q, b->count, clamp_u32(d_eau));
+  decay_array(b->humeur_q, b->count, clamp_u32(d_humeur));
+  uint32_t clock = (uint32_t)b->clock_ms + elapsed_ms % 1000U;
+  b->last_update += (time_t)(elapsed_ms / 1000U + clock / 1000U);
+  b->clock_ms = (uint16_t)(clock % 1000U);
+}
+
+REPTILE_ALWAYS_INLINE size_t
+check_events_species(reptile_batch_t *b, const reptile_species_profile_t *sp) {
+  const uint32_t *restrict faim = b->faim_q;
+  const uint32_t *restrict eau = b->eau_q;
+  const uint32_t *restrict humeur = b->humeur_q;
+  const uint32_t *restrict temp = b->temperature;
+  const uint32_t *restrict hum = b->humidite;
+  uint8_t *restrict event = b->event;
+  uint32_t now = (uint32_t)b->last_update;
+  size_t changed = 0;
+
+  /* No lifecycle in the batch: the cycle predicates stay false */
+  for (size_t i = 0; i < b->count; ++i) {
+    uint32_t preds =
+        reptile_rules_preds(sp, reptile_q_view(faim[i]), reptile_q_view(eau[i]),
+                            reptile_q_view(humeur[i]), temp[i], hum[i], 0);
+    uint8_t evt = reptile_rules_step(&b->rules[i], preds, now);
+    changed += (evt != event[i]);
+    event[i] = evt;
+  }
+  return changed;
+}
+
+size_t reptile_check_events_batch(reptile_batch_t *b) {
+  if (!b) {
+    return 0;
+  }
+  size_t changed = 0;
+  REPTILE_SPECIES_SWITCH(b->species, changed = check_events_species(b, SP));
+  return changed;
+}
@@ -0,0 +1,86 @@
+#ifndef REPTILE_BATCH_H
+#define REPTILE_BATCH_H
+
+#include "reptile_logic.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Population of reptiles stored as parallel arrays (structure of
+ * arrays).
+ *
+ * Each stat lives in its own contiguous array so that one pass of
+ * ::reptile_update_batch touches only the cache lines it modifies. Index @c i
+ * of every array describes the same animal. Temperature and humidity are
+ * environment inputs: the caller writes them per enclosure, the batch update
+ * only applies the decay. A batch holds a single species, taken from the
+ * first reptile added. The lifecycle (age, weight, timer wheel) is not
+ * carried: ::reptile_batch_get leaves those fields of its output untouched.
+ */
+typedef struct {
+  size_t count;
+  size_t capacity;
+  /* Fixed-point stats (REPTILE_Q_ONE per point) */
+  uint32_t *faim_q;
+  uint32_t *eau_q;
+  uint32_t *humeur_q;
+  uint32_t *temperature;
+  uint32_t *humidite;
+  uint8_t *event; /* reptile_event_t, stocké sur un octet */
+  reptile_rule_state_t *rules;
+  reptile_species_t species;
+  time_t last_update;
+  uint16_t clock_ms;
+} reptile_batch_t;
+
+/**
+ * @brief Allocate storage for @p capacity reptiles.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM.
+ */
+esp_err_t reptile_batch_init(reptile_batch_t *b, size_t capacity);
+
+/** Release the storage owned by the batch. */
+void reptile_batch_free(reptile_batch_t *b);
+
+/**
+ * @brief Append a reptile to the batch.
+ *
+ * @param index Optional output receiving the slot of the new reptile.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG (NULL or species differing from the
+ *         batch) or ESP_ERR_NO_MEM when full.
+ */
+esp_err_t reptile_batch_add(reptile_batch_t *b, const reptile_t *r,
+                            size_t *index);
+
+/** Copy reptile @p i of the batch into @p out. */
+void reptile_batch_get(const reptile_batch_t *b, size_t i, reptile_t *out);
+
+/** Overwrite reptile @p i of the batch with @p r. */
+void reptile_batch_set(reptile_batch_t *b, size_t i, const reptile_t *r);
+
+/**
+ * @brief Apply @p elapsed_ms of decay to every reptile of the batch.
+ *
+ * Same rule as ::reptile_update, at the decay rates of the batch species.
+ */
+void reptile_update_batch(reptile_batch_t *b, uint32_t elapsed_ms);
+
+/**
+ * @brief Evaluate events for every reptile of the batch.
+ *
+ * Same rule table as ::reptile_check_events, with minimum durations
+ * measured on @c b->last_update. The result is stored in @c b->event.
+ *
+ * @return Number of reptiles whose event changed.
+ */
+size_t reptile_check_events_batch(reptile_batch_t *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REPTILE_BATCH_H
@@ -0,0 +1,633 @@
+#include "reptile_journal.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "storage.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "reptile_journal";
+
+#define JNL_MAGIC "RJNL"
+#define JNL_VERSION 2
+#define SLOT_MAGIC "RSLT"
+
+/*
+ * Every field of reptile_t, as (member, units): arrays are split into units
+ * diffed and journaled one by one. Padding is never read, so it cannot make
+ * a save look dirty. A field missing here would not survive a load.
+ */
+#define JNL_FIELDS(X)                                                          \
+  X(faim, 1)                                                                   \
+  X(eau, 1)                                                                    \
+  X(temperature, 1)                                                            \
+  X(humidite, 1)                                                               \
+  X(humeur, 1)                                                                 \
+  X(event, 1)                                                                  \
+  X(last_update, 1)                                                            \
+  X(clock_ms, 1)                                                               \
+  X(faim_q, 1)                                                                 \
+  X(eau_q, 1)                                                                  \
+  X(humeur_q, 1)                                                               \
+  X(seed, 1)                                                                   \
+  X(species, 1)                                                                \
+  X(rules.active, 1)                                                           \
+  X(rules.pending, 1)                                                          \
+  X(rules.since, REPTILE_RULE_COUNT)                                           \
+  X(age_jours, 1)                                                              \
+  X(poids_g, 1)                                                                \
+  X(cycle, 1)                                                                  \
+  X(wheel.now, 1)                                                              \
+  X(wheel.free_head, 1)                                                        \
+  X(wheel.count, 1)                                                            \
+  X(wheel.head, sizeof(((reptile_t *)0)->wheel.head) / 8U)                     \
+  X(wheel.occupied, REPTILE_WHEEL_LEVELS)                                      \
+  X(wheel.pool, REPTILE_WHEEL_POOL)
+
+#define FIELD_SIZE(f) sizeof(((reptile_t *)0)->f)
+#define X_UNITS(f, n) +(n)
+#define X_BYTES(f, n) +FIELD_SIZE(f)
+#define X_SPAN(f, n) {offsetof(reptile_t, f), FIELD_SIZE(f) / (n), (n)},
+
+enum {
+  JNL_UNITS = 0 JNL_FIELDS(X_UNITS),
+  JNL_FIELD_BYTES = 0 JNL_FIELDS(X_BYTES),
+};
+
+/* Units of one field of reptile_t */
+typedef struct {
+  uint16_t offset;
+  uint8_t size; /* bytes per unit */
+  uint8_t count;
+} jnl_span_t;
+
+static const jnl_span_t k_spans[] = {JNL_FIELDS(X_SPAN)};
+
+typedef struct {
+  char magic[4];
+  uint16_t version;
+  uint16_t units; /* JNL_UNITS: the field list the records index */
+  uint32_t state_size;
+  uint32_t bytes; /* REPTILE_JOURNAL_BYTES of records after the header */
+  uint32_t generation; /* snapshot the records apply to */
+  uint32_t crc;
+} jnl_header_t;
+
+/*
+ * Record of one save, packed: generation (u32), payload length (u16), then
+ * the payload, a unit index (u8) followed by the unit bytes for each unit
+ * changed since the previous save, then a CRC32 of all that. A record is
+ * applied whole or not at all.
+ */
+#define REC_HEAD 6
+#define REC_MAX (REC_HEAD + JNL_UNITS + JNL_FIELD_BYTES + 4)
+
+/* Header of each of the two slots of the snapshot file */
+typedef struct {
+  char magic[4];
+  uint16_t layout;   /* REPTILE_STATE_LAYOUT of the payload */
+  uint16_t size;     /* payload bytes */
+  uint32_t sequence; /* generation of the snapshot */
+  uint32_t crc;      /* header up to here, then payload */
+} slot_header_t;
+
+/* Headerless snapshot of the first journal format: state, then trailer */
+typedef struct {
+  uint32_t generation;
+  uint32_t crc; /* state and generation */
+} snap_trailer_t;
+
+/* Layout 1: before the lifecycle fields and the MALADIE_LONGUE rule */
+typedef struct {
+  uint32_t faim;
+  uint32_t eau;
+  uint32_t temperature;
+  uint32_t humidite;
+  uint32_t humeur;
+  reptile_event_t event;
+  time_t last_update;
+  uint16_t clock_ms;
+  uint32_t faim_q;
+  uint32_t eau_q;
+  uint32_t humeur_q;
+  uint32_t seed;
+  reptile_species_t species;
+  struct {
+    uint64_t active;
+    uint64_t pending;
+    uint32_t since[11];
+  } rules;
+} reptile_state_v1_t;
+
+_Static_assert(sizeof(slot_header_t) + sizeof(reptile_t) <=
+                   REPTILE_JOURNAL_SLOT_SIZE,
+               "state does not fit in a save slot");
+_Static_assert(sizeof(reptile_state_v1_t) != sizeof(reptile_t),
+               "headerless layouts are told apart by their size");
+_Static_assert(JNL_UNITS <= 256, "unit index stored on one byte");
+_Static_assert(JNL_FIELD_BYTES <= sizeof(reptile_t),
+               "journaled fields overlap");
+
+static storage_file_t *s_jnl;
+static char s_snap_path[64];
+static uint32_t s_generation;   /* highest generation found on the card */
+static bool s_generation_known;
+static uint32_t s_next;         /* offset of the next record in the area */
+static time_t s_last_compact;   /* game time of the snapshot */
+static uint32_t s_compact_s = REPTILE_JOURNAL_COMPACT_S;
+static reptile_t s_image;       /* state as persisted so far */
+static reptile_t s_scratch;
+static uint8_t s_buf[REPTILE_JOURNAL_SLOT_SIZE]; /* raw snapshot payload */
+static uint8_t s_rec[REC_MAX];                   /* record being written or read */
+static reptile_journal_stats_t s_stats;
+
+static uint32_t crc32(const void *data, size_t len) {
+  return esp_rom_crc32_le(0, (const uint8_t *)data, len);
+}
+
+static uint32_t record_offset(uint32_t pos) {
+  return (uint32_t)sizeof(jnl_header_t) + pos;
+}
+
+/*
+ * Payload of the units of @p r that differ from @p old into @p out.
+ * @return Payload length, 0 when nothing changed.
+ */
+static size_t record_diff(const reptile_t *r, const reptile_t *old,
+                          uint8_t *out) {
+  size_t len = 0;
+  unsigned unit = 0;
+  for (size_t i = 0; i < sizeof(k_spans) / sizeof(k_spans[0]); ++i) {
+    const jnl_span_t *sp = &k_spans[i];
+    for (unsigned k = 0; k < sp->count; ++k, ++unit) {
+      size_t off = sp->offset + (size_t)k * sp->size;
+      const uint8_t *cur = (const uint8_t *)r + off;
+      if (memcmp(cur, (const uint8_t *)old + off, sp->size) != 0) {
+        out[len++] = (uint8_t)unit;
+        memcpy(out + len, cur, sp->size);
+        len += sp->size;
+      }
+    }
+  }
+  return len;
+}
+
+/* Apply a payload written by record_diff; false if it is malformed */
+static bool record_apply(reptile_t *r, const uint8_t *in, size_t len) {
+  size_t pos = 0;
+  while (pos < len) {
+    unsigned unit = in[pos++];
+    const jnl_span_t *sp = k_spans;
+    while (sp < k_spans + sizeof(k_spans) / sizeof(k_spans[0]) &&
+           unit >= sp->count) {
+      unit -= sp->count;
+      ++sp;
+    }
+    if (sp == k_spans + sizeof(k_spans) / sizeof(k_spans[0]) ||
+        len - pos < sp->size) {
+      return false;
+    }
+    memcpy((uint8_t *)r + sp->offset + (size_t)unit * sp->size, in + pos,
+           sp->size);
+    pos += sp->size;
+  }
+  return true;
+}
+
+void reptile_journal_close(void) {
+  if (s_jnl) {
+    storage_close(s_jnl);
+    s_jnl = NULL;
+  }
+  s_snap_path[0] = '\0';
+}
+
+void reptile_journal_set_compact_period(uint32_t seconds) {
+  s_compact_s = seconds;
+}
+
+void reptile_journal_get_stats(reptile_journal_stats_t *out) {
+  if (out) {
+    *out = s_stats;
+  }
+}
+
+/* Convert a payload of @p layout to the current reptile_t */
+static bool state_decode(uint16_t layout, const uint8_t *buf, size_t size,
+                         reptile_t *out) {
+  switch (layout) {
+  case REPTILE_STATE_LAYOUT:
+    if (size != sizeof(reptile_t)) {
+      return false;
+    }
+    memcpy(out, buf, size);
+    return true;
+  case 1: {
+    if (size != sizeof(reptile_state_v1_t)) {
+      return false;
+    }
+    reptile_state_v1_t v1;
+    memcpy(&v1, buf, sizeof(v1));
+    memset(out, 0, sizeof(*out));
+    out->faim = v1.faim;
+    out->eau = v1.eau;
+    out->temperature = v1.temperature;
+    out->humidite = v1.humidite;
+    out->humeur = v1.humeur;
+    out->event = v1.event;
+    out->last_update = v1.last_update;
+    out->clock_ms = v1.clock_ms;
+    out->faim_q = v1.faim_q;
+    out->eau_q = v1.eau_q;
+    out->humeur_q = v1.humeur_q;
+    out->seed = v1.seed;
+    /* Rule indices moved: timers restart, the lifecycle starts at birth */
+    reptile_set_species(out, v1.species);
+    ESP_LOGI(TAG, "Sauvegarde migrée depuis la version 1");
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+static uint32_t slot_crc(const slot_header_t *h, const uint8_t *payload) {
+  return esp_rom_crc32_le(crc32(h, offsetof(slot_header_t, crc)), payload,
+                          h->size);
+}
+
+static bool slot_read(storage_file_t *f, int slot, const slot_header_t *h,
+                      reptile_t *out) {
+  if (memcmp(h->magic, SLOT_MAGIC, sizeof(h->magic)) != 0 ||
+      h->size > REPTILE_JOURNAL_SLOT_SIZE - sizeof(*h) ||
+      storage_pread(f, s_buf, h->size,
+                    (uint32_t)slot * REPTILE_JOURNAL_SLOT_SIZE + sizeof(*h),
+                    NULL) != ESP_OK ||
+      slot_crc(h, s_buf) != h->crc) {
+    return false;
+  }
+  return state_decode(h->layout, s_buf, h->size, out);
+}
+
+/* Snapshot files written before the slots, told apart by their size */
+static bool legacy_read(storage_file_t *f, uint32_t size, reptile_t *out,
+                        uint32_t *gen) {
+  *gen = 0;
+  if (size > sizeof(s_buf) ||
+      storage_pread(f, s_buf, size, 0, NULL) != ESP_OK) {
+    return false;
+  }
+  if (size == sizeof(reptile_state_v1_t)) {
+    return state_decode(1, s_buf, size, out);
+  }
+  if (size == sizeof(reptile_t) + sizeof(snap_trailer_t)) {
+    snap_trailer_t tr;
+    memcpy(&tr, s_buf + sizeof(reptile_t), sizeof(tr));
+    if (esp_rom_crc32_le(crc32(s_buf, sizeof(reptile_t)),
+                         (const uint8_t *)&tr.generation,
+                         sizeof(tr.generation)) != tr.crc) {
+      return false;
+    }
+    *gen = tr.generation;
+    size = sizeof(reptile_t);
+  }
+  return state_decode(REPTILE_STATE_LAYOUT, s_buf, size, out);
+}
+
+/*
+ * Newest valid slot of the snapshot file: both headers are read, the slot
+ * with the higher sequence is checked first and the other one only if its
+ * CRC or layout is rejected (write torn by a power cut).
+ */
+static bool read_snapshot(const char *path, reptile_t *out, uint32_t *gen) {
+  storage_file_t *f;
+  if (storage_open(path, STORAGE_READ, &f) != ESP_OK) {
+    return false;
+  }
+  bool ok = false;
+  uint32_t size = 0;
+  if (storage_size(f, &size) != ESP_OK) {
+    size = 0;
+  }
+  if (size != 2U * REPTILE_JOURNAL_SLOT_SIZE) {
+    ok = size > 0 && legacy_read(f, size, out, gen);
+  } else {
+    slot_header_t h[2];
+    for (int i = 0; i < 2; ++i) {
+      if (storage_pread(f, &h[i], sizeof(h[i]),
+                        (uint32_t)i * REPTILE_JOURNAL_SLOT_SIZE,
+                        NULL) != ESP_OK) {
+        memset(&h[i], 0, sizeof(h[i]));
+      }
+    }
+    int first = (h[1].sequence > h[0].sequence) ? 1 : 0;
+    for (int k = 0; k < 2 && !ok; ++k) {
+      int i = first ^ k;
+      ok = slot_read(f, i, &h[i], out);
+      *gen = h[i].sequence;
+    }
+  }
+  storage_close(f);
+  if (!ok) {
+    ESP_LOGW(TAG, "Aucun instantané valide dans %s", path);
+  }
+  return ok;
+}
+
+static void slot_init(slot_header_t *h, const reptile_t *r, uint32_t gen) {
+  memset(h, 0, sizeof(*h));
+  memcpy(h->magic, SLOT_MAGIC, sizeof(h->magic));
+  h->layout = REPTILE_STATE_LAYOUT;
+  h->size = sizeof(reptile_t);
+  h->sequence = gen;
+  h->crc = slot_crc(h, (const uint8_t *)r);
+}
+
+/*
+ * Write generation @p gen into slot gen % 2, in place: a torn write leaves
+ * the other slot, one generation older, intact. A missing or legacy file
+ * is replaced by a new two-slot file through a rename.
+ */
+static esp_err_t write_snapshot(const char *path, const reptile_t *r,
+                                uint32_t gen) {
+  slot_header_t h;
+  slot_init(&h, r, gen);
+  uint32_t at = (gen & 1U) * REPTILE_JOURNAL_SLOT_SIZE;
+  /* Header and state leave in one write */
+  memcpy(s_buf, &h, sizeof(h));
+  memcpy(s_buf + sizeof(h), r, sizeof(reptile_t));
+  size_t len = sizeof(h) + sizeof(reptile_t);
+
+  storage_file_t *f;
+  uint32_t size = 0;
+  if (storage_open(path, STORAGE_RDWR, &f) != ESP_OK) {
+    f = NULL;
+  }
+  if (f && storage_size(f, &size) == ESP_OK &&
+      size == 2U * REPTILE_JOURNAL_SLOT_SIZE) {
+    bool ok = storage_pwrite(f, s_buf, len, at) == ESP_OK &&
+              storage_fsync(f) == ESP_OK;
+    ok = (storage_close(f) == ESP_OK) && ok;
+    if (!ok) {
+      ESP_LOGE(TAG, "Écriture de l'instantané %s échouée", path);
+      return ESP_FAIL;
+    }
+    s_stats.bytes += (uint32_t)len;
+    return ESP_OK;
+  }
+  if (f) {
+    storage_close(f);
+  }
+
+  char tmp[72];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  if (storage_open(tmp, STORAGE_CREATE, &f) != ESP_OK) {
+    ESP_LOGE(TAG, "Impossible d'ouvrir %s", tmp);
+    return ESP_FAIL;
+  }
+  /* The other slot is left zeroed, which no header matches */
+  memset(s_buf + len, 0, sizeof(s_buf) - len);
+  static const uint8_t zero[REPTILE_JOURNAL_SLOT_SIZE];
+  bool ok = true;
+  for (uint32_t pos = 0; pos < 2U * REPTILE_JOURNAL_SLOT_SIZE && ok;
+       pos += REPTILE_JOURNAL_SLOT_SIZE) {
+    ok = storage_pwrite(f, (pos == at) ? s_buf : zero,
+                        REPTILE_JOURNAL_SLOT_SIZE, pos) == ESP_OK;
+  }
+  ok = ok && storage_fsync(f) == ESP_OK;
+  ok = (storage_close(f) == ESP_OK) && ok;
+  /* FAT cannot rename over an existing file; load falls back on .tmp */
+  esp_err_t rm = ok ? storage_remove(path) : ESP_FAIL;
+  if (!ok || (rm != ESP_OK && rm != ESP_ERR_NOT_FOUND) ||
+      storage_rename(tmp, path) != ESP_OK) {
+    ESP_LOGE(TAG, "Écriture de l'instantané %s échouée", path);
+    return ESP_FAIL;
+  }
+  s_stats.bytes += 2U * REPTILE_JOURNAL_SLOT_SIZE;
+  return ESP_OK;
+}
+
+static void header_init(jnl_header_t *h, uint32_t gen) {
+  memset(h, 0, sizeof(*h));
+  memcpy(h->magic, JNL_MAGIC, sizeof(h->magic));
+  h->version = JNL_VERSION;
+  h->units = JNL_UNITS;
+  h->state_size = sizeof(reptile_t);
+  h->bytes = REPTILE_JOURNAL_BYTES;
+  h->generation = gen;
+  h->crc = crc32(h, offsetof(jnl_header_t, crc));
+}
+
+/* Restart the journal at @p path for generation @p gen, allocating it once */
+static esp_err_t journal_reset(const char *path, uint32_t gen) {
+  uint32_t size = record_offset(REPTILE_JOURNAL_BYTES);
+  if (!s_jnl) {
+    uint32_t have = 0;
+    if (storage_open(path, STORAGE_RDWR, &s_jnl) != ESP_OK) {
+      s_jnl = NULL;
+    } else if (storage_size(s_jnl, &have) != ESP_OK || have != size) {
+      reptile_journal_close();
+    }
+  }
+  if (!s_jnl) {
+    /* Pre-allocate: later writes stay inside the file's clusters */
+    if (storage_open(path, STORAGE_CREATE, &s_jnl) != ESP_OK) {
+      s_jnl = NULL;
+      ESP_LOGE(TAG, "Impossible de créer le journal %s", path);
+      return ESP_FAIL;
+    }
+    static const uint8_t zero[4096];
+    for (uint32_t pos = 0; pos < size; pos += sizeof(zero)) {
+      size_t n = (size - pos < sizeof(zero)) ? size - pos : sizeof(zero);
+      if (storage_pwrite(s_jnl, zero, n, pos) != ESP_OK) {
+        reptile_journal_close();
+        return ESP_FAIL;
+      }
+    }
+  }
+  jnl_header_t h;
+  header_init(&h, gen);
+  if (storage_pwrite(s_jnl, &h, sizeof(h), 0) != ESP_OK ||
+      storage_fsync(s_jnl) != ESP_OK) {
+    reptile_journal_close();
+    return ESP_FAIL;
+  }
+  s_next = 0;
+  return ESP_OK;
+}
+
+/* Header generation of the journal at @p path, 0 if unreadable */
+static uint32_t journal_generation(const char *path) {
+  jnl_header_t h;
+  storage_file_t *f;
+  if (storage_open(path, STORAGE_READ, &f) != ESP_OK) {
+    return 0;
+  }
+  bool ok = storage_pread(f, &h, sizeof(h), 0, NULL) == ESP_OK &&
+            memcmp(h.magic, JNL_MAGIC, sizeof(h.magic)) == 0 &&
+            h.crc == crc32(&h, offsetof(jnl_header_t, crc));
+  storage_close(f);
+  return ok ? h.generation : 0;
+}
+
+static void journal_path_set(const char *snap_path) {
+  snprintf(s_snap_path, sizeof(s_snap_path), "%s", snap_path);
+}
+
+static esp_err_t compact(const char *snap_path, const char *jnl_path,
+                         const reptile_t *r) {
+  if (strcmp(s_snap_path, snap_path) != 0) {
+    reptile_journal_close();
+    s_generation_known = false;
+  }
+  if (!s_generation_known) {
+    /* Generations only grow, so stale records of any earlier lap are
+     * rejected by the new one */
+    uint32_t snap_gen = 0;
+    read_snapshot(snap_path, &s_scratch, &snap_gen);
+    uint32_t jnl_gen = journal_generation(jnl_path);
+    s_generation = (snap_gen > jnl_gen) ? snap_gen : jnl_gen;
+    s_generation_known = true;
+  }
+  uint32_t gen = s_generation + 1U;
+  /* Snapshot first: a crash before the journal reset leaves records of the
+   * previous generation, which no longer match */
+  esp_err_t err = write_snapshot(snap_path, r, gen);
+  if (err == ESP_OK) {
+    err = journal_reset(jnl_path, gen);
+  }
+  if (err != ESP_OK) {
+    reptile_journal_close();
+    return err;
+  }
+  journal_path_set(snap_path);
+  s_generation = gen;
+  s_image = *r;
+  s_last_compact = r->last_update;
+  s_stats.compactions++;
+  s_stats.bytes += sizeof(jnl_header_t);
+  return ESP_OK;
+}
+
+esp_err_t reptile_journal_save(const char *snap_path, const char *jnl_path,
+                               const reptile_t *r) {
+  if (!snap_path || !jnl_path || !r) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_jnl || strcmp(s_snap_path, snap_path) != 0 ||
+      r->last_update - s_last_compact >= (time_t)s_compact_s ||
+      r->last_update < s_last_compact) {
+    return compact(snap_path, jnl_path, r);
+  }
+
+  size_t len = record_diff(r, &s_image, s_rec + REC_HEAD);
+  if (len == 0) {
+    return ESP_OK;
+  }
+  size_t size = REC_HEAD + len + 4;
+  if (s_next + size > REPTILE_JOURNAL_BYTES) {
+    return compact(snap_path, jnl_path, r);
+  }
+  uint16_t len16 = (uint16_t)len;
+  memcpy(s_rec, &s_generation, 4);
+  memcpy(s_rec + 4, &len16, 2);
+  uint32_t crc = crc32(s_rec, REC_HEAD + len);
+  memcpy(s_rec + REC_HEAD + len, &crc, 4);
+  if (storage_pwrite(s_jnl, s_rec, size, record_offset(s_next)) != ESP_OK ||
+      storage_fsync(s_jnl) != ESP_OK) {
+    ESP_LOGE(TAG, "Écriture du journal échouée");
+    reptile_journal_close();
+    return ESP_FAIL;
+  }
+  s_next += (uint32_t)size;
+  s_image = *r;
+  s_stats.saves++;
+  s_stats.records++;
+  s_stats.bytes += (uint32_t)size;
+  return ESP_OK;
+}
+
+/* Apply the whole records of the open journal; returns the next offset */
+static uint32_t journal_replay(reptile_t *state, uint32_t gen,
+                               uint32_t *saves) {
+  uint32_t pos = 0;
+  *saves = 0;
+  while (pos + REC_HEAD + 4 <= REPTILE_JOURNAL_BYTES) {
+    uint32_t rec_gen, crc;
+    uint16_t len;
+    if (storage_pread(s_jnl, s_rec, REC_HEAD, record_offset(pos), NULL) !=
+        ESP_OK) {
+      break;
+    }
+    memcpy(&rec_gen, s_rec, 4);
+    memcpy(&len, s_rec + 4, 2);
+    size_t size = REC_HEAD + (size_t)len + 4;
+    if (rec_gen != gen || len == 0 || size > REC_MAX ||
+        pos + size > REPTILE_JOURNAL_BYTES ||
+        storage_pread(s_jnl, s_rec + REC_HEAD, len + 4U,
+                      record_offset(pos) + REC_HEAD, NULL) != ESP_OK) {
+      break;
+    }
+    memcpy(&crc, s_rec + REC_HEAD + len, 4);
+    /* Torn or stale record: the saves before it are all there is */
+    reptile_t work = *state;
+    if (crc != crc32(s_rec, REC_HEAD + len) ||
+        !record_apply(&work, s_rec + REC_HEAD, len)) {
+      break;
+    }
+    *state = work;
+    pos += (uint32_t)size;
+    (*saves)++;
+  }
+  return pos;
+}
+
+esp_err_t reptile_journal_load(const char *snap_path, const char *jnl_path,
+                               reptile_t *out) {
+  if (!snap_path || !jnl_path || !out) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  reptile_journal_close();
+
+  char tmp[72];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", snap_path);
+  uint32_t gen;
+  if (!read_snapshot(snap_path, out, &gen)) {
+    /* Interrupted migration: the new slot file was not renamed yet */
+    if (!read_snapshot(tmp, out, &gen)) {
+      return ESP_FAIL;
+    }
+    storage_remove(snap_path);
+    if (storage_rename(tmp, snap_path) != ESP_OK) {
+      ESP_LOGW(TAG, "Impossible de renommer %s", tmp);
+    }
+  } else {
+    storage_remove(tmp);
+  }
+  uint32_t jnl_gen = journal_generation(jnl_path);
+  s_generation = (gen > jnl_gen) ? gen : jnl_gen;
+  s_generation_known = true;
+  s_image = *out;
+  s_last_compact = out->last_update;
+  s_stats.replayed = 0;
+
+  if (storage_open(jnl_path, STORAGE_RDWR, &s_jnl) != ESP_OK) {
+    s_jnl = NULL;
+  }
+  jnl_header_t h, want;
+  header_init(&want, gen);
+  if (s_jnl && storage_pread(s_jnl, &h, sizeof(h), 0, NULL) == ESP_OK &&
+      memcmp(&h, &want, sizeof(h)) == 0) {
+    s_next = journal_replay(out, gen, &s_stats.replayed);
+    s_image = *out;
+    journal_path_set(snap_path);
+    ESP_LOGI(TAG, "Instantané %" PRIu32 " + %" PRIu32 " sauvegardes",
+             gen, s_stats.replayed);
+  } else {
+    /* Other generation or layout: the next save compacts */
+    reptile_journal_close();
+  }
+  return ESP_OK;
+}
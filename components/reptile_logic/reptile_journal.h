@@ -0,0 +1,81 @@
+#ifndef REPTILE_JOURNAL_H
+#define REPTILE_JOURNAL_H
+
+#include "reptile_logic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Journaled storage behind ::reptile_save / ::reptile_load.
+ *
+ * The snapshot file has two fixed slots. Each holds a header (magic,
+ * REPTILE_STATE_LAYOUT, size, sequence number, CRC32) and a full state; the
+ * slot of generation g is g % 2 and is rewritten in place, so a torn write
+ * leaves the previous generation readable. Load reads both headers and
+ * takes the newest slot whose CRC matches, migrating older layouts; a
+ * headerless file from an earlier firmware is recognized by its size.
+ *
+ * Each save appends one record to a pre-allocated journal file, kept open:
+ * the fields of reptile_t that changed since the previous save, each as a
+ * one-byte index and its bytes (array fields element by element, padding
+ * never), with the generation of its snapshot and a CRC32. A simulated tick
+ * changes the stats, their fixed-point values, the time and the seed: about
+ * 45 bytes (tests/bench_storage.c) written in place, so FAT neither grows the file nor rewrites its
+ * directory entry. A journal of the chunked format of earlier firmware is
+ * not replayed: the saves since its snapshot, at most one compaction
+ * period, are lost once.
+ *
+ * Every REPTILE_JOURNAL_COMPACT_S of game time by default, or when the
+ * journal is full, the state is written to the snapshot slot of the next
+ * generation and the journal restarts from its first record; records of
+ * older generations are then ignored. Load applies the committed saves of
+ * the journal to the snapshot and stops at the first torn or stale record.
+ *
+ * Not thread-safe: saves come from a single writer (see reptile_persist.h).
+ */
+
+#define REPTILE_JOURNAL_BYTES (64 * 1024) /* record area after the header */
+#define REPTILE_JOURNAL_COMPACT_S 600
+#define REPTILE_JOURNAL_SLOT_SIZE 2048 /* bytes per snapshot slot */
+
+typedef struct {
+  uint32_t saves;       /* saves appended to the journal */
+  uint32_t records;     /* records written, one per save */
+  uint32_t bytes;       /* bytes written, snapshots included */
+  uint32_t compactions; /* snapshots written */
+  uint32_t replayed;    /* saves applied by the last load */
+} reptile_journal_stats_t;
+
+/**
+ * @brief Load the snapshot at @p snap_path and replay the journal at
+ * @p jnl_path on top of it.
+ *
+ * @return ESP_OK, ESP_FAIL when no snapshot is readable.
+ */
+esp_err_t reptile_journal_load(const char *snap_path, const char *jnl_path,
+                               reptile_t *out);
+
+/**
+ * @brief Persist @p r: append its changed chunks, or compact.
+ *
+ * Compacts when no journal is open (no prior load, change of path, after
+ * ::reptile_journal_close or an I/O error).
+ */
+esp_err_t reptile_journal_save(const char *snap_path, const char *jnl_path,
+                               const reptile_t *r);
+
+/** Game time between two compactions, in seconds (0: every save). */
+void reptile_journal_set_compact_period(uint32_t seconds);
+
+/** Close the journal, e.g. before the SD card is unmounted. */
+void reptile_journal_close(void);
+
+void reptile_journal_get_stats(reptile_journal_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REPTILE_JOURNAL_H
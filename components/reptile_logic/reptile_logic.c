@@ -1,32 +1,78 @@
 #include "reptile_logic.h"
+#include "reptile_journal.h"
+#include "reptile_species_impl.h"
 #include "esp_log.h"
 #include "esp_random.h"
+#include "prng.h"
 #include "gpio.h"
 #include "sensors.h"
 #include "sd.h"
+#include "storage.h"
 #include <stdbool.h>
 #include <math.h>
 #include <stdio.h>
-#include <sys/stat.h>
-#include <errno.h>
+#include <string.h>
 
 static const char *TAG = "reptile_logic";
 static bool s_sensors_ready = false;
 static bool s_simulation_mode = false;
 static bool log_once = false;
+static reptile_save_fn_t s_save_fn = reptile_save;
 
-static const char *get_save_path(void) {
-  static char path[64];
+#define REPTILE_PATH_LEN 64
+
+/* Snapshot and journal of the current mode, see reptile_journal.h */
+static void get_save_paths(char *snap, char *jnl) {
   const char *base = MOUNT_POINT;
-  if (s_simulation_mode) {
-    snprintf(path, sizeof(path), "%s/sim/reptile_state.bin", base);
-  } else {
-    snprintf(path, sizeof(path), "%s/real/reptile_state.bin", base);
-  }
-  return path;
+  const char *dir = s_simulation_mode ? "sim" : "real";
+  snprintf(snap, REPTILE_PATH_LEN, "%s/%s/reptile_state.bin", base, dir);
+  snprintf(jnl, REPTILE_PATH_LEN, "%s/%s/reptile_state.jnl", base, dir);
 }
 
 static void reptile_set_defaults(reptile_t *r);
+static void reptile_life_reset(reptile_t *r);
+
+#define REPTILE_SOOTHE_DURATION_MS 5000U
+#define REPTILE_SOOTHE_MOOD_PER_S 2U
+#define REPTILE_SOOTHE_RATE_Q (REPTILE_SOOTHE_MOOD_PER_S * REPTILE_Q_ONE / 1000U)
+#define REPTILE_Q_MAX (REPTILE_STAT_MAX * REPTILE_Q_ONE)
+
+#define REPTILE_JOUR_S 86400U
+#define REPTILE_INCUBATION_S 600U
+#define REPTILE_MALADIE_DUREE_S (6U * 3600U)
+#define REPTILE_MUE_PROLONGATION_S (12U * 3600U)
+#define REPTILE_MUE_PROLONGATIONS_MAX 4U
+
+/* Rules of the MALADIE event that have a cause, i.e. all but the lasting one */
+#define X(name, event, enter, hold, min_s, a, b)                               \
+  | (((event) == REPTILE_EVENT_MALADIE) ? 1ULL << REPTILE_RULE_##name : 0ULL)
+static const uint64_t k_maladie_causes =
+    (0ULL REPTILE_RULE_LIST(X, 0, 0)) & ~(1ULL << REPTILE_RULE_MALADIE_LONGUE);
+#undef X
+
+static void reptile_sync_views(reptile_t *r) {
+  r->faim = reptile_q_view(r->faim_q);
+  r->eau = reptile_q_view(r->eau_q);
+  r->humeur = reptile_q_view(r->humeur_q);
+}
+
+/* Add @p points to a fixed-point stat, capped at REPTILE_STAT_MAX */
+static inline uint32_t q_add_points(uint32_t q, uint32_t points) {
+  uint32_t add = points * REPTILE_Q_ONE;
+  return (q + add > REPTILE_Q_MAX) ? REPTILE_Q_MAX : q + add;
+}
+
+reptile_save_fn_t reptile_set_save_fn(reptile_save_fn_t fn) {
+  reptile_save_fn_t prev = s_save_fn;
+  s_save_fn = fn;
+  return prev;
+}
+
+static void reptile_autosave(reptile_t *r) {
+  if (s_save_fn) {
+    s_save_fn(r);
+  }
+}
 
 esp_err_t reptile_init(reptile_t *r, bool simulation) {
   if (!r) {
@@ -38,10 +84,10 @@ esp_err_t reptile_init(reptile_t *r, bool simulation) {
   char real_dir[64];
   snprintf(sim_dir, sizeof(sim_dir), "%s/sim", base);
   snprintf(real_dir, sizeof(real_dir), "%s/real", base);
-  if (mkdir(sim_dir, 0777) != 0 && errno != EEXIST) {
+  if (storage_mkdir(sim_dir) != ESP_OK) {
     ESP_LOGW(TAG, "Création du répertoire %s échouée", sim_dir);
   }
-  if (mkdir(real_dir, 0777) != 0 && errno != EEXIST) {
+  if (storage_mkdir(real_dir) != ESP_OK) {
     ESP_LOGW(TAG, "Création du répertoire %s échouée", real_dir);
   }
 
@@ -63,34 +109,206 @@ esp_err_t reptile_init(reptile_t *r, bool simulation) {
   return ESP_OK;
 }
 
+bool reptile_set_simulation(bool simulation) {
+  bool prev = s_simulation_mode;
+  s_simulation_mode = simulation;
+  return prev;
+}
+
 static void reptile_set_defaults(reptile_t *r) {
-  r->faim = 100;
-  r->eau = 100;
+  r->faim_q = REPTILE_Q_MAX;
+  r->eau_q = REPTILE_Q_MAX;
+  r->humeur_q = REPTILE_Q_MAX;
+  reptile_sync_views(r);
   r->temperature = 30;
   r->humidite = 50;
-  r->humeur = 100;
   r->event = REPTILE_EVENT_NONE;
   r->last_update = time(NULL);
+  r->clock_ms = 0;
+  r->species = REPTILE_SPECIES_GENERIQUE;
+  memset(&r->rules, 0, sizeof(r->rules));
+  reptile_life_reset(r);
+  reptile_set_seed(r, esp_random());
 }
 
-void reptile_update(reptile_t *r, uint32_t elapsed_ms) {
+void reptile_set_seed(reptile_t *r, uint32_t seed) {
+  if (!r) {
+    return;
+  }
+  r->seed = seed;
+  prng_seed(seed);
+}
+
+void reptile_set_species(reptile_t *r, reptile_species_t species) {
   if (!r) {
     return;
   }
+  if ((unsigned)species >= REPTILE_SPECIES_COUNT) {
+    species = REPTILE_SPECIES_GENERIQUE;
+  }
+  r->species = species;
+  memset(&r->rules, 0, sizeof(r->rules));
+  reptile_life_reset(r);
+}
+
+static void reptile_life_schedule(reptile_t *r, uint32_t at,
+                                  reptile_life_kind_t kind, uint16_t arg) {
+  if (reptile_wheel_schedule(&r->wheel, at, (uint8_t)kind, arg) != ESP_OK) {
+    ESP_LOGW(TAG, "Échéancier du cycle de vie plein");
+  }
+}
 
-  uint32_t decay = elapsed_ms / 1000U; /* 1 point per second */
+/* Juveniles shed twice as often as adults */
+static uint32_t reptile_mue_interval_s(const reptile_t *r,
+                                       const reptile_species_profile_t *sp) {
+  uint32_t jours = sp->mue_cycle_j;
+  if (r->age_jours < sp->maturite_j) {
+    jours /= 2U;
+  }
+  return (jours ? jours : 1U) * REPTILE_JOUR_S;
+}
 
-  r->faim = (r->faim > decay) ? (r->faim - decay) : 0;
-  r->eau = (r->eau > decay) ? (r->eau - decay) : 0;
-  r->humeur = (r->humeur > decay) ? (r->humeur - decay) : 0;
+/* Newborn of the current species, born at last_update */
+static void reptile_life_reset(reptile_t *r) {
+  const reptile_species_profile_t *sp = reptile_species_profile(r->species);
+  uint32_t now = (uint32_t)r->last_update;
+  r->age_jours = 0;
+  r->poids_g = sp->poids_naissance_g;
+  r->cycle = 0;
+  reptile_wheel_init(&r->wheel, now);
+  reptile_life_schedule(r, now + REPTILE_JOUR_S, REPTILE_LIFE_JOUR, 0);
+  reptile_life_schedule(r, now + reptile_mue_interval_s(r, sp),
+                        REPTILE_LIFE_MUE_DEBUT, 0);
+}
 
-  if (s_simulation_mode) {
-    uint32_t randv = esp_random();
-    float temp = 26.0f + (float)(randv % 80) / 10.0f; /* 26.0 - 33.9 */
-    randv = esp_random();
-    float hum = 40.0f + (float)(randv % 200) / 10.0f; /* 40.0 - 59.9 */
-    r->temperature = (uint32_t)temp;
-    r->humidite = (uint32_t)hum;
+/* One day older; juveniles that ate grow, starving reptiles lose 1 % */
+static void reptile_life_day(reptile_t *r,
+                             const reptile_species_profile_t *sp) {
+  if (r->age_jours < UINT16_MAX) {
+    r->age_jours++;
+  }
+  if (r->faim <= sp->famine) {
+    uint32_t loss = r->poids_g / 100U;
+    loss = loss ? loss : 1U;
+    r->poids_g = (r->poids_g > sp->poids_naissance_g + loss)
+                     ? (uint16_t)(r->poids_g - loss)
+                     : sp->poids_naissance_g;
+  } else if (!(r->cycle & REPTILE_CYCLE_MALADE) &&
+             r->poids_g < sp->poids_adulte_g) {
+    uint32_t gain = (uint32_t)(sp->poids_adulte_g - sp->poids_naissance_g) /
+                    (sp->maturite_j ? sp->maturite_j : 1U);
+    gain = gain ? gain : 1U;
+    r->poids_g = (r->poids_g + gain < sp->poids_adulte_g)
+                     ? (uint16_t)(r->poids_g + gain)
+                     : sp->poids_adulte_g;
+  }
+}
+
+/* Wheel callback: apply one lifecycle event and schedule its follow-up */
+static void reptile_life_event(void *ctx, uint8_t kind, uint16_t arg,
+                               uint32_t expires) {
+  reptile_t *r = (reptile_t *)ctx;
+  const reptile_species_profile_t *sp = reptile_species_profile(r->species);
+  switch ((reptile_life_kind_t)kind) {
+  case REPTILE_LIFE_JOUR:
+    reptile_life_day(r, sp);
+    reptile_life_schedule(r, expires + REPTILE_JOUR_S, REPTILE_LIFE_JOUR, 0);
+    break;
+  case REPTILE_LIFE_MUE_DEBUT:
+    r->cycle |= REPTILE_CYCLE_MUE;
+    reptile_life_schedule(r, expires + sp->mue_duree_h * 3600U,
+                          REPTILE_LIFE_MUE_FIN, 0);
+    break;
+  case REPTILE_LIFE_MUE_FIN:
+    /* Too dry: the old skin sticks and the shed drags on */
+    if (r->humidite < sp->mue_humidite &&
+        arg < REPTILE_MUE_PROLONGATIONS_MAX) {
+      reptile_life_schedule(r, expires + REPTILE_MUE_PROLONGATION_S,
+                            REPTILE_LIFE_MUE_FIN, (uint16_t)(arg + 1U));
+      break;
+    }
+    r->cycle &= (uint8_t)~REPTILE_CYCLE_MUE;
+    reptile_life_schedule(r, expires + reptile_mue_interval_s(r, sp),
+                          REPTILE_LIFE_MUE_DEBUT, 0);
+    break;
+  case REPTILE_LIFE_INCUBATION:
+    r->cycle &= (uint8_t)~REPTILE_CYCLE_INCUBATION;
+    r->cycle |= REPTILE_CYCLE_MALADE;
+    reptile_life_schedule(r, expires + REPTILE_MALADIE_DUREE_S,
+                          REPTILE_LIFE_GUERISON, 0);
+    break;
+  case REPTILE_LIFE_GUERISON:
+    r->cycle &= (uint8_t)~REPTILE_CYCLE_MALADE;
+    break;
+  }
+}
+
+/* Decay of @p ms at the species rates, then advance the clock */
+REPTILE_ALWAYS_INLINE void reptile_decay(reptile_t *r,
+                                         const reptile_species_profile_t *sp,
+                                         uint64_t ms) {
+  r->faim_q = reptile_q_decay(r->faim_q, sp->faim_rate_q, ms);
+  r->eau_q = reptile_q_decay(r->eau_q, sp->eau_rate_q, ms);
+  r->humeur_q = reptile_q_decay(r->humeur_q, sp->humeur_rate_q, ms);
+  reptile_sync_views(r);
+  uint64_t clock = (uint64_t)r->clock_ms + ms;
+  r->last_update += (time_t)(clock / 1000U);
+  r->clock_ms = (uint16_t)(clock % 1000U);
+}
+
+/*
+ * Decay of @p ms with the lifecycle events due in that interval applied in
+ * order, each on the stats of its own instant.
+ */
+REPTILE_ALWAYS_INLINE void reptile_advance(reptile_t *r,
+                                           const reptile_species_profile_t *sp,
+                                           uint64_t ms) {
+  uint64_t end_s = (uint64_t)(uint32_t)r->last_update +
+                   ((uint64_t)r->clock_ms + ms) / 1000U;
+  uint32_t due;
+  while ((due = reptile_wheel_next_expiry(&r->wheel)) <= end_s &&
+         due > (uint32_t)r->last_update) {
+    uint64_t step = (uint64_t)(due - (uint32_t)r->last_update) * 1000U -
+                    r->clock_ms;
+    reptile_decay(r, sp, step);
+    ms -= step;
+    reptile_wheel_advance(&r->wheel, due, reptile_life_event, r);
+  }
+  reptile_decay(r, sp, ms);
+  reptile_wheel_advance(&r->wheel, (uint32_t)r->last_update,
+                        reptile_life_event, r);
+}
+
+/* Simulated terrarium drawn inside the species' usual range */
+REPTILE_ALWAYS_INLINE void reptile_sim_env(reptile_t *r,
+                                           const reptile_species_profile_t *sp) {
+  float temp = (float)sp->sim_temp_min +
+               (float)prng_range(PRNG_STREAM_REPTILE, sp->sim_temp_span * 10U) /
+                   10.0f;
+  float hum = (float)sp->sim_hum_min +
+              (float)prng_range(PRNG_STREAM_REPTILE, sp->sim_hum_span * 10U) /
+                  10.0f;
+  r->temperature = (uint32_t)temp;
+  r->humidite = (uint32_t)hum;
+}
+
+void reptile_update(reptile_t *r, uint32_t elapsed_ms) {
+  reptile_update_with_env(r, elapsed_ms, NULL);
+}
+
+void reptile_update_with_env(reptile_t *r, uint32_t elapsed_ms,
+                             const reptile_env_t *env) {
+  if (!r) {
+    return;
+  }
+
+  REPTILE_SPECIES_SWITCH(r->species, reptile_advance(r, SP, elapsed_ms));
+
+  if (env) {
+    r->temperature = env->temperature;
+    r->humidite = env->humidite;
+  } else if (s_simulation_mode) {
+    REPTILE_SPECIES_SWITCH(r->species, reptile_sim_env(r, SP));
   } else if (s_sensors_ready) {
 
     float temp = sensors_read_temperature();
@@ -111,41 +329,287 @@ void reptile_update(reptile_t *r, uint32_t elapsed_ms) {
     ESP_LOGW(TAG, "Capteurs indisponibles");
     log_once = true;
   }
+}
 
-  r->last_update += (time_t)decay;
+bool reptile_tick_step(reptile_t *r, reptile_tick_ctx_t *ctx,
+                       uint32_t elapsed_ms, const reptile_env_t *env) {
+  if (!r || !ctx) {
+    return false;
+  }
+
+  time_t prev_s = r->last_update;
+  uint32_t prev_faim = r->faim, prev_eau = r->eau, prev_humeur = r->humeur;
+  reptile_update_with_env(r, elapsed_ms, env);
+
+  if (ctx->soothe_time_ms > 0) {
+    uint32_t ms = (ctx->soothe_time_ms < elapsed_ms) ? ctx->soothe_time_ms
+                                                     : elapsed_ms;
+    ctx->soothe_time_ms -= ms;
+    uint32_t bonus = ms * REPTILE_SOOTHE_RATE_Q;
+    r->humeur_q = (r->humeur_q + bonus > REPTILE_Q_MAX) ? REPTILE_Q_MAX
+                                                        : r->humeur_q + bonus;
+    r->humeur = reptile_q_view(r->humeur_q);
+  }
+
+  reptile_check_events(r);
+  return r->last_update != prev_s || r->faim != prev_faim ||
+         r->eau != prev_eau || r->humeur != prev_humeur;
+}
+
+void reptile_apply_action(reptile_t *r, reptile_tick_ctx_t *ctx,
+                          reptile_action_t action) {
+  if (!r) {
+    return;
+  }
+  switch (action) {
+  case REPTILE_ACTION_FEED:
+    reptile_feed(r);
+    break;
+  case REPTILE_ACTION_WATER:
+    reptile_give_water(r);
+    break;
+  case REPTILE_ACTION_HEAT:
+    reptile_heat(r);
+    break;
+  case REPTILE_ACTION_SOOTHE:
+    reptile_soothe(r);
+    if (ctx) {
+      ctx->soothe_time_ms = REPTILE_SOOTHE_DURATION_MS;
+    }
+    break;
+  }
+}
+
+/* One word at a time: a multiply and a shift per field, not per byte */
+static uint32_t hash_u32(uint32_t h, uint32_t v) {
+  h = (h ^ v) * 0x9E3779B1U;
+  return h ^ (h >> 15);
+}
+
+static uint32_t hash_u64(uint32_t h, uint64_t v) {
+  return hash_u32(hash_u32(h, (uint32_t)v), (uint32_t)(v >> 32));
+}
+
+uint32_t reptile_state_hash(const reptile_t *r) {
+  if (!r) {
+    return 0;
+  }
+  const uint32_t fields[] = {
+      r->faim,
+      r->eau,
+      r->temperature,
+      r->humidite,
+      r->humeur,
+      (uint32_t)r->event,
+      (uint32_t)r->last_update,
+      (uint32_t)r->species,
+      r->faim_q,
+      r->eau_q,
+      r->humeur_q,
+      r->clock_ms,
+      r->age_jours,
+      r->poids_g,
+      r->cycle,
+      r->seed,
+      (uint32_t)((uint64_t)r->last_update >> 32),
+  };
+  uint32_t h = 2166136261U;
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+    h = hash_u32(h, fields[i]);
+  }
+  /* Rule timers and lifecycle wheel, field by field: padding is not hashed */
+  h = hash_u64(h, r->rules.active);
+  h = hash_u64(h, r->rules.pending);
+  for (int i = 0; i < REPTILE_RULE_COUNT; ++i) {
+    h = hash_u32(h, r->rules.since[i]);
+  }
+  const reptile_wheel_t *w = &r->wheel;
+  h = hash_u32(h, w->now);
+  h = hash_u32(h, w->free_head | ((uint32_t)w->count << 8));
+  for (int l = 0; l < REPTILE_WHEEL_LEVELS; ++l) {
+    h = hash_u64(h, w->occupied[l]);
+  }
+  const uint8_t *head = &w->head[0][0];
+  for (size_t i = 0; i < sizeof(w->head); i += 4) {
+    h = hash_u32(h, (uint32_t)head[i] | ((uint32_t)head[i + 1] << 8) |
+                        ((uint32_t)head[i + 2] << 16) |
+                        ((uint32_t)head[i + 3] << 24));
+  }
+  for (int i = 0; i < REPTILE_WHEEL_POOL; ++i) {
+    h = hash_u32(h, w->pool[i].expires);
+    h = hash_u32(h, w->pool[i].next | ((uint32_t)w->pool[i].kind << 8) |
+                        ((uint32_t)w->pool[i].arg << 16));
+  }
+  return h;
+}
+
+reptile_event_t reptile_catch_up(reptile_t *r, time_t now) {
+  if (!r) {
+    return REPTILE_EVENT_NONE;
+  }
+  if (now < r->last_update) {
+    /*
+     * Clock set back: lifecycle timers and rules already pending keep the
+     * time they had left; a rule entering now starts its minimum duration.
+     */
+    uint32_t back = (uint32_t)(r->last_update - now);
+    reptile_wheel_rebase(&r->wheel, (uint32_t)now);
+    reptile_rules_rebase(&r->rules, back);
+    r->last_update = now;
+  }
+  if (now == r->last_update) {
+    return reptile_check_events(r);
+  }
+
+  /* Linear decay, saturated at 0: same result as any sequence of ticks */
+  time_t elapsed = now - r->last_update;
+  uint64_t ms = ((elapsed > (time_t)UINT32_MAX) ? UINT32_MAX
+                                                : (uint64_t)elapsed) *
+                1000U;
+  REPTILE_SPECIES_SWITCH(r->species, reptile_advance(r, SP, ms));
+  r->last_update = now;
+  reptile_wheel_advance(&r->wheel, (uint32_t)now, reptile_life_event, r);
+
+  /* Stats only decrease, so the final state alone decides the event */
+  return reptile_check_events(r);
+}
+
+/* Fixed-point stat and decay rate of each field; 0 for sampled fields */
+#define REPTILE_Q_faim(r) (r)->faim_q
+#define REPTILE_Q_eau(r) (r)->eau_q
+#define REPTILE_Q_humeur(r) (r)->humeur_q
+#define REPTILE_Q_temperature(r) 0U
+#define REPTILE_Q_humidite(r) 0U
+#define REPTILE_Q_cycle(r) 0U
+#define REPTILE_RATE_faim(sp) (sp)->faim_rate_q
+#define REPTILE_RATE_eau(sp) (sp)->eau_rate_q
+#define REPTILE_RATE_humeur(sp) (sp)->humeur_rate_q
+#define REPTILE_RATE_temperature(sp) 0U
+#define REPTILE_RATE_humidite(sp) 0U
+#define REPTILE_RATE_cycle(sp) 0U
+
+/*
+ * Largest fixed-point value whose view makes `view op threshold` take its
+ * decayed side: view <= T for LE/GT, view <= T - 1 for GE/LT.
+ */
+static inline int64_t flip_q_LE(uint32_t threshold) {
+  return (int64_t)threshold * REPTILE_Q_ONE;
+}
+static inline int64_t flip_q_GT(uint32_t threshold) {
+  return flip_q_LE(threshold);
+}
+static inline int64_t flip_q_GE(uint32_t threshold) {
+  return ((int64_t)threshold - 1) * REPTILE_Q_ONE;
+}
+static inline int64_t flip_q_LT(uint32_t threshold) {
+  return flip_q_GE(threshold);
+}
+/* Lifecycle flags do not decay; they change on wheel events */
+static inline int64_t flip_q_HAS(uint32_t mask) {
+  (void)mask;
+  return -1;
+}
+
+/* Milliseconds of decay at @p rate_q before @p q reaches @p target */
+static inline uint32_t ms_to_reach(uint32_t q, int64_t target,
+                                   uint32_t rate_q) {
+  if (target < 0 || (int64_t)q <= target) {
+    return UINT32_MAX;
+  }
+  uint64_t ms = ((uint64_t)((int64_t)q - target) + rate_q - 1U) / rate_q;
+  return (ms > UINT32_MAX) ? UINT32_MAX : (uint32_t)ms;
+}
+
+REPTILE_ALWAYS_INLINE uint32_t
+reptile_next_crossing_ms(const reptile_t *r,
+                         const reptile_species_profile_t *sp) {
+  uint32_t ms = UINT32_MAX;
+  uint32_t v;
+#define X(name, field, op, thr)                                                \
+  if (REPTILE_RATE_##field(sp)) {                                              \
+    v = ms_to_reach(REPTILE_Q_##field(r), flip_q_##op((uint32_t)(thr)),        \
+                    REPTILE_RATE_##field(sp));                                 \
+    ms = (v < ms) ? v : ms;                                                    \
+  }
+  REPTILE_PRED_LIST(X)
+#undef X
+  return ms;
+}
+
+uint32_t reptile_next_event_ms(const reptile_t *r) {
+  if (!r) {
+    return UINT32_MAX;
+  }
+  uint32_t ms = UINT32_MAX;
+  REPTILE_SPECIES_SWITCH(r->species, ms = reptile_next_crossing_ms(r, SP));
+
+  /* Rules waiting for their minimum duration, measured in whole seconds */
+  uint32_t now = (uint32_t)r->last_update;
+  for (uint64_t w = r->rules.pending; w; w &= w - 1) {
+    int i = __builtin_ctzll(w);
+    uint32_t waited = now - r->rules.since[i];
+    uint32_t left_s =
+        (waited < reptile_rule_min_s[i]) ? reptile_rule_min_s[i] - waited : 1U;
+    uint64_t v = (uint64_t)left_s * 1000U - r->clock_ms;
+    ms = (v < ms) ? (uint32_t)v : ms;
+  }
+
+  uint32_t due = reptile_wheel_next_expiry(&r->wheel);
+  if (due != UINT32_MAX) {
+    uint64_t v = (due > now) ? (uint64_t)(due - now) * 1000U - r->clock_ms : 0;
+    ms = (v < ms) ? (uint32_t)v : ms;
+  }
+  return ms;
+}
+
+void reptile_peek(const reptile_t *r, uint32_t elapsed_ms, reptile_t *out) {
+  if (!r || !out) {
+    return;
+  }
+  *out = *r;
+  REPTILE_SPECIES_SWITCH(r->species, reptile_decay(out, SP, elapsed_ms));
 }
 
 esp_err_t reptile_save(reptile_t *r) {
   if (!r) {
     return ESP_ERR_INVALID_ARG;
   }
-  const char *path = get_save_path();
-  FILE *f = fopen(path, "wb");
-  if (!f) {
-    ESP_LOGE(TAG, "Impossible d'ouvrir le fichier de sauvegarde SD");
-    return ESP_FAIL;
-  }
-  size_t written = fwrite(r, sizeof(reptile_t), 1, f);
-  fclose(f);
-  if (written != 1) {
-    ESP_LOGE(TAG, "Écriture incomplète de la sauvegarde SD");
-    return ESP_FAIL;
+  char snap[REPTILE_PATH_LEN], jnl[REPTILE_PATH_LEN];
+  get_save_paths(snap, jnl);
+  esp_err_t err = reptile_journal_save(snap, jnl, r);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Écriture de la sauvegarde SD échouée");
   }
-  return ESP_OK;
+  return err;
 }
 
 esp_err_t reptile_load(reptile_t *r) {
   if (!r) {
     return ESP_ERR_INVALID_ARG;
   }
-  const char *path = get_save_path();
-  FILE *f = fopen(path, "rb");
-  if (!f) {
+  char snap[REPTILE_PATH_LEN], jnl[REPTILE_PATH_LEN];
+  get_save_paths(snap, jnl);
+  if (reptile_journal_load(snap, jnl, r) != ESP_OK) {
     return ESP_FAIL;
   }
-  size_t read = fread(r, 1, sizeof(reptile_t), f);
-  fclose(f);
-  return (read == sizeof(reptile_t)) ? ESP_OK : ESP_FAIL;
+  if ((unsigned)r->species >= REPTILE_SPECIES_COUNT) {
+    r->species = REPTILE_SPECIES_GENERIQUE;
+  }
+  r->faim_q = (r->faim_q > REPTILE_Q_MAX) ? REPTILE_Q_MAX : r->faim_q;
+  r->eau_q = (r->eau_q > REPTILE_Q_MAX) ? REPTILE_Q_MAX : r->eau_q;
+  r->humeur_q = (r->humeur_q > REPTILE_Q_MAX) ? REPTILE_Q_MAX : r->humeur_q;
+  r->clock_ms %= 1000U;
+  r->cycle &= REPTILE_CYCLE_MUE | REPTILE_CYCLE_MALADE |
+              REPTILE_CYCLE_INCUBATION;
+  if (r->wheel.count > REPTILE_WHEEL_POOL ||
+      (r->wheel.free_head >= REPTILE_WHEEL_POOL &&
+       r->wheel.free_head != REPTILE_WHEEL_NIL)) {
+    ESP_LOGW(TAG, "Échéancier du cycle de vie invalide, réinitialisé");
+    reptile_life_reset(r);
+  }
+  reptile_sync_views(r);
+  prng_seed(r->seed);
+  return ESP_OK;
 
 }
 
@@ -153,24 +617,26 @@ void reptile_feed(reptile_t *r) {
   if (!r) {
     return;
   }
-  r->faim = (r->faim + 10 > 100) ? 100 : r->faim + 10;
+  r->faim_q = q_add_points(r->faim_q, 10);
+  r->faim = reptile_q_view(r->faim_q);
   if (!s_simulation_mode) {
     /* Physically pulse the feeder servo */
     reptile_feed_gpio();
   }
-  reptile_save(r);
+  reptile_autosave(r);
 }
 
 void reptile_give_water(reptile_t *r) {
   if (!r) {
     return;
   }
-  r->eau = (r->eau + 10 > 100) ? 100 : r->eau + 10;
+  r->eau_q = q_add_points(r->eau_q, 10);
+  r->eau = reptile_q_view(r->eau_q);
   if (!s_simulation_mode) {
     /* Activate the water pump */
     reptile_water_gpio();
   }
-  reptile_save(r);
+  reptile_autosave(r);
 }
 
 void reptile_heat(reptile_t *r) {
@@ -182,7 +648,7 @@ void reptile_heat(reptile_t *r) {
     /* Drive the heating resistor */
     reptile_heat_gpio();
   }
-  reptile_save(r);
+  reptile_autosave(r);
 }
 
 void reptile_soothe(reptile_t *r) {
@@ -190,8 +656,9 @@ void reptile_soothe(reptile_t *r) {
     return;
   }
   /* Petting the reptile improves its mood */
-  r->humeur = (r->humeur + 10 > 100) ? 100 : r->humeur + 10;
-  reptile_save(r);
+  r->humeur_q = q_add_points(r->humeur_q, 10);
+  r->humeur = reptile_q_view(r->humeur_q);
+  reptile_autosave(r);
 }
 
 reptile_event_t reptile_check_events(reptile_t *r) {
@@ -199,24 +666,28 @@ reptile_event_t reptile_check_events(reptile_t *r) {
     return REPTILE_EVENT_NONE;
   }
 
-  reptile_event_t evt = REPTILE_EVENT_NONE;
+  uint32_t preds = 0;
+  REPTILE_SPECIES_SWITCH(r->species,
+                         preds = reptile_rules_preds(SP, r->faim, r->eau,
+                                                     r->humeur, r->temperature,
+                                                     r->humidite, r->cycle));
+  r->event = (reptile_event_t)reptile_rules_step(&r->rules, preds,
+                                                 (uint32_t)r->last_update);
 
-  if (r->faim <= REPTILE_FAMINE_THRESHOLD || r->eau <= REPTILE_EAU_THRESHOLD ||
-      r->temperature <= REPTILE_TEMP_THRESHOLD_LOW ||
-      r->temperature >= REPTILE_TEMP_THRESHOLD_HIGH ||
-      r->humeur <= REPTILE_HUMEUR_THRESHOLD) {
-    evt = REPTILE_EVENT_MALADIE;
-  } else if (r->faim >= 90 && r->eau >= 90 && r->humeur >= 90 &&
-             r->temperature > REPTILE_TEMP_THRESHOLD_LOW &&
-             r->temperature < REPTILE_TEMP_THRESHOLD_HIGH) {
-    evt = REPTILE_EVENT_CROISSANCE;
+  /*
+   * A cause of illness held without a break for REPTILE_INCUBATION_S makes
+   * the reptile ill for REPTILE_MALADIE_DUREE_S, see MALADIE_LONGUE.
+   */
+  bool cause = (r->rules.active & k_maladie_causes) != 0;
+  if (cause && !(r->cycle & (REPTILE_CYCLE_MALADE | REPTILE_CYCLE_INCUBATION))) {
+    r->cycle |= REPTILE_CYCLE_INCUBATION;
+    reptile_life_schedule(r, (uint32_t)r->last_update + REPTILE_INCUBATION_S,
+                          REPTILE_LIFE_INCUBATION, 0);
+  } else if (!cause && (r->cycle & REPTILE_CYCLE_INCUBATION)) {
+    r->cycle &= (uint8_t)~REPTILE_CYCLE_INCUBATION;
+    reptile_wheel_cancel(&r->wheel, REPTILE_LIFE_INCUBATION);
   }
-
-  if (evt != r->event) {
-    r->event = evt;
-  }
-
-  return evt;
+  return r->event;
 }
 
 bool reptile_sensors_available(void) {
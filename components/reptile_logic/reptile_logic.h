@@ -14,8 +14,64 @@ typedef enum {
   REPTILE_EVENT_NONE = 0,
   REPTILE_EVENT_MALADIE,
   REPTILE_EVENT_CROISSANCE,
+  REPTILE_EVENT_MUE,
+  REPTILE_EVENT_DESHYDRATATION,
+  REPTILE_EVENT_COUP_DE_CHALEUR,
+  REPTILE_EVENT_ENNUI,
+  REPTILE_EVENT_COUNT,
 } reptile_event_t;
 
+typedef enum {
+  REPTILE_FAMINE_THRESHOLD = 30,
+  REPTILE_EAU_THRESHOLD = 30,
+  REPTILE_TEMP_THRESHOLD_LOW = 26,
+  REPTILE_TEMP_THRESHOLD_HIGH = 34,
+  REPTILE_HUMEUR_THRESHOLD = 40,
+  REPTILE_CROISSANCE_THRESHOLD = 90,
+  REPTILE_DESHYDRATATION_THRESHOLD = 10,
+  REPTILE_TEMP_THRESHOLD_STRESS = 38,
+  REPTILE_MUE_HUMIDITE_THRESHOLD = 65,
+  REPTILE_ENNUI_THRESHOLD = 60,
+} reptile_threshold_t;
+
+/** Lifecycle states lasting a duration, driven by the timer wheel. */
+typedef enum {
+  REPTILE_CYCLE_MUE = 1U << 0,
+  REPTILE_CYCLE_MALADE = 1U << 1,
+  REPTILE_CYCLE_INCUBATION = 1U << 2, /* a cause of illness is held */
+} reptile_cycle_t;
+
+/** Lifecycle events scheduled on reptile_t::wheel. */
+typedef enum {
+  REPTILE_LIFE_JOUR = 0,   /* age and weight, once a day */
+  REPTILE_LIFE_MUE_DEBUT,
+  REPTILE_LIFE_MUE_FIN,    /* arg: prolongations already granted */
+  REPTILE_LIFE_INCUBATION, /* cause held long enough: the illness sets in */
+  REPTILE_LIFE_GUERISON,
+} reptile_life_kind_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "reptile_species.h"
+#include "reptile_rules.h"
+#include "reptile_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Fixed-point unit of the stats: one point is REPTILE_Q_ONE. */
+#define REPTILE_Q_ONE 1000000U
+#define REPTILE_STAT_MAX 100U
+
+/**
+ * Version of the reptile_t layout stored in save slots. Bump it when the
+ * struct changes and teach reptile_journal.c to migrate the previous one.
+ */
+#define REPTILE_STATE_LAYOUT 2
+
 typedef struct {
   uint32_t faim;
   uint32_t eau;
@@ -24,24 +80,144 @@ typedef struct {
   uint32_t humeur;
   reptile_event_t event;
   time_t last_update;
+  uint16_t clock_ms; /* sub-second part of last_update */
+  /* Fixed-point stats; faim/eau/humeur are their views rounded up */
+  uint32_t faim_q;
+  uint32_t eau_q;
+  uint32_t humeur_q;
+  uint32_t seed; /* graine PRNG de la simulation */
+  reptile_species_t species;
+  reptile_rule_state_t rules; /* hysteresis and timers of the event rules */
+  uint16_t age_jours;
+  uint16_t poids_g;
+  uint8_t cycle;         /* REPTILE_CYCLE_* flags */
+  reptile_wheel_t wheel; /* pending lifecycle events, clock = last_update */
 } reptile_t;
 
 typedef enum {
-  REPTILE_FAMINE_THRESHOLD = 30,
-  REPTILE_EAU_THRESHOLD = 30,
-  REPTILE_TEMP_THRESHOLD_LOW = 26,
-  REPTILE_TEMP_THRESHOLD_HIGH = 34,
-  REPTILE_HUMEUR_THRESHOLD = 40,
-} reptile_threshold_t;
+  REPTILE_ACTION_FEED = 0,
+  REPTILE_ACTION_WATER,
+  REPTILE_ACTION_HEAT,
+  REPTILE_ACTION_SOOTHE,
+} reptile_action_t;
+
+/** Environment sample fed to the update instead of reading the sensors. */
+typedef struct {
+  uint32_t temperature;
+  uint32_t humidite;
+} reptile_env_t;
+
+/** Game state carried from one tick to the next. */
+typedef struct {
+  uint32_t soothe_time_ms; /* remaining duration of the soothe bonus */
+} reptile_tick_ctx_t;
+
+/** Persistence hook invoked by the actions after modifying the state. */
+typedef esp_err_t (*reptile_save_fn_t)(reptile_t *r);
 
 esp_err_t reptile_init(reptile_t *r, bool simulation);
+/**
+ * @brief Switch the actions between simulation (no GPIO) and hardware.
+ *
+ * Unlike ::reptile_init, neither the sensors nor the card are touched.
+ * Returns the previous mode so that it can be restored.
+ */
+bool reptile_set_simulation(bool simulation);
+/**
+ * @brief Select how actions persist the state.
+ *
+ * Defaults to ::reptile_save. Pass NULL to skip saving entirely, e.g. in
+ * host simulations that must stay CPU-bound.
+ */
+reptile_save_fn_t reptile_set_save_fn(reptile_save_fn_t fn);
 void reptile_update(reptile_t *r, uint32_t elapsed_ms);
+/**
+ * @brief Same as ::reptile_update, with the environment taken from @p env
+ * instead of the sensors or the simulation draws. NULL samples as usual.
+ */
+void reptile_update_with_env(reptile_t *r, uint32_t elapsed_ms,
+                             const reptile_env_t *env);
+/**
+ * @brief One game tick: decay, soothe bonus and events.
+ *
+ * Decay is linear in fixed point, so any split of an interval into ticks
+ * gives the same state as a single update (until a stat saturates).
+ *
+ * @param env Optional environment override, see ::reptile_update_with_env.
+ * @return true when the state changed and should be saved.
+ */
+bool reptile_tick_step(reptile_t *r, reptile_tick_ctx_t *ctx,
+                       uint32_t elapsed_ms, const reptile_env_t *env);
+/**
+ * @brief Apply a player action; soothing also starts the timed mood bonus
+ * tracked in @p ctx.
+ */
+void reptile_apply_action(reptile_t *r, reptile_tick_ctx_t *ctx,
+                          reptile_action_t action);
+/**
+ * @brief Hash of the full gameplay state of @p r, rule timers and lifecycle
+ * wheel included, used to compare two states.
+ */
+uint32_t reptile_state_hash(const reptile_t *r);
+/**
+ * @brief Apply in one step the decay accumulated since @c r->last_update.
+ *
+ * Decay costs O(1) whatever the time spent asleep or powered off; the
+ * lifecycle events due in the gap are replayed in order, one decay step
+ * each (about one per day of absence). Temperature and humidity are left
+ * untouched; they are refreshed by the next update. Timed rules are only
+ * evaluated once, at @p now: a rule already pending keeps its start time,
+ * but one whose condition was reached during the gap starts its minimum
+ * duration at @p now. If the wall clock went backwards, @c last_update, the
+ * lifecycle timers and the start times of pending rules are all moved back
+ * by the same amount: nothing decays, lifecycle timers and pending rules
+ * keep the time they had left, and a rule whose condition holds only from
+ * now on starts its minimum duration now.
+ *
+ * @param now Current wall-clock time.
+ * @return Event resulting from the catch-up.
+ */
+reptile_event_t reptile_catch_up(reptile_t *r, time_t now);
+/**
+ * @brief Milliseconds left before a decaying stat's integer view crosses a
+ * rule predicate, a pending rule reaches its minimum duration or a
+ * lifecycle event falls due.
+ *
+ * @return Delay in ms, or UINT32_MAX when no crossing is ahead.
+ */
+uint32_t reptile_next_event_ms(const reptile_t *r);
+/**
+ * @brief Predict the state after @p elapsed_ms without modifying @p r.
+ *
+ * Used to interpolate the displayed values between two ticks.
+ */
+void reptile_peek(const reptile_t *r, uint32_t elapsed_ms, reptile_t *out);
 esp_err_t reptile_load(reptile_t *r);
+/**
+ * @brief Reseed the simulation streams and store @p seed in the state.
+ *
+ * Two runs started from the same state and seed produce bit-identical
+ * trajectories.
+ */
+void reptile_set_seed(reptile_t *r, uint32_t seed);
+/**
+ * @brief Change the species of @p r; its decay rates, thresholds and sprite
+ * set (read by the UI when the game screen is built) follow the new
+ * profile. Rule timers restart and the lifecycle starts over from a newborn
+ * of that species.
+ */
+void reptile_set_species(reptile_t *r, reptile_species_t species);
 esp_err_t reptile_save(reptile_t *r);
 void reptile_feed(reptile_t *r);
 void reptile_give_water(reptile_t *r);
 void reptile_heat(reptile_t *r);
 void reptile_soothe(reptile_t *r);
+/**
+ * @brief Evaluate the rule table (reptile_rules.h) on @p r.
+ *
+ * Minimum durations are measured on @c r->last_update, so the result
+ * depends on the sequence of calls and not only on the current stats.
+ */
 reptile_event_t reptile_check_events(reptile_t *r);
 bool reptile_sensors_available(void);
 
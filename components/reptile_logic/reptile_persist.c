@@ -0,0 +1,233 @@
+#include "reptile_persist.h"
+#include "reptile_journal.h"
+#include "storage_supervisor.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "reptile_persist";
+
+static TaskHandle_t s_task;
+static SemaphoreHandle_t s_lock;    /* guards everything below up to s_stats */
+static SemaphoreHandle_t s_flushed; /* given when a flush request is served */
+static reptile_t s_pending;
+static bool s_dirty;
+static bool s_busy; /* a snapshot is being written */
+static bool s_flush_req;
+static bool s_close_req; /* close the journal once the flush is served */
+static reptile_t *s_load_req; /* then load the saved state into it */
+static esp_err_t s_load_err;
+static TickType_t s_dirty_since;
+static esp_err_t s_flush_err;
+static reptile_persist_stats_t s_stats;
+static uint32_t s_window_ms;
+static reptile_t s_writing; /* task-private copy, written outside the lock */
+static uint32_t s_epoch;    /* card mount the open journal belongs to */
+static uint32_t s_failures; /* consecutive failed writes, card present */
+
+static void persist_write(void) {
+  /* The journal kept open on a previous mount is stale after a remount */
+  uint32_t epoch = storage_supervisor_epoch();
+  if (epoch != s_epoch) {
+    reptile_journal_close();
+    s_epoch = epoch;
+  }
+  int64_t t0 = esp_timer_get_time();
+  esp_err_t err = reptile_save(&s_writing);
+  uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+  /* Card gone: keep the snapshot and retry once the supervisor remounts */
+  bool retry = err != ESP_OK && s_failures < REPTILE_PERSIST_RETRIES &&
+               storage_supervisor_report_error() == ESP_OK;
+
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_stats.writes++;
+  if (err != ESP_OK) {
+    s_stats.errors++;
+  }
+  if (us > s_stats.max_write_us) {
+    s_stats.max_write_us = us;
+  }
+  if (retry && !s_dirty) {
+    /* Nothing newer was submitted meanwhile */
+    memcpy(&s_pending, &s_writing, sizeof(s_pending));
+    s_dirty = true;
+    s_dirty_since = xTaskGetTickCount();
+  }
+  s_failures = retry ? s_failures + 1U : 0U;
+  s_flush_err = err;
+  s_busy = false;
+  xSemaphoreGive(s_lock);
+
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Sauvegarde différée échouée: %s%s", esp_err_to_name(err),
+             retry ? ", attente de la carte" : "");
+  }
+  if (retry &&
+      storage_supervisor_wait_ready(REPTILE_PERSIST_READY_WAIT_MS) != ESP_OK) {
+    /* Retried anyway, without blocking flushes for good; the last retry
+     * that fails drops the snapshot until the next submit */
+    ESP_LOGW(TAG, "Carte toujours absente après %u ms, essai %" PRIu32 "/%u",
+             REPTILE_PERSIST_READY_WAIT_MS, s_failures,
+             REPTILE_PERSIST_RETRIES);
+  }
+}
+
+static void persist_task(void *arg) {
+  (void)arg;
+  for (;;) {
+    /* Woken by the first change after a write, or by a flush */
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    for (;;) {
+      xSemaphoreTake(s_lock, portMAX_DELAY);
+      bool flush = s_flush_req;
+      if (!s_dirty) {
+        /* Clean and idle: a flush is served once nothing is left to write */
+        /* Under the lock: a caller that timed out sees it done or not */
+        if (flush && s_close_req && s_flush_err == ESP_OK) {
+          reptile_journal_close();
+        }
+        if (flush && s_load_req) {
+          s_load_err = reptile_load(s_load_req);
+        }
+        s_flush_req = false;
+        s_close_req = false;
+        s_load_req = NULL;
+        xSemaphoreGive(s_lock);
+        if (flush) {
+          xSemaphoreGive(s_flushed);
+        }
+        break;
+      }
+      TickType_t waited = xTaskGetTickCount() - s_dirty_since;
+      TickType_t window = pdMS_TO_TICKS(s_window_ms);
+      if (!flush && waited < window) {
+        xSemaphoreGive(s_lock);
+        /* A flush request cuts the wait short */
+        ulTaskNotifyTake(pdTRUE, window - waited);
+        continue;
+      }
+      memcpy(&s_writing, &s_pending, sizeof(s_writing));
+      s_dirty = false;
+      s_busy = true;
+      xSemaphoreGive(s_lock);
+
+      persist_write();
+    }
+  }
+}
+
+esp_err_t reptile_persist_start(uint32_t window_ms) {
+  if (s_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!s_lock) {
+    s_lock = xSemaphoreCreateMutex();
+    s_flushed = xSemaphoreCreateBinary();
+    if (!s_lock || !s_flushed) {
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  s_window_ms = window_ms;
+  s_epoch = storage_supervisor_epoch();
+  if (xTaskCreate(persist_task, "reptile_persist",
+                  REPTILE_PERSIST_TASK_STACK_SIZE, NULL,
+                  REPTILE_PERSIST_TASK_PRIORITY, &s_task) != pdPASS) {
+    s_task = NULL;
+    return ESP_ERR_NO_MEM;
+  }
+  ESP_LOGI(TAG, "Sauvegarde différée, fenêtre %" PRIu32 " ms", window_ms);
+  return ESP_OK;
+}
+
+esp_err_t reptile_persist_submit(reptile_t *r) {
+  if (!r) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_task) {
+    return reptile_save(r);
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  memcpy(&s_pending, r, sizeof(s_pending));
+  bool wake = !s_dirty;
+  if (wake) {
+    s_dirty = true;
+    s_dirty_since = xTaskGetTickCount();
+  }
+  s_stats.submits++;
+  xSemaphoreGive(s_lock);
+  if (wake) {
+    xTaskNotifyGive(s_task);
+  }
+  return ESP_OK;
+}
+
+/* Flush, then close the journal or load @p load on the task */
+static esp_err_t persist_sync(uint32_t timeout_ms, bool close,
+                              reptile_t *load) {
+  if (!s_task) {
+    if (close) {
+      reptile_journal_close();
+    }
+    return load ? reptile_load(load) : ESP_OK;
+  }
+  xSemaphoreTake(s_flushed, 0); /* drop the completion of a timed-out flush */
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  if (!s_dirty && !s_busy) {
+    if (!close && !load) {
+      xSemaphoreGive(s_lock);
+      return ESP_OK;
+    }
+    s_flush_err = ESP_OK; /* nothing pending, the task only closes or loads */
+  }
+  s_flush_req = true;
+  s_close_req = close;
+  s_load_req = load;
+  xSemaphoreGive(s_lock);
+
+  xTaskNotifyGive(s_task);
+  if (xSemaphoreTake(s_flushed, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+    /* Nothing touches the journal or @p load once this returns */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_close_req = false;
+    s_load_req = NULL;
+    xSemaphoreGive(s_lock);
+    return ESP_ERR_TIMEOUT;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  esp_err_t err = load ? s_load_err : s_flush_err;
+  xSemaphoreGive(s_lock);
+  return err;
+}
+
+esp_err_t reptile_persist_flush(uint32_t timeout_ms) {
+  return persist_sync(timeout_ms, false, NULL);
+}
+
+esp_err_t reptile_persist_close(uint32_t timeout_ms) {
+  return persist_sync(timeout_ms, true, NULL);
+}
+
+esp_err_t reptile_persist_load(reptile_t *r, uint32_t timeout_ms) {
+  if (!r) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return persist_sync(timeout_ms, false, r);
+}
+
+void reptile_persist_get_stats(reptile_persist_stats_t *out) {
+  if (!out) {
+    return;
+  }
+  if (!s_lock) {
+    memset(out, 0, sizeof(*out));
+    return;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  *out = s_stats;
+  xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,89 @@
+#ifndef REPTILE_PERSIST_H
+#define REPTILE_PERSIST_H
+
+#include "reptile_logic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Write-behind persistence of the reptile state.
+ *
+ * ::reptile_persist_submit copies the state into a pending snapshot and
+ * returns: the caller (LVGL task, action callbacks) pays a memcpy under a
+ * short lock. A background task writes the latest snapshot with
+ * ::reptile_save once @c window_ms have elapsed since the first unsaved
+ * change, so every tick and action of that window costs a single SD write.
+ * When a write fails while the storage supervisor runs, the snapshot is kept
+ * and the task waits for the card to be mounted again, at most
+ * ::REPTILE_PERSIST_READY_WAIT_MS, before retrying.
+ */
+
+#define REPTILE_PERSIST_TASK_STACK_SIZE (4 * 1024)
+#define REPTILE_PERSIST_TASK_PRIORITY 1 /* below the LVGL task */
+#define REPTILE_PERSIST_RETRIES 3 /* failed writes kept while the card answers */
+#define REPTILE_PERSIST_READY_WAIT_MS 30000 /* wait for a remount, per retry */
+
+typedef struct {
+  uint32_t submits;      /* snapshots received */
+  uint32_t writes;       /* reptile_save calls */
+  uint32_t errors;       /* failed writes */
+  uint32_t max_write_us; /* longest reptile_save */
+} reptile_persist_stats_t;
+
+/**
+ * @brief Start the persistence task.
+ *
+ * @param window_ms Maximum age of an unsaved change; 0 writes as soon as the
+ *                  task runs.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if already running, ESP_ERR_NO_MEM.
+ */
+esp_err_t reptile_persist_start(uint32_t window_ms);
+
+/**
+ * @brief Queue a snapshot of @p r for writing.
+ *
+ * Matches ::reptile_save_fn_t, see ::reptile_set_save_fn. Saves
+ * synchronously when the task is not running.
+ */
+esp_err_t reptile_persist_submit(reptile_t *r);
+
+/**
+ * @brief Write the pending snapshot now and wait for it, e.g. before the
+ * SD card is unmounted.
+ *
+ * @return Result of the write, ESP_OK if nothing was pending,
+ *         ESP_ERR_TIMEOUT after @p timeout_ms.
+ */
+esp_err_t reptile_persist_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Flush, then close the journal on the persistence task, so the close
+ * never races a write, e.g. before the SD card is unmounted.
+ *
+ * The journal stays open when the flush fails or times out.
+ *
+ * @return As ::reptile_persist_flush.
+ */
+esp_err_t reptile_persist_close(uint32_t timeout_ms);
+
+/**
+ * @brief Flush, then ::reptile_load into @p r on the persistence task, so the
+ * journal is never read while a snapshot is written.
+ *
+ * Loads directly when the task is not running. A failed flush does not stop
+ * the load: it returns the last complete save.
+ *
+ * @return Result of ::reptile_load, ESP_ERR_TIMEOUT after @p timeout_ms
+ *         (@p r is then left alone).
+ */
+esp_err_t reptile_persist_load(reptile_t *r, uint32_t timeout_ms);
+
+void reptile_persist_get_stats(reptile_persist_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REPTILE_PERSIST_H
@@ -0,0 +1,621 @@
+#include "reptile_replay.h"
+#include "reptile_species_impl.h"
+#include "storage.h"
+#include "storage_supervisor.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REC_TICK 0x01
+#define REC_ACTION 0x02
+#define REC_SYNC 0x03
+
+#define REPLAY_READ_CHUNK 512U
+
+static const char *TAG = "reptile_replay";
+static const uint8_t MAGIC[4] = {'R', 'P', 'L', 'Y'};
+
+/*
+ * Recorder: the game thread serializes each record into s_buf under s_lock
+ * and returns; the recorder task moves the buffer to the card. When the
+ * buffer is full or a write fails, records are lost and the next one is a
+ * SYNC (or the header when the file was never started), so the stream stays
+ * replayable.
+ */
+static TaskHandle_t s_task;
+static SemaphoreHandle_t s_lock;   /* guards everything below up to s_out */
+static SemaphoreHandle_t s_synced; /* given when a flush request is served */
+static uint8_t *s_buf;             /* REPTILE_RECORDER_BUF_SIZE bytes */
+static size_t s_len;
+static char s_path[64];
+static uint32_t s_session;  /* incremented by each new recording */
+static bool s_active;
+static bool s_create;       /* s_buf starts with the header of a new file */
+static bool s_started;      /* the header of this session is on the card */
+static bool s_resync;       /* records were lost since the last write */
+static bool s_flush_req;
+static bool s_close_req;    /* close the file once the flush is served */
+static esp_err_t s_flush_err;
+static uint8_t *s_out;      /* task-private copy, written outside the lock */
+static storage_file_t *s_file;
+static uint32_t s_epoch;    /* card mount s_file belongs to */
+static uint32_t s_size;     /* bytes of the file known to be written */
+
+/* Bounded output into the record buffer; a record that does not fit is
+ * dropped as a whole */
+typedef struct {
+  uint8_t *data;
+  size_t len;
+  size_t cap;
+  bool full;
+} rec_out_t;
+
+/* Buffered reader over the storage backend */
+typedef struct {
+  storage_file_t *f;
+  uint32_t off;
+  size_t pos;
+  size_t len;
+  uint8_t buf[REPLAY_READ_CHUNK];
+} rec_in_t;
+
+static void put_bytes(rec_out_t *o, const void *p, size_t n) {
+  if (o->full || o->cap - o->len < n) {
+    o->full = true;
+    return;
+  }
+  memcpy(o->data + o->len, p, n);
+  o->len += n;
+}
+
+static void put_u8(rec_out_t *o, uint8_t v) { put_bytes(o, &v, 1); }
+
+static void put_u32(rec_out_t *o, uint32_t v) {
+  uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16),
+                  (uint8_t)(v >> 24)};
+  put_bytes(o, b, sizeof(b));
+}
+
+static void put_varint(rec_out_t *o, uint32_t v) {
+  uint8_t b[5];
+  size_t n = 0;
+  do {
+    b[n] = (uint8_t)(v & 0x7FU);
+    v >>= 7;
+    if (v) {
+      b[n] |= 0x80U;
+    }
+    ++n;
+  } while (v);
+  put_bytes(o, b, n);
+}
+
+static int get_u8(rec_in_t *in) {
+  if (in->pos == in->len) {
+    size_t done = 0;
+    if (storage_pread(in->f, in->buf, sizeof(in->buf), in->off, &done) !=
+            ESP_OK ||
+        done == 0) {
+      return EOF;
+    }
+    in->off += (uint32_t)done;
+    in->pos = 0;
+    in->len = done;
+  }
+  return in->buf[in->pos++];
+}
+
+static bool get_bytes(rec_in_t *in, void *p, size_t n) {
+  uint8_t *d = p;
+  for (size_t i = 0; i < n; ++i) {
+    int c = get_u8(in);
+    if (c == EOF) {
+      return false;
+    }
+    d[i] = (uint8_t)c;
+  }
+  return true;
+}
+
+static bool get_u32(rec_in_t *in, uint32_t *v) {
+  uint8_t b[4];
+  if (!get_bytes(in, b, sizeof(b))) {
+    return false;
+  }
+  *v = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) |
+       ((uint32_t)b[3] << 24);
+  return true;
+}
+
+static bool get_varint(rec_in_t *in, uint32_t *v) {
+  uint32_t out = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    int c = get_u8(in);
+    if (c == EOF) {
+      return false;
+    }
+    out |= (uint32_t)(c & 0x7F) << shift;
+    if (!(c & 0x80)) {
+      *v = out;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void put_u64(rec_out_t *o, uint64_t v) {
+  put_u32(o, (uint32_t)v);
+  put_u32(o, (uint32_t)(v >> 32));
+}
+
+static bool get_u64(rec_in_t *in, uint64_t *v) {
+  uint32_t lo, hi;
+  if (!get_u32(in, &lo) || !get_u32(in, &hi)) {
+    return false;
+  }
+  *v = ((uint64_t)hi << 32) | lo;
+  return true;
+}
+
+/*
+ * Full state: fixed-point stats, environment, event, last_update (64-bit)
+ * and its ms part, seed, species, then the rule masks and timers prefixed by
+ * the rule count, then the lifecycle and its timer wheel field by field so
+ * that timers due in the same second fire in the recorded order. Integer
+ * views are derived on load.
+ */
+static void put_wheel(rec_out_t *o, const reptile_wheel_t *w) {
+  put_u32(o, w->now);
+  put_u8(o, w->free_head);
+  put_u8(o, w->count);
+  put_bytes(o, w->head, sizeof(w->head));
+  for (int l = 0; l < REPTILE_WHEEL_LEVELS; ++l) {
+    put_u64(o, w->occupied[l]);
+  }
+  for (int i = 0; i < REPTILE_WHEEL_POOL; ++i) {
+    put_u32(o, w->pool[i].expires);
+    put_u32(o, w->pool[i].next | ((uint32_t)w->pool[i].kind << 8) |
+                   ((uint32_t)w->pool[i].arg << 16));
+  }
+}
+
+static bool get_wheel(rec_in_t *in, reptile_wheel_t *w) {
+  int free_head, count;
+  if (!get_u32(in, &w->now) || (free_head = get_u8(in)) == EOF ||
+      (count = get_u8(in)) == EOF || count > REPTILE_WHEEL_POOL ||
+      !get_bytes(in, w->head, sizeof(w->head))) {
+    return false;
+  }
+  w->free_head = (uint8_t)free_head;
+  w->count = (uint8_t)count;
+  for (int l = 0; l < REPTILE_WHEEL_LEVELS; ++l) {
+    if (!get_u64(in, &w->occupied[l])) {
+      return false;
+    }
+  }
+  for (int i = 0; i < REPTILE_WHEEL_POOL; ++i) {
+    uint32_t packed;
+    if (!get_u32(in, &w->pool[i].expires) || !get_u32(in, &packed)) {
+      return false;
+    }
+    w->pool[i].next = (uint8_t)packed;
+    w->pool[i].kind = (uint8_t)(packed >> 8);
+    w->pool[i].arg = (uint16_t)(packed >> 16);
+  }
+  return true;
+}
+
+static void put_state(rec_out_t *o, const reptile_t *r) {
+  put_u32(o, r->faim_q);
+  put_u32(o, r->eau_q);
+  put_u32(o, r->temperature);
+  put_u32(o, r->humidite);
+  put_u32(o, r->humeur_q);
+  put_u32(o, (uint32_t)r->event);
+  put_u64(o, (uint64_t)r->last_update);
+  put_u32(o, r->clock_ms);
+  put_u32(o, r->seed);
+  put_u32(o, (uint32_t)r->species);
+  put_u64(o, r->rules.active);
+  put_u64(o, r->rules.pending);
+  put_u32(o, REPTILE_RULE_COUNT);
+  for (int i = 0; i < REPTILE_RULE_COUNT; ++i) {
+    put_u32(o, r->rules.since[i]);
+  }
+  put_u32(o, r->age_jours | ((uint32_t)r->poids_g << 16));
+  put_u8(o, r->cycle);
+  put_wheel(o, &r->wheel);
+}
+
+static bool get_state(rec_in_t *in, reptile_t *r) {
+  uint32_t evt, clock_ms, species, n_rules;
+  uint64_t t;
+  if (!get_u32(in, &r->faim_q) || !get_u32(in, &r->eau_q) ||
+      !get_u32(in, &r->temperature) || !get_u32(in, &r->humidite) ||
+      !get_u32(in, &r->humeur_q) || !get_u32(in, &evt) || !get_u64(in, &t) ||
+      !get_u32(in, &clock_ms) || clock_ms >= 1000U ||
+      !get_u32(in, &r->seed) || !get_u32(in, &species) ||
+      species >= REPTILE_SPECIES_COUNT || !get_u64(in, &r->rules.active) ||
+      !get_u64(in, &r->rules.pending) || !get_u32(in, &n_rules) ||
+      n_rules != REPTILE_RULE_COUNT) {
+    return false;
+  }
+  for (int i = 0; i < REPTILE_RULE_COUNT; ++i) {
+    if (!get_u32(in, &r->rules.since[i])) {
+      return false;
+    }
+  }
+  uint32_t life;
+  int cycle;
+  if (!get_u32(in, &life) || (cycle = get_u8(in)) == EOF ||
+      !get_wheel(in, &r->wheel)) {
+    return false;
+  }
+  r->age_jours = (uint16_t)life;
+  r->poids_g = (uint16_t)(life >> 16);
+  r->cycle = (uint8_t)cycle;
+  r->event = (reptile_event_t)evt;
+  r->species = (reptile_species_t)species;
+  r->last_update = (time_t)t;
+  r->clock_ms = (uint16_t)clock_ms;
+  r->faim = reptile_q_view(r->faim_q);
+  r->eau = reptile_q_view(r->eau_q);
+  r->humeur = reptile_q_view(r->humeur_q);
+  return true;
+}
+
+/*
+ * Task side: write @p len bytes of the session at the end of the part of the
+ * file known to be good. Writing in place rather than appending overwrites
+ * whatever a failed write left behind.
+ */
+static esp_err_t recorder_write(const char *path, const uint8_t *data,
+                                size_t len, bool create) {
+  /* The file kept open on a previous mount is stale after a remount */
+  uint32_t epoch = storage_supervisor_epoch();
+  if (s_file && (create || epoch != s_epoch)) {
+    storage_close(s_file);
+    s_file = NULL;
+  }
+  esp_err_t err = ESP_OK;
+  if (!s_file) {
+    err = storage_open(path, create ? STORAGE_CREATE : STORAGE_RDWR, &s_file);
+    s_epoch = epoch;
+    if (create) {
+      s_size = 0;
+    }
+  }
+  if (err == ESP_OK) {
+    err = storage_pwrite(s_file, data, len, s_size);
+  }
+  if (err == ESP_OK) {
+    err = storage_fsync(s_file);
+  }
+  if (err == ESP_OK) {
+    s_size += (uint32_t)len;
+    return ESP_OK;
+  }
+  if (s_file) {
+    storage_close(s_file);
+    s_file = NULL;
+  }
+  storage_supervisor_report_error();
+  return err;
+}
+
+static void recorder_task(void *arg) {
+  (void)arg;
+  char path[sizeof(s_path)];
+  for (;;) {
+    /* Woken when the buffer fills up or by a flush, else every period */
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(REPTILE_RECORDER_FLUSH_MS));
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    size_t len = s_len;
+    memcpy(s_out, s_buf, len);
+    s_len = 0;
+    bool create = s_create;
+    s_create = false;
+    uint32_t session = s_session;
+    bool flush = s_flush_req;
+    memcpy(path, s_path, sizeof(path));
+    xSemaphoreGive(s_lock);
+
+    esp_err_t err = len ? recorder_write(path, s_out, len, create) : ESP_OK;
+    if (err != ESP_OK) {
+      ESP_LOGW(TAG, "Écriture de %s échouée: %s, %u octets perdus", path,
+               esp_err_to_name(err), (unsigned)len);
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (session == s_session) {
+      if (err != ESP_OK) {
+        s_resync = true;
+      } else if (create) {
+        s_started = true;
+      }
+    }
+    if (flush) {
+      /* Under the lock: a caller that timed out sees it done or not */
+      if (s_close_req && s_file) {
+        storage_close(s_file);
+        s_file = NULL;
+      }
+      s_flush_err = err;
+      s_flush_req = false;
+      s_close_req = false;
+    }
+    xSemaphoreGive(s_lock);
+    if (flush) {
+      xSemaphoreGive(s_synced);
+    }
+  }
+}
+
+/* Header of a new file, or a SYNC record, carrying the state @p r and the
+ * tick context @p ctx */
+static void rec_state(rec_out_t *o, const reptile_t *r,
+                      const reptile_tick_ctx_t *ctx, bool header) {
+  if (header) {
+    put_bytes(o, MAGIC, sizeof(MAGIC));
+    put_u8(o, REPTILE_REPLAY_VERSION);
+    put_u8(o, 0); /* flags, réservé */
+  } else {
+    put_u8(o, REC_SYNC);
+  }
+  put_state(o, r);
+  put_u32(o, ctx->soothe_time_ms);
+}
+
+/* Under s_lock: restart the stream from @p r, in place of the records lost */
+static bool rec_resync(const reptile_t *r, const reptile_tick_ctx_t *ctx) {
+  bool header = !s_started;
+  if (header) {
+    /* The header never reached the card: the file starts over */
+    s_len = 0;
+  }
+  rec_out_t o = {s_buf, s_len, REPTILE_RECORDER_BUF_SIZE, false};
+  rec_state(&o, r, ctx, header);
+  if (o.full) {
+    return false;
+  }
+  s_len = o.len;
+  s_create = s_create || header;
+  s_resync = false;
+  return true;
+}
+
+/* Under s_lock: keep @p o, or drop it and resync on the next record */
+static void rec_commit(const rec_out_t *o) {
+  if (o->full) {
+    s_resync = true;
+    return;
+  }
+  bool wake = s_len < REPTILE_RECORDER_WRITE_AT &&
+              o->len >= REPTILE_RECORDER_WRITE_AT;
+  s_len = o->len;
+  if (wake) {
+    xTaskNotifyGive(s_task);
+  }
+}
+
+esp_err_t reptile_recorder_start(const char *path, const reptile_t *r,
+                                 const reptile_tick_ctx_t *ctx) {
+  if (!path || !r || !ctx || strlen(path) >= sizeof(s_path)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!s_task) {
+    s_lock = xSemaphoreCreateMutex();
+    s_synced = xSemaphoreCreateBinary();
+    s_buf = malloc(2 * REPTILE_RECORDER_BUF_SIZE);
+    if (!s_lock || !s_synced || !s_buf) {
+      return ESP_ERR_NO_MEM;
+    }
+    s_out = s_buf + REPTILE_RECORDER_BUF_SIZE;
+    if (xTaskCreate(recorder_task, "reptile_rec",
+                    REPTILE_RECORDER_TASK_STACK_SIZE, NULL,
+                    REPTILE_RECORDER_TASK_PRIORITY, &s_task) != pdPASS) {
+      s_task = NULL;
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  if (s_active && strcmp(path, s_path) == 0) {
+    /* State reloaded mid-session: resynchronise instead of truncating */
+    s_resync = !rec_resync(r, ctx);
+  } else {
+    strcpy(s_path, path);
+    s_session++;
+    s_active = true;
+    s_started = false;
+    s_create = false;
+    s_resync = !rec_resync(r, ctx);
+  }
+  xSemaphoreGive(s_lock);
+  xTaskNotifyGive(s_task);
+  return ESP_OK;
+}
+
+void reptile_recorder_tick(uint32_t elapsed_ms, const reptile_t *r,
+                           const reptile_tick_ctx_t *ctx) {
+  if (!s_active || !r || !ctx) {
+    return;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  if (s_active && !(s_resync && rec_resync(r, ctx))) {
+    rec_out_t o = {s_buf, s_len, REPTILE_RECORDER_BUF_SIZE, false};
+    put_u8(&o, REC_TICK);
+    put_varint(&o, elapsed_ms);
+    put_varint(&o, r->temperature);
+    put_varint(&o, r->humidite);
+    put_u32(&o, reptile_state_hash(r));
+    rec_commit(&o);
+  }
+  xSemaphoreGive(s_lock);
+}
+
+void reptile_recorder_action(reptile_action_t action, const reptile_t *r,
+                             const reptile_tick_ctx_t *ctx) {
+  if (!s_active || !r || !ctx) {
+    return;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  if (s_active && !(s_resync && rec_resync(r, ctx))) {
+    rec_out_t o = {s_buf, s_len, REPTILE_RECORDER_BUF_SIZE, false};
+    put_u8(&o, REC_ACTION);
+    put_u8(&o, (uint8_t)action);
+    put_u32(&o, reptile_state_hash(r));
+    rec_commit(&o);
+  }
+  xSemaphoreGive(s_lock);
+}
+
+/* Write what is buffered, then close the file on the task */
+static esp_err_t recorder_sync(uint32_t timeout_ms, bool close) {
+  if (!s_task) {
+    return ESP_OK;
+  }
+  xSemaphoreTake(s_synced, 0); /* drop the completion of a timed-out flush */
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_flush_req = true;
+  s_close_req = close;
+  xSemaphoreGive(s_lock);
+
+  xTaskNotifyGive(s_task);
+  if (xSemaphoreTake(s_synced, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+    /* The file is not closed behind the caller's back once this returns */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_close_req = false;
+    xSemaphoreGive(s_lock);
+    return ESP_ERR_TIMEOUT;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  esp_err_t err = s_flush_err;
+  xSemaphoreGive(s_lock);
+  return err;
+}
+
+esp_err_t reptile_recorder_flush(uint32_t timeout_ms) {
+  return recorder_sync(timeout_ms, false);
+}
+
+esp_err_t reptile_recorder_close(uint32_t timeout_ms) {
+  return recorder_sync(timeout_ms, true);
+}
+
+void reptile_recorder_stop(void) {
+  if (!s_active) {
+    return;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_active = false;
+  xSemaphoreGive(s_lock);
+  if (reptile_recorder_close(REPTILE_RECORDER_STOP_WAIT_MS) != ESP_OK) {
+    ESP_LOGW(TAG, "Fin de l'enregistrement non écrite");
+  }
+}
+
+bool reptile_recorder_active(void) { return s_active; }
+
+esp_err_t reptile_replay_file(const char *path,
+                              reptile_replay_stats_t *stats) {
+  if (!path || !stats) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memset(stats, 0, sizeof(*stats));
+  stats->mismatch_step = UINT32_MAX;
+
+  rec_in_t *in = calloc(1, sizeof(*in));
+  if (!in) {
+    return ESP_ERR_NO_MEM;
+  }
+  if (storage_open(path, STORAGE_READ, &in->f) != ESP_OK) {
+    free(in);
+    return ESP_FAIL;
+  }
+  esp_err_t ret = ESP_OK;
+  uint8_t magic[4];
+  int version = EOF, flags = EOF;
+  if (!get_bytes(in, magic, sizeof(magic)) ||
+      memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+    ret = ESP_FAIL;
+  } else if ((version = get_u8(in)) != REPTILE_REPLAY_VERSION ||
+             (flags = get_u8(in)) == EOF) {
+    ret = ESP_ERR_INVALID_VERSION;
+  }
+
+  /* get_state fills every field: no reptile_init, which would switch the
+   * mode of the running game and touch the card */
+  reptile_t r;
+  memset(&r, 0, sizeof(r));
+  reptile_tick_ctx_t ctx;
+  memset(&ctx, 0, sizeof(ctx));
+  if (ret == ESP_OK &&
+      (!get_state(in, &r) || !get_u32(in, &ctx.soothe_time_ms))) {
+    ret = ESP_FAIL;
+  }
+  if (ret != ESP_OK) {
+    storage_close(in->f);
+    free(in);
+    return ret;
+  }
+  reptile_set_seed(&r, r.seed);
+  reptile_save_fn_t prev_save = reptile_set_save_fn(NULL);
+  /* Replayed actions must not drive the feeder, pump or heater */
+  bool prev_sim = reptile_set_simulation(true);
+
+  uint32_t step = 0;
+  int tag;
+  while ((tag = get_u8(in)) != EOF) {
+    uint32_t expected = 0;
+    bool ok = true;
+    if (tag == REC_TICK) {
+      uint32_t elapsed;
+      reptile_env_t env;
+      ok = get_varint(in, &elapsed) && get_varint(in, &env.temperature) &&
+           get_varint(in, &env.humidite) && get_u32(in, &expected);
+      if (ok) {
+        reptile_tick_step(&r, &ctx, elapsed, &env);
+        stats->ticks++;
+      }
+    } else if (tag == REC_ACTION) {
+      int action = get_u8(in);
+      ok = (action != EOF) && get_u32(in, &expected);
+      if (ok) {
+        reptile_apply_action(&r, &ctx, (reptile_action_t)action);
+        stats->actions++;
+      }
+    } else if (tag == REC_SYNC) {
+      ok = get_state(in, &r) && get_u32(in, &ctx.soothe_time_ms);
+      if (ok) {
+        reptile_set_seed(&r, r.seed);
+        expected = reptile_state_hash(&r);
+        stats->syncs++;
+      }
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      /* Truncated tail (power cut during recording): stop quietly */
+      ESP_LOGW(TAG, "Enregistrement tronqué à l'étape %" PRIu32, step);
+      break;
+    }
+    if (reptile_state_hash(&r) != expected) {
+      stats->mismatch_step = step;
+      ret = ESP_ERR_INVALID_STATE;
+      break;
+    }
+    ++step;
+  }
+
+  reptile_set_simulation(prev_sim);
+  reptile_set_save_fn(prev_save);
+  storage_close(in->f);
+  free(in);
+  stats->final_state = r;
+  return ret;
+}
@@ -0,0 +1,103 @@
+#ifndef REPTILE_REPLAY_H
+#define REPTILE_REPLAY_H
+
+#include "reptile_logic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Record/replay of every input of the reptile model.
+ *
+ * Stream layout (little-endian):
+ *  - header: "RPLY", version, flags, initial state (stats, seed, species,
+ *    rule timers, lifecycle and its timer wheel) and tick context;
+ *  - TICK records: elapsed ms and sampled environment (varints), followed
+ *    by the hash of the resulting state;
+ *  - ACTION records: action id and resulting state hash;
+ *  - SYNC records: full state and tick context, written when the game reloads its state
+ *    (wake from sleep) while a recording is running, or after records were
+ *    lost (buffer full, card gone).
+ *
+ * The recorder only fills a RAM buffer on the caller's thread. A task writes
+ * it through storage.h when it holds ::REPTILE_RECORDER_WRITE_AT bytes, or
+ * every ::REPTILE_RECORDER_FLUSH_MS, and reopens the file after a remount.
+ */
+#define REPTILE_REPLAY_VERSION 6
+
+#define REPTILE_RECORDER_TASK_STACK_SIZE (3 * 1024)
+#define REPTILE_RECORDER_TASK_PRIORITY 1 /* below the LVGL task */
+#define REPTILE_RECORDER_BUF_SIZE 4096   /* records waiting for the card */
+#define REPTILE_RECORDER_WRITE_AT 1024   /* wake the task from this fill */
+#define REPTILE_RECORDER_FLUSH_MS 60000  /* oldest unwritten record */
+#define REPTILE_RECORDER_STOP_WAIT_MS 2000
+
+typedef struct {
+  uint32_t ticks;
+  uint32_t actions;
+  uint32_t syncs;
+  uint32_t mismatch_step; /* UINT32_MAX si aucune divergence */
+  reptile_t final_state;
+} reptile_replay_stats_t;
+
+/**
+ * @brief Start recording to @p path, or write a SYNC record if a recording
+ * to @p path is already running.
+ *
+ * The file is created by the recorder task; write errors are logged there
+ * and the stream resumes with a SYNC record.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM.
+ */
+esp_err_t reptile_recorder_start(const char *path, const reptile_t *r,
+                                 const reptile_tick_ctx_t *ctx);
+
+/**
+ * Record a tick of @p elapsed_ms that produced state @p r. No-op when idle.
+ * @p ctx is only written when the stream has to be resynchronised.
+ */
+void reptile_recorder_tick(uint32_t elapsed_ms, const reptile_t *r,
+                           const reptile_tick_ctx_t *ctx);
+
+/** Record a player action that produced state @p r. No-op when idle. */
+void reptile_recorder_action(reptile_action_t action, const reptile_t *r,
+                             const reptile_tick_ctx_t *ctx);
+
+/**
+ * @brief Write the buffered records, waiting at most @p timeout_ms.
+ *
+ * @return ESP_OK, the error of the write, ESP_ERR_TIMEOUT.
+ */
+esp_err_t reptile_recorder_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Same as ::reptile_recorder_flush, then close the file, e.g. before
+ * the card is unmounted. The recording goes on and the file is reopened by
+ * the next write.
+ */
+esp_err_t reptile_recorder_close(uint32_t timeout_ms);
+
+/** Write the buffered records and end the recording. */
+void reptile_recorder_stop(void);
+
+/** True while a recording is running. */
+bool reptile_recorder_active(void);
+
+/**
+ * @brief Re-drive a recording and verify the state after every step.
+ *
+ * Actions are replayed in simulation mode without persistence, so no
+ * actuator is driven and the SD card is not touched.
+ *
+ * @return ESP_OK when every step matched, ESP_ERR_INVALID_STATE on the first
+ *         divergence (see @c stats->mismatch_step), ESP_ERR_INVALID_VERSION
+ *         or ESP_FAIL for unreadable streams.
+ */
+esp_err_t reptile_replay_file(const char *path, reptile_replay_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REPTILE_REPLAY_H
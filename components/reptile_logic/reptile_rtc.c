@@ -0,0 +1,47 @@
+#include "reptile_rtc.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include <stddef.h>
+#include <string.h>
+
+#define REPTILE_RTC_MAGIC 0x52545243U /* "RTCR" */
+
+typedef struct {
+  uint32_t magic;
+  uint16_t layout; /* REPTILE_STATE_LAYOUT */
+  uint16_t size;   /* sizeof(reptile_t) */
+  reptile_t state;
+  reptile_tick_ctx_t tick_ctx;
+  uint32_t crc; /* everything above */
+} reptile_rtc_image_t;
+
+/* Not cleared by the startup code, so it outlives software resets */
+static RTC_NOINIT_ATTR reptile_rtc_image_t s_image;
+
+static uint32_t image_crc(const reptile_rtc_image_t *img) {
+  return esp_rom_crc32_le(0, (const uint8_t *)img,
+                          offsetof(reptile_rtc_image_t, crc));
+}
+
+void reptile_rtc_store(const reptile_t *r, const reptile_tick_ctx_t *ctx) {
+  if (!r || !ctx) {
+    return;
+  }
+  s_image.magic = REPTILE_RTC_MAGIC;
+  s_image.layout = REPTILE_STATE_LAYOUT;
+  s_image.size = sizeof(reptile_t);
+  memcpy(&s_image.state, r, sizeof(s_image.state));
+  memcpy(&s_image.tick_ctx, ctx, sizeof(s_image.tick_ctx));
+  s_image.crc = image_crc(&s_image);
+}
+
+bool reptile_rtc_restore(reptile_t *r, reptile_tick_ctx_t *ctx) {
+  if (!r || !ctx || s_image.magic != REPTILE_RTC_MAGIC ||
+      s_image.layout != REPTILE_STATE_LAYOUT ||
+      s_image.size != sizeof(reptile_t) || s_image.crc != image_crc(&s_image)) {
+    return false;
+  }
+  memcpy(r, &s_image.state, sizeof(*r));
+  memcpy(ctx, &s_image.tick_ctx, sizeof(*ctx));
+  return true;
+}
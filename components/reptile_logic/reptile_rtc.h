@@ -0,0 +1,40 @@
+#ifndef REPTILE_RTC_H
+#define REPTILE_RTC_H
+
+#include "reptile_logic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Mirror of the live game state in RTC memory.
+ *
+ * The image lives in RTC_NOINIT memory, which keeps its content across
+ * light and deep sleep, software resets, panics and watchdog resets, but
+ * not across a power cycle. A magic, the state layout and a CRC32 mark it
+ * valid, so garbage left after power-on or a brownout is rejected.
+ * Restoring from it skips the SD card entirely; the card only receives the
+ * periodic checkpoints of reptile_persist.h.
+ */
+
+/**
+ * @brief Copy @p r and @p ctx to RTC memory.
+ *
+ * About 600 bytes and a CRC, cheap enough for every tick and action.
+ */
+void reptile_rtc_store(const reptile_t *r, const reptile_tick_ctx_t *ctx);
+
+/**
+ * @brief Restore the last stored state.
+ *
+ * @return true when a valid image was copied to @p r and @p ctx, false
+ *         (outputs untouched) after a power cycle or a layout change.
+ */
+bool reptile_rtc_restore(reptile_t *r, reptile_tick_ctx_t *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REPTILE_RTC_H
@@ -0,0 +1,63 @@
+#include "reptile_logic.h"
+
+/*
+ * Lookup tables generated from REPTILE_RULE_LIST.
+ *
+ * Row n, column v holds the rules whose required predicates in nibble n of
+ * the predicate mask are all set in v. ANDing the rows selected by each
+ * nibble of a predicate mask gives every rule whose predicates all hold.
+ */
+
+#define NIB(mask, n) (((uint32_t)(mask) >> (4 * (n))) & 0xFU)
+#define RULE_OK(mask, n, v) (((v) & NIB(mask, n)) == NIB(mask, n))
+
+#define RULE_BIT_ENTER(name, event, enter, hold, min_s, n, v)                  \
+  | ((uint64_t)RULE_OK(enter, n, v) << REPTILE_RULE_##name)
+#define RULE_BIT_HOLD(name, event, enter, hold, min_s, n, v)                   \
+  | ((uint64_t)RULE_OK(hold, n, v) << REPTILE_RULE_##name)
+
+#define LUT_ENTRY(kind, n, v) (0 REPTILE_RULE_LIST(RULE_BIT_##kind, n, v))
+#define LUT_ROW(kind, n)                                                       \
+  {                                                                            \
+    LUT_ENTRY(kind, n, 0), LUT_ENTRY(kind, n, 1), LUT_ENTRY(kind, n, 2),       \
+        LUT_ENTRY(kind, n, 3), LUT_ENTRY(kind, n, 4), LUT_ENTRY(kind, n, 5),   \
+        LUT_ENTRY(kind, n, 6), LUT_ENTRY(kind, n, 7), LUT_ENTRY(kind, n, 8),   \
+        LUT_ENTRY(kind, n, 9), LUT_ENTRY(kind, n, 10),                         \
+        LUT_ENTRY(kind, n, 11), LUT_ENTRY(kind, n, 12),                        \
+        LUT_ENTRY(kind, n, 13), LUT_ENTRY(kind, n, 14),                        \
+        LUT_ENTRY(kind, n, 15)                                                 \
+  }
+#define LUT(kind)                                                              \
+  {                                                                            \
+    LUT_ROW(kind, 0), LUT_ROW(kind, 1), LUT_ROW(kind, 2), LUT_ROW(kind, 3),    \
+        LUT_ROW(kind, 4), LUT_ROW(kind, 5), LUT_ROW(kind, 6),                  \
+        LUT_ROW(kind, 7)                                                       \
+  }
+
+const uint64_t reptile_rule_enter_lut[REPTILE_RULE_NIBBLES][16] = LUT(ENTER);
+const uint64_t reptile_rule_hold_lut[REPTILE_RULE_NIBBLES][16] = LUT(HOLD);
+
+#define X(name, event, enter, hold, min_s, a, b) [REPTILE_RULE_##name] = min_s,
+const uint32_t reptile_rule_min_s[REPTILE_RULE_COUNT] = {
+    REPTILE_RULE_LIST(X, 0, 0)};
+#undef X
+
+#define X(name, event, enter, hold, min_s, a, b) [REPTILE_RULE_##name] = event,
+const uint8_t reptile_rule_event[REPTILE_RULE_COUNT] = {
+    REPTILE_RULE_LIST(X, 0, 0)};
+#undef X
+
+#define X(name, event, enter, hold, min_s, a, b) [REPTILE_RULE_##name] = enter,
+const uint32_t reptile_rule_enter_mask[REPTILE_RULE_COUNT] = {
+    REPTILE_RULE_LIST(X, 0, 0)};
+#undef X
+
+#define X(name, event, enter, hold, min_s, a, b) [REPTILE_RULE_##name] = hold,
+const uint32_t reptile_rule_hold_mask[REPTILE_RULE_COUNT] = {
+    REPTILE_RULE_LIST(X, 0, 0)};
+#undef X
+
+#define X(name, event, enter, hold, min_s, a, b)                               \
+  | ((uint64_t)((min_s) > 0) << REPTILE_RULE_##name)
+const uint64_t reptile_rule_timed_mask = 0 REPTILE_RULE_LIST(X, 0, 0);
+#undef X
@@ -0,0 +1,213 @@
+#ifndef REPTILE_RULES_H
+#define REPTILE_RULES_H
+
+/*
+ * Event rule table of the reptile model. Included from reptile_logic.h once
+ * the events and thresholds are defined.
+ *
+ * REPTILE_PRED_LIST: one comparison on a reptile field per entry
+ *   X(name, field, op, threshold), op in LE/GE/LT/GT, or HAS to test
+ *   lifecycle flags (REPTILE_CYCLE_*). Thresholds are read from the species
+ *   profile @c sp (reptile_species.h).
+ *   Each predicate owns one bit of the predicate mask.
+ *
+ * REPTILE_RULE_LIST: X(name, event, enter, hold, min_duration_s, a, b)
+ *   enter: predicates that must all be true to start the rule;
+ *   hold: predicates that must all stay true to keep it (hysteresis);
+ *   min_duration_s: how long @c enter must hold before the rule fires.
+ *   Rules are listed by decreasing priority: the first active rule gives
+ *   the event. @c a and @c b are forwarded to X untouched.
+ *
+ * Both lists are expanded at build time into nibble-indexed lookup tables
+ * (reptile_rules.c), so evaluating every rule costs a fixed number of table
+ * loads and ANDs whatever the number of rules.
+ */
+
+#include "reptile_species.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#define REPTILE_STATIC_ASSERT static_assert
+#else
+#define REPTILE_STATIC_ASSERT _Static_assert
+#endif
+
+#define REPTILE_PRED_LIST(X)                                                   \
+  X(FAIM_BAS, faim, LE, sp->famine)                                            \
+  X(EAU_BAS, eau, LE, sp->eau)                                                 \
+  X(HUMEUR_BAS, humeur, LE, sp->humeur)                                        \
+  X(TEMP_FROID, temperature, LE, sp->temp_low)                                 \
+  X(TEMP_CHAUD, temperature, GE, sp->temp_high)                                \
+  X(HUMIDITE_SECHE, humidite, LT, sp->humidite_min)                            \
+  X(FAIM_HAUT, faim, GE, sp->croissance)                                       \
+  X(EAU_HAUT, eau, GE, sp->croissance)                                         \
+  X(HUMEUR_HAUT, humeur, GE, sp->croissance)                                   \
+  X(TEMP_TIEDE_MIN, temperature, GT, sp->temp_low)                             \
+  X(TEMP_TIEDE_MAX, temperature, LT, sp->temp_high)                            \
+  X(EAU_CRITIQUE, eau, LE, sp->deshydratation)                                 \
+  X(EAU_CRITIQUE_HOLD, eau, LE, sp->deshydratation + 10)                       \
+  X(TEMP_STRESS, temperature, GE, sp->temp_stress)                             \
+  X(TEMP_STRESS_HOLD, temperature, GE, sp->temp_stress - 2)                    \
+  X(HUMEUR_ENNUI, humeur, LE, sp->ennui)                                       \
+  X(HUMEUR_ENNUI_HOLD, humeur, LE, sp->ennui + 10)                             \
+  X(EN_MUE, cycle, HAS, REPTILE_CYCLE_MUE)                                     \
+  X(MALADE, cycle, HAS, REPTILE_CYCLE_MALADE)
+
+#define REPTILE_P(name) (1UL << REPTILE_PRED_##name)
+
+#define REPTILE_RULE_LIST(X, a, b)                                             \
+  X(COUP_DE_CHALEUR, REPTILE_EVENT_COUP_DE_CHALEUR, REPTILE_P(TEMP_STRESS),    \
+    REPTILE_P(TEMP_STRESS_HOLD), 60, a, b)                                     \
+  X(DESHYDRATATION, REPTILE_EVENT_DESHYDRATATION, REPTILE_P(EAU_CRITIQUE),     \
+    REPTILE_P(EAU_CRITIQUE_HOLD), 30, a, b)                                    \
+  X(MALADIE_FAIM, REPTILE_EVENT_MALADIE, REPTILE_P(FAIM_BAS),                  \
+    REPTILE_P(FAIM_BAS), 0, a, b)                                              \
+  X(MALADIE_EAU, REPTILE_EVENT_MALADIE, REPTILE_P(EAU_BAS),                    \
+    REPTILE_P(EAU_BAS), 0, a, b)                                               \
+  X(MALADIE_HUMEUR, REPTILE_EVENT_MALADIE, REPTILE_P(HUMEUR_BAS),              \
+    REPTILE_P(HUMEUR_BAS), 0, a, b)                                            \
+  X(MALADIE_FROID, REPTILE_EVENT_MALADIE, REPTILE_P(TEMP_FROID),               \
+    REPTILE_P(TEMP_FROID), 0, a, b)                                            \
+  X(MALADIE_CHAUD, REPTILE_EVENT_MALADIE, REPTILE_P(TEMP_CHAUD),               \
+    REPTILE_P(TEMP_CHAUD), 0, a, b)                                            \
+  X(MALADIE_SEC, REPTILE_EVENT_MALADIE, REPTILE_P(HUMIDITE_SECHE),             \
+    REPTILE_P(HUMIDITE_SECHE), 0, a, b)                                        \
+  X(MALADIE_LONGUE, REPTILE_EVENT_MALADIE, REPTILE_P(MALADE),                  \
+    REPTILE_P(MALADE), 0, a, b)                                                \
+  X(MUE, REPTILE_EVENT_MUE, REPTILE_P(EN_MUE), REPTILE_P(EN_MUE), 0, a, b)     \
+  X(ENNUI, REPTILE_EVENT_ENNUI, REPTILE_P(HUMEUR_ENNUI),                       \
+    REPTILE_P(HUMEUR_ENNUI_HOLD), 300, a, b)                                   \
+  X(CROISSANCE, REPTILE_EVENT_CROISSANCE,                                      \
+    REPTILE_P(FAIM_HAUT) | REPTILE_P(EAU_HAUT) | REPTILE_P(HUMEUR_HAUT) |      \
+        REPTILE_P(TEMP_TIEDE_MIN) | REPTILE_P(TEMP_TIEDE_MAX),                 \
+    REPTILE_P(FAIM_HAUT) | REPTILE_P(EAU_HAUT) | REPTILE_P(HUMEUR_HAUT) |      \
+        REPTILE_P(TEMP_TIEDE_MIN) | REPTILE_P(TEMP_TIEDE_MAX),                 \
+    0, a, b)
+
+#define REPTILE_CMP_LE <=
+#define REPTILE_CMP_GE >=
+#define REPTILE_CMP_LT <
+#define REPTILE_CMP_GT >
+#define REPTILE_CMP_HAS &
+
+enum {
+#define X(name, field, op, thr) REPTILE_PRED_##name,
+  REPTILE_PRED_LIST(X)
+#undef X
+  REPTILE_PRED_COUNT
+};
+
+enum {
+#define X(name, event, enter, hold, min_s, a, b) REPTILE_RULE_##name,
+  REPTILE_RULE_LIST(X, 0, 0)
+#undef X
+  REPTILE_RULE_COUNT
+};
+
+/*
+ * One uint32_t of predicates, one uint64_t of rules, four bits per LUT row.
+ * The 64 rule cap is deliberate: every mask stays one register, and each
+ * rule adds a since[] word to reptile_t, which is written to the journal
+ * (2 KB slots) and to the replay streams. Hundreds of rules would need
+ * multi-word masks and a new save format.
+ */
+#define REPTILE_RULE_NIBBLES 8
+REPTILE_STATIC_ASSERT(REPTILE_PRED_COUNT <= 4 * REPTILE_RULE_NIBBLES,
+                      "predicate mask limited to 32 bits");
+REPTILE_STATIC_ASSERT(REPTILE_RULE_COUNT <= 64, "rule mask limited to 64 bits");
+
+/** Per-reptile progress of every rule. */
+typedef struct {
+  uint64_t active;                     /* rules currently firing */
+  uint64_t pending;                    /* rules waiting for min duration */
+  uint32_t since[REPTILE_RULE_COUNT];  /* start of the pending period (s) */
+} reptile_rule_state_t;
+
+extern const uint64_t reptile_rule_enter_lut[REPTILE_RULE_NIBBLES][16];
+extern const uint64_t reptile_rule_hold_lut[REPTILE_RULE_NIBBLES][16];
+extern const uint32_t reptile_rule_min_s[REPTILE_RULE_COUNT];
+extern const uint8_t reptile_rule_event[REPTILE_RULE_COUNT];
+extern const uint32_t reptile_rule_enter_mask[REPTILE_RULE_COUNT];
+extern const uint32_t reptile_rule_hold_mask[REPTILE_RULE_COUNT];
+extern const uint64_t reptile_rule_timed_mask;
+
+/**
+ * @brief Predicate mask of one reptile.
+ *
+ * Compiles to compares and shifts only; with a constant @p sp the
+ * thresholds become immediates.
+ */
+static inline __attribute__((always_inline)) uint32_t
+reptile_rules_preds(const reptile_species_profile_t *sp, uint32_t faim,
+                    uint32_t eau, uint32_t humeur, uint32_t temperature,
+                    uint32_t humidite, uint32_t cycle) {
+  (void)faim, (void)eau, (void)humeur, (void)temperature, (void)humidite;
+  (void)cycle;
+  uint32_t m = 0;
+#define X(name, field, op, thr)                                                \
+  m |= (uint32_t)((field REPTILE_CMP_##op(uint32_t)(thr)) != 0)                \
+       << REPTILE_PRED_##name;
+  REPTILE_PRED_LIST(X)
+#undef X
+  return m;
+}
+
+/** Rules whose predicates are all set in @p preds, through @p lut. */
+static inline uint64_t reptile_rules_match(const uint64_t lut[][16],
+                                           uint32_t preds) {
+  uint64_t ok = ~0ULL;
+  for (int n = 0; n < (REPTILE_PRED_COUNT + 3) / 4; ++n) {
+    ok &= lut[n][(preds >> (4 * n)) & 0xFU];
+  }
+  return ok;
+}
+
+/**
+ * @brief Advance the rules of one reptile and return its event.
+ *
+ * @param now Monotonic time in seconds, used for minimum durations.
+ */
+static inline uint8_t reptile_rules_step(reptile_rule_state_t *st,
+                                         uint32_t preds, uint32_t now) {
+  uint64_t enter = reptile_rules_match(reptile_rule_enter_lut, preds);
+  uint64_t hold = reptile_rules_match(reptile_rule_hold_lut, preds);
+  uint64_t still = st->active & hold;
+  uint64_t cand = enter & ~still;
+
+  /* Timers start on the first evaluation where the enter condition holds */
+  uint64_t started = cand & ~st->pending & reptile_rule_timed_mask;
+  while (started) {
+    int i = __builtin_ctzll(started);
+    st->since[i] = now;
+    started &= started - 1;
+  }
+  uint64_t matured = cand & ~reptile_rule_timed_mask;
+  uint64_t waiting = cand & reptile_rule_timed_mask;
+  for (uint64_t w = waiting; w; w &= w - 1) {
+    int i = __builtin_ctzll(w);
+    if (now - st->since[i] >= reptile_rule_min_s[i]) {
+      matured |= 1ULL << i;
+    }
+  }
+  st->pending = waiting & ~matured;
+  st->active = still | matured;
+  return st->active ? reptile_rule_event[__builtin_ctzll(st->active)] : 0;
+}
+
+/**
+ * @brief Move the pending periods of @p st @p back seconds earlier, for a
+ * clock set back by that much: each keeps the time it already waited.
+ */
+static inline void reptile_rules_rebase(reptile_rule_state_t *st,
+                                        uint32_t back) {
+  for (uint64_t p = st->pending; p; p &= p - 1) {
+    st->since[__builtin_ctzll(p)] -= back;
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REPTILE_RULES_H
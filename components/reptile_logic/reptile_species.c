@@ -0,0 +1,15 @@
+#include "reptile_logic.h"
+
+const reptile_species_profile_t reptile_species_profiles[REPTILE_SPECIES_COUNT] = {
+#define X(id, arg) [REPTILE_SPECIES_##id] = REPTILE_PROFILE_##id,
+    REPTILE_SPECIES_LIST(X, 0)
+#undef X
+};
+
+const reptile_species_profile_t *
+reptile_species_profile(reptile_species_t species) {
+  if ((unsigned)species >= REPTILE_SPECIES_COUNT) {
+    species = REPTILE_SPECIES_GENERIQUE;
+  }
+  return &reptile_species_profiles[species];
+}
@@ -0,0 +1,134 @@
+#ifndef REPTILE_SPECIES_H
+#define REPTILE_SPECIES_H
+
+/*
+ * Species profiles: decay rates, comfort envelope and sprite set of each
+ * kind of reptile. Included from reptile_logic.h.
+ *
+ * Profiles are compile-time constants (REPTILE_PROFILE_<ID> initializers).
+ * The tick path is expanded once per species with the profile folded in
+ * (see reptile_species_impl.h); ::reptile_species_profile is for the UI and
+ * tools only.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* X(id, arg): arg is forwarded untouched */
+#define REPTILE_SPECIES_LIST(X, arg)                                           \
+  X(GENERIQUE, arg)                                                            \
+  X(POGONA, arg)                                                               \
+  X(GECKO, arg)                                                                \
+  X(CAMELEON, arg)
+
+typedef enum {
+#define X(id, arg) REPTILE_SPECIES_##id,
+  REPTILE_SPECIES_LIST(X, 0)
+#undef X
+  REPTILE_SPECIES_COUNT
+} reptile_species_t;
+
+typedef struct {
+  const char *name;
+  uint8_t sprite_set; /* index into the UI sprite sets (reptile_game.c) */
+  /* Decay in REPTILE_Q_ONE units per ms (1000 = 1 point/s) */
+  uint16_t faim_rate_q;
+  uint16_t eau_rate_q;
+  uint16_t humeur_rate_q;
+  /* Rule thresholds, see REPTILE_PRED_LIST */
+  uint8_t famine;
+  uint8_t eau;
+  uint8_t humeur;
+  uint8_t temp_low;       /* °C */
+  uint8_t temp_high;      /* °C */
+  uint8_t temp_stress;    /* °C */
+  uint8_t humidite_min;   /* % ; 0 = pas de minimum */
+  uint8_t mue_humidite;   /* % */
+  uint8_t croissance;
+  uint8_t deshydratation;
+  uint8_t ennui;
+  /* Lifecycle, see reptile_wheel.h */
+  uint16_t poids_naissance_g;
+  uint16_t poids_adulte_g;
+  uint16_t maturite_j;   /* age adulte en jours */
+  uint8_t mue_cycle_j;   /* jours entre deux mues d'un adulte */
+  uint8_t mue_duree_h;   /* heures de mue si l'humidite suffit */
+  /* Environment drawn in simulation mode: min + [0, span) */
+  uint8_t sim_temp_min;
+  uint8_t sim_temp_span;
+  uint8_t sim_hum_min;
+  uint8_t sim_hum_span;
+} reptile_species_profile_t;
+
+/* Reference animal: the historical thresholds of reptile_threshold_t */
+#define REPTILE_PROFILE_GENERIQUE                                              \
+  {                                                                            \
+    .name = "Générique", .sprite_set = 0, .faim_rate_q = 1000,                 \
+    .eau_rate_q = 1000, .humeur_rate_q = 1000,                                 \
+    .famine = REPTILE_FAMINE_THRESHOLD, .eau = REPTILE_EAU_THRESHOLD,          \
+    .humeur = REPTILE_HUMEUR_THRESHOLD,                                        \
+    .temp_low = REPTILE_TEMP_THRESHOLD_LOW,                                    \
+    .temp_high = REPTILE_TEMP_THRESHOLD_HIGH,                                  \
+    .temp_stress = REPTILE_TEMP_THRESHOLD_STRESS, .humidite_min = 0,           \
+    .mue_humidite = REPTILE_MUE_HUMIDITE_THRESHOLD,                            \
+    .croissance = REPTILE_CROISSANCE_THRESHOLD,                                \
+    .deshydratation = REPTILE_DESHYDRATATION_THRESHOLD,                        \
+    .ennui = REPTILE_ENNUI_THRESHOLD, .poids_naissance_g = 20,                 \
+    .poids_adulte_g = 300, .maturite_j = 180, .mue_cycle_j = 30,               \
+    .mue_duree_h = 48, .sim_temp_min = 26, .sim_temp_span = 8,                 \
+    .sim_hum_min = 40, .sim_hum_span = 20,                                     \
+  }
+
+/* Pogona vitticeps: desert basker, hot and dry, drinks little */
+#define REPTILE_PROFILE_POGONA                                                 \
+  {                                                                            \
+    .name = "Pogona", .sprite_set = 1, .faim_rate_q = 1000, .eau_rate_q = 500, \
+    .humeur_rate_q = 1000, .famine = 30, .eau = 25, .humeur = 40,              \
+    .temp_low = 27, .temp_high = 40, .temp_stress = 44, .humidite_min = 20,    \
+    .mue_humidite = 45, .croissance = 90, .deshydratation = 10, .ennui = 60,   \
+    .poids_naissance_g = 4, .poids_adulte_g = 400, .maturite_j = 365,          \
+    .mue_cycle_j = 30, .mue_duree_h = 48, .sim_temp_min = 28,                  \
+    .sim_temp_span = 10, .sim_hum_min = 25, .sim_hum_span = 20,                \
+  }
+
+/* Gecko léopard: nocturnal, slow metabolism, moderate humidity */
+#define REPTILE_PROFILE_GECKO                                                  \
+  {                                                                            \
+    .name = "Gecko", .sprite_set = 2, .faim_rate_q = 400, .eau_rate_q = 500,   \
+    .humeur_rate_q = 1000, .famine = 25, .eau = 30, .humeur = 40,              \
+    .temp_low = 24, .temp_high = 33, .temp_stress = 36, .humidite_min = 30,    \
+    .mue_humidite = 60, .croissance = 90, .deshydratation = 10, .ennui = 60,   \
+    .poids_naissance_g = 3, .poids_adulte_g = 60, .maturite_j = 300,           \
+    .mue_cycle_j = 30, .mue_duree_h = 24, .sim_temp_min = 25,                  \
+    .sim_temp_span = 7, .sim_hum_min = 35, .sim_hum_span = 20,                 \
+  }
+
+/* Caméléon casqué: cool and very humid, dehydrates quickly */
+#define REPTILE_PROFILE_CAMELEON                                               \
+  {                                                                            \
+    .name = "Caméléon", .sprite_set = 3, .faim_rate_q = 1000,                  \
+    .eau_rate_q = 1250, .humeur_rate_q = 1000, .famine = 30, .eau = 40,        \
+    .humeur = 45, .temp_low = 22, .temp_high = 32, .temp_stress = 35,          \
+    .humidite_min = 50, .mue_humidite = 80, .croissance = 90,                  \
+    .deshydratation = 20, .ennui = 65, .poids_naissance_g = 2,                 \
+    .poids_adulte_g = 150, .maturite_j = 240, .mue_cycle_j = 35,               \
+    .mue_duree_h = 48, .sim_temp_min = 23,                                     \
+    .sim_temp_span = 8, .sim_hum_min = 55, .sim_hum_span = 30,                 \
+  }
+
+/** Every profile, indexed by species; defined once in reptile_species.c. */
+extern const reptile_species_profile_t
+    reptile_species_profiles[REPTILE_SPECIES_COUNT];
+
+/** Profile of @p species; unknown values fall back to the generic one. */
+const reptile_species_profile_t *
+reptile_species_profile(reptile_species_t species);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REPTILE_SPECIES_H
@@ -0,0 +1,49 @@
+#ifndef REPTILE_SPECIES_IMPL_H
+#define REPTILE_SPECIES_IMPL_H
+
+/*
+ * Private to reptile_logic: per-species instantiation of the tick path.
+ *
+ * REPTILE_SPECIES_SWITCH expands a statement once per species with SP
+ * pointing at a local copy of that species' REPTILE_PROFILE_<ID>
+ * initializer, so the compiler sees the values without a per-unit copy of
+ * the profile table (reptile_species_profiles, reptile_species.c). Callees
+ * marked REPTILE_ALWAYS_INLINE are inlined into every case and the profile
+ * fields become immediates.
+ */
+
+#include "reptile_logic.h"
+
+#define REPTILE_ALWAYS_INLINE static inline __attribute__((always_inline))
+
+#define REPTILE_SPECIES_CASE_(id, stmt)                                        \
+  case REPTILE_SPECIES_##id: {                                                 \
+    const reptile_species_profile_t SP_##id = REPTILE_PROFILE_##id;            \
+    const reptile_species_profile_t *const SP = &SP_##id;                      \
+    stmt;                                                                      \
+  } break;
+
+/* Unknown species are validated away on load; default keeps the switch total */
+#define REPTILE_SPECIES_SWITCH(species, stmt)                                  \
+  switch (species) {                                                           \
+    REPTILE_SPECIES_LIST(REPTILE_SPECIES_CASE_, stmt)                          \
+  default: {                                                                   \
+    const reptile_species_profile_t SP_default = REPTILE_PROFILE_GENERIQUE;    \
+    const reptile_species_profile_t *const SP = &SP_default;                   \
+    stmt;                                                                      \
+  } break;                                                                     \
+  }
+
+/* Linear decay of a fixed-point stat, saturated at 0 */
+REPTILE_ALWAYS_INLINE uint32_t reptile_q_decay(uint32_t q, uint32_t rate_q,
+                                               uint64_t ms) {
+  uint64_t d = (uint64_t)rate_q * ms;
+  return (d < q) ? q - (uint32_t)d : 0;
+}
+
+/* Integer view of a fixed-point stat: a point counts until fully consumed */
+REPTILE_ALWAYS_INLINE uint32_t reptile_q_view(uint32_t q) {
+  return (q + REPTILE_Q_ONE - 1U) / REPTILE_Q_ONE;
+}
+
+#endif // REPTILE_SPECIES_IMPL_H
@@ -0,0 +1,226 @@
+#include "reptile_wheel.h"
+#include <string.h>
+
+#define SLOT_MASK (REPTILE_WHEEL_SLOTS - 1U)
+#define TOP (REPTILE_WHEEL_LEVELS - 1)
+
+static inline uint32_t level_shift(int level) {
+  return (uint32_t)level * REPTILE_WHEEL_BITS;
+}
+
+/* File timer @p i relative to the wheel clock; expires >= now */
+static void wheel_insert(reptile_wheel_t *w, uint8_t i) {
+  uint32_t expires = w->pool[i].expires;
+  uint32_t diff = expires ^ w->now;
+  int level = diff ? (31 - __builtin_clz(diff)) / REPTILE_WHEEL_BITS : 0;
+  uint32_t slot;
+  if (level > TOP) {
+    /*
+     * Across a top-level rotation: the slot of the next rotation when it
+     * comes before the current one again, otherwise park in the slot
+     * reached last and re-file from there.
+     */
+    uint32_t ahead = (expires >> level_shift(TOP)) - (w->now >> level_shift(TOP));
+    level = TOP;
+    slot = (ahead < REPTILE_WHEEL_SLOTS)
+               ? (expires >> level_shift(TOP)) & SLOT_MASK
+               : ((w->now >> level_shift(TOP)) - 1U) & SLOT_MASK;
+  } else {
+    slot = (expires >> level_shift(level)) & SLOT_MASK;
+  }
+  w->pool[i].next = w->head[level][slot];
+  w->head[level][slot] = i;
+  w->occupied[level] |= 1ULL << slot;
+}
+
+void reptile_wheel_init(reptile_wheel_t *w, uint32_t now) {
+  if (!w) {
+    return;
+  }
+  memset(w->head, REPTILE_WHEEL_NIL, sizeof(w->head));
+  memset(w->occupied, 0, sizeof(w->occupied));
+  for (uint8_t i = 0; i < REPTILE_WHEEL_POOL; ++i) {
+    w->pool[i].next = (i + 1U < REPTILE_WHEEL_POOL) ? i + 1U : REPTILE_WHEEL_NIL;
+  }
+  w->free_head = 0;
+  w->count = 0;
+  w->now = now;
+}
+
+esp_err_t reptile_wheel_schedule(reptile_wheel_t *w, uint32_t expires,
+                                 uint8_t kind, uint16_t arg) {
+  if (!w) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  uint8_t i = w->free_head;
+  if (i == REPTILE_WHEEL_NIL) {
+    return ESP_ERR_NO_MEM;
+  }
+  w->free_head = w->pool[i].next;
+  /* The slot of `now` has already been processed */
+  w->pool[i].expires = (expires > w->now) ? expires : w->now + 1U;
+  w->pool[i].kind = kind;
+  w->pool[i].arg = arg;
+  w->count++;
+  wheel_insert(w, i);
+  return ESP_OK;
+}
+
+uint32_t reptile_wheel_cancel(reptile_wheel_t *w, uint8_t kind) {
+  if (!w) {
+    return 0;
+  }
+  uint32_t removed = 0;
+  for (int level = 0; level < REPTILE_WHEEL_LEVELS; ++level) {
+    for (uint64_t occ = w->occupied[level]; occ; occ &= occ - 1) {
+      int slot = __builtin_ctzll(occ);
+      uint8_t *link = &w->head[level][slot];
+      while (*link != REPTILE_WHEEL_NIL) {
+        uint8_t i = *link;
+        if (w->pool[i].kind == kind) {
+          *link = w->pool[i].next;
+          w->pool[i].next = w->free_head;
+          w->free_head = i;
+          w->count--;
+          removed++;
+        } else {
+          link = &w->pool[i].next;
+        }
+      }
+      if (w->head[level][slot] == REPTILE_WHEEL_NIL) {
+        w->occupied[level] &= ~(1ULL << slot);
+      }
+    }
+  }
+  return removed;
+}
+
+void reptile_wheel_rebase(reptile_wheel_t *w, uint32_t now) {
+  if (!w) {
+    return;
+  }
+  reptile_wheel_timer_t pending[REPTILE_WHEEL_POOL];
+  uint8_t n = 0;
+  for (int level = 0; level < REPTILE_WHEEL_LEVELS; ++level) {
+    for (uint64_t occ = w->occupied[level]; occ; occ &= occ - 1) {
+      int slot = __builtin_ctzll(occ);
+      for (uint8_t i = w->head[level][slot]; i != REPTILE_WHEEL_NIL;
+           i = w->pool[i].next) {
+        pending[n++] = w->pool[i];
+      }
+    }
+  }
+  uint32_t old = w->now;
+  reptile_wheel_init(w, now);
+  for (uint8_t k = 0; k < n; ++k) {
+    /* Pending timers expire after the clock */
+    reptile_wheel_schedule(w, now + (pending[k].expires - old),
+                           pending[k].kind, pending[k].arg);
+  }
+}
+
+/* Earliest time after the clock at which slot work is due on @p level */
+static uint64_t level_next_time(const reptile_wheel_t *w, int level) {
+  uint64_t occ = w->occupied[level];
+  if (!occ) {
+    return UINT64_MAX;
+  }
+  uint32_t shift = level_shift(level);
+  uint32_t cur = (w->now >> shift) & SLOT_MASK;
+  /* Slots after the current one, then wrap to the next rotation */
+  uint64_t after = (cur == SLOT_MASK) ? 0 : occ & (~0ULL << (cur + 1U));
+  uint64_t base = ((uint64_t)w->now >> (shift + REPTILE_WHEEL_BITS))
+                  << (shift + REPTILE_WHEEL_BITS);
+  if (after) {
+    return base + ((uint64_t)__builtin_ctzll(after) << shift);
+  }
+  return base + (1ULL << (shift + REPTILE_WHEEL_BITS)) +
+         ((uint64_t)__builtin_ctzll(occ) << shift);
+}
+
+static uint64_t wheel_next_time(const reptile_wheel_t *w) {
+  uint64_t next = UINT64_MAX;
+  for (int level = 0; level < REPTILE_WHEEL_LEVELS; ++level) {
+    uint64_t t = level_next_time(w, level);
+    next = (t < next) ? t : next;
+  }
+  return next;
+}
+
+uint32_t reptile_wheel_next_expiry(const reptile_wheel_t *w) {
+  if (!w || w->count == 0) {
+    return UINT32_MAX;
+  }
+  /*
+   * A timer sits on the level of the highest bit group where it differs
+   * from the clock, so every timer of a lower level expires first. The
+   * earliest slot of the lowest non-empty level holds the next expiry.
+   */
+  for (int level = 0; level < REPTILE_WHEEL_LEVELS; ++level) {
+    uint64_t t = level_next_time(w, level);
+    if (t == UINT64_MAX) {
+      continue;
+    }
+    uint32_t shift = level_shift(level);
+    uint32_t slot = (uint32_t)(t >> shift) & SLOT_MASK;
+    uint32_t best = UINT32_MAX;
+    for (uint8_t i = w->head[level][slot]; i != REPTILE_WHEEL_NIL;
+         i = w->pool[i].next) {
+      best = (w->pool[i].expires < best) ? w->pool[i].expires : best;
+    }
+    return best;
+  }
+  return UINT32_MAX;
+}
+
+static uint8_t detach_slot(reptile_wheel_t *w, int level, uint32_t slot) {
+  uint8_t list = w->head[level][slot];
+  w->head[level][slot] = REPTILE_WHEEL_NIL;
+  w->occupied[level] &= ~(1ULL << slot);
+  return list;
+}
+
+uint32_t reptile_wheel_advance(reptile_wheel_t *w, uint32_t now,
+                               reptile_wheel_cb_t cb, void *ctx) {
+  if (!w) {
+    return 0;
+  }
+  uint32_t fired = 0;
+  while (w->now < now) {
+    uint64_t t = wheel_next_time(w);
+    if (t > now) {
+      /* Nothing due before @p now: no slot range starts in between */
+      w->now = now;
+      break;
+    }
+    w->now = (uint32_t)t;
+
+    /* Re-file the higher slots whose range starts now, top level first */
+    for (int level = TOP; level > 0; --level) {
+      uint32_t shift = level_shift(level);
+      if (w->now & ((1U << shift) - 1U)) {
+        continue;
+      }
+      uint8_t i = detach_slot(w, level, (w->now >> shift) & SLOT_MASK);
+      while (i != REPTILE_WHEEL_NIL) {
+        uint8_t next = w->pool[i].next;
+        wheel_insert(w, i);
+        i = next;
+      }
+    }
+
+    uint8_t i = detach_slot(w, 0, w->now & SLOT_MASK);
+    while (i != REPTILE_WHEEL_NIL) {
+      reptile_wheel_timer_t tm = w->pool[i];
+      w->pool[i].next = w->free_head;
+      w->free_head = i;
+      w->count--;
+      if (cb) {
+        cb(ctx, tm.kind, tm.arg, tm.expires);
+      }
+      fired++;
+      i = tm.next;
+    }
+  }
+  return fired;
+}
@@ -0,0 +1,88 @@
+#ifndef REPTILE_WHEEL_H
+#define REPTILE_WHEEL_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Hierarchical timer wheel with one-second resolution.
+ *
+ * Level L has 64 slots of 64^L seconds each, so four levels cover about
+ * 194 days; later timers are parked in the top level and re-filed when it
+ * wraps. Timers come from a fixed pool and are chained by index, so the
+ * wheel is plain data and can be saved as part of reptile_t.
+ *
+ * Insert is O(1). Advancing jumps straight to the next non-empty slot
+ * using the per-level occupancy bitmaps, so a gap of months costs a few
+ * iterations per pending timer, not one per second.
+ */
+
+#define REPTILE_WHEEL_LEVELS 4
+#define REPTILE_WHEEL_BITS 6
+#define REPTILE_WHEEL_SLOTS (1U << REPTILE_WHEEL_BITS)
+#define REPTILE_WHEEL_POOL 16
+#define REPTILE_WHEEL_NIL 0xFFU
+
+typedef struct {
+  uint32_t expires; /* absolute time in seconds */
+  uint8_t next;     /* next timer of the slot, or REPTILE_WHEEL_NIL */
+  uint8_t kind;
+  uint16_t arg;
+} reptile_wheel_timer_t;
+
+typedef struct {
+  uint32_t now; /* time up to which every timer has fired */
+  uint8_t free_head;
+  uint8_t count;
+  uint8_t head[REPTILE_WHEEL_LEVELS][REPTILE_WHEEL_SLOTS];
+  uint64_t occupied[REPTILE_WHEEL_LEVELS];
+  reptile_wheel_timer_t pool[REPTILE_WHEEL_POOL];
+} reptile_wheel_t;
+
+/** Called for each expired timer, in expiry order. May schedule timers. */
+typedef void (*reptile_wheel_cb_t)(void *ctx, uint8_t kind, uint16_t arg,
+                                   uint32_t expires);
+
+/** Empty the wheel and set its clock to @p now. */
+void reptile_wheel_init(reptile_wheel_t *w, uint32_t now);
+
+/**
+ * @brief Schedule a timer at absolute time @p expires.
+ *
+ * Times not after the wheel clock fire on the next advance.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM when the pool is exhausted.
+ */
+esp_err_t reptile_wheel_schedule(reptile_wheel_t *w, uint32_t expires,
+                                 uint8_t kind, uint16_t arg);
+
+/** Cancel every timer of @p kind. @return Number of timers removed. */
+uint32_t reptile_wheel_cancel(reptile_wheel_t *w, uint8_t kind);
+
+/**
+ * @brief Fire every timer due up to @p now and move the clock there.
+ *
+ * @return Number of timers fired.
+ */
+uint32_t reptile_wheel_advance(reptile_wheel_t *w, uint32_t now,
+                               reptile_wheel_cb_t cb, void *ctx);
+
+/**
+ * @brief Move the clock to @p now, earlier or later, without firing
+ * anything: every timer keeps the time it had left. Used when the wall
+ * clock is set back.
+ */
+void reptile_wheel_rebase(reptile_wheel_t *w, uint32_t now);
+
+/** Earliest pending expiry. @return UINT32_MAX when the wheel is empty. */
+uint32_t reptile_wheel_next_expiry(const reptile_wheel_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REPTILE_WHEEL_H
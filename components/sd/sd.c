@@ -38,7 +38,7 @@ esp_err_t sd_mmc_init() {
     esp_vfs_fat_sdmmc_mount_config_t mount_config = {
         .format_if_mount_failed = EXAMPLE_FORMAT_IF_MOUNT_FAILED, // Format if mount fails
         .max_files = 5,                  // Max number of open files
-        .allocation_unit_size = 16 * 1024 // Allocation unit size
+        .allocation_unit_size = SD_ALLOCATION_UNIT_SIZE // Allocation unit size
     };
 
     // Attempt to mount the filesystem multiple times
@@ -110,6 +110,18 @@ esp_err_t sd_card_print_info() {
     return ESP_OK;
 }
 
+/**
+ * @brief Check that the mounted SD card still answers.
+ *
+ * Sends a status request (CMD13): a removed card times out.
+ */
+esp_err_t sd_card_probe() {
+    if (card == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return sdmmc_get_status(card);
+}
+
 /**
  * @brief Unmount the SD card and release resources.
  * 
@@ -33,6 +33,7 @@
 #define EXAMPLE_PIN_CLK GPIO_NUM_12          // GPIO pin for SD card clock
 #define EXAMPLE_PIN_CMD GPIO_NUM_11          // GPIO pin for SD card command line
 #define EXAMPLE_PIN_D0  GPIO_NUM_13          // GPIO pin for SD card data line (D0)
+#define SD_ALLOCATION_UNIT_SIZE (16 * 1024) // Cluster size when formatting, log write unit
 
 // Function declarations
 
@@ -61,7 +62,16 @@ esp_err_t sd_mmc_unmount();
  * @retval ESP_OK if the information is printed successfully.
  * @retval ESP_ERR_INVALID_STATE if no card is mounted.
  */
-esp_err_t sd_card_print_info();
+esp_err_t sd_card_print_info();
+
+/**
+ * @brief Check that the mounted SD card still answers (CMD13 status).
+ *
+ * @retval ESP_OK if the card replied.
+ * @retval ESP_ERR_INVALID_STATE if no card is mounted.
+ * @retval Other error codes if the card did not reply (removed or faulty).
+ */
+esp_err_t sd_card_probe();
 
 /**
  * @brief Get total and available memory capacity of the SD card.
@@ -3,6 +3,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "log_limit.h"
 #include <math.h>
 #include <stdbool.h>
 
@@ -75,7 +76,7 @@ static float sensors_real_read_temperature(void)
     }
 
     if (count == 0) {
-        ESP_LOGW(TAG, "No temperature sensor available");
+        LOG_LIMIT_W(TAG, "No temperature sensor available");
         return NAN;
     }
 
@@ -1,5 +1,5 @@
 #include "sensors.h"
-#include "esp_random.h"
+#include "prng.h"
 #include <math.h>
 
 static float s_temp = NAN;
@@ -15,8 +15,7 @@ static float sensors_sim_read_temperature(void)
     if (!isnan(s_temp)) {
         return s_temp;
     }
-    uint32_t randv = esp_random();
-    return 26.0f + (float)(randv % 80) / 10.0f;
+    return 26.0f + (float)prng_range(PRNG_STREAM_SENSORS, 80) / 10.0f;
 }
 
 static float sensors_sim_read_humidity(void)
@@ -24,8 +23,7 @@ static float sensors_sim_read_humidity(void)
     if (!isnan(s_hum)) {
         return s_hum;
     }
-    uint32_t randv = esp_random();
-    return 40.0f + (float)(randv % 200) / 10.0f;
+    return 40.0f + (float)prng_range(PRNG_STREAM_SENSORS, 200) / 10.0f;
 }
 
 static void sensors_sim_deinit(void)
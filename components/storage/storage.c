@@ -0,0 +1,102 @@
+#include "storage.h"
+
+static const storage_backend_t *s_backend = &storage_posix_backend;
+
+void storage_set_backend(const storage_backend_t *backend) {
+  s_backend = backend ? backend : &storage_posix_backend;
+}
+
+const storage_backend_t *storage_get_backend(void) { return s_backend; }
+
+esp_err_t storage_open(const char *path, storage_mode_t mode,
+                       storage_file_t **out) {
+  if (!path || !out) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *out = NULL;
+  esp_err_t err = s_backend->open(path, mode, out);
+  if (err == ESP_OK) {
+    (*out)->backend = s_backend;
+  }
+  return err;
+}
+
+esp_err_t storage_close(storage_file_t *f) {
+  if (!f) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return f->backend->close(f);
+}
+
+esp_err_t storage_pread(storage_file_t *f, void *buf, size_t len,
+                        uint32_t off, size_t *done) {
+  if (!f || (!buf && len)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  size_t n = 0;
+  esp_err_t err = f->backend->pread(f, buf, len, off, &n);
+  if (done) {
+    *done = n;
+  } else if (err == ESP_OK && n != len) {
+    err = ESP_FAIL;
+  }
+  return err;
+}
+
+esp_err_t storage_pwrite(storage_file_t *f, const void *buf, size_t len,
+                         uint32_t off) {
+  if (!f || (!buf && len)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return f->backend->pwrite(f, buf, len, off);
+}
+
+esp_err_t storage_append(storage_file_t *f, const void *buf, size_t len) {
+  if (!f || (!buf && len)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return f->backend->append(f, buf, len);
+}
+
+esp_err_t storage_fsync(storage_file_t *f) {
+  if (!f) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return f->backend->fsync(f);
+}
+
+esp_err_t storage_size(storage_file_t *f, uint32_t *out) {
+  if (!f || !out) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return f->backend->size(f, out);
+}
+
+esp_err_t storage_rename(const char *from, const char *to) {
+  if (!from || !to) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return s_backend->rename(from, to);
+}
+
+esp_err_t storage_remove(const char *path) {
+  if (!path) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return s_backend->remove(path);
+}
+
+esp_err_t storage_stat(const char *path, uint32_t *size) {
+  if (!path) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  uint32_t unused;
+  return s_backend->stat(path, size ? size : &unused);
+}
+
+esp_err_t storage_mkdir(const char *path) {
+  if (!path) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return s_backend->mkdir(path);
+}
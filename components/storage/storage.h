@@ -0,0 +1,99 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Thin file interface used for everything written to the SD card.
+ *
+ * Calls go to the selected backend: storage_posix (default) maps them to
+ * open/pread/pwrite/fsync, i.e. to FATFS through the ESP VFS on the board
+ * and to the host file system elsewhere; storage_fake keeps files in memory
+ * and models an SD card (storage_fake.h). Paths are absolute, e.g. under
+ * MOUNT_POINT.
+ *
+ * Every call returns ESP_OK or an error: ESP_ERR_NOT_FOUND for a missing
+ * file, ESP_ERR_INVALID_ARG, ESP_FAIL for an I/O error. Writes are all or
+ * nothing from the caller's point of view; a short write is an error.
+ */
+
+typedef enum {
+  STORAGE_READ,   /* existing file, read only */
+  STORAGE_RDWR,   /* existing file, read and write in place */
+  STORAGE_CREATE, /* create or truncate, read and write */
+  STORAGE_APPEND, /* create if missing, storage_append writes at the end */
+} storage_mode_t;
+
+/** Open file; backends extend it with their own fields. */
+typedef struct storage_file {
+  const struct storage_backend *backend;
+} storage_file_t;
+
+typedef struct storage_backend {
+  const char *name;
+  esp_err_t (*open)(const char *path, storage_mode_t mode,
+                    storage_file_t **out);
+  esp_err_t (*close)(storage_file_t *f);
+  esp_err_t (*pread)(storage_file_t *f, void *buf, size_t len, uint32_t off,
+                     size_t *done);
+  esp_err_t (*pwrite)(storage_file_t *f, const void *buf, size_t len,
+                      uint32_t off);
+  esp_err_t (*append)(storage_file_t *f, const void *buf, size_t len);
+  esp_err_t (*fsync)(storage_file_t *f);
+  esp_err_t (*size)(storage_file_t *f, uint32_t *out);
+  esp_err_t (*rename)(const char *from, const char *to);
+  esp_err_t (*remove)(const char *path);
+  esp_err_t (*stat)(const char *path, uint32_t *size);
+  esp_err_t (*mkdir)(const char *path);
+} storage_backend_t;
+
+extern const storage_backend_t storage_posix_backend;
+
+/**
+ * @brief Route the calls that open a file, and the path operations, to
+ * @p backend (NULL restores storage_posix). Files already open keep theirs.
+ */
+void storage_set_backend(const storage_backend_t *backend);
+const storage_backend_t *storage_get_backend(void);
+
+esp_err_t storage_open(const char *path, storage_mode_t mode,
+                       storage_file_t **out);
+esp_err_t storage_close(storage_file_t *f);
+
+/**
+ * @brief Read up to @p len bytes at @p off.
+ *
+ * @param done Bytes read, fewer than @p len at the end of the file. NULL
+ *             requires the full length (ESP_FAIL otherwise).
+ */
+esp_err_t storage_pread(storage_file_t *f, void *buf, size_t len,
+                        uint32_t off, size_t *done);
+/** Write @p len bytes at @p off, growing the file if needed. */
+esp_err_t storage_pwrite(storage_file_t *f, const void *buf, size_t len,
+                         uint32_t off);
+/** Write @p len bytes at the end of the file. */
+esp_err_t storage_append(storage_file_t *f, const void *buf, size_t len);
+/** Push written data and the directory entry to the medium. */
+esp_err_t storage_fsync(storage_file_t *f);
+esp_err_t storage_size(storage_file_t *f, uint32_t *out);
+
+/** Rename @p from to @p to; fails if @p to exists, as on FAT. */
+esp_err_t storage_rename(const char *from, const char *to);
+esp_err_t storage_remove(const char *path);
+/** Size of the file at @p path, ESP_ERR_NOT_FOUND if missing. */
+esp_err_t storage_stat(const char *path, uint32_t *size);
+/** Create a directory; an existing one is not an error. */
+esp_err_t storage_mkdir(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STORAGE_H
@@ -0,0 +1,434 @@
+#include "storage_fake.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FAKE_MAX_FILES 128 /* a few months of daily log segments */
+#define FAKE_PATH_LEN 96
+
+typedef struct {
+  bool used;
+  char path[FAKE_PATH_LEN];
+  uint8_t *data;
+  uint32_t size;
+  uint32_t cap;
+  uint32_t clusters; /* allocated on the volume */
+} fake_node_t;
+
+typedef struct {
+  storage_file_t base;
+  int node;
+  storage_mode_t mode;
+  bool dirty;     /* directory entry (size, date) to write back */
+  uint32_t win;   /* sector held in the file's buffer, UINT32_MAX: none */
+  bool win_dirty; /* buffer not programmed yet */
+} fake_file_t;
+
+static storage_fake_config_t s_cfg = STORAGE_FAKE_CONFIG_DEFAULT();
+static fake_node_t s_nodes[FAKE_MAX_FILES];
+static storage_fake_stats_t s_stats;
+static uint64_t s_budget = UINT64_MAX;
+static bool s_cut;
+static uint32_t s_fail_ppm;
+static uint32_t s_rng;
+
+/* Time of one command moving @p bytes at @p kib_s */
+static uint32_t xfer_us(uint32_t bytes, uint32_t kib_s) {
+  return s_cfg.cmd_us +
+         (uint32_t)((uint64_t)bytes * 1000000U / ((uint64_t)kib_s * 1024U));
+}
+
+static void charge(uint32_t us) {
+  s_stats.busy_us += us;
+  if (us > s_stats.max_op_us) {
+    s_stats.max_op_us = us;
+  }
+  if (s_cfg.realtime && us) {
+    usleep(us);
+  }
+}
+
+static uint32_t meta_write(void) {
+  s_stats.meta_writes++;
+  s_stats.media_written += s_cfg.sector_size;
+  return xfer_us(s_cfg.sector_size, s_cfg.write_kib_s);
+}
+
+/* Power state and transient errors, checked at the start of every call */
+static bool call_fails(void) {
+  s_stats.ops++;
+  if (s_cut) {
+    s_stats.failures++;
+    return true;
+  }
+  if (s_fail_ppm) {
+    s_rng = s_rng * 1664525U + 1013904223U;
+    if ((s_rng >> 8) % 1000000U < s_fail_ppm) {
+      s_stats.failures++;
+      return true;
+    }
+  }
+  return false;
+}
+
+static int node_find(const char *path) {
+  for (int i = 0; i < FAKE_MAX_FILES; ++i) {
+    if (s_nodes[i].used && strcmp(s_nodes[i].path, path) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void node_free(int i) {
+  free(s_nodes[i].data);
+  memset(&s_nodes[i], 0, sizeof(s_nodes[i]));
+}
+
+static int node_create(const char *path) {
+  if (strlen(path) >= FAKE_PATH_LEN) {
+    return -1;
+  }
+  for (int i = 0; i < FAKE_MAX_FILES; ++i) {
+    if (!s_nodes[i].used) {
+      s_nodes[i].used = true;
+      strcpy(s_nodes[i].path, path);
+      return i;
+    }
+  }
+  return -1;
+}
+
+static bool node_reserve(fake_node_t *n, uint32_t size) {
+  if (size <= n->cap) {
+    return true;
+  }
+  uint32_t cap = n->cap ? n->cap : 1024U;
+  while (cap < size) {
+    cap *= 2U;
+  }
+  uint8_t *data = realloc(n->data, cap);
+  if (!data) {
+    return false;
+  }
+  memset(data + n->cap, 0, cap - n->cap);
+  n->data = data;
+  n->cap = cap;
+  return true;
+}
+
+/* Program the buffered sector of @p f, if modified */
+static uint32_t win_flush(fake_file_t *f) {
+  if (!f->win_dirty) {
+    return 0;
+  }
+  f->win_dirty = false;
+  s_stats.media_written += s_cfg.sector_size;
+  return xfer_us(s_cfg.sector_size, s_cfg.write_kib_s);
+}
+
+/*
+ * Store @p len bytes at @p off, charged like FATFS: whole sectors are
+ * programmed directly, a partial sector goes through the one-sector buffer
+ * of the file, read first if it holds data, and is programmed when the
+ * buffer moves to another sector or on fsync/close; new clusters update
+ * the FAT. Returns the modelled time. With a power cut pending, only the
+ * bytes within the budget are stored and *torn is set.
+ */
+static uint32_t file_write(fake_file_t *f, const void *buf, uint32_t len,
+                           uint32_t off, bool *torn) {
+  fake_node_t *n = &s_nodes[f->node];
+  uint32_t us = 0;
+  uint32_t keep = len;
+  *torn = false;
+  if (s_budget < len) {
+    keep = (uint32_t)s_budget;
+    *torn = true;
+  }
+  if (s_budget != UINT64_MAX) {
+    s_budget -= keep;
+  }
+  uint32_t ss = s_cfg.sector_size;
+  uint32_t end = off + len;
+  uint32_t direct = 0;
+  for (uint32_t sec = off / ss; sec <= (end - 1U) / ss; ++sec) {
+    uint32_t start = sec * ss;
+    if (start >= off && start + ss <= end && sec != f->win) {
+      direct++;
+      continue;
+    }
+    if (sec != f->win) {
+      us += win_flush(f);
+      if (start < n->size) {
+        s_stats.rmw++;
+        us += xfer_us(ss, s_cfg.read_kib_s);
+      }
+      f->win = sec;
+    }
+    f->win_dirty = true;
+  }
+  if (direct) {
+    s_stats.media_written += (uint64_t)direct * ss;
+    us += xfer_us(direct * ss, s_cfg.write_kib_s);
+  }
+  uint32_t clusters = (end + s_cfg.cluster_size - 1U) / s_cfg.cluster_size;
+  if (clusters > n->clusters) {
+    n->clusters = clusters;
+    us += meta_write();
+  }
+
+  memcpy(n->data + off, buf, keep);
+  uint32_t reached = off + keep;
+  if (reached > n->size) {
+    n->size = reached;
+  }
+  s_stats.bytes_written += keep;
+  return us;
+}
+
+static esp_err_t fake_open(const char *path, storage_mode_t mode,
+                           storage_file_t **out) {
+  if (call_fails()) {
+    return ESP_FAIL;
+  }
+  uint32_t us = s_cfg.meta_us;
+  int i = node_find(path);
+  bool created = false;
+  if (i < 0) {
+    if (mode == STORAGE_READ || mode == STORAGE_RDWR) {
+      charge(us);
+      return ESP_ERR_NOT_FOUND;
+    }
+    i = node_create(path);
+    if (i < 0) {
+      charge(us);
+      return ESP_ERR_NO_MEM;
+    }
+    created = true;
+  } else if (mode == STORAGE_CREATE && s_nodes[i].size) {
+    s_nodes[i].size = 0;
+    s_nodes[i].clusters = 0;
+    created = true;
+  }
+  if (created) {
+    us += meta_write();
+  }
+  charge(us);
+  fake_file_t *f = calloc(1, sizeof(*f));
+  if (!f) {
+    return ESP_ERR_NO_MEM;
+  }
+  f->node = i;
+  f->mode = mode;
+  f->win = UINT32_MAX;
+  *out = &f->base;
+  return ESP_OK;
+}
+
+static esp_err_t fake_close(storage_file_t *file) {
+  fake_file_t *f = (fake_file_t *)file;
+  if (call_fails()) {
+    free(f);
+    return ESP_FAIL;
+  }
+  uint32_t us = win_flush(f);
+  if (f->dirty) {
+    us += meta_write();
+  }
+  free(f);
+  charge(us);
+  return ESP_OK;
+}
+
+static esp_err_t fake_pread(storage_file_t *file, void *buf, size_t len,
+                            uint32_t off, size_t *done) {
+  fake_file_t *f = (fake_file_t *)file;
+  *done = 0;
+  if (call_fails()) {
+    return ESP_FAIL;
+  }
+  if (f->mode == STORAGE_APPEND) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  fake_node_t *n = &s_nodes[f->node];
+  size_t avail = (off < n->size) ? n->size - off : 0;
+  size_t got = (len < avail) ? len : avail;
+  memcpy(buf, n->data + off, got);
+  *done = got;
+  s_stats.bytes_read += got;
+  charge(xfer_us((uint32_t)got, s_cfg.read_kib_s));
+  return ESP_OK;
+}
+
+static esp_err_t fake_write_at(fake_file_t *f, const void *buf, size_t len,
+                               uint32_t off) {
+  if (call_fails()) {
+    return ESP_FAIL;
+  }
+  if (f->mode == STORAGE_READ) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (len == 0) {
+    return ESP_OK;
+  }
+  fake_node_t *n = &s_nodes[f->node];
+  if ((uint64_t)off + len > UINT32_MAX ||
+      !node_reserve(n, off + (uint32_t)len)) {
+    return ESP_ERR_NO_MEM;
+  }
+  bool torn;
+  charge(file_write(f, buf, (uint32_t)len, off, &torn));
+  f->dirty = true;
+  if (torn) {
+    s_cut = true;
+    s_stats.failures++;
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t fake_pwrite(storage_file_t *file, const void *buf, size_t len,
+                             uint32_t off) {
+  return fake_write_at((fake_file_t *)file, buf, len, off);
+}
+
+static esp_err_t fake_append(storage_file_t *file, const void *buf,
+                             size_t len) {
+  fake_file_t *f = (fake_file_t *)file;
+  return fake_write_at(f, buf, len, s_nodes[f->node].size);
+}
+
+static esp_err_t fake_fsync(storage_file_t *file) {
+  fake_file_t *f = (fake_file_t *)file;
+  if (call_fails()) {
+    return ESP_FAIL;
+  }
+  uint32_t us = s_cfg.sync_us + win_flush(f);
+  if (f->dirty) {
+    us += meta_write();
+    f->dirty = false;
+  }
+  s_stats.syncs++;
+  charge(us);
+  return ESP_OK;
+}
+
+static esp_err_t fake_size(storage_file_t *file, uint32_t *out) {
+  *out = s_nodes[((fake_file_t *)file)->node].size;
+  return ESP_OK;
+}
+
+static esp_err_t fake_rename(const char *from, const char *to) {
+  if (call_fails()) {
+    return ESP_FAIL;
+  }
+  int i = node_find(from);
+  if (i < 0) {
+    charge(s_cfg.meta_us);
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (node_find(to) >= 0 || strlen(to) >= FAKE_PATH_LEN) {
+    charge(s_cfg.meta_us);
+    return ESP_FAIL;
+  }
+  strcpy(s_nodes[i].path, to);
+  /* New entry, then the old one marked deleted */
+  charge(s_cfg.meta_us + meta_write() + meta_write());
+  return ESP_OK;
+}
+
+static esp_err_t fake_remove(const char *path) {
+  if (call_fails()) {
+    return ESP_FAIL;
+  }
+  int i = node_find(path);
+  if (i < 0) {
+    charge(s_cfg.meta_us);
+    return ESP_ERR_NOT_FOUND;
+  }
+  node_free(i);
+  /* Directory entry and FAT chain */
+  charge(s_cfg.meta_us + meta_write() + meta_write());
+  return ESP_OK;
+}
+
+static esp_err_t fake_stat(const char *path, uint32_t *size) {
+  if (call_fails()) {
+    return ESP_FAIL;
+  }
+  charge(s_cfg.meta_us);
+  int i = node_find(path);
+  if (i < 0) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  *size = s_nodes[i].size;
+  return ESP_OK;
+}
+
+static esp_err_t fake_mkdir(const char *path) {
+  (void)path;
+  if (call_fails()) {
+    return ESP_FAIL;
+  }
+  charge(s_cfg.meta_us);
+  return ESP_OK;
+}
+
+const storage_backend_t storage_fake_backend = {
+    .name = "fake_sd",
+    .open = fake_open,
+    .close = fake_close,
+    .pread = fake_pread,
+    .pwrite = fake_pwrite,
+    .append = fake_append,
+    .fsync = fake_fsync,
+    .size = fake_size,
+    .rename = fake_rename,
+    .remove = fake_remove,
+    .stat = fake_stat,
+    .mkdir = fake_mkdir,
+};
+
+void storage_fake_init(const storage_fake_config_t *cfg) {
+  storage_fake_deinit();
+  if (cfg) {
+    s_cfg = *cfg;
+  } else {
+    storage_fake_config_t def = STORAGE_FAKE_CONFIG_DEFAULT();
+    s_cfg = def;
+  }
+}
+
+void storage_fake_deinit(void) {
+  for (int i = 0; i < FAKE_MAX_FILES; ++i) {
+    if (s_nodes[i].used) {
+      node_free(i);
+    }
+  }
+  storage_fake_reset_stats();
+  s_budget = UINT64_MAX;
+  s_cut = false;
+  s_fail_ppm = 0;
+}
+
+void storage_fake_get_stats(storage_fake_stats_t *out) {
+  if (out) {
+    *out = s_stats;
+  }
+}
+
+void storage_fake_reset_stats(void) { memset(&s_stats, 0, sizeof(s_stats)); }
+
+void storage_fake_cut_after(uint64_t bytes) { s_budget = bytes; }
+
+bool storage_fake_is_cut(void) { return s_cut; }
+
+void storage_fake_power_on(void) {
+  s_cut = false;
+  s_budget = UINT64_MAX;
+}
+
+void storage_fake_set_fail_rate(uint32_t per_million, uint32_t seed) {
+  s_fail_ppm = per_million;
+  s_rng = seed;
+}
@@ -0,0 +1,92 @@
+#ifndef STORAGE_FAKE_H
+#define STORAGE_FAKE_H
+
+#include "storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * In-memory SD card for host tests and benchmarks.
+ *
+ * Files live in RAM; every call is charged the time a FAT volume on an SD
+ * card would take. Whole sectors are programmed directly; a partial sector
+ * goes through the one-sector buffer of the open file, read first if it
+ * holds data (read-modify-write) and programmed when the buffer moves or
+ * on fsync/close. Growing a file into a new cluster writes a FAT sector,
+ * and the directory entry is written on fsync or close after a change, on
+ * create, rename and remove. The modelled time is accumulated in the stats
+ * (busy_us), and also slept when @c realtime is set.
+ *
+ * Failures: a power cut after a byte budget tears the write that crosses
+ * it and fails every later call until ::storage_fake_power_on, with the
+ * bytes before the cut kept (writes reach the medium in order, buffered
+ * ones included). Transient errors fail a share of the calls without
+ * touching the data.
+ *
+ * Not thread-safe; the callers under test run on one thread.
+ */
+
+typedef struct {
+  uint32_t sector_size;  /* bytes programmed at once */
+  uint32_t cluster_size; /* FAT allocation unit */
+  uint32_t cmd_us;       /* fixed cost of a read or write command */
+  uint32_t read_kib_s;   /* transfer rates */
+  uint32_t write_kib_s;
+  uint32_t sync_us;  /* card busy programming on fsync */
+  uint32_t meta_us;  /* directory lookup of open, stat, rename, remove */
+  bool realtime;     /* sleep for the modelled time as well */
+} storage_fake_config_t;
+
+/* Class 10 card on the 1-bit SDMMC bus, small random writes */
+#define STORAGE_FAKE_CONFIG_DEFAULT()                                          \
+  {                                                                            \
+      .sector_size = 512,                                                      \
+      .cluster_size = 4096,                                                    \
+      .cmd_us = 1000,                                                          \
+      .read_kib_s = 8192,                                                      \
+      .write_kib_s = 4096,                                                     \
+      .sync_us = 2000,                                                         \
+      .meta_us = 500,                                                          \
+      .realtime = false,                                                       \
+  }
+
+typedef struct {
+  uint32_t ops;           /* backend calls */
+  uint64_t bytes_written; /* requested by the callers */
+  uint64_t bytes_read;
+  uint64_t media_written; /* sectors programmed, metadata included */
+  uint32_t rmw;           /* partial sectors read back before a write */
+  uint32_t meta_writes;   /* FAT and directory sectors */
+  uint32_t syncs;
+  uint32_t failures; /* injected errors and calls refused after a cut */
+  uint64_t busy_us;  /* modelled card time */
+  uint32_t max_op_us;
+} storage_fake_stats_t;
+
+/** The backend to pass to ::storage_set_backend. */
+extern const storage_backend_t storage_fake_backend;
+
+/** Drop every file and reset stats and failures; NULL uses the defaults. */
+void storage_fake_init(const storage_fake_config_t *cfg);
+/** Free the files. */
+void storage_fake_deinit(void);
+
+void storage_fake_get_stats(storage_fake_stats_t *out);
+void storage_fake_reset_stats(void);
+
+/** Cut the power once @p bytes more bytes were written (UINT64_MAX: never). */
+void storage_fake_cut_after(uint64_t bytes);
+/** True once the power was cut. */
+bool storage_fake_is_cut(void);
+/** Restore the power; files keep what reached them before the cut. */
+void storage_fake_power_on(void);
+/** Fail @p per_million of the calls, drawn from @p seed (0: never). */
+void storage_fake_set_fail_rate(uint32_t per_million, uint32_t seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STORAGE_FAKE_H
@@ -0,0 +1,171 @@
+#include "storage.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* FATFS through the ESP VFS on the board, the host file system elsewhere */
+
+typedef struct {
+  storage_file_t base;
+  int fd;
+} posix_file_t;
+
+static esp_err_t errno_to_err(void) {
+  return (errno == ENOENT) ? ESP_ERR_NOT_FOUND : ESP_FAIL;
+}
+
+static esp_err_t posix_open(const char *path, storage_mode_t mode,
+                            storage_file_t **out) {
+  int flags;
+  switch (mode) {
+  case STORAGE_READ:
+    flags = O_RDONLY;
+    break;
+  case STORAGE_RDWR:
+    flags = O_RDWR;
+    break;
+  case STORAGE_CREATE:
+    flags = O_RDWR | O_CREAT | O_TRUNC;
+    break;
+  case STORAGE_APPEND:
+    flags = O_WRONLY | O_CREAT | O_APPEND;
+    break;
+  default:
+    return ESP_ERR_INVALID_ARG;
+  }
+  posix_file_t *f = malloc(sizeof(*f));
+  if (!f) {
+    return ESP_ERR_NO_MEM;
+  }
+  f->fd = open(path, flags, 0666);
+  if (f->fd < 0) {
+    esp_err_t err = errno_to_err();
+    free(f);
+    return err;
+  }
+  *out = &f->base;
+  return ESP_OK;
+}
+
+static esp_err_t posix_close(storage_file_t *file) {
+  posix_file_t *f = (posix_file_t *)file;
+  int rc = close(f->fd);
+  free(f);
+  return (rc == 0) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t posix_pread(storage_file_t *file, void *buf, size_t len,
+                             uint32_t off, size_t *done) {
+  posix_file_t *f = (posix_file_t *)file;
+  size_t total = 0;
+  while (total < len) {
+    ssize_t n = pread(f->fd, (uint8_t *)buf + total, len - total,
+                      (off_t)off + (off_t)total);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      *done = total;
+      return ESP_FAIL;
+    }
+    if (n == 0) {
+      break;
+    }
+    total += (size_t)n;
+  }
+  *done = total;
+  return ESP_OK;
+}
+
+static esp_err_t posix_pwrite(storage_file_t *file, const void *buf,
+                              size_t len, uint32_t off) {
+  posix_file_t *f = (posix_file_t *)file;
+  size_t total = 0;
+  while (total < len) {
+    ssize_t n = pwrite(f->fd, (const uint8_t *)buf + total, len - total,
+                       (off_t)off + (off_t)total);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return ESP_FAIL;
+    }
+    total += (size_t)n;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t posix_append(storage_file_t *file, const void *buf,
+                              size_t len) {
+  posix_file_t *f = (posix_file_t *)file;
+  size_t total = 0;
+  while (total < len) {
+    ssize_t n = write(f->fd, (const uint8_t *)buf + total, len - total);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return ESP_FAIL;
+    }
+    total += (size_t)n;
+  }
+  return ESP_OK;
+}
+
+static esp_err_t posix_fsync(storage_file_t *file) {
+  return (fsync(((posix_file_t *)file)->fd) == 0) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t posix_size(storage_file_t *file, uint32_t *out) {
+  struct stat st;
+  if (fstat(((posix_file_t *)file)->fd, &st) != 0) {
+    return ESP_FAIL;
+  }
+  *out = (uint32_t)st.st_size;
+  return ESP_OK;
+}
+
+static esp_err_t posix_rename(const char *from, const char *to) {
+  if (access(to, F_OK) == 0) {
+    return ESP_FAIL; /* same rule as FAT on every host */
+  }
+  return (rename(from, to) == 0) ? ESP_OK : errno_to_err();
+}
+
+static esp_err_t posix_remove(const char *path) {
+  return (unlink(path) == 0) ? ESP_OK : errno_to_err();
+}
+
+static esp_err_t posix_stat(const char *path, uint32_t *size) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return errno_to_err();
+  }
+  *size = (uint32_t)st.st_size;
+  return ESP_OK;
+}
+
+static esp_err_t posix_mkdir(const char *path) {
+  if (mkdir(path, 0777) != 0 && errno != EEXIST) {
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+const storage_backend_t storage_posix_backend = {
+    .name = "posix",
+    .open = posix_open,
+    .close = posix_close,
+    .pread = posix_pread,
+    .pwrite = posix_pwrite,
+    .append = posix_append,
+    .fsync = posix_fsync,
+    .size = posix_size,
+    .rename = posix_rename,
+    .remove = posix_remove,
+    .stat = posix_stat,
+    .mkdir = posix_mkdir,
+};
@@ -0,0 +1,255 @@
+#include "storage_supervisor.h"
+#include "esp_log.h"
+#include "metrics.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <string.h>
+
+static const char *TAG = "storage_sup";
+
+#define READY_POLL_MS 100 /* wait_ready also polls, for several waiters */
+
+static storage_supervisor_config_t s_cfg;
+static TaskHandle_t s_task;
+static SemaphoreHandle_t s_lock;  /* guards everything below up to s_stats */
+static SemaphoreHandle_t s_ready; /* given at each mount */
+static SemaphoreHandle_t s_done;  /* given when a suspend request is served */
+static storage_card_state_t s_state = STORAGE_CARD_ABSENT;
+static bool s_suspend_req;
+static bool s_resume_req;
+static uint32_t s_epoch;
+static storage_supervisor_stats_t s_stats;
+
+static void set_state(storage_card_state_t state) {
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_state = state;
+  metrics_set(METRIC_SD_STATE, (int32_t)state);
+  if (state == STORAGE_CARD_MOUNTED) {
+    s_epoch++;
+    s_stats.mounts++;
+  }
+  xSemaphoreGive(s_lock);
+  if (state == STORAGE_CARD_MOUNTED) {
+    xSemaphoreGive(s_ready);
+  }
+}
+
+static void card_lost(const char *why) {
+  ESP_LOGW(TAG, "Carte SD perdue (%s), démontage", why);
+  s_cfg.unmount();
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_stats.losses++;
+  xSemaphoreGive(s_lock);
+  metrics_inc(METRIC_SD_LOSSES);
+  set_state(STORAGE_CARD_ABSENT);
+}
+
+static bool probe_ok(void) { return !s_cfg.probe || s_cfg.probe() == ESP_OK; }
+
+static void supervisor_task(void *arg) {
+  (void)arg;
+  uint32_t backoff = 0; /* first mount right away */
+  for (;;) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool suspend = s_suspend_req;
+    bool resume = s_resume_req;
+    s_suspend_req = s_resume_req = false;
+    storage_card_state_t state = s_state;
+    xSemaphoreGive(s_lock);
+
+    if (suspend) {
+      if (state == STORAGE_CARD_MOUNTED || state == STORAGE_CARD_CHECKING) {
+        s_cfg.unmount();
+      }
+      state = STORAGE_CARD_SUSPENDED;
+      set_state(state);
+      xSemaphoreGive(s_done);
+    }
+    if (resume && state == STORAGE_CARD_SUSPENDED) {
+      state = STORAGE_CARD_ABSENT;
+      set_state(state);
+      backoff = 0;
+    }
+
+    switch (state) {
+    case STORAGE_CARD_CHECKING:
+      if (!probe_ok()) {
+        card_lost("erreur signalée");
+        backoff = s_cfg.backoff_min_ms;
+        break;
+      }
+      set_state(STORAGE_CARD_MOUNTED);
+      /* fall through */
+    case STORAGE_CARD_MOUNTED:
+      /* Errors and requests notify; silence means time to probe */
+      if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(s_cfg.probe_ms)) == 0 &&
+          !probe_ok()) {
+        card_lost("sonde");
+        backoff = s_cfg.backoff_min_ms;
+      }
+      break;
+    case STORAGE_CARD_ABSENT:
+      /* Only suspend/resume notify here; they restart the wait */
+      if (backoff && ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(backoff)) != 0) {
+        break;
+      }
+      {
+        esp_err_t err = s_cfg.mount();
+        if (err == ESP_OK || err == ESP_ERR_INVALID_STATE) {
+          ESP_LOGI(TAG, "Carte SD montée");
+          metrics_inc(METRIC_SD_MOUNTS);
+          set_state(STORAGE_CARD_MOUNTED);
+          backoff = s_cfg.backoff_min_ms;
+        } else {
+          metrics_inc(METRIC_SD_MOUNT_FAILS);
+          backoff = backoff ? backoff * 2U : s_cfg.backoff_min_ms;
+          if (backoff > s_cfg.backoff_max_ms) {
+            backoff = s_cfg.backoff_max_ms;
+          }
+          ESP_LOGW(TAG, "Carte SD absente, nouvel essai dans %" PRIu32 " ms",
+                   backoff);
+        }
+      }
+      break;
+    case STORAGE_CARD_SUSPENDED:
+    default:
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      break;
+    }
+  }
+}
+
+esp_err_t storage_supervisor_start(const storage_supervisor_config_t *cfg) {
+  if (!cfg || !cfg->mount || !cfg->unmount) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (s_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!s_lock) {
+    s_lock = xSemaphoreCreateMutex();
+    s_ready = xSemaphoreCreateBinary();
+    s_done = xSemaphoreCreateBinary();
+    if (!s_lock || !s_ready || !s_done) {
+      return ESP_ERR_NO_MEM;
+    }
+  }
+  s_cfg = *cfg;
+  if (s_cfg.backoff_min_ms == 0) {
+    s_cfg.backoff_min_ms = 1;
+  }
+  if (s_cfg.backoff_max_ms < s_cfg.backoff_min_ms) {
+    s_cfg.backoff_max_ms = s_cfg.backoff_min_ms;
+  }
+  s_state = STORAGE_CARD_ABSENT;
+  if (xTaskCreate(supervisor_task, "storage_sup",
+                  STORAGE_SUPERVISOR_TASK_STACK_SIZE, NULL,
+                  STORAGE_SUPERVISOR_TASK_PRIORITY, &s_task) != pdPASS) {
+    s_task = NULL;
+    return ESP_ERR_NO_MEM;
+  }
+  ESP_LOGI(TAG, "Superviseur SD démarré");
+  return ESP_OK;
+}
+
+storage_card_state_t storage_supervisor_state(void) {
+  if (!s_lock) {
+    return STORAGE_CARD_ABSENT;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  storage_card_state_t state = s_state;
+  xSemaphoreGive(s_lock);
+  return state;
+}
+
+bool storage_supervisor_card_ready(void) {
+  return storage_supervisor_state() == STORAGE_CARD_MOUNTED;
+}
+
+uint32_t storage_supervisor_epoch(void) {
+  if (!s_lock) {
+    return 0;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  uint32_t epoch = s_epoch;
+  xSemaphoreGive(s_lock);
+  return epoch;
+}
+
+esp_err_t storage_supervisor_report_error(void) {
+  if (!s_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  bool wake = (s_state == STORAGE_CARD_MOUNTED);
+  if (wake) {
+    s_state = STORAGE_CARD_CHECKING;
+  }
+  xSemaphoreGive(s_lock);
+  if (wake) {
+    xTaskNotifyGive(s_task);
+  }
+  return ESP_OK;
+}
+
+esp_err_t storage_supervisor_wait_ready(uint32_t timeout_ms) {
+  if (!s_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  TickType_t start = xTaskGetTickCount();
+  TickType_t limit = pdMS_TO_TICKS(timeout_ms);
+  for (;;) {
+    if (storage_supervisor_card_ready()) {
+      return ESP_OK;
+    }
+    TickType_t wait = pdMS_TO_TICKS(READY_POLL_MS);
+    if (timeout_ms != portMAX_DELAY) {
+      TickType_t spent = xTaskGetTickCount() - start;
+      if (spent >= limit) {
+        return ESP_ERR_TIMEOUT;
+      }
+      wait = (limit - spent < wait) ? limit - spent : wait;
+    }
+    xSemaphoreTake(s_ready, wait);
+  }
+}
+
+esp_err_t storage_supervisor_suspend(uint32_t timeout_ms) {
+  if (!s_task) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  xSemaphoreTake(s_done, 0); /* drop the completion of a timed-out request */
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_suspend_req = true;
+  xSemaphoreGive(s_lock);
+  xTaskNotifyGive(s_task);
+  if (xSemaphoreTake(s_done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+    return ESP_ERR_TIMEOUT;
+  }
+  return ESP_OK;
+}
+
+void storage_supervisor_resume(void) {
+  if (!s_task) {
+    return;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  s_resume_req = true;
+  xSemaphoreGive(s_lock);
+  xTaskNotifyGive(s_task);
+}
+
+void storage_supervisor_get_stats(storage_supervisor_stats_t *out) {
+  if (!out) {
+    return;
+  }
+  if (!s_lock) {
+    memset(out, 0, sizeof(*out));
+    return;
+  }
+  xSemaphoreTake(s_lock, portMAX_DELAY);
+  *out = s_stats;
+  xSemaphoreGive(s_lock);
+}
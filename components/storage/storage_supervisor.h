@@ -0,0 +1,106 @@
+#ifndef STORAGE_SUPERVISOR_H
+#define STORAGE_SUPERVISOR_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Background owner of the SD card mount.
+ *
+ * A low-priority task mounts the card, watches it (periodic probe, errors
+ * reported by writers) and, once it is gone, unmounts it and retries the
+ * mount with an exponential backoff. Writers keep their own buffers and
+ * tasks (reptile_persist, logging): they check ::storage_supervisor_card_ready
+ * or wait for it with a timeout, and report the errors they see.
+ */
+
+#define STORAGE_SUPERVISOR_TASK_STACK_SIZE (4 * 1024)
+#define STORAGE_SUPERVISOR_TASK_PRIORITY 1 /* below the LVGL task */
+
+typedef struct {
+  esp_err_t (*mount)(void);   /* ESP_ERR_INVALID_STATE: already mounted */
+  esp_err_t (*unmount)(void);
+  esp_err_t (*probe)(void);   /* card still answering; NULL: never probed */
+  uint32_t backoff_min_ms;    /* first remount delay, doubled on failure */
+  uint32_t backoff_max_ms;
+  uint32_t probe_ms;          /* probe period while mounted and idle */
+} storage_supervisor_config_t;
+
+#define STORAGE_SUPERVISOR_CONFIG_DEFAULT()                                    \
+  {                                                                            \
+      .mount = NULL,                                                           \
+      .unmount = NULL,                                                         \
+      .probe = NULL,                                                           \
+      .backoff_min_ms = 500,                                                   \
+      .backoff_max_ms = 30000,                                                 \
+      .probe_ms = 5000,                                                        \
+  }
+
+typedef enum {
+  STORAGE_CARD_ABSENT,    /* not mounted, remount pending */
+  STORAGE_CARD_MOUNTED,
+  STORAGE_CARD_CHECKING,  /* mounted, an error is being checked */
+  STORAGE_CARD_SUSPENDED, /* unmounted on request, see ::storage_supervisor_resume */
+} storage_card_state_t;
+
+typedef struct {
+  uint32_t mounts;
+  uint32_t losses; /* card found gone */
+} storage_supervisor_stats_t;
+
+/**
+ * @brief Start the task; the first mount is attempted right away.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG without mount/unmount,
+ *         ESP_ERR_INVALID_STATE if already running, ESP_ERR_NO_MEM.
+ */
+esp_err_t storage_supervisor_start(const storage_supervisor_config_t *cfg);
+
+storage_card_state_t storage_supervisor_state(void);
+bool storage_supervisor_card_ready(void);
+
+/**
+ * @brief Mount generation, incremented at each successful mount. Files kept
+ * open across calls must be reopened when it changes.
+ */
+uint32_t storage_supervisor_epoch(void);
+
+/**
+ * @brief Report an I/O error seen outside the supervisor: the card is not
+ * ready until the task has probed it.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if the supervisor is not running.
+ */
+esp_err_t storage_supervisor_report_error(void);
+
+/**
+ * @brief Wait until the card is mounted, from a task that may block.
+ *
+ * @return ESP_OK, ESP_ERR_TIMEOUT, ESP_ERR_INVALID_STATE if not running.
+ */
+esp_err_t storage_supervisor_wait_ready(uint32_t timeout_ms);
+
+/**
+ * @brief Unmount and stay unmounted, e.g. before sleep; writers must have
+ * closed their files.
+ *
+ * @return ESP_OK once unmounted, ESP_ERR_TIMEOUT after @p timeout_ms.
+ */
+esp_err_t storage_supervisor_suspend(uint32_t timeout_ms);
+
+/** Mount again in the background after ::storage_supervisor_suspend. */
+void storage_supervisor_resume(void);
+
+void storage_supervisor_get_stats(storage_supervisor_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STORAGE_SUPERVISOR_H
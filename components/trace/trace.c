@@ -0,0 +1,438 @@
+#include "trace.h"
+#include "storage.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_ipc.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#define TRACE_CORES portNUM_PROCESSORS
+#else
+#include <time.h>
+#define IRAM_ATTR
+#define TRACE_CORES 1
+#endif
+
+#define TASK_NAME_LEN 8   /* first characters of the task name kept */
+#define DUMP_CHUNK 1024   /* JSON bytes per write */
+#define DUMP_TASKS 32     /* tasks named per core */
+
+/*
+ * Events are published seqlock style: seq is zeroed, the fields written,
+ * then seq set to the write index + 1. An event is valid for a dump when its
+ * seq matches its index before and after it is copied.
+ */
+typedef struct {
+    _Atomic uint32_t seq;
+    uint32_t cycles;
+    const char *name;
+    const void *task; /* NULL in an interrupt */
+    int32_t value;
+    uint8_t type;     /* trace_event_type_t */
+    char task_name[TASK_NAME_LEN];
+} trace_event_t;
+
+/* Counters in internal RAM for the atomic add, events possibly in PSRAM */
+typedef struct {
+    trace_event_t *events;
+    uint32_t mask;
+    _Atomic uint32_t head; /* events ever reserved */
+} trace_ring_t;
+
+/* Same instant seen by the cycle counter of a core and the system timer */
+typedef struct {
+    uint32_t cycles;
+    int64_t ns;
+} trace_sync_t;
+
+static trace_ring_t s_ring[TRACE_CORES];
+static _Atomic bool s_on;
+static int64_t s_start_ns;
+
+#ifdef ESP_PLATFORM
+/* In IRAM with trace_record, for interrupts that run with the cache off */
+static inline IRAM_ATTR uint32_t cycles_now(void)
+{
+    return esp_cpu_get_cycle_count();
+}
+
+static inline IRAM_ATTR int core_now(void)
+{
+    return esp_cpu_get_core_id();
+}
+
+static inline IRAM_ATTR const void *task_now(char *name)
+{
+    if (xPortInIsrContext()) {
+        /* Stored as immediates: a literal would be read from flash */
+        name[0] = 'I';
+        name[1] = 'S';
+        name[2] = 'R';
+        name[3] = '\0';
+        return NULL;
+    }
+    /* FreeRTOS names are at least 16 bytes, read whole */
+    memcpy(name, pcTaskGetName(NULL), TASK_NAME_LEN);
+    return xTaskGetCurrentTaskHandle();
+}
+
+static uint32_t ticks_per_us(void)
+{
+    return esp_rom_get_cpu_ticks_per_us();
+}
+
+static int64_t time_ns(void)
+{
+    return esp_timer_get_time() * 1000;
+}
+
+static void *alloc_events(size_t size)
+{
+    void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    return p ? p : malloc(size);
+}
+
+static void sync_here(void *arg)
+{
+    trace_sync_t *s = arg;
+    s->cycles = esp_cpu_get_cycle_count();
+    s->ns = time_ns();
+}
+
+static void sync_cores(trace_sync_t *sync)
+{
+    for (int c = 0; c < TRACE_CORES; ++c) {
+        /* Runs on core c, also when c is the caller's */
+        esp_ipc_call_blocking(c, sync_here, &sync[c]);
+    }
+}
+#else
+/*
+ * Host: a clock of 16 ticks per microsecond stands for the cycle counter of
+ * one core, wrapping every 268 s like a slow CPU rather than every 4 s.
+ */
+#define HOST_TICKS_PER_US 16U
+
+static _Thread_local char s_thread;
+
+static int64_t time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline uint32_t cycles_now(void)
+{
+    return (uint32_t)(time_ns() * HOST_TICKS_PER_US / 1000);
+}
+
+static inline int core_now(void)
+{
+    return 0;
+}
+
+static inline const void *task_now(char *name)
+{
+    memcpy(name, "host", 5);
+    return &s_thread;
+}
+
+static uint32_t ticks_per_us(void)
+{
+    return HOST_TICKS_PER_US;
+}
+
+static void *alloc_events(size_t size)
+{
+    return malloc(size);
+}
+
+static void sync_cores(trace_sync_t *sync)
+{
+    int64_t ns = time_ns();
+    sync[0].cycles = (uint32_t)(ns * HOST_TICKS_PER_US / 1000);
+    sync[0].ns = ns;
+}
+#endif
+
+esp_err_t trace_start(size_t events)
+{
+    if (events < 16) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_ring[0].events) {
+        uint32_t pow2 = 16;
+        while (pow2 <= events / 2 && pow2 < 0x00100000U) {
+            pow2 <<= 1;
+        }
+        for (int c = 0; c < TRACE_CORES; ++c) {
+            trace_event_t *ev = alloc_events(sizeof(trace_event_t) * pow2);
+            if (!ev) {
+                for (int k = 0; k < c; ++k) {
+                    free(s_ring[k].events);
+                    s_ring[k].events = NULL;
+                }
+                return ESP_ERR_NO_MEM;
+            }
+            for (uint32_t i = 0; i < pow2; ++i) {
+                atomic_init(&ev[i].seq, 0);
+            }
+            s_ring[c].mask = pow2 - 1U;
+            atomic_init(&s_ring[c].head, 0);
+            s_ring[c].events = ev;
+        }
+        s_start_ns = time_ns();
+    }
+    atomic_store_explicit(&s_on, true, memory_order_release);
+    return ESP_OK;
+}
+
+void trace_stop(void)
+{
+    atomic_store_explicit(&s_on, false, memory_order_release);
+}
+
+void IRAM_ATTR trace_record(trace_event_type_t type, const char *name,
+                            int32_t value)
+{
+    if (!atomic_load_explicit(&s_on, memory_order_acquire)) {
+        return;
+    }
+    uint32_t cycles = cycles_now();
+    trace_ring_t *r = &s_ring[core_now()];
+    uint32_t i = atomic_fetch_add_explicit(&r->head, 1, memory_order_relaxed);
+    trace_event_t *e = &r->events[i & r->mask];
+    atomic_store_explicit(&e->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    e->cycles = cycles;
+    e->name = name;
+    e->task = task_now(e->task_name);
+    e->value = value;
+    e->type = (uint8_t)type;
+    atomic_store_explicit(&e->seq, i + 1U, memory_order_release);
+}
+
+/* Copy of event i of ring r if it is complete and still there */
+static bool read_event(trace_ring_t *r, uint32_t i, trace_event_t *out)
+{
+    trace_event_t *e = &r->events[i & r->mask];
+    if (atomic_load_explicit(&e->seq, memory_order_acquire) != i + 1U) {
+        return false;
+    }
+    out->cycles = e->cycles;
+    out->name = e->name;
+    out->task = e->task;
+    out->value = e->value;
+    out->type = e->type;
+    memcpy(out->task_name, e->task_name, TASK_NAME_LEN);
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&e->seq, memory_order_relaxed) == i + 1U;
+}
+
+typedef struct {
+    trace_write_fn_t write;
+    void *ctx;
+    char buf[DUMP_CHUNK];
+    size_t len;
+    esp_err_t err;
+    bool first;
+} dump_t;
+
+static void out_flush(dump_t *d)
+{
+    if (d->len && d->err == ESP_OK) {
+        d->err = d->write(d->buf, d->len, d->ctx);
+    }
+    d->len = 0;
+}
+
+static void out_fmt(dump_t *d, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void out_fmt(dump_t *d, const char *fmt, ...)
+{
+    va_list ap;
+    for (int tries = 0; tries < 2; ++tries) {
+        va_start(ap, fmt);
+        int n = vsnprintf(d->buf + d->len, sizeof(d->buf) - d->len, fmt, ap);
+        va_end(ap);
+        if (n >= 0 && (size_t)n < sizeof(d->buf) - d->len) {
+            d->len += (size_t)n;
+            return;
+        }
+        out_flush(d); /* retry in an empty buffer */
+    }
+}
+
+/* JSON string of at most max characters, quotes and backslashes escaped */
+static void out_str(dump_t *d, const char *s, size_t max)
+{
+    out_fmt(d, "\"");
+    for (size_t i = 0; i < max && s && s[i]; ++i) {
+        char c = s[i];
+        if (c == '"' || c == '\\') {
+            out_fmt(d, "\\%c", c);
+        } else if ((unsigned char)c >= 0x20) {
+            out_fmt(d, "%c", c);
+        }
+    }
+    out_fmt(d, "\"");
+}
+
+/* Start of a JSON event, comma separated */
+static void out_event(dump_t *d, const char *ph, int core, uintptr_t tid)
+{
+    out_fmt(d, "%s{\"ph\":\"%s\",\"pid\":%d,\"tid\":%" PRIuPTR ",",
+            d->first ? "" : ",\n", ph, core, tid);
+    d->first = false;
+}
+
+static void dump_core(dump_t *d, int c, const trace_sync_t *sync)
+{
+    static const char *const k_ph[] = {"B", "E", "i", "C"};
+    trace_ring_t *r = &s_ring[c];
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint32_t n = (head > r->mask) ? r->mask + 1U : head;
+    uint32_t tpu = ticks_per_us();
+    trace_event_t e;
+
+    out_event(d, "M", c, 0);
+    out_fmt(d, "\"name\":\"process_name\",\"args\":{\"name\":\"core %d\"}}", c);
+
+    /*
+     * Cycle counts are 32 bits: walk back from the sync point to find how
+     * long before it the oldest event is, adding the signed gaps between
+     * neighbours (events of a core are not strictly in order when a task is
+     * preempted between its timestamp and its slot).
+     */
+    int64_t back = 0; /* cycles before the sync point */
+    uint32_t prev = sync->cycles;
+    bool newest = true;
+    for (uint32_t k = 0; k < n; ++k) {
+        if (read_event(r, head - 1U - k, &e)) {
+            back += newest ? (int64_t)(uint32_t)(prev - e.cycles)
+                           : (int64_t)(int32_t)(prev - e.cycles);
+            prev = e.cycles;
+            newest = false;
+        }
+    }
+
+    const void *named[DUMP_TASKS];
+    size_t n_named = 0;
+    bool oldest = true;
+    for (uint32_t i = head - n; i != head; ++i) {
+        if (!read_event(r, i, &e)) {
+            continue;
+        }
+        back -= oldest ? 0 : (int64_t)(int32_t)(e.cycles - prev);
+        prev = e.cycles;
+        oldest = false;
+        int64_t ns = sync->ns - s_start_ns - back * 1000 / (int64_t)tpu;
+        uintptr_t tid = (uintptr_t)e.task;
+
+        bool known = false;
+        for (size_t k = 0; k < n_named && !known; ++k) {
+            known = named[k] == e.task;
+        }
+        if (!known && n_named < DUMP_TASKS) {
+            named[n_named++] = e.task;
+            out_event(d, "M", c, tid);
+            out_fmt(d, "\"name\":\"thread_name\",\"args\":{\"name\":");
+            out_str(d, e.task_name, TASK_NAME_LEN);
+            out_fmt(d, "}}");
+        }
+
+        out_event(d, k_ph[e.type], c, tid);
+        int64_t abs_ns = (ns < 0) ? -ns : ns;
+        out_fmt(d, "\"ts\":%s%" PRId64 ".%03d,\"name\":", (ns < 0) ? "-" : "",
+                abs_ns / 1000, (int)(abs_ns % 1000));
+        out_str(d, e.name, 64);
+        if (e.type == TRACE_EV_INSTANT) {
+            out_fmt(d, ",\"s\":\"t\"");
+        } else if (e.type == TRACE_EV_COUNTER) {
+            out_fmt(d, ",\"args\":{\"value\":%" PRId32 "}", e.value);
+        }
+        out_fmt(d, "}");
+    }
+}
+
+esp_err_t trace_dump(trace_write_fn_t write, void *ctx)
+{
+    if (!s_ring[0].events || !write) {
+        return s_ring[0].events ? ESP_ERR_INVALID_ARG : ESP_ERR_INVALID_STATE;
+    }
+    bool was_on = atomic_exchange_explicit(&s_on, false, memory_order_acq_rel);
+    trace_sync_t sync[TRACE_CORES];
+    sync_cores(sync);
+
+    dump_t *d = malloc(sizeof(*d)); /* too big for the stack of most tasks */
+    if (!d) {
+        atomic_store_explicit(&s_on, was_on, memory_order_release);
+        return ESP_ERR_NO_MEM;
+    }
+    d->write = write;
+    d->ctx = ctx;
+    d->len = 0;
+    d->err = ESP_OK;
+    d->first = true;
+    out_fmt(d, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int c = 0; c < TRACE_CORES; ++c) {
+        dump_core(d, c, &sync[c]);
+    }
+    out_fmt(d, "\n]}\n");
+    out_flush(d);
+    esp_err_t err = d->err;
+    free(d);
+    atomic_store_explicit(&s_on, was_on, memory_order_release);
+    return err;
+}
+
+typedef struct {
+    storage_file_t *file;
+    uint32_t off;
+} file_out_t;
+
+static esp_err_t write_file(const char *buf, size_t len, void *ctx)
+{
+    file_out_t *f = ctx;
+    esp_err_t err = storage_pwrite(f->file, buf, len, f->off);
+    f->off += (uint32_t)len;
+    return err;
+}
+
+esp_err_t trace_dump_file(const char *path)
+{
+    file_out_t f = {0};
+    esp_err_t err = storage_open(path, STORAGE_CREATE, &f.file);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = trace_dump(write_file, &f);
+    esp_err_t close_err = storage_close(f.file);
+    return (err != ESP_OK) ? err : close_err;
+}
+
+static esp_err_t write_console(const char *buf, size_t len, void *ctx)
+{
+    (void)ctx;
+    return (fwrite(buf, 1, len, stdout) == len) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t trace_dump_console(void)
+{
+    esp_err_t err = trace_dump(write_console, NULL);
+    fflush(stdout);
+    return err;
+}
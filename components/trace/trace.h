@@ -0,0 +1,100 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Span, instant and counter events of the firmware, for chrome://tracing
+ * and ui.perfetto.dev.
+ *
+ * Each core records into its own ring of fixed-size events: a producer
+ * reserves a slot with one atomic add, fills it and publishes it with its
+ * sequence number, so tasks and interrupts never wait on each other and the
+ * oldest events are overwritten once the ring is full. Timestamps are CPU
+ * cycle counts, turned into microseconds when the rings are exported as
+ * Chrome trace JSON (::trace_dump): one process per core, one thread per
+ * task, interrupts on thread 0.
+ *
+ * The TRACE_* macros compile to nothing unless CONFIG_TRACE_ENABLE is set;
+ * with it set they cost a few dozen cycles, and nothing is recorded before
+ * ::trace_start. Names must be string literals or otherwise outlive the
+ * dump. Cycle counters stop in light sleep and wrap every 17 s at 240 MHz:
+ * times are exact between events less than 8 s apart on a core, which the
+ * LVGL task alone guarantees on its core.
+ */
+
+typedef enum {
+    TRACE_EV_BEGIN,
+    TRACE_EV_END,
+    TRACE_EV_INSTANT,
+    TRACE_EV_COUNTER,
+} trace_event_type_t;
+
+#ifdef CONFIG_TRACE_ENABLE
+#define TRACE_BEGIN(name) trace_record(TRACE_EV_BEGIN, (name), 0)
+#define TRACE_END(name) trace_record(TRACE_EV_END, (name), 0)
+#define TRACE_INSTANT(name) trace_record(TRACE_EV_INSTANT, (name), 0)
+#define TRACE_COUNTER(name, value)                                             \
+    trace_record(TRACE_EV_COUNTER, (name), (int32_t)(value))
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#endif
+
+/** Receives the JSON text of a dump, @p len bytes at a time. */
+typedef esp_err_t (*trace_write_fn_t)(const char *buf, size_t len, void *ctx);
+
+/**
+ * @brief Allocate a ring of @p events per core (rounded down to a power of
+ * two, PSRAM when available) and start recording.
+ *
+ * @return ESP_OK, also if already started; ESP_ERR_INVALID_ARG below 16
+ *         events; ESP_ERR_NO_MEM.
+ */
+esp_err_t trace_start(size_t events);
+
+/** Stop recording; the rings keep their events for ::trace_dump. */
+void trace_stop(void);
+
+/**
+ * Record one event; any task or interrupt, never blocks. In IRAM, like the
+ * metrics updates: IRAM interrupts may record too, unless the rings went to
+ * PSRAM, which is unreachable while the flash cache is off.
+ */
+void trace_record(trace_event_type_t type, const char *name, int32_t value);
+
+/**
+ * @brief Write the events of every ring as Chrome trace JSON, oldest first
+ * per core.
+ *
+ * Recording is paused during the dump and resumed after if it was on.
+ * Events still being written when the dump starts are left out.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_STATE before ::trace_start, or the first
+ *         error of @p write.
+ */
+esp_err_t trace_dump(trace_write_fn_t write, void *ctx);
+
+/** ::trace_dump to a file, e.g. "/sdcard/trace.json". */
+esp_err_t trace_dump_file(const char *path);
+
+/** ::trace_dump to the console UART. */
+esp_err_t trace_dump_console(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,116 @@
+#include "wall_clock.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+#include <stdint.h>
+#include <sys/time.h>
+
+#define WALL_CLOCK_MAGIC 0x57434C4BU /* "WCLK" */
+#define NVS_NS "clock"
+#define NVS_KEY "epoch"
+
+static const char *TAG = "wall_clock";
+
+typedef struct {
+  uint32_t magic;
+  uint32_t source; /* wall_clock_source_t */
+} wall_clock_rtc_t;
+
+/* Kept across software resets, like the system time itself */
+static RTC_NOINIT_ATTR wall_clock_rtc_t s_rtc;
+static wall_clock_source_t s_source = WALL_CLOCK_UNSET;
+static bool s_restarted;
+
+static void set_source(wall_clock_source_t source) {
+  s_source = source;
+  s_rtc.source = (uint32_t)source;
+  s_rtc.magic = WALL_CLOCK_MAGIC ^ s_rtc.source;
+}
+
+static esp_err_t set_time(time_t t) {
+  struct timeval tv = {.tv_sec = t, .tv_usec = 0};
+  return settimeofday(&tv, NULL) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static void wall_clock_task(void *arg) {
+  (void)arg;
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_WALL_CLOCK_SAVE_S * 1000U));
+    wall_clock_save();
+  }
+}
+
+esp_err_t wall_clock_init(void) {
+  esp_reset_reason_t rr = esp_reset_reason();
+  bool powered_off = (rr == ESP_RST_POWERON || rr == ESP_RST_BROWNOUT);
+  if (!powered_off && s_rtc.source <= WALL_CLOCK_SET &&
+      s_rtc.magic == (WALL_CLOCK_MAGIC ^ s_rtc.source)) {
+    /* Software reset: the system time kept running */
+    s_source = (wall_clock_source_t)s_rtc.source;
+  } else {
+    s_restarted = true;
+    set_source(WALL_CLOCK_UNSET);
+    nvs_handle_t nvs;
+    int64_t saved = 0;
+    if (nvs_open(NVS_NS, NVS_READONLY, &nvs) == ESP_OK) {
+      nvs_get_i64(nvs, NVS_KEY, &saved);
+      nvs_close(nvs);
+    }
+    if (saved > (int64_t)time(NULL) && set_time((time_t)saved) == ESP_OK) {
+      set_source(WALL_CLOCK_SEEDED);
+    }
+  }
+  ESP_LOGI(TAG, "Horloge %s : %lld",
+           s_source == WALL_CLOCK_SET      ? "réglée"
+           : s_source == WALL_CLOCK_SEEDED ? "reprise de la dernière sauvegarde"
+                                           : "non réglée",
+           (long long)time(NULL));
+  if (xTaskCreate(wall_clock_task, "wall_clock", 2048, NULL, 1, NULL) !=
+      pdPASS) {
+    return ESP_ERR_NO_MEM;
+  }
+  return ESP_OK;
+}
+
+esp_err_t wall_clock_set(time_t now) {
+  esp_err_t err = set_time(now);
+  if (err != ESP_OK) {
+    return err;
+  }
+  set_source(WALL_CLOCK_SET);
+  return wall_clock_save();
+}
+
+void wall_clock_seed(time_t t) {
+  if (s_source == WALL_CLOCK_SET || time(NULL) >= t) {
+    return;
+  }
+  if (set_time(t) == ESP_OK) {
+    set_source(WALL_CLOCK_SEEDED);
+  }
+}
+
+esp_err_t wall_clock_save(void) {
+  if (s_source == WALL_CLOCK_UNSET) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_open(NVS_NS, NVS_READWRITE, &nvs);
+  if (err != ESP_OK) {
+    return err;
+  }
+  err = nvs_set_i64(nvs, NVS_KEY, (int64_t)time(NULL));
+  if (err == ESP_OK) {
+    err = nvs_commit(nvs);
+  }
+  nvs_close(nvs);
+  return err;
+}
+
+wall_clock_source_t wall_clock_source(void) { return s_source; }
+
+bool wall_clock_restarted(void) { return s_restarted; }
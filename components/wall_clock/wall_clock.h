@@ -0,0 +1,66 @@
+#ifndef WALL_CLOCK_H
+#define WALL_CLOCK_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Wall clock of the board, which has no battery-backed RTC.
+ *
+ * The system time survives software resets and sleep but restarts at 1970
+ * after a power cycle. The last known time is saved to NVS periodically and
+ * the clock restarts from it at boot: it never runs backwards across power
+ * cycles, but it is behind by the time spent off, so it is not trusted
+ * until a real source sets it.
+ */
+typedef enum {
+  WALL_CLOCK_UNSET,  /* power-on with nothing saved */
+  WALL_CLOCK_SEEDED, /* restarted from a saved time, off time unknown */
+  WALL_CLOCK_SET,    /* set by wall_clock_set() since the last power-on */
+} wall_clock_source_t;
+
+/**
+ * Restore the clock at boot and start saving it every
+ * CONFIG_WALL_CLOCK_SAVE_S. Must run after nvs_flash_init().
+ */
+esp_err_t wall_clock_init(void);
+
+/**
+ * Set the time from a real source (user, network, GPS...). The settings
+ * screen calls it when the date and time are entered by hand.
+ */
+esp_err_t wall_clock_set(time_t now);
+
+/**
+ * Move an untrusted clock forward to at least @p t, a time known to be past
+ * (e.g. the last update of a saved game). No effect on a trusted clock.
+ */
+void wall_clock_seed(time_t t);
+
+/** Save the current time to NVS, unless the clock was never set */
+esp_err_t wall_clock_save(void);
+
+wall_clock_source_t wall_clock_source(void);
+
+/**
+ * True when this boot followed a power cycle: the clock restarted from the
+ * NVS save (or from 1970) and the time spent off is unknown. False after a
+ * software reset, when the system time kept running.
+ */
+bool wall_clock_restarted(void);
+
+/** True when time(NULL) also counts the time spent powered off */
+static inline bool wall_clock_trusted(void) {
+  return wall_clock_source() == WALL_CLOCK_SET;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WALL_CLOCK_H */
@@ -20,12 +20,13 @@
 #include "esp_lcd_panel_ops.h"
 #include "esp_sleep.h"    // Light-sleep configuration
 #include "esp_system.h"   // Reset reason API
-#include "esp_task_wdt.h" // Watchdog timer API
+#include "esp_timer.h"    // Wake latency measurement
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "gpio.h" // Custom GPIO wrappers for reptile control
 #include "sensors.h"      // Sensor initialization
 #include "logging.h"
+#include "metrics.h"      // Counters, gauges and histograms of the drivers
 #include "lv_demos.h" // LVGL demo headers
 #include "lvgl.h"
 #include "lvgl_port.h"    // LVGL porting functions for integration
@@ -33,10 +34,16 @@
 #include "nvs_flash.h"    // NVS flash for persistent storage
 #include "reptile_game.h" // Reptile game interface
 #include "reptile_real.h" // Real-world mode interface
+#include "reptile_persist.h" // Background state saves
+#include "reptile_replay.h"  // Input recorder
 #include "sd.h"
+#include "storage_supervisor.h" // Background SD mount and remount
 #include "sleep.h" // Sleep control interface
 #include "settings.h"     // Application settings
+#include "trace.h"        // Span recorder, Chrome trace JSON
+#include "wall_clock.h"   // Saved time across power cycles
 #include "game_mode.h"
+#include <inttypes.h>
 
 static const char *TAG = "main"; // Tag for logging
 
@@ -45,8 +52,7 @@ static bool sleep_enabled;      // Runtime sleep state
 
 static esp_lcd_panel_handle_t panel_handle = NULL;
 static esp_lcd_touch_handle_t tp_handle = NULL;
-static lv_obj_t *error_screen;
-static lv_obj_t *prev_screen;
+static lv_obj_t *sd_banner; // "no card" notice on the top layer
 lv_obj_t *menu_screen;
 
 enum {
@@ -142,56 +148,87 @@ void sleep_set_enabled(bool enabled) {
 
 bool sleep_is_enabled(void) { return sleep_enabled; }
 
-static void show_error_screen(const char *msg) {
-  if (!lvgl_port_lock(-1))
-    return;
-  if (!error_screen) {
-    prev_screen = lv_scr_act();
-    error_screen = lv_obj_create(NULL);
-    lv_obj_t *label = lv_label_create(error_screen);
-    lv_label_set_text(label, msg);
-    lv_obj_center(label);
+// Show or hide the card notice; polled, the UI never waits on the card
+static void sd_status_timer_cb(lv_timer_t *timer) {
+  (void)timer;
+  storage_card_state_t state = storage_supervisor_state();
+  bool missing =
+      state == STORAGE_CARD_ABSENT || state == STORAGE_CARD_CHECKING;
+  if (missing && !sd_banner) {
+    sd_banner = lv_label_create(lv_layer_top());
+    lv_label_set_text(sd_banner, "Carte SD absente - sauvegardes en attente");
+    lv_obj_set_style_bg_opa(sd_banner, LV_OPA_70, 0);
+    lv_obj_set_style_bg_color(sd_banner, lv_color_hex(0x800000), 0);
+    lv_obj_set_style_text_color(sd_banner, lv_color_white(), 0);
+    lv_obj_set_style_pad_all(sd_banner, 6, 0);
+    lv_obj_align(sd_banner, LV_ALIGN_TOP_MID, 0, 4);
+  } else if (!missing && sd_banner) {
+    lv_obj_del(sd_banner);
+    sd_banner = NULL;
   }
-  lv_disp_load_scr(error_screen);
-  lvgl_port_unlock();
 }
 
-static void hide_error_screen(void) {
-  if (!lvgl_port_lock(-1))
-    return;
-  if (error_screen) {
-    lv_disp_load_scr(prev_screen);
-    lv_obj_del(error_screen);
-    error_screen = NULL;
+static void sd_supervisor_start(void) {
+  storage_supervisor_config_t cfg = STORAGE_SUPERVISOR_CONFIG_DEFAULT();
+  cfg.mount = sd_mmc_init;
+  cfg.unmount = sd_mmc_unmount;
+  cfg.probe = sd_card_probe;
+  cfg.backoff_max_ms = CONFIG_SD_REMOUNT_MAX_S * 1000U;
+  esp_err_t err = storage_supervisor_start(&cfg);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Superviseur SD: %s", esp_err_to_name(err));
   }
-  lvgl_port_unlock();
-}
-
-static void wait_for_sd_card(void) {
-  esp_err_t err;
-  int attempts = 0;
-  const int max_attempts = 10;
 
-  ESP_ERROR_CHECK(esp_task_wdt_add(NULL));
+  logging_config_t log_cfg = LOGGING_CONFIG_DEFAULT();
+  log_cfg.ring_size = CONFIG_LOG_RING_KB * 1024U;
+  log_cfg.block_size = SD_ALLOCATION_UNIT_SIZE;
+  log_cfg.fsync_ms = CONFIG_LOG_FSYNC_S * 1000U;
+  log_cfg.period_ms = CONFIG_LOG_PERIOD_S * 1000U;
+  err = logging_start(&log_cfg);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Journal: %s", esp_err_to_name(err));
+  }
+}
 
-  while (true) {
-    esp_task_wdt_reset();
-    err = sd_mmc_init();
-    if (err == ESP_OK || err == ESP_ERR_INVALID_STATE) {
-      hide_error_screen();
-      return;
-    }
+#if defined(CONFIG_TRACE_ENABLE) && CONFIG_TRACE_DUMP_S > 0
+// One-shot dump of the trace rings to the card, the console without it
+static void trace_dump_task(void *arg) {
+  (void)arg;
+  vTaskDelay(pdMS_TO_TICKS(CONFIG_TRACE_DUMP_S * 1000U));
+  esp_err_t err = trace_dump_file(MOUNT_POINT "/trace.json");
+  if (err == ESP_OK) {
+    ESP_LOGI(TAG, "Trace: " MOUNT_POINT "/trace.json");
+  } else {
+    ESP_LOGW(TAG, "Trace sur carte: %s, sortie console",
+             esp_err_to_name(err));
+    trace_dump_console();
+  }
+  vTaskDelete(NULL);
+}
+#endif
+
+#if CONFIG_METRICS_LOG_S > 0
+// Periodic text snapshot on the console, off the LVGL task: the UART blocks
+static void metrics_log_task(void *arg) {
+  (void)arg;
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_METRICS_LOG_S * 1000U));
+    metrics_log();
+  }
+}
+#endif
 
-    ESP_LOGE(TAG, "Carte SD absente ou illisible (%s)", esp_err_to_name(err));
-    show_error_screen("Insérer une carte SD valide");
-    vTaskDelay(pdMS_TO_TICKS(500));
-    if (++attempts >= max_attempts) {
-      show_error_screen("Carte SD absente - redémarrage");
-      vTaskDelay(pdMS_TO_TICKS(2000));
-      esp_restart();
-    }
-    // Attendre indéfiniment jusqu'à insertion d'une carte valide
+static void trace_init(void) {
+#ifdef CONFIG_TRACE_ENABLE
+  esp_err_t err = trace_start(CONFIG_TRACE_EVENTS);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Trace: %s", esp_err_to_name(err));
+    return;
   }
+#if CONFIG_TRACE_DUMP_S > 0
+  xTaskCreate(trace_dump_task, "trace_dump", 4096, NULL, 1, NULL);
+#endif
+#endif
 }
 
 #define BL_PIN GPIO_NUM_16
@@ -242,8 +279,22 @@ static void sleep_timer_cb(lv_timer_t *timer) {
   gpio_set_level(BL_PIN, 0);
 
   esp_sleep_wakeup_cause_t cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+  int64_t wake_us = esp_timer_get_time();
   logging_pause();
-  esp_err_t err = sd_mmc_unmount();
+  // Write the pending snapshot and close the journal before the card goes
+  // away; both run on the persist task, the journal stays open on failure
+  if (reptile_persist_close(2000) != ESP_OK) {
+    ESP_LOGW(TAG, "Sauvegarde avant veille non terminée");
+  }
+  // The recording goes on after the wake, in a file reopened on the new mount
+  if (reptile_recorder_close(2000) != ESP_OK) {
+    ESP_LOGW(TAG, "Enregistrement avant veille non écrit");
+  }
+  // Pending log lines are written and the log file closed before the unmount
+  if (logging_flush(2000) != ESP_OK) {
+    ESP_LOGW(TAG, "Journal avant veille non vid\u00e9");
+  }
+  esp_err_t err = storage_supervisor_suspend(2000);
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "D\u00e9montage SD: %s", esp_err_to_name(err));
     goto cleanup;
@@ -254,6 +305,7 @@ static void sleep_timer_cb(lv_timer_t *timer) {
   gpio_pulldown_en(
       GPIO_NUM_4); // ensure defined level; use external pull-up if needed
   esp_light_sleep_start();
+  wake_us = esp_timer_get_time();
   cause = esp_sleep_get_wakeup_cause();
   ESP_LOGI(TAG, "Wakeup cause: %d", cause);
 
@@ -262,21 +314,25 @@ cleanup:
   ledc_set_duty(BL_LEDC_MODE, BL_LEDC_CHANNEL, bl_duty);
   ledc_update_duty(BL_LEDC_MODE, BL_LEDC_CHANNEL);
 
-  if (cause == ESP_SLEEP_WAKEUP_EXT1) {
-    wait_for_sd_card();
+  // The game state stayed in RAM: show it before touching the SD card
+  if (reptile_game_is_active()) {
+    reptile_game_resume();
+    reptile_tick(NULL);
   }
 
-  logging_resume();
-
-  reptile_game_init();
-  reptile_tick(NULL);
-
   t = lv_timer_get_next(NULL);
   while (t) {
     lv_timer_resume(t);
     t = lv_timer_get_next(t);
   }
   lv_timer_reset(timer);
+  lv_refr_now(NULL);
+  ESP_LOGI(TAG, "Réveil -> première image: %" PRId64 " ms",
+           (esp_timer_get_time() - wake_us) / 1000);
+
+  // Remount in the background; saves and logs wait in their buffers meanwhile
+  storage_supervisor_resume();
+  logging_resume();
 }
 
 // Main application function
@@ -284,6 +340,12 @@ void app_main() {
   esp_reset_reason_t rr = esp_reset_reason();
   ESP_LOGI(TAG, "Reset reason: %d", rr);
 
+  // Record spans from the start when tracing is built in
+  trace_init();
+#if CONFIG_METRICS_LOG_S > 0
+  xTaskCreate(metrics_log_task, "metrics_log", 3072, NULL, 1, NULL);
+#endif
+
   // Initialize NVS flash storage with error handling for page issues
   esp_err_t ret = nvs_flash_init();
   if (ret == ESP_ERR_NVS_NO_FREE_PAGES ||
@@ -293,14 +355,14 @@ void app_main() {
   }
   ESP_ERROR_CHECK(ret);
 
+  // Restart the clock from its last saved time after a power cycle
+  wall_clock_init();
+
   // Load persisted application settings
   settings_init();
 
-  // Initialize SD card at boot for early log availability
-  esp_err_t sd_ret = sd_mmc_init();
-  if (sd_ret != ESP_OK) {
-    ESP_LOGW(TAG, "Initial SD init failed: %s", esp_err_to_name(sd_ret));
-  }
+  // Mount the SD card and start the log writer in the background
+  sd_supervisor_start();
 
   // Initialize the GT911 touch screen controller
   esp_err_t tp_ret = touch_gt911_init(&tp_handle);
@@ -335,8 +397,11 @@ void app_main() {
   // Initialize LVGL with the panel and touch handles
   ESP_ERROR_CHECK(lvgl_port_init(panel_handle, tp_handle));
 
-  // Initialize SD card (retry until available)
-  wait_for_sd_card();
+  // Give the card a moment so that a saved game is found; the UI starts
+  // without it otherwise and the card is picked up whenever it shows up
+  if (storage_supervisor_wait_ready(CONFIG_SD_BOOT_WAIT_MS) != ESP_OK) {
+    ESP_LOGW(TAG, "Carte SD absente au d\u00e9marrage");
+  }
 
   ESP_LOGI(TAG, "Display LVGL demos");
 
@@ -409,8 +474,7 @@ void app_main() {
       break;
     }
 
+    lv_timer_create(sd_status_timer_cb, 1000, NULL);
     lvgl_port_unlock();
   }
-
-  esp_task_wdt_delete(NULL);
 }
@@ -1,14 +1,24 @@
 #include "reptile_game.h"
+#include "reptile_replay.h"
+#include "reptile_persist.h"
+#include "reptile_journal.h"
+#include "reptile_rtc.h"
 #include "can.h"
 #include "image.h"
 #include "lvgl_port.h"
 #include "sleep.h"
 #include "logging.h"
+#include "stats_charts.h"
+#include "trace.h"
+#include "wall_clock.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "game_mode.h"
 #include "ui_sprite.h"
 #include "LGFX_S3_RGB.hpp"
+#include "sdkconfig.h"
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 #include <stdbool.h>
 
@@ -30,35 +40,51 @@ static lv_obj_t *label_stat_eau;
 static lv_obj_t *label_stat_temp;
 static lv_obj_t *label_stat_humeur;
 static lv_obj_t *label_stat_humidite;
+static lv_obj_t *label_stat_vie;
 static lv_obj_t *lbl_sleep;
 extern lv_obj_t *menu_screen;
 
 #define REPTILE_UPDATE_PERIOD_MS 1000
+#define REPTILE_REPLAY_PATH "/sdcard/reptile_replay.bin"
+#ifdef CONFIG_REPTILE_TICKLESS
+#define REPTILE_TICKLESS_MAX_PERIOD_MS CONFIG_REPTILE_TICKLESS_MAX_PERIOD_MS
+#endif
 
 static reptile_t reptile;
 static uint32_t last_tick;
 static lv_timer_t *life_timer;
 static lv_timer_t *action_timer;
-static uint32_t soothe_time_ms;
-static uint32_t update_ms_accum;
-static uint32_t soothe_ms_accum;
+#ifdef CONFIG_REPTILE_TICKLESS
+static lv_timer_t *ui_timer;
+#endif
+static reptile_tick_ctx_t tick_ctx;
 
 static const char *TAG = "reptile_game";
 
 
-typedef enum {
-  ACTION_FEED,
-  ACTION_WATER,
-  ACTION_HEAT,
-  ACTION_SOOTHE,
-} action_type_t;
-
-static const lv_image_dsc_t *sprite_idle = &gImage_reptile_idle;
-static const lv_image_dsc_t *sprite_manger = &gImage_reptile_manger;
-static const lv_image_dsc_t *sprite_boire = &gImage_reptile_boire;
-static const lv_image_dsc_t *sprite_chauffer = &gImage_reptile_chauffer;
-static const lv_image_dsc_t *sprite_happy = &gImage_reptile_happy;
-static const lv_image_dsc_t *sprite_sad = &gImage_reptile_sad;
+typedef struct {
+  const lv_image_dsc_t *idle;
+  const lv_image_dsc_t *manger;
+  const lv_image_dsc_t *boire;
+  const lv_image_dsc_t *chauffer;
+  const lv_image_dsc_t *happy;
+  const lv_image_dsc_t *sad;
+  uint32_t tint;     /* 0xRRGGBB mixed into every sprite of the set */
+  lv_opa_t tint_opa; /* LV_OPA_TRANSP: drawn as is */
+} sprite_set_t;
+
+/* Indexed by reptile_species_profile_t.sprite_set. The species share the
+ * generic drawings, told apart by their colour until they get their own. */
+#define SPRITES_GENERIC                                                        \
+  &gImage_reptile_idle, &gImage_reptile_manger, &gImage_reptile_boire,         \
+      &gImage_reptile_chauffer, &gImage_reptile_happy, &gImage_reptile_sad
+static const sprite_set_t sprite_sets[] = {
+    {SPRITES_GENERIC, 0x000000, LV_OPA_TRANSP}, /* générique */
+    {SPRITES_GENERIC, 0xD9A441, LV_OPA_40},     /* pogona, sable */
+    {SPRITES_GENERIC, 0xE8C547, LV_OPA_30},     /* gecko léopard, jaune */
+    {SPRITES_GENERIC, 0x3FA34D, LV_OPA_50},     /* caméléon, vert */
+};
+static const sprite_set_t *sprites = &sprite_sets[0];
 
 static void warning_anim_cb(void *obj, int32_t v);
 static void start_warning_anim(lv_obj_t *obj);
@@ -67,30 +93,91 @@ static void back_btn_event_cb(lv_event_t *e);
 static void action_btn_event_cb(lv_event_t *e);
 static void sleep_btn_event_cb(lv_event_t *e);
 static void menu_btn_event_cb(lv_event_t *e);
-static void ui_update_main(void);
-static void ui_update_stats(void);
+static void ui_update_main(const reptile_t *r);
+static void ui_update_stats(const reptile_t *r);
 static void show_event_popup(reptile_event_t event);
 static void set_bar_color(lv_obj_t *bar, uint32_t value, uint32_t max);
-static void update_sprite(void);
-static void show_action_sprite(action_type_t action);
+static void update_sprite(const reptile_t *r);
+static void show_action_sprite(reptile_action_t action);
 static void revert_sprite_cb(lv_timer_t *t);
 
 bool reptile_game_is_active(void) { return s_game_active; }
 
+/* Apply the time spent asleep or powered off, when the clock measured it */
+static void reptile_catch_up_boot(void) {
+  if (!wall_clock_trusted()) {
+    /* An unset clock never goes back past the game */
+    wall_clock_seed(reptile.last_update);
+    if (wall_clock_restarted()) {
+      /* Power cycle: the clock restarted from a saved time, the time spent
+       * off is unknown and is not applied. After a software reset the clock
+       * kept running and the gap is applied as usual. */
+      ESP_LOGW(TAG, "Horloge non réglée : temps hors tension ignoré");
+    }
+  }
+  reptile_catch_up(&reptile, time(NULL));
+}
+
 void reptile_game_init(void) {
 
   game_mode_set(GAME_MODE_SIMULATION);
   reptile_init(&reptile, true);
   last_tick = lv_tick_get();
-  update_ms_accum = 0;
-  soothe_ms_accum = 0;
-  if (reptile_load(&reptile) != ESP_OK) {
-    reptile_save(&reptile);
+  memset(&tick_ctx, 0, sizeof(tick_ctx));
+  int64_t t0 = esp_timer_get_time();
+  const char *source = "RTC";
+  reptile_journal_set_compact_period(CONFIG_REPTILE_JOURNAL_COMPACT_MIN * 60U);
+  /* After a software reset the RTC mirror is newer than the SD card */
+  if (reptile_rtc_restore(&reptile, &tick_ctx)) {
+    /* reptile_init drew a fresh seed: the PRNG follows the saved one */
+    reptile_set_seed(&reptile, reptile.seed);
+    reptile_catch_up_boot();
+  } else if (reptile_persist_load(&reptile, 2000) == ESP_OK) {
+    /* Read on the persist task, after the last snapshot of a previous
+     * session: it may still be running after a wake from sleep */
+    reptile_set_seed(&reptile, reptile.seed);
+    reptile_catch_up_boot();
+    source = "SD";
+  } else {
+    reptile_set_species(&reptile,
+                        (reptile_species_t)CONFIG_REPTILE_SPECIES_DEFAULT);
+    source = "nouvelle partie";
   }
+  reptile_rtc_store(&reptile, &tick_ctx);
+  ESP_LOGI(TAG, "État restauré (%s) en %" PRId64 " us", source,
+           esp_timer_get_time() - t0);
+  uint8_t set = reptile_species_profile(reptile.species)->sprite_set;
+  sprites = &sprite_sets[(set < sizeof(sprite_sets) / sizeof(sprite_sets[0]))
+                             ? set
+                             : 0];
+  /* Saves leave the UI thread; already running after a wake from sleep */
+  reptile_persist_start(CONFIG_REPTILE_SAVE_WINDOW_MS);
+  reptile_set_save_fn(reptile_persist_submit);
+  reptile_persist_submit(&reptile);
+#ifdef CONFIG_REPTILE_RECORD
+  reptile_recorder_start(REPTILE_REPLAY_PATH, &reptile, &tick_ctx);
+#endif
 
   ui_sprite_init(gfx.width(), gfx.height());
 }
 
+void reptile_game_resume(void) {
+  if (!s_game_active) {
+    return;
+  }
+  /* RAM survived light sleep: only the time spent asleep is applied */
+  reptile_catch_up(&reptile, time(NULL));
+#ifdef CONFIG_REPTILE_RECORD
+  /* The catch-up is not a recorded input: resynchronise the replay */
+  reptile_recorder_start(REPTILE_REPLAY_PATH, &reptile, &tick_ctx);
+#endif
+  last_tick = lv_tick_get();
+  reptile_rtc_store(&reptile, &tick_ctx);
+  reptile_persist_submit(&reptile);
+  ui_update_main(&reptile);
+  ui_update_stats(&reptile);
+}
+
 const reptile_t *reptile_get_state(void) { return &reptile; }
 
 static void warning_anim_cb(void *obj, int32_t v) {
@@ -119,6 +206,18 @@ static void show_event_popup(reptile_event_t event) {
   case REPTILE_EVENT_CROISSANCE:
     msg = "Le reptile grandit!";
     break;
+  case REPTILE_EVENT_MUE:
+    msg = "Le reptile commence sa mue.";
+    break;
+  case REPTILE_EVENT_DESHYDRATATION:
+    msg = "Le reptile est déshydraté!";
+    break;
+  case REPTILE_EVENT_COUP_DE_CHALEUR:
+    msg = "Coup de chaleur! Refroidissez le terrarium.";
+    break;
+  case REPTILE_EVENT_ENNUI:
+    msg = "Le reptile s'ennuie.";
+    break;
   default:
     return;
   }
@@ -133,11 +232,11 @@ static void set_bar_color(lv_obj_t *bar, uint32_t value, uint32_t max) {
   lv_color_t palette_color;
 
   if (bar == bar_temp) {
-    if (value < REPTILE_TEMP_THRESHOLD_LOW ||
-        value > REPTILE_TEMP_THRESHOLD_HIGH) {
+    const reptile_species_profile_t *sp =
+        reptile_species_profile(reptile.species);
+    if (value < sp->temp_low || value > sp->temp_high) {
       palette_color = lv_palette_main(LV_PALETTE_RED);
-    } else if (value <= REPTILE_TEMP_THRESHOLD_LOW + 1 ||
-               value >= REPTILE_TEMP_THRESHOLD_HIGH - 1) {
+    } else if (value <= sp->temp_low + 1U || value >= sp->temp_high - 1U) {
       palette_color = lv_palette_main(LV_PALETTE_YELLOW);
     } else {
       palette_color = lv_palette_main(LV_PALETTE_GREEN);
@@ -177,13 +276,13 @@ static void set_sprite_anim(bool happy) {
   lv_anim_start(&a);
 }
 
-static void update_sprite(void) {
+static void update_sprite(const reptile_t *r) {
   if (action_timer)
     return;
-  bool happy = reptile.humeur >= 50;
+  bool happy = r->humeur >= 50;
   if (happy != sprite_is_happy) {
     sprite_is_happy = happy;
-    lv_img_set_src(img_reptile, happy ? sprite_happy : sprite_sad);
+    lv_img_set_src(img_reptile, happy ? sprites->happy : sprites->sad);
     set_sprite_anim(happy);
   }
 }
@@ -194,23 +293,23 @@ static void revert_sprite_cb(lv_timer_t *t) {
     lv_timer_del(action_timer);
     action_timer = NULL;
   }
-  update_sprite();
+  update_sprite(&reptile);
 }
 
-static void show_action_sprite(action_type_t action) {
-  const lv_image_dsc_t *src = sprite_idle;
+static void show_action_sprite(reptile_action_t action) {
+  const lv_image_dsc_t *src = sprites->idle;
   switch (action) {
-  case ACTION_FEED:
-    src = sprite_manger;
+  case REPTILE_ACTION_FEED:
+    src = sprites->manger;
     break;
-  case ACTION_WATER:
-    src = sprite_boire;
+  case REPTILE_ACTION_WATER:
+    src = sprites->boire;
     break;
-  case ACTION_HEAT:
-    src = sprite_chauffer;
+  case REPTILE_ACTION_HEAT:
+    src = sprites->chauffer;
     break;
-  case ACTION_SOOTHE:
-    src = sprite_idle;
+  case REPTILE_ACTION_SOOTHE:
+    src = sprites->idle;
     break;
   }
   lv_img_set_src(img_reptile, src);
@@ -220,44 +319,53 @@ static void show_action_sprite(action_type_t action) {
   action_timer = lv_timer_create(revert_sprite_cb, 1000, NULL);
 }
 
+#ifdef CONFIG_REPTILE_TICKLESS
+/* Arm life_timer for the next threshold crossing instead of every second */
+static void schedule_next_tick(void) {
+  if (!life_timer)
+    return;
+  uint32_t period = REPTILE_UPDATE_PERIOD_MS;
+  if (tick_ctx.soothe_time_ms == 0) {
+    period = reptile_next_event_ms(&reptile);
+    if (period < REPTILE_UPDATE_PERIOD_MS)
+      period = REPTILE_UPDATE_PERIOD_MS;
+    else if (period > REPTILE_TICKLESS_MAX_PERIOD_MS)
+      period = REPTILE_TICKLESS_MAX_PERIOD_MS;
+  }
+  lv_timer_set_period(life_timer, period);
+  lv_timer_reset(life_timer);
+}
+
+/* Refresh the bars with interpolated values, without touching the state */
+static void ui_interpolate_cb(lv_timer_t *t) {
+  (void)t;
+  reptile_t view;
+  reptile_peek(&reptile, lv_tick_elaps(last_tick), &view);
+  ui_update_main(&view);
+  ui_update_stats(&view);
+}
+#endif
+
 void reptile_tick(lv_timer_t *timer) {
   (void)timer;
+  TRACE_BEGIN("reptile_tick");
   uint32_t now = lv_tick_get();
   uint32_t elapsed = now - last_tick;
   last_tick = now;
 
-  update_ms_accum += elapsed;
-  uint32_t process_ms = update_ms_accum - (update_ms_accum % 1000U);
-  reptile_update(&reptile, process_ms);
-  update_ms_accum -= process_ms;
-  bool dirty = process_ms > 0;
-
-  if (soothe_time_ms > 0) {
-    soothe_time_ms = (soothe_time_ms > elapsed) ? (soothe_time_ms - elapsed) : 0;
-    soothe_ms_accum += elapsed;
-    uint32_t mood_sec = soothe_ms_accum / 1000U;
-    if (mood_sec > 0) {
-      uint32_t inc = mood_sec * 2U;
-      reptile.humeur =
-          (reptile.humeur + inc > 100) ? 100 : reptile.humeur + inc;
-      soothe_ms_accum -= mood_sec * 1000U;
-      dirty = true;
-    }
-  } else {
-    soothe_ms_accum = 0;
-  }
-
   reptile_event_t prev_evt = reptile.event;
-  reptile_event_t evt = reptile_check_events(&reptile);
-  if (evt != prev_evt && evt != REPTILE_EVENT_NONE) {
-    show_event_popup(evt);
+  bool dirty = reptile_tick_step(&reptile, &tick_ctx, elapsed, NULL);
+  reptile_recorder_tick(elapsed, &reptile, &tick_ctx);
+  if (reptile.event != prev_evt && reptile.event != REPTILE_EVENT_NONE) {
+    show_event_popup(reptile.event);
   }
+  reptile_rtc_store(&reptile, &tick_ctx);
   if (dirty) {
-    reptile_save(&reptile);
+    reptile_persist_submit(&reptile);
   }
 
-  ui_update_main();
-  ui_update_stats();
+  ui_update_main(&reptile);
+  ui_update_stats(&reptile);
 
   // Broadcast reptile state over CAN bus
   can_message_t msg = {
@@ -280,14 +388,17 @@ void reptile_tick(lv_timer_t *timer) {
     }
   }
 
-  if (reptile.faim <= REPTILE_FAMINE_THRESHOLD) {
+  /* Same thresholds as the rules (FAIM_BAS, EAU_BAS, TEMP_FROID/CHAUD) */
+  const reptile_species_profile_t *sp =
+      reptile_species_profile(reptile.species);
+  if (reptile.faim <= sp->famine) {
     start_warning_anim(bar_faim);
   }
-  if (reptile.eau <= REPTILE_EAU_THRESHOLD) {
+  if (reptile.eau <= sp->eau) {
     start_warning_anim(bar_eau);
   }
-  if (reptile.temperature <= REPTILE_TEMP_THRESHOLD_LOW ||
-      reptile.temperature >= REPTILE_TEMP_THRESHOLD_HIGH) {
+  if (reptile.temperature <= sp->temp_low ||
+      reptile.temperature >= sp->temp_high) {
     start_warning_anim(bar_temp);
   }
 
@@ -298,12 +409,18 @@ void reptile_tick(lv_timer_t *timer) {
   spr->setTextColor(0xFFFF);
   spr->drawString(buf, 10, 10);
   ui_sprite_push();
+
+#ifdef CONFIG_REPTILE_TICKLESS
+  schedule_next_tick();
+#endif
+  TRACE_END("reptile_tick");
 }
 
 static void stats_btn_event_cb(lv_event_t *e) {
   (void)e;
   if (lvgl_port_lock(-1)) {
     lv_scr_load(screen_stats);
+    stats_charts_load((uint32_t)time(NULL));
     lvgl_port_unlock();
   }
 }
@@ -317,26 +434,18 @@ static void back_btn_event_cb(lv_event_t *e) {
 }
 
 static void action_btn_event_cb(lv_event_t *e) {
-  action_type_t action = (action_type_t)(uintptr_t)lv_event_get_user_data(e);
+  reptile_action_t action =
+      (reptile_action_t)(uintptr_t)lv_event_get_user_data(e);
   if (lvgl_port_lock(-1)) {
-    switch (action) {
-    case ACTION_FEED:
-      reptile_feed(&reptile);
-      break;
-    case ACTION_WATER:
-      reptile_give_water(&reptile);
-      break;
-    case ACTION_HEAT:
-      reptile_heat(&reptile);
-      break;
-    case ACTION_SOOTHE:
-      reptile_soothe(&reptile);
-      soothe_time_ms = 5000;
-      break;
-    }
+    reptile_apply_action(&reptile, &tick_ctx, action);
+    reptile_recorder_action(action, &reptile, &tick_ctx);
+    reptile_rtc_store(&reptile, &tick_ctx);
+#ifdef CONFIG_REPTILE_TICKLESS
+    schedule_next_tick();
+#endif
     show_action_sprite(action);
-    ui_update_main();
-    ui_update_stats();
+    ui_update_main(&reptile);
+    ui_update_stats(&reptile);
     lvgl_port_unlock();
   }
 }
@@ -352,7 +461,6 @@ void reptile_game_stop(void) {
   s_game_active = false;
   logging_pause();
   sleep_set_enabled(false);
-  soothe_time_ms = 0;
   if (life_timer) {
     lv_timer_del(life_timer);
     life_timer = NULL;
@@ -361,6 +469,12 @@ void reptile_game_stop(void) {
     lv_timer_del(action_timer);
     action_timer = NULL;
   }
+#ifdef CONFIG_REPTILE_TICKLESS
+  if (ui_timer) {
+    lv_timer_del(ui_timer);
+    ui_timer = NULL;
+  }
+#endif
   if (screen_main) {
     lv_obj_del(screen_main);
     screen_main = NULL;
@@ -369,9 +483,10 @@ void reptile_game_stop(void) {
     lv_obj_del(screen_stats);
     screen_stats = NULL;
   }
+  stats_charts_delete();
   lv_style_reset(&style_font24);
-  update_ms_accum = 0;
-  soothe_ms_accum = 0;
+  memset(&tick_ctx, 0, sizeof(tick_ctx));
+  reptile_recorder_stop();
 }
 
 static void menu_btn_event_cb(lv_event_t *e) {
@@ -383,28 +498,33 @@ static void menu_btn_event_cb(lv_event_t *e) {
   }
 }
 
-static void ui_update_main(void) {
-  lv_bar_set_value(bar_faim, reptile.faim, LV_ANIM_ON);
-  lv_bar_set_value(bar_eau, reptile.eau, LV_ANIM_ON);
-  lv_bar_set_value(bar_humeur, reptile.humeur, LV_ANIM_ON);
-  set_bar_color(bar_faim, reptile.faim, 100);
-  set_bar_color(bar_eau, reptile.eau, 100);
-  set_bar_color(bar_humeur, reptile.humeur, 100);
-  lv_bar_set_value(bar_temp, reptile.temperature, LV_ANIM_ON);
-  lv_bar_set_value(bar_humidite, reptile.humidite, LV_ANIM_ON);
-  set_bar_color(bar_temp, reptile.temperature, 50);
-  set_bar_color(bar_humidite, reptile.humidite, 100);
-  update_sprite();
+static void ui_update_main(const reptile_t *r) {
+  lv_bar_set_value(bar_faim, r->faim, LV_ANIM_ON);
+  lv_bar_set_value(bar_eau, r->eau, LV_ANIM_ON);
+  lv_bar_set_value(bar_humeur, r->humeur, LV_ANIM_ON);
+  set_bar_color(bar_faim, r->faim, 100);
+  set_bar_color(bar_eau, r->eau, 100);
+  set_bar_color(bar_humeur, r->humeur, 100);
+  lv_bar_set_value(bar_temp, r->temperature, LV_ANIM_ON);
+  lv_bar_set_value(bar_humidite, r->humidite, LV_ANIM_ON);
+  set_bar_color(bar_temp, r->temperature, 50);
+  set_bar_color(bar_humidite, r->humidite, 100);
+  update_sprite(r);
 }
 
-static void ui_update_stats(void) {
-  lv_label_set_text_fmt(label_stat_faim, "Faim: %" PRIu32, reptile.faim);
-  lv_label_set_text_fmt(label_stat_eau, "Eau: %" PRIu32, reptile.eau);
+static void ui_update_stats(const reptile_t *r) {
+  lv_label_set_text_fmt(label_stat_faim, "Faim: %" PRIu32, r->faim);
+  lv_label_set_text_fmt(label_stat_eau, "Eau: %" PRIu32, r->eau);
   lv_label_set_text_fmt(label_stat_temp, "Température: %" PRIu32,
-                        reptile.temperature);
+                        r->temperature);
   lv_label_set_text_fmt(label_stat_humidite, "Humidité: %" PRIu32,
-                        reptile.humidite);
-  lv_label_set_text_fmt(label_stat_humeur, "Humeur: %" PRIu32, reptile.humeur);
+                        r->humidite);
+  lv_label_set_text_fmt(label_stat_humeur, "Humeur: %" PRIu32, r->humeur);
+  lv_label_set_text_fmt(label_stat_vie, "Âge: %u j  Poids: %u g%s",
+                        (unsigned)r->age_jours, (unsigned)r->poids_g,
+                        (r->cycle & REPTILE_CYCLE_MALADE) ? "  (malade)"
+                        : (r->cycle & REPTILE_CYCLE_MUE)  ? "  (en mue)"
+                                                          : "");
 }
 
 void reptile_game_start(esp_lcd_panel_handle_t panel,
@@ -420,7 +540,11 @@ void reptile_game_start(esp_lcd_panel_handle_t panel,
 
   /* Reptile sprite */
   img_reptile = lv_img_create(screen_main);
-  lv_img_set_src(img_reptile, sprite_idle);
+  lv_img_set_src(img_reptile, sprites->idle);
+  lv_obj_set_style_img_recolor(img_reptile, lv_color_hex(sprites->tint),
+                               LV_PART_MAIN);
+  lv_obj_set_style_img_recolor_opa(img_reptile, sprites->tint_opa,
+                                   LV_PART_MAIN);
   lv_obj_align(img_reptile, LV_ALIGN_TOP_MID, 0, 0);
 
   /* Hunger bar */
@@ -483,7 +607,7 @@ void reptile_game_start(esp_lcd_panel_handle_t panel,
   lv_obj_set_size(btn_feed, 120, 40);
   lv_obj_align(btn_feed, LV_ALIGN_BOTTOM_LEFT, 10, -10);
   lv_obj_add_event_cb(btn_feed, action_btn_event_cb, LV_EVENT_CLICKED,
-                      (void *)(uintptr_t)ACTION_FEED);
+                      (void *)(uintptr_t)REPTILE_ACTION_FEED);
   lv_obj_t *lbl_feed = lv_label_create(btn_feed);
   lv_obj_add_style(lbl_feed, &style_font24, 0);
   lv_label_set_text(lbl_feed, "Nourrir");
@@ -493,7 +617,7 @@ void reptile_game_start(esp_lcd_panel_handle_t panel,
   lv_obj_set_size(btn_water, 120, 40);
   lv_obj_align(btn_water, LV_ALIGN_BOTTOM_MID, 0, -10);
   lv_obj_add_event_cb(btn_water, action_btn_event_cb, LV_EVENT_CLICKED,
-                      (void *)(uintptr_t)ACTION_WATER);
+                      (void *)(uintptr_t)REPTILE_ACTION_WATER);
   lv_obj_t *lbl_water = lv_label_create(btn_water);
   lv_obj_add_style(lbl_water, &style_font24, 0);
   lv_label_set_text(lbl_water, "Hydrater");
@@ -503,7 +627,7 @@ void reptile_game_start(esp_lcd_panel_handle_t panel,
   lv_obj_set_size(btn_heat, 120, 40);
   lv_obj_align(btn_heat, LV_ALIGN_BOTTOM_RIGHT, -10, -10);
   lv_obj_add_event_cb(btn_heat, action_btn_event_cb, LV_EVENT_CLICKED,
-                      (void *)(uintptr_t)ACTION_HEAT);
+                      (void *)(uintptr_t)REPTILE_ACTION_HEAT);
   lv_obj_t *lbl_heat = lv_label_create(btn_heat);
   lv_obj_add_style(lbl_heat, &style_font24, 0);
   lv_label_set_text(lbl_heat, "Chauffer");
@@ -513,7 +637,7 @@ void reptile_game_start(esp_lcd_panel_handle_t panel,
   lv_obj_set_size(btn_soothe, 120, 40);
   lv_obj_align(btn_soothe, LV_ALIGN_BOTTOM_RIGHT, -10, -60);
   lv_obj_add_event_cb(btn_soothe, action_btn_event_cb, LV_EVENT_CLICKED,
-                      (void *)(uintptr_t)ACTION_SOOTHE);
+                      (void *)(uintptr_t)REPTILE_ACTION_SOOTHE);
   lv_obj_t *lbl_soothe = lv_label_create(btn_soothe);
   lv_obj_add_style(lbl_soothe, &style_font24, 0);
   lv_label_set_text(lbl_soothe, "Caresser");
@@ -569,18 +693,29 @@ void reptile_game_start(esp_lcd_panel_handle_t panel,
   lv_obj_add_style(label_stat_humeur, &style_font24, 0);
   lv_obj_align(label_stat_humeur, LV_ALIGN_TOP_LEFT, 10, 170);
 
+  label_stat_vie = lv_label_create(screen_stats);
+  lv_obj_add_style(label_stat_vie, &style_font24, 0);
+  lv_obj_align(label_stat_vie, LV_ALIGN_TOP_LEFT, 10, 210);
+
   lv_obj_t *btn_back = lv_btn_create(screen_stats);
   lv_obj_set_size(btn_back, 160, 40);
-  lv_obj_align(btn_back, LV_ALIGN_BOTTOM_MID, 0, -10);
+  lv_obj_align(btn_back, LV_ALIGN_TOP_RIGHT, -10, 10);
   lv_obj_add_event_cb(btn_back, back_btn_event_cb, LV_EVENT_CLICKED, NULL);
   lv_obj_t *lbl_back = lv_label_create(btn_back);
   lv_obj_add_style(lbl_back, &style_font24, 0);
   lv_label_set_text(lbl_back, "Retour");
   lv_obj_center(lbl_back);
 
-  ui_update_main();
-  ui_update_stats();
+  /* History below the current values; the screen scrolls */
+  stats_charts_create(screen_stats, 260, &style_font24);
+
+  ui_update_main(&reptile);
+  ui_update_stats(&reptile);
   life_timer = lv_timer_create(reptile_tick, REPTILE_UPDATE_PERIOD_MS, NULL);
+#ifdef CONFIG_REPTILE_TICKLESS
+  ui_timer = lv_timer_create(ui_interpolate_cb, REPTILE_UPDATE_PERIOD_MS, NULL);
+  schedule_next_tick();
+#endif
 
   lv_scr_load(screen_main);
 }
@@ -12,6 +12,11 @@ extern "C" {
 #endif
 
 void reptile_game_init(void);
+/**
+ * @brief Continue the game after light sleep: the state kept in RAM only
+ * catches up the time spent asleep, nothing is reloaded from the SD card.
+ */
+void reptile_game_resume(void);
 void reptile_tick(lv_timer_t *timer);
 const reptile_t *reptile_get_state(void);
 void reptile_game_stop(void);
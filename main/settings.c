@@ -2,7 +2,9 @@
 #include "lvgl.h"
 #include "nvs.h"
 #include "sleep.h"
+#include "wall_clock.h"
 #include <stdio.h>
+#include <time.h>
 
 #define NVS_NS "cfg"
 #define KEY_TEMP "temp_th"
@@ -27,6 +29,8 @@ static lv_obj_t *sb_temp;
 static lv_obj_t *sb_hum;
 static lv_obj_t *sw_sleep;
 static lv_obj_t *dd_log;
+static lv_obj_t *sb_clock[5]; // day, month, year, hour, minute (UTC)
+static bool clock_edited;
 
 extern lv_obj_t *menu_screen;
 
@@ -76,9 +80,33 @@ esp_err_t settings_init(void)
     return ESP_OK;
 }
 
+static void clock_changed_cb(lv_event_t *e)
+{
+    (void)e;
+    clock_edited = true;
+}
+
+/* Set the wall clock from the date and time fields, when they were edited */
+static void clock_save(void)
+{
+    if (!clock_edited)
+        return;
+    struct tm tm = {
+        .tm_mday = lv_spinbox_get_value(sb_clock[0]),
+        .tm_mon = lv_spinbox_get_value(sb_clock[1]) - 1,
+        .tm_year = lv_spinbox_get_value(sb_clock[2]) - 1900,
+        .tm_hour = lv_spinbox_get_value(sb_clock[3]),
+        .tm_min = lv_spinbox_get_value(sb_clock[4]),
+    };
+    time_t t = mktime(&tm); // TZ is unset: UTC
+    if (t == (time_t)-1 || wall_clock_set(t) != ESP_OK)
+        ESP_LOGW("settings", "Réglage de l'horloge impossible");
+}
+
 static void save_btn_cb(lv_event_t *e)
 {
     (void)e;
+    clock_save();
     g_settings.temp_threshold = lv_spinbox_get_value(sb_temp);
     g_settings.humidity_threshold = lv_spinbox_get_value(sb_hum);
     g_settings.sleep_default = lv_obj_has_state(sw_sleep, LV_STATE_CHECKED);
@@ -132,6 +160,40 @@ void settings_screen_show(void)
     lv_dropdown_set_selected(dd_log, g_settings.log_level);
     lv_obj_align_to(dd_log, label, LV_ALIGN_OUT_RIGHT_MID, 10, 0);
 
+    /* Date and time, prefilled with the current clock */
+    static const struct {
+        int32_t min, max;
+        uint8_t digits;
+    } fields[5] = {
+        {1, 31, 2}, {1, 12, 2}, {2024, 2099, 4}, {0, 23, 2}, {0, 59, 2},
+    };
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    int32_t values[5] = {tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900,
+                         tm.tm_hour, tm.tm_min};
+    clock_edited = false;
+    for (int i = 0; i < 5; i++) {
+        if (i == 0 || i == 3) {
+            label = lv_label_create(screen);
+            lv_label_set_text(label, i == 0 ? "Date" : "Heure (UTC)");
+            lv_obj_align(label, LV_ALIGN_TOP_LEFT, 10, i == 0 ? 210 : 260);
+        }
+        sb_clock[i] = lv_spinbox_create(screen);
+        lv_spinbox_set_range(sb_clock[i], fields[i].min, fields[i].max);
+        lv_spinbox_set_digit_format(sb_clock[i], fields[i].digits, 0);
+        lv_spinbox_set_value(sb_clock[i], values[i]);
+        lv_spinbox_set_step(sb_clock[i], 1);
+        lv_obj_set_width(sb_clock[i], fields[i].digits == 4 ? 80 : 50);
+        if (i == 0 || i == 3)
+            lv_obj_align_to(sb_clock[i], label, LV_ALIGN_OUT_RIGHT_MID, 10, 0);
+        else
+            lv_obj_align_to(sb_clock[i], sb_clock[i - 1],
+                            LV_ALIGN_OUT_RIGHT_MID, 10, 0);
+        lv_obj_add_event_cb(sb_clock[i], clock_changed_cb,
+                            LV_EVENT_VALUE_CHANGED, NULL);
+    }
+
     lv_obj_t *btn = lv_btn_create(screen);
     lv_obj_align(btn, LV_ALIGN_BOTTOM_MID, 0, -20);
     lv_obj_add_event_cb(btn, save_btn_cb, LV_EVENT_CLICKED, NULL);
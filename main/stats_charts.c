@@ -0,0 +1,310 @@
+#include "stats_charts.h"
+#include "log_series.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "lvgl_port.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CHART_W 980 /* pixels, also the most points of a series */
+#define CHART_H 150
+#define X_RANGE 1000 /* chart x axis, the window mapped onto it */
+#define LOADER_STACK_SIZE (4 * 1024)
+#define LOADER_PRIORITY 1 /* below the LVGL task */
+
+static const char *TAG = "stats_charts";
+
+typedef struct {
+  const char *title;
+  int32_t max; /* top of the y axis, tenths */
+} stat_chart_t;
+
+/* By log_rollup_field_t, ranges of the bars of the main screen */
+static const stat_chart_t k_stats[LOG_ROLLUP_FIELDS] = {
+    {"Température", 500}, {"Humidité", 1000}, {"Faim", 1000},
+    {"Eau", 1000},        {"Humeur", 1000},
+};
+
+/* By log_window_t */
+static const char *k_window_map[] = {"1 h", "24 h", "30 j", ""};
+
+/* A load request, then its result, handed from the UI to the loader task
+ * and back with lv_async_call; its series arrays follow it */
+typedef struct {
+  uint32_t gen;
+  log_window_t window;
+  uint32_t now;
+  esp_err_t err;
+  int64_t load_us;
+  size_t scratch_size;
+  log_series_t series;
+} chart_load_t;
+
+static lv_obj_t *s_title[LOG_ROLLUP_FIELDS];
+static lv_obj_t *s_when; /* end of the window shown */
+static lv_obj_t *s_chart[LOG_ROLLUP_FIELDS];
+static lv_coord_t *s_coords; /* x then y of each chart, CHART_W each */
+static log_window_t s_window = LOG_WINDOW_DAY;
+static uint32_t s_back; /* windows between the one shown and now */
+static uint32_t s_gen; /* latest request; results of older ones are dropped */
+static QueueHandle_t s_requests; /* one chart_load_t *, the latest */
+
+static void *alloc_psram(size_t size) {
+  void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+  return p ? p : malloc(size);
+}
+
+static void window_event_cb(lv_event_t *e) {
+  uint16_t id = lv_btnmatrix_get_selected_btn(lv_event_get_target(e));
+  if (id < LOG_WINDOWS && id != s_window) {
+    s_window = (log_window_t)id;
+    s_back = 0;
+    stats_charts_load((uint32_t)time(NULL));
+  }
+}
+
+/* "<" shows the previous window, ">" the next one, up to now */
+static void nav_event_cb(lv_event_t *e) {
+  intptr_t dir = (intptr_t)lv_event_get_user_data(e);
+  uint32_t now = (uint32_t)time(NULL);
+  uint32_t span = log_window_span(s_window);
+  if (dir < 0 && (uint64_t)(s_back + 1U) * span < now) {
+    s_back++;
+  } else if (dir > 0 && s_back > 0) {
+    s_back--;
+  } else {
+    return;
+  }
+  stats_charts_load(now);
+}
+
+static lv_obj_t *nav_button(lv_obj_t *parent, const char *text, intptr_t dir,
+                            lv_style_t *font) {
+  lv_obj_t *btn = lv_btn_create(parent);
+  lv_obj_set_size(btn, 60, 60);
+  lv_obj_add_event_cb(btn, nav_event_cb, LV_EVENT_CLICKED, (void *)dir);
+  lv_obj_t *label = lv_label_create(btn);
+  lv_obj_add_style(label, font, 0);
+  lv_label_set_text(label, text);
+  lv_obj_center(label);
+  return btn;
+}
+
+void stats_charts_create(lv_obj_t *parent, lv_coord_t y, lv_style_t *font) {
+  size_t points = (size_t)CHART_W * LOG_ROLLUP_FIELDS;
+  s_coords = (lv_coord_t *)alloc_psram(2 * sizeof(lv_coord_t) * points);
+  if (!s_coords) {
+    ESP_LOGE(TAG, "Mémoire insuffisante pour les graphiques");
+    return;
+  }
+
+  lv_obj_t *selector = lv_btnmatrix_create(parent);
+  lv_btnmatrix_set_map(selector, k_window_map);
+  lv_btnmatrix_set_btn_ctrl_all(selector, LV_BTNMATRIX_CTRL_CHECKABLE);
+  lv_btnmatrix_set_one_checked(selector, true);
+  lv_btnmatrix_set_btn_ctrl(selector, (uint16_t)s_window,
+                            LV_BTNMATRIX_CTRL_CHECKED);
+  lv_obj_add_style(selector, font, 0);
+  lv_obj_set_size(selector, 360, 60);
+  lv_obj_align(selector, LV_ALIGN_TOP_LEFT, 10, y);
+  lv_obj_add_event_cb(selector, window_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
+  lv_obj_t *older = nav_button(parent, LV_SYMBOL_LEFT, -1, font);
+  lv_obj_align_to(older, selector, LV_ALIGN_OUT_RIGHT_MID, 20, 0);
+  lv_obj_t *newer = nav_button(parent, LV_SYMBOL_RIGHT, 1, font);
+  lv_obj_align_to(newer, older, LV_ALIGN_OUT_RIGHT_MID, 10, 0);
+  s_when = lv_label_create(parent);
+  lv_obj_add_style(s_when, font, 0);
+  lv_label_set_text(s_when, "");
+  lv_obj_align_to(s_when, newer, LV_ALIGN_OUT_RIGHT_MID, 20, 0);
+  y += 80;
+
+  for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+    s_title[f] = lv_label_create(parent);
+    lv_obj_add_style(s_title[f], font, 0);
+    lv_label_set_text(s_title[f], k_stats[f].title);
+    lv_obj_align(s_title[f], LV_ALIGN_TOP_LEFT, 10, y);
+    y += 35;
+
+    /* Scatter: points sit at their time, the buckets of a window may have
+     * gaps. Lines only, no point markers. */
+    lv_obj_t *chart = lv_chart_create(parent);
+    s_chart[f] = chart;
+    lv_obj_set_size(chart, CHART_W, CHART_H);
+    lv_obj_align(chart, LV_ALIGN_TOP_LEFT, 10, y);
+    lv_obj_clear_flag(chart, LV_OBJ_FLAG_SCROLLABLE);
+    lv_chart_set_type(chart, LV_CHART_TYPE_SCATTER);
+    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_X, 0, X_RANGE);
+    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0,
+                       (lv_coord_t)k_stats[f].max);
+    lv_chart_set_div_line_count(chart, 5, 7);
+    lv_obj_set_style_size(chart, 0, LV_PART_INDICATOR);
+    lv_obj_set_style_line_width(chart, 2, LV_PART_ITEMS);
+    lv_chart_series_t *ser = lv_chart_add_series(
+        chart, lv_palette_main(LV_PALETTE_GREEN), LV_CHART_AXIS_PRIMARY_Y);
+    lv_coord_t *x = s_coords + (size_t)f * 2 * CHART_W;
+    x[0] = 0;
+    x[CHART_W] = LV_CHART_POINT_NONE;
+    lv_chart_set_ext_x_array(chart, ser, x);
+    lv_chart_set_ext_y_array(chart, ser, x + CHART_W);
+    lv_chart_set_point_count(chart, 1);
+    y += CHART_H + 20;
+  }
+}
+
+/* Copy series f of @p s into its chart, the window mapped onto [0, X_RANGE] */
+static void show_series(const log_series_t *s, log_window_t window, int f) {
+  lv_coord_t *x = s_coords + (size_t)f * 2 * CHART_W;
+  lv_coord_t *y = x + CHART_W;
+  uint64_t span = log_window_span(window);
+  int32_t lo = INT32_MAX, hi = INT32_MIN;
+  for (size_t i = 0; i < s->n; ++i) {
+    int32_t v = s->v[f][i];
+    uint64_t dt = s->t[f][i] - s->t0;
+    x[i] = (lv_coord_t)(dt * X_RANGE / span);
+    y[i] = (lv_coord_t)v;
+    lo = (v < lo) ? v : lo;
+    hi = (v > hi) ? v : hi;
+  }
+  if (s->n == 0) {
+    x[0] = 0;
+    y[0] = LV_CHART_POINT_NONE;
+    lv_label_set_text(s_title[f], k_stats[f].title);
+  } else {
+    lv_label_set_text_fmt(s_title[f], "%s  %" PRId32 ".%" PRId32
+                          " - %" PRId32 ".%" PRId32, k_stats[f].title,
+                          lo / 10, abs(lo % 10), hi / 10, abs(hi % 10));
+  }
+  lv_chart_set_point_count(s_chart[f], (uint16_t)(s->n ? s->n : 1));
+  lv_chart_refresh(s_chart[f]);
+}
+
+/* LVGL task: draw a finished load unless the charts moved on meanwhile */
+static void show_load_cb(void *arg) {
+  chart_load_t *req = (chart_load_t *)arg;
+  if (req->gen != s_gen || !s_coords) {
+    free(req);
+    return;
+  }
+  if (req->err != ESP_OK) {
+    ESP_LOGW(TAG, "Lecture du journal: %s", esp_err_to_name(req->err));
+    req->series.n = 0;
+  }
+  int64_t t0 = esp_timer_get_time();
+  for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+    show_series(&req->series, req->window, f);
+  }
+  lv_refr_now(NULL);
+  int64_t draw_us = esp_timer_get_time() - t0;
+  size_t buffers = (sizeof(uint32_t) + sizeof(int32_t) +
+                    2 * sizeof(lv_coord_t)) * CHART_W * LOG_ROLLUP_FIELDS;
+  ESP_LOGI(TAG,
+           "%s: %u points lus, %u affichés, lecture %" PRId64
+           " us, dessin %" PRId64 " us, mémoire %u + %u o temporaires",
+           k_window_map[req->window], (unsigned)req->series.points,
+           (unsigned)req->series.n, req->load_us, draw_us, (unsigned)buffers,
+           (unsigned)req->scratch_size);
+  free(req);
+}
+
+/* Reads the card off the LVGL task, one request at a time */
+static void loader_task(void *arg) {
+  (void)arg;
+  for (;;) {
+    chart_load_t *req;
+    xQueueReceive(s_requests, &req, portMAX_DELAY);
+    req->scratch_size = log_series_scratch_size(req->window, CHART_W);
+    int64_t t0 = esp_timer_get_time();
+    void *scratch = alloc_psram(req->scratch_size);
+    req->err = scratch ? log_series_load(req->window, req->now, &req->series,
+                                         scratch)
+                       : ESP_ERR_NO_MEM;
+    free(scratch);
+    req->load_us = esp_timer_get_time() - t0;
+    bool posted = false;
+    if (lvgl_port_lock(-1)) {
+      posted = lv_async_call(show_load_cb, req) == LV_RES_OK;
+      lvgl_port_unlock();
+    }
+    if (!posted) {
+      free(req);
+    }
+  }
+}
+
+void stats_charts_load(uint32_t now) {
+  if (!s_coords) {
+    return;
+  }
+  if (!s_requests) {
+    s_requests = xQueueCreate(1, sizeof(chart_load_t *));
+    if (!s_requests ||
+        xTaskCreate(loader_task, "stats_charts", LOADER_STACK_SIZE, NULL,
+                    LOADER_PRIORITY, NULL) != pdPASS) {
+      ESP_LOGE(TAG, "Tâche de lecture des graphiques non créée");
+      if (s_requests) {
+        vQueueDelete(s_requests);
+        s_requests = NULL;
+      }
+      return;
+    }
+  }
+  size_t points = (size_t)CHART_W * LOG_ROLLUP_FIELDS;
+  chart_load_t *req = (chart_load_t *)alloc_psram(
+      sizeof(*req) + (sizeof(uint32_t) + sizeof(int32_t)) * points);
+  if (!req) {
+    ESP_LOGE(TAG, "Mémoire insuffisante pour les graphiques");
+    return;
+  }
+  /* The window shown ends s_back windows before now */
+  uint64_t back = (uint64_t)s_back * log_window_span(s_window);
+  uint32_t end = (back < now) ? now - (uint32_t)back : 0U;
+  req->gen = ++s_gen;
+  req->window = s_window;
+  req->now = end;
+  req->series.max = CHART_W;
+  uint32_t *t = (uint32_t *)(req + 1);
+  int32_t *v = (int32_t *)(t + points);
+  for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+    req->series.t[f] = t + (size_t)f * CHART_W;
+    req->series.v[f] = v + (size_t)f * CHART_W;
+  }
+  /* Replace a request the loader has not taken yet */
+  chart_load_t *stale;
+  if (xQueueReceive(s_requests, &stale, 0) == pdTRUE) {
+    free(stale);
+  }
+  xQueueSend(s_requests, &req, 0);
+
+  if (s_back == 0) {
+    lv_label_set_text(s_when, "Jusqu'à maintenant");
+  } else {
+    time_t t = (time_t)end;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    lv_label_set_text_fmt(s_when, "Jusqu'au %02d/%02d/%04d %02d:%02d UTC",
+                          tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900,
+                          tm.tm_hour, tm.tm_min);
+  }
+
+  /* Placeholder until the result comes back */
+  for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+    lv_label_set_text_fmt(s_title[f], "%s  (chargement...)", k_stats[f].title);
+  }
+}
+
+void stats_charts_delete(void) {
+  free(s_coords);
+  s_coords = NULL;
+  s_gen++; /* a load still running is dropped when it comes back */
+  for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+    s_title[f] = NULL;
+    s_chart[f] = NULL;
+  }
+  s_when = NULL;
+  s_back = 0;
+}
@@ -0,0 +1,42 @@
+#ifndef STATS_CHARTS_H
+#define STATS_CHARTS_H
+
+#include "lvgl.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief History charts of the stats screen: a 1 h / 24 h / 30 j selector,
+ * "<" and ">" buttons that move the window back and forth by its own length,
+ * and one chart per stat, stacked from @p y in the scrollable @p parent.
+ *
+ * Chart buffers hold one point per pixel of width and are allocated in
+ * PSRAM when available; nothing is read from the card before
+ * ::stats_charts_load.
+ */
+void stats_charts_create(lv_obj_t *parent, lv_coord_t y,
+                         lv_style_t *font);
+
+/**
+ * @brief Load the selected window from the card logs (log_series.h) and
+ * redraw the charts; the load and draw times are logged. The window ends at
+ * @p now, or as many windows earlier as "<" was pressed.
+ *
+ * Returns at once: the titles show a placeholder while a background task
+ * reads the card, and the charts are redrawn on the LVGL task with
+ * lv_async_call. A newer request replaces one not started yet and the
+ * result of an older one is dropped. Call with the LVGL lock held.
+ */
+void stats_charts_load(uint32_t now);
+
+/** Free the buffers; the objects go with their screen. */
+void stats_charts_delete(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STATS_CHARTS_H
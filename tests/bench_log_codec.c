@@ -0,0 +1,151 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "log_codec.h"
+#include "reptile_logic.h"
+#include "test_util.h"
+
+/*
+ * Size of the columnar log (log_codec.c) against the CSV log it replaces.
+ *
+ * The reptile model runs at 1 Hz for the given number of days, with a slow
+ * day/night temperature and humidity cycle plus sensor noise and regular
+ * care. Every sample is logged to both formats. As in the logging task,
+ * the CSV rows are written at each sync, and the open binary block is
+ * written there too, then rewritten in place until it is full; the bytes
+ * written count every rewrite. The blocks are then decoded and compared
+ * with the samples.
+ *
+ * Usage: bench_log_codec [days] [sync_s]
+ * Build: same sources as tests/bench_reptile_batch.c (README) plus
+ *        components/logging/log_codec.c and -Icomponents/logging
+ */
+
+static void sample_of(const reptile_t *r, log_sample_t *s)
+{
+    s->timestamp = (uint32_t)r->last_update;
+    s->values[LOG_COL_FAIM] = (int32_t)r->faim;
+    s->values[LOG_COL_EAU] = (int32_t)r->eau;
+    s->values[LOG_COL_TEMPERATURE] = (int32_t)r->temperature;
+    s->values[LOG_COL_HUMIDITE] = (int32_t)r->humidite;
+    s->values[LOG_COL_HUMEUR] = (int32_t)r->humeur;
+    s->values[LOG_COL_EVENT] = (int32_t)r->event;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t days = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 1;
+    uint32_t sync_s = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 60;
+    uint32_t seconds = days * 86400U;
+
+    reptile_t r;
+    reptile_tick_ctx_t ctx = {0};
+    reptile_set_save_fn(NULL);
+    reptile_init(&r, true);
+    r.last_update = 1700000000;
+    uint32_t noise = 1;
+
+    log_sample_t *samples = malloc(sizeof(*samples) * seconds);
+    uint8_t *blocks = malloc((size_t)LOG_BLOCK_SIZE * (seconds + 1U));
+    if (!samples || !blocks) {
+        printf("mémoire insuffisante\n");
+        return 1;
+    }
+    log_encoder_t enc;
+    log_encoder_init(&enc);
+    size_t n_blocks = 0;
+    uint64_t written = 0; /* block bytes sent to the card, rewrites included */
+    uint8_t open_copy[LOG_BLOCK_SIZE];
+    uint64_t csv_bytes = 0;
+    double encode_s = 0.0;
+
+    for (uint32_t t = 0; t < seconds; ++t) {
+        double phase = 2.0 * M_PI * (double)(t % 86400U) / 86400.0;
+        reptile_env_t env = {
+            .temperature = (uint32_t)lround(30.0 + 4.0 * sin(phase) +
+                                            (lcg_next(&noise) % 100U < 3U)),
+            .humidite = (uint32_t)lround(50.0 - 10.0 * sin(phase) +
+                                         (lcg_next(&noise) % 100U < 5U)),
+        };
+        reptile_tick_step(&r, &ctx, 1000, &env);
+        if (t % (6U * 3600U) == 0) {
+            reptile_apply_action(&r, &ctx, REPTILE_ACTION_FEED);
+        }
+        if (t % (4U * 3600U) == 0) {
+            reptile_apply_action(&r, &ctx, REPTILE_ACTION_WATER);
+        }
+        if (t % (2U * 3600U) == 0) {
+            reptile_apply_action(&r, &ctx, REPTILE_ACTION_SOOTHE);
+        }
+        sample_of(&r, &samples[t]);
+
+        /* Row of the previous CSV log */
+        char line[96];
+        csv_bytes += (uint64_t)snprintf(line, sizeof(line),
+                "%ld,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+                (long)r.last_update, r.faim, r.eau, r.temperature, r.humeur,
+                (uint32_t)r.event);
+
+        double t0 = now_s();
+        if (log_encoder_add(&enc, &samples[t], blocks + n_blocks * LOG_BLOCK_SIZE)) {
+            n_blocks++;
+            written += LOG_BLOCK_SIZE;
+        }
+        if (sync_s && (t + 1U) % sync_s == 0 && log_encoder_peek(&enc, open_copy)) {
+            written += LOG_BLOCK_SIZE;
+        }
+        encode_s += now_s() - t0;
+    }
+    if (log_encoder_flush(&enc, blocks + n_blocks * LOG_BLOCK_SIZE)) {
+        n_blocks++;
+        written += LOG_BLOCK_SIZE;
+    }
+
+    /* Decode everything back */
+    int fails = 0;
+    uint32_t k = 0;
+    double t0 = now_s();
+    for (size_t b = 0; b < n_blocks && !fails; ++b) {
+        log_block_reader_t rd;
+        log_sample_t s;
+        if (!log_block_open(&rd, blocks + b * LOG_BLOCK_SIZE)) {
+            printf("bloc %zu illisible\n", b);
+            fails++;
+            break;
+        }
+        while (log_block_next(&rd, &s)) {
+            if (k >= seconds || memcmp(&s, &samples[k], sizeof(s)) != 0) {
+                printf("échantillon %" PRIu32 " différent\n", k);
+                fails++;
+                break;
+            }
+            k++;
+        }
+    }
+    double decode_s = now_s() - t0;
+    if (!fails && k != seconds) {
+        printf("%" PRIu32 " échantillons relus sur %" PRIu32 "\n", k, seconds);
+        fails++;
+    }
+
+    uint64_t bin_bytes = (uint64_t)n_blocks * LOG_BLOCK_SIZE;
+    printf("%" PRIu32 " échantillons, sync %" PRIu32 " s\n", seconds, sync_s);
+    printf("CSV      : %10" PRIu64 " o  %.1f o/échantillon\n", csv_bytes,
+           (double)csv_bytes / seconds);
+    printf("colonnes : %10" PRIu64 " o écrits  %.2f o/échantillon, "
+           "fichier %" PRIu64 " o (%zu blocs, %.0f échantillons/bloc)\n",
+           written, (double)written / seconds, bin_bytes, n_blocks,
+           (double)seconds / (double)n_blocks);
+    printf("réduction: %.1fx écrits, %.1fx sur la carte\n",
+           (double)csv_bytes / (double)written,
+           (double)csv_bytes / (double)bin_bytes);
+    printf("codage %.0f ns/échantillon, décodage %.0f ns/échantillon\n",
+           encode_s * 1e9 / seconds, decode_s * 1e9 / seconds);
+    printf("%s\n", fails ? "FAIL" : "OK");
+    free(samples);
+    free(blocks);
+    return fails ? 1 : 0;
+}
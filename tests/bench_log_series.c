@@ -0,0 +1,179 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "log_rollup.h"
+#include "log_segment.h"
+#include "log_series.h"
+#include "storage_fake.h"
+#include "test_log_feed.h"
+#include "test_util.h"
+
+/*
+ * Chart windows of the stats screen (components/logging/log_series.c) on
+ * the fake SD card.
+ *
+ * 30 days of 1 Hz samples are written by the writer of the logging task
+ * (log_writer.c): daily segments with their index, minute, hour and day
+ * rollups. Each window
+ * (1 h, 24 h, 30 d) is then loaded for a chart of CHART_POINTS pixels and
+ * its time, card reads (modelled card time included) and memory are
+ * printed. The windows must hold every source point of their range, reduced
+ * to at most CHART_POINTS, with the rollup means matching the samples and a
+ * one-second spike of the last hour kept by the downsampling.
+ *
+ * Usage: bench_log_series [days]
+ * Build: gcc -O2 -Icomponents/logging -Icomponents/storage \
+ *            -Icomponents/metrics -Icomponents/trace \
+ *            tests/bench_log_series.c components/logging/log_codec.c \
+ *            components/logging/log_segment.c components/logging/log_rollup.c \
+ *            components/logging/log_series.c components/logging/log_writer.c \
+ *            components/metrics/metrics.c components/storage/storage.c \
+ *            components/storage/storage_posix.c \
+ *            components/storage/storage_fake.c -o bench_log_series
+ */
+
+#define T_START 1760054400U /* 10 October 2025, 00:00 UTC */
+#define CHART_POINTS 1000
+#define SYNC_EVERY 60
+#define SPIKE_AGE 1234U /* seconds before the end */
+
+static const char *const k_window_name[LOG_WINDOWS] = {"1 h", "24 h", "30 j"};
+static uint32_t s_end;
+
+/* Value of column c at time t: daily cycle plus noise, one spike */
+static int32_t value_at(uint32_t t, int c)
+{
+    uint32_t h = (t ^ ((uint32_t)c * 0x9e3779b9U)) * 2654435761U;
+    int32_t day = (int32_t)((t % 86400U) / 3600U);
+    int32_t v = 20 + (day < 12 ? day : 24 - day) + (int32_t)(h >> 29) + c;
+    return (c == LOG_COL_TEMPERATURE && t == s_end - SPIKE_AGE) ? 99 : v;
+}
+
+/* Rounded mean in tenths of field f over [t0, t0 + span) */
+static int32_t mean_at(uint32_t t0, uint32_t span, int f)
+{
+    int64_t sum = 0;
+    uint32_t n = 0;
+    for (uint32_t t = t0; t < t0 + span && t < s_end; ++t, ++n) {
+        sum += value_at(t, log_rollup_column((log_rollup_field_t)f));
+    }
+    return (int32_t)((sum * 10 + n / 2) / n);
+}
+
+static int check_window(log_window_t w, const log_series_t *s)
+{
+    int fails = 0;
+    uint32_t span = log_window_span(w);
+    size_t expected = (w == LOG_WINDOW_HOUR)  ? span + 1U
+                      : (w == LOG_WINDOW_DAY) ? span / 60U
+                                              : span / 3600U;
+    size_t n = (expected < CHART_POINTS) ? expected : CHART_POINTS;
+    if (s->points != expected || s->n != n) {
+        printf("%s : %zu points lus, %zu gardés au lieu de %zu, %zu\n",
+               k_window_name[w], s->points, s->n, expected, n);
+        return 1;
+    }
+    for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+        for (size_t i = 0; i < s->n; ++i) {
+            uint32_t t = s->t[f][i];
+            int32_t v = s->v[f][i];
+            int32_t want =
+                (w == LOG_WINDOW_HOUR)  ? 10 * value_at(t, log_rollup_column((log_rollup_field_t)f))
+                : (w == LOG_WINDOW_DAY) ? mean_at(t - t % 60U, 60U, f)
+                                        : mean_at(t - t % 3600U, 3600U, f);
+            if ((i && t <= s->t[f][i - 1]) || t < s->t0 || t > s->t1 ||
+                abs(v - want) > 1) {
+                printf("%s, champ %d, point %zu : %" PRIu32 " = %" PRId32
+                       " au lieu de %" PRId32 "\n", k_window_name[w], f, i, t,
+                       v, want);
+                return 1;
+            }
+        }
+    }
+    if (w == LOG_WINDOW_HOUR) {
+        bool spike = false;
+        for (size_t i = 0; i < s->n; ++i) {
+            spike |= s->t[LOG_ROLLUP_TEMPERATURE][i] == s_end - SPIKE_AGE;
+        }
+        if (!spike) {
+            printf("1 h : pic de température perdu\n");
+            fails++;
+        }
+    }
+    return fails;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t days = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 30;
+    s_end = T_START + days * 86400U;
+    storage_fake_init(NULL);
+    storage_set_backend(&storage_fake_backend);
+
+    test_log_feed_t feed = {0};
+    const log_writer_io_t io = test_log_feed_io(&feed);
+    static uint8_t block[16 * LOG_BLOCK_SIZE];
+    static log_bucket_t buckets[256];
+    log_writer_t wr;
+    int fails = log_writer_init(&wr, &io, sizeof(block), block, buckets,
+                                256) != ESP_OK;
+    for (uint32_t t = T_START; t < s_end; ++t) {
+        log_sample_t s = {.timestamp = t};
+        for (int c = 0; c < LOG_VALUES; ++c) {
+            s.values[c] = value_at(t, c);
+        }
+        feed = (test_log_feed_t){&s, 1};
+        bool sync = (t - T_START) % SYNC_EVERY == SYNC_EVERY - 1;
+        log_writer_flush(&wr, sync);
+        if (sync) {
+            log_writer_sync(&wr);
+        }
+    }
+    log_writer_flush(&wr, true);
+    log_writer_sync(&wr);
+    log_writer_close(&wr);
+    fails += wr.stats.write_errors != 0;
+    printf("%" PRIu32 " jours à 1 Hz écrits\n", days);
+
+    /* Buffers of a chart screen: CHART_POINTS per stat */
+    log_series_t s = {.max = CHART_POINTS};
+    for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+        s.t[f] = malloc(sizeof(uint32_t) * CHART_POINTS);
+        s.v[f] = malloc(sizeof(int32_t) * CHART_POINTS);
+    }
+    size_t series_bytes = (sizeof(uint32_t) + sizeof(int32_t)) *
+                          CHART_POINTS * LOG_ROLLUP_FIELDS;
+    for (int w = 0; w < LOG_WINDOWS && !fails; ++w) {
+        size_t scratch_size = log_series_scratch_size((log_window_t)w,
+                                                      CHART_POINTS);
+        void *scratch = malloc(scratch_size);
+        storage_fake_stats_t before, after;
+        storage_fake_get_stats(&before);
+        double t0 = now_s();
+        esp_err_t err = log_series_load((log_window_t)w, s_end - 1U, &s, scratch);
+        double load_s = now_s() - t0;
+        storage_fake_get_stats(&after);
+        free(scratch);
+        if (err != ESP_OK) {
+            printf("%s : erreur %d\n", k_window_name[w], (int)err);
+            fails++;
+            break;
+        }
+        fails += check_window((log_window_t)w, &s);
+        printf("%-4s : %5zu points lus -> %4zu, %6" PRIu64 " o lus, "
+               "%5.0f us (carte simulée %6" PRIu64 " us), mémoire %zu + %zu o\n",
+               k_window_name[w], s.points, s.n, after.bytes_read - before.bytes_read,
+               load_s * 1e6, after.busy_us - before.busy_us, scratch_size,
+               series_bytes);
+    }
+    for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+        free(s.t[f]);
+        free(s.v[f]);
+    }
+    printf("%s\n", fails ? "FAIL" : "OK");
+    storage_fake_deinit();
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "log_codec.h"
+#include "test_util.h"
+
+/*
+ * tools/log_stats.cpp on generated logs, checked and timed.
+ *
+ * Writes the given number of days at 1 Hz from 2024-01-01 to a temporary
+ * directory, both as daily segments (AAAAMMJJ.bin, with an unused block at
+ * the end of the first one), as one CSV file with a damaged line and as
+ * the older CSV without humidity (timestamp,faim,eau,temperature,humeur,
+ * event). The card is out for two hours on the second day and for the whole
+ * fifth day.
+ * Temperature follows a day/night cycle that leaves the 26-34 band, hunger
+ * decays and gets a meal every 6 h. The expected report is computed here
+ * sample by sample; log_stats must print exactly the same one from the
+ * segments and from the CSV, and the same with a humidity of 0 from the
+ * older CSV. The time of each run is printed.
+ *
+ * Usage: bench_log_stats [days] [path of log_stats]
+ * Build: gcc -O2 -Icomponents/logging tests/bench_log_stats.c \
+ *            components/logging/log_codec.c -lm -o bench_log_stats
+ */
+
+#define T0 1704067200U /* 2024-01-01 00:00 UTC */
+#define DAY_S 86400U
+#define GAP_S 300U
+#define BAND "26:34"
+#define BAND_MIN 26
+#define BAND_MAX 34
+#define MEANS LOG_COL_EVENT
+
+typedef struct {
+    uint64_t samples;
+    int64_t sum[MEANS];
+    uint64_t measured_s;
+    uint64_t out_s;
+    uint32_t feedings;
+} day_t;
+
+/* @p humidity false: the mean humidity of a log without it, 0 */
+static void print_row(FILE *out, const char *label, const day_t *d,
+                      bool humidity)
+{
+    static const int k_order[MEANS] = {LOG_COL_TEMPERATURE, LOG_COL_HUMIDITE,
+                                       LOG_COL_FAIM, LOG_COL_EAU,
+                                       LOG_COL_HUMEUR};
+    fprintf(out, "%s,%" PRIu64, label, d->samples);
+    for (int c = 0; c < MEANS; ++c) {
+        bool none = !d->samples ||
+                    (!humidity && k_order[c] == LOG_COL_HUMIDITE);
+        fprintf(out, ",%.2f",
+                none ? 0.0 : (double)d->sum[k_order[c]] / (double)d->samples);
+    }
+    fprintf(out, ",%" PRIu64 ",%" PRIu64 ",%" PRIu32 "\n", d->measured_s,
+            d->out_s, d->feedings);
+}
+
+/* Run @p cmd and compare its stdout with the file @p expect */
+static int run_and_compare(const char *cmd, const char *expect, double *secs)
+{
+    double t0 = now_s();
+    FILE *p = popen(cmd, "r");
+    FILE *e = fopen(expect, "r");
+    if (!p || !e) {
+        printf("impossible de lancer %s\n", cmd);
+        return 1;
+    }
+    char got[256], want[256];
+    int line = 0, fails = 0;
+    for (;;) {
+        char *g = fgets(got, sizeof(got), p);
+        char *w = fgets(want, sizeof(want), e);
+        line++;
+        if (!g && !w) {
+            break;
+        }
+        if (!g || !w || strcmp(got, want)) {
+            if (!fails++) {
+                printf("%s\nligne %d : %s  attendu : %s", cmd, line,
+                       g ? got : "(fin)\n", w ? want : "(fin)\n");
+            }
+            if (!g || !w) {
+                break;
+            }
+        }
+    }
+    fails += pclose(p) != 0;
+    fclose(e);
+    *secs = now_s() - t0;
+    return fails;
+}
+
+static void day_label(uint32_t d, char *buf, size_t size)
+{
+    time_t day0 = (time_t)(T0 + d * DAY_S);
+    struct tm tm;
+    gmtime_r(&day0, &tm);
+    strftime(buf, size, "%Y-%m-%d", &tm);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t days = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 365;
+    const char *tool = (argc > 2) ? argv[2] : "./log_stats";
+    char dir[] = "/tmp/log_stats_XXXXXX";
+    if (days < 6 || !mkdtemp(dir)) {
+        printf("6 jours au moins, dans /tmp\n");
+        return 1;
+    }
+    char path[128];
+    snprintf(path, sizeof(path), "%s/reptile_log.csv", dir);
+    FILE *csv = fopen(path, "w");
+    snprintf(path, sizeof(path), "%s/ancien.csv", dir);
+    FILE *legacy = fopen(path, "w");
+    day_t *stats = calloc(days, sizeof(*stats));
+    if (!csv || !legacy || !stats) {
+        perror(dir);
+        return 1;
+    }
+    fputs(LOG_CSV_HEADER, csv);
+    fputs("timestamp,faim,eau,temperature,humeur,event\n", legacy);
+
+    uint32_t noise = 1;
+    int32_t faim_q = 100 * 400, eau_q = 100 * 300;
+    log_sample_t prev = {0};
+    uint64_t samples = 0;
+    double t_gen = now_s();
+    for (uint32_t d = 0; d < days; ++d) {
+        FILE *bin = NULL;
+        log_encoder_t enc;
+        log_encoder_init(&enc);
+        uint8_t block[LOG_BLOCK_SIZE];
+        for (uint32_t t = 0; t < DAY_S; ++t) {
+            uint32_t ts = T0 + d * DAY_S + t;
+            /* Hunger and water decay all the time, logged or not */
+            faim_q = (faim_q > 0) ? faim_q - 1 : 0;
+            eau_q = (eau_q > 0) ? eau_q - 1 : 0;
+            if (ts % (6U * 3600U) == 0) {
+                faim_q = (faim_q + 10 * 400 > 100 * 400) ? 100 * 400
+                                                         : faim_q + 10 * 400;
+            }
+            if (ts % (4U * 3600U) == 1800U) {
+                eau_q = (eau_q + 10 * 300 > 100 * 300) ? 100 * 300
+                                                       : eau_q + 10 * 300;
+            }
+            if (d == 4 || (d == 1 && t >= 36000U && t < 43200U)) {
+                continue; /* card out */
+            }
+            double phase = 2.0 * M_PI * (double)t / (double)DAY_S;
+            log_sample_t s = {.timestamp = ts};
+            s.values[LOG_COL_FAIM] = (faim_q + 399) / 400;
+            s.values[LOG_COL_EAU] = (eau_q + 299) / 300;
+            s.values[LOG_COL_TEMPERATURE] =
+                (int32_t)lround(30.0 + 5.0 * sin(phase)) +
+                (lcg_next(&noise) % 100U < 2U);
+            s.values[LOG_COL_HUMIDITE] =
+                (int32_t)lround(50.0 - 10.0 * sin(phase)) +
+                (lcg_next(&noise) % 100U < 5U);
+            s.values[LOG_COL_HUMEUR] = 60 + (int32_t)(lcg_next(&noise) % 8U);
+            s.values[LOG_COL_EVENT] = (lcg_next(&noise) % 50000U == 0);
+
+            if (!bin) {
+                char name[16];
+                time_t day0 = (time_t)(T0 + d * DAY_S);
+                strftime(name, sizeof(name), "%Y%m%d", gmtime(&day0));
+                snprintf(path, sizeof(path), "%s/%s.bin", dir, name);
+                bin = fopen(path, "wb");
+                if (!bin) {
+                    perror(path);
+                    return 1;
+                }
+            }
+            if (log_encoder_add(&enc, &s, block)) {
+                fwrite(block, 1, sizeof(block), bin);
+            }
+            char line[128];
+            log_sample_format(&s, line, sizeof(line));
+            fputs(line, csv);
+            if (samples == 1000) {
+                fputs("1704068200,12,,30,50,60,0\n", csv); /* damaged */
+            }
+            fprintf(legacy, "%" PRIu32 ",%" PRId32 ",%" PRId32 ",%" PRId32
+                            ",%" PRId32 ",%" PRId32 "\n",
+                    s.timestamp, s.values[LOG_COL_FAIM],
+                    s.values[LOG_COL_EAU], s.values[LOG_COL_TEMPERATURE],
+                    s.values[LOG_COL_HUMEUR], s.values[LOG_COL_EVENT]);
+
+            day_t *day = &stats[d];
+            day->samples++;
+            for (int c = 0; c < MEANS; ++c) {
+                day->sum[c] += s.values[c];
+            }
+            if (samples) {
+                /* An interval belongs to the day of its first sample */
+                day_t *from = &stats[(prev.timestamp - T0) / DAY_S];
+                uint32_t dt = ts - prev.timestamp;
+                if (dt <= GAP_S) {
+                    from->measured_s += dt;
+                    if (prev.values[LOG_COL_TEMPERATURE] < BAND_MIN ||
+                        prev.values[LOG_COL_TEMPERATURE] > BAND_MAX) {
+                        from->out_s += dt;
+                    }
+                }
+                day->feedings +=
+                    s.values[LOG_COL_FAIM] > prev.values[LOG_COL_FAIM];
+            }
+            prev = s;
+            samples++;
+        }
+        if (!bin) {
+            continue;
+        }
+        if (log_encoder_flush(&enc, block)) {
+            fwrite(block, 1, sizeof(block), bin);
+        }
+        if (d == 0) {
+            memset(block, 0, sizeof(block));
+            fwrite(block, 1, sizeof(block), bin); /* unused block */
+        }
+        fclose(bin);
+    }
+    fclose(csv);
+    fclose(legacy);
+    t_gen = now_s() - t_gen;
+
+    char legacy_path[128];
+    snprintf(path, sizeof(path), "%s/attendu.txt", dir);
+    snprintf(legacy_path, sizeof(legacy_path), "%s/attendu_ancien.txt", dir);
+    FILE *expect = fopen(path, "w");
+    FILE *expect_legacy = fopen(legacy_path, "w");
+    if (!expect || !expect_legacy) {
+        perror(dir);
+        return 1;
+    }
+    static const char k_head[] = "jour,echantillons,temperature,humidite,faim,"
+                                 "eau,humeur,mesure_s,hors_plage_s,repas\n";
+    fputs(k_head, expect);
+    fputs(k_head, expect_legacy);
+    day_t total = {0};
+    for (uint32_t d = 0; d < days; ++d) {
+        const day_t *day = &stats[d];
+        if (!day->samples) {
+            continue;
+        }
+        char label[16];
+        day_label(d, label, sizeof(label));
+        print_row(expect, label, day, true);
+        print_row(expect_legacy, label, day, false);
+        total.samples += day->samples;
+        for (int c = 0; c < MEANS; ++c) {
+            total.sum[c] += day->sum[c];
+        }
+        total.measured_s += day->measured_s;
+        total.out_s += day->out_s;
+        total.feedings += day->feedings;
+    }
+    print_row(expect, "total", &total, true);
+    print_row(expect_legacy, "total", &total, false);
+    fclose(expect);
+    fclose(expect_legacy);
+    printf("%" PRIu64 " échantillons générés en %.1f s\n", samples, t_gen);
+
+    char cmd[512];
+    double secs;
+    snprintf(cmd, sizeof(cmd), "%s --band " BAND " %s/*.bin", tool, dir);
+    int fails = run_and_compare(cmd, path, &secs);
+    printf("segments : %.2f s\n", secs);
+    snprintf(cmd, sizeof(cmd), "%s --band " BAND " %s/reptile_log.csv", tool,
+             dir);
+    fails += run_and_compare(cmd, path, &secs);
+    printf("CSV      : %.2f s\n", secs);
+    snprintf(cmd, sizeof(cmd), "%s --band " BAND " %s/ancien.csv", tool, dir);
+    fails += run_and_compare(cmd, legacy_path, &secs);
+    printf("ancien   : %.2f s\n", secs);
+
+    snprintf(cmd, sizeof(cmd), "rm -r %s", dir);
+    fails += system(cmd) != 0;
+    free(stats);
+    printf("%s\n", fails ? "FAIL" : "OK");
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "reptile_logic.h"
+#include "reptile_batch.h"
+#include "test_util.h"
+
+#define BENCH_ANIMALS 1024
+#define BENCH_STEPS 2000
+
+int main(int argc, char **argv)
+{
+    size_t animals = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_ANIMALS;
+    unsigned steps = (argc > 2) ? strtoul(argv[2], NULL, 10) : BENCH_STEPS;
+    if (animals == 0 || steps == 0) {
+        fprintf(stderr, "usage: %s [animals] [steps]\n", argv[0]);
+        return 1;
+    }
+
+    reptile_t *aos = malloc(animals * sizeof(reptile_t));
+    reptile_batch_t batch;
+    if (!aos || reptile_batch_init(&batch, animals) != ESP_OK) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    reptile_t proto;
+    reptile_init(&proto, true);
+    for (size_t i = 0; i < animals; ++i) {
+        aos[i] = proto;
+        reptile_batch_add(&batch, &proto, NULL);
+    }
+
+    /* 1 s per step, restarting from full stats so values never pin at 0 */
+    double t0 = now_s();
+    for (unsigned s = 0; s < steps; ++s) {
+        for (size_t i = 0; i < animals; ++i) {
+            if ((s % 100U) == 0) {
+                aos[i].faim_q = aos[i].eau_q = aos[i].humeur_q = 100 * REPTILE_Q_ONE;
+            }
+            reptile_update(&aos[i], 1000);
+            reptile_check_events(&aos[i]);
+        }
+    }
+    double t_struct = now_s() - t0;
+
+    t0 = now_s();
+    for (unsigned s = 0; s < steps; ++s) {
+        if ((s % 100U) == 0) {
+            for (size_t i = 0; i < animals; ++i) {
+                batch.faim_q[i] = batch.eau_q[i] = batch.humeur_q[i] =
+                    100 * REPTILE_Q_ONE;
+            }
+        }
+        reptile_update_batch(&batch, 1000);
+        reptile_check_events_batch(&batch);
+    }
+    double t_batch = now_s() - t0;
+
+    double total = (double)animals * (double)steps;
+    printf("animals=%zu steps=%u\n", animals, steps);
+    printf("reptile_update (par struct, capteurs simules inclus): %.3e animaux/s\n",
+           total / t_struct);
+    printf("reptile_update_batch (SoA): %.3e animaux/s\n", total / t_batch);
+    printf("acceleration: x%.1f\n", t_struct / t_batch);
+
+    reptile_batch_free(&batch);
+    free(aos);
+    return 0;
+}
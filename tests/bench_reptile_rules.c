@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "reptile_logic.h"
+#include "reptile_batch.h"
+#include "test_util.h"
+
+/*
+ * Rule engine benchmark: evaluates the event rules over a population with
+ * random stats, once through the generated lookup tables
+ * (reptile_check_events_batch) and once with a plain loop over the rule
+ * table, and checks that both give the same events.
+ */
+
+#define BENCH_ANIMALS 65536
+#define BENCH_STEPS 200
+
+/* Reference: one rule at a time, straight from the masks */
+static uint8_t naive_step(reptile_rule_state_t *st, uint32_t preds, uint32_t now)
+{
+    uint64_t active = 0, pending = 0;
+    for (int i = 0; i < REPTILE_RULE_COUNT; ++i) {
+        uint64_t bit = 1ULL << i;
+        uint32_t em = reptile_rule_enter_mask[i];
+        uint32_t hm = reptile_rule_hold_mask[i];
+        if ((st->active & bit) && (preds & hm) == hm) {
+            active |= bit;
+        } else if ((preds & em) == em) {
+            if (!(st->pending & bit)) {
+                st->since[i] = now;
+            }
+            if (now - st->since[i] >= reptile_rule_min_s[i]) {
+                active |= bit;
+            } else {
+                pending |= bit;
+            }
+        }
+    }
+    st->active = active;
+    st->pending = pending;
+    for (int i = 0; i < REPTILE_RULE_COUNT; ++i) {
+        if (active & (1ULL << i)) {
+            return reptile_rule_event[i];
+        }
+    }
+    return REPTILE_EVENT_NONE;
+}
+
+static void randomize(reptile_batch_t *b, uint32_t *seed)
+{
+    for (size_t i = 0; i < b->count; ++i) {
+        b->faim_q[i] = (lcg_next(seed) % 101U) * REPTILE_Q_ONE;
+        b->eau_q[i] = (lcg_next(seed) % 101U) * REPTILE_Q_ONE;
+        b->humeur_q[i] = (lcg_next(seed) % 101U) * REPTILE_Q_ONE;
+        b->temperature[i] = 20U + lcg_next(seed) % 22U;
+        b->humidite[i] = 30U + lcg_next(seed) % 50U;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t animals = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_ANIMALS;
+    unsigned steps = (argc > 2) ? strtoul(argv[2], NULL, 10) : BENCH_STEPS;
+    unsigned species = (argc > 3) ? strtoul(argv[3], NULL, 10) : 0;
+    if (animals == 0 || steps == 0 || species >= REPTILE_SPECIES_COUNT) {
+        fprintf(stderr, "usage: %s [animals] [steps] [species]\n", argv[0]);
+        return 1;
+    }
+
+    reptile_batch_t batch;
+    reptile_rule_state_t *ref = calloc(animals, sizeof(*ref));
+    uint8_t *ref_evt = calloc(animals, 1);
+    if (!ref || !ref_evt || reptile_batch_init(&batch, animals) != ESP_OK) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+    reptile_t proto;
+    memset(&proto, 0, sizeof(proto));
+    proto.species = (reptile_species_t)species;
+    for (size_t i = 0; i < animals; ++i) {
+        reptile_batch_add(&batch, &proto, NULL);
+    }
+
+    /* New stats every 10 steps, clock +10 s per step so the timed rules mature */
+    uint32_t seed = 1;
+    double t_lut = 0.0, t_naive = 0.0;
+    size_t mismatches = 0;
+    for (unsigned s = 0; s < steps; ++s) {
+        if ((s % 10U) == 0) {
+            randomize(&batch, &seed);
+        }
+        batch.last_update += 10;
+
+        double t0 = now_s();
+        reptile_check_events_batch(&batch);
+        t_lut += now_s() - t0;
+
+        uint32_t now = (uint32_t)batch.last_update;
+        const reptile_species_profile_t *sp =
+            reptile_species_profile(batch.species);
+        t0 = now_s();
+        for (size_t i = 0; i < animals; ++i) {
+            uint32_t preds = reptile_rules_preds(
+                sp, batch.faim_q[i] / REPTILE_Q_ONE,
+                batch.eau_q[i] / REPTILE_Q_ONE,
+                batch.humeur_q[i] / REPTILE_Q_ONE, batch.temperature[i],
+                batch.humidite[i], 0);
+            ref_evt[i] = naive_step(&ref[i], preds, now);
+        }
+        t_naive += now_s() - t0;
+
+        for (size_t i = 0; i < animals; ++i) {
+            mismatches += (ref_evt[i] != batch.event[i]);
+        }
+    }
+
+    size_t per_event[REPTILE_EVENT_COUNT] = { 0 };
+    for (size_t i = 0; i < animals; ++i) {
+        per_event[batch.event[i]]++;
+    }
+
+    double total = (double)animals * (double)steps;
+    printf("animals=%zu steps=%u espece=%s regles=%d predicats=%d\n", animals,
+           steps, reptile_species_profile(batch.species)->name,
+           REPTILE_RULE_COUNT, REPTILE_PRED_COUNT);
+    printf("tables (reptile_check_events_batch): %.1f ns/animal\n",
+           1e9 * t_lut / total);
+    printf("boucle par regle (reference):        %.1f ns/animal\n",
+           1e9 * t_naive / total);
+    printf("etat final:");
+    for (int e = 0; e < REPTILE_EVENT_COUNT; ++e) {
+        printf(" %d:%zu", e, per_event[e]);
+    }
+    printf("\n%s (%zu divergences)\n", mismatches ? "ECHEC" : "OK", mismatches);
+
+    reptile_batch_free(&batch);
+    free(ref);
+    free(ref_evt);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game_mode.h"
+#include "reptile_journal.h"
+#include "reptile_logic.h"
+#include "sensors.h"
+#include "storage_fake.h"
+
+/*
+ * Write patterns of the game on the fake SD card (storage_fake.c), one
+ * operation per game second: the journaled save, the former save that
+ * rewrote the whole state file, and the CSV log line opened, appended and
+ * closed each time or appended to a file kept open. Times are the card
+ * time modelled by the fake, not host time.
+ *
+ * Usage: bench_storage [operations]
+ * Build: same sources as tests/bench_reptile_batch.c (README)
+ */
+
+#define BENCH_OPS 3600
+#define SNAP_PATH "/sdcard/real/reptile_state.bin"
+#define JNL_PATH "/sdcard/real/reptile_state.jnl"
+#define LOG_PATH "/sdcard/reptile_log.csv"
+
+typedef struct {
+    uint64_t busy_us;
+    uint64_t max_us;
+} bench_time_t;
+
+static uint64_t busy_us(void)
+{
+    storage_fake_stats_t st;
+    storage_fake_get_stats(&st);
+    return st.busy_us;
+}
+
+static void op_end(bench_time_t *t, uint64_t start)
+{
+    uint64_t us = busy_us() - start;
+    t->busy_us += us;
+    if (us > t->max_us) {
+        t->max_us = us;
+    }
+}
+
+static void report(const char *name, unsigned ops, const bench_time_t *t)
+{
+    storage_fake_stats_t st;
+    storage_fake_get_stats(&st);
+    printf("%-24s %8.0f %8" PRIu64 " %10.0f %8.1f %6.1fx\n", name,
+           (double)t->busy_us / ops, t->max_us,
+           (double)st.media_written / ops, (double)st.bytes_written / ops,
+           st.bytes_written ? (double)st.media_written / st.bytes_written : 0.0);
+}
+
+static void step(reptile_t *r, unsigned i)
+{
+    const reptile_env_t env = {.temperature = 28, .humidite = 55};
+    reptile_update_with_env(r, 1000, &env);
+    if (i % 16U == 0) {
+        reptile_feed(r);
+    }
+}
+
+static int format_line(char *buf, size_t len, const reptile_t *r)
+{
+    return snprintf(buf, len,
+                    "%ld,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32
+                    ",%" PRIu32 "\n",
+                    (long)r->last_update, r->faim, r->eau, r->temperature,
+                    r->humeur, (uint32_t)r->event);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned ops = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_OPS;
+    if (ops == 0) {
+        fprintf(stderr, "usage: %s [operations]\n", argv[0]);
+        return 1;
+    }
+    game_mode_set(GAME_MODE_SIMULATION);
+    sensors_init();
+    reptile_set_save_fn(NULL);
+    storage_set_backend(&storage_fake_backend);
+
+    reptile_t proto;
+    reptile_init(&proto, true);
+    proto.last_update = 1000;
+
+    printf("%-24s %8s %8s %10s %8s %7s\n", "motif", "moy us", "max us",
+           "carte o/op", "util o/op", "amplif");
+
+    /* Journal: records of the changed chunks, periodic snapshot */
+    storage_fake_init(NULL);
+    reptile_t r = proto;
+    bench_time_t t = {0};
+    for (unsigned i = 0; i < ops; ++i) {
+        step(&r, i);
+        uint64_t start = busy_us();
+        reptile_journal_save(SNAP_PATH, JNL_PATH, &r);
+        op_end(&t, start);
+    }
+    reptile_journal_close();
+    report("sauvegarde journalisée", ops, &t);
+
+    /* Former reptile_save: truncate and rewrite the whole state */
+    storage_fake_init(NULL);
+    r = proto;
+    memset(&t, 0, sizeof(t));
+    for (unsigned i = 0; i < ops; ++i) {
+        step(&r, i);
+        uint64_t start = busy_us();
+        storage_file_t *f;
+        if (storage_open(SNAP_PATH, STORAGE_CREATE, &f) == ESP_OK) {
+            storage_append(f, &r, sizeof(r));
+            storage_fsync(f);
+            storage_close(f);
+        }
+        op_end(&t, start);
+    }
+    report("réécriture complète", ops, &t);
+
+    /* logging.c: open, append one line, close */
+    storage_fake_init(NULL);
+    r = proto;
+    memset(&t, 0, sizeof(t));
+    for (unsigned i = 0; i < ops; ++i) {
+        step(&r, i);
+        char line[96];
+        int len = format_line(line, sizeof(line), &r);
+        uint64_t start = busy_us();
+        storage_file_t *f;
+        if (storage_open(LOG_PATH, STORAGE_APPEND, &f) == ESP_OK) {
+            storage_append(f, line, (size_t)len);
+            storage_close(f);
+        }
+        op_end(&t, start);
+    }
+    report("journal CSV ouvert/fermé", ops, &t);
+
+    /* Same lines to a file kept open, synced once a minute */
+    storage_fake_init(NULL);
+    r = proto;
+    memset(&t, 0, sizeof(t));
+    storage_file_t *log;
+    if (storage_open(LOG_PATH, STORAGE_APPEND, &log) != ESP_OK) {
+        fprintf(stderr, "open failed\n");
+        return 1;
+    }
+    for (unsigned i = 0; i < ops; ++i) {
+        step(&r, i);
+        char line[96];
+        int len = format_line(line, sizeof(line), &r);
+        uint64_t start = busy_us();
+        storage_append(log, line, (size_t)len);
+        if (i % 60U == 59U) {
+            storage_fsync(log);
+        }
+        op_end(&t, start);
+    }
+    storage_close(log);
+    report("journal CSV gardé ouvert", ops, &t);
+
+    storage_fake_deinit();
+    sensors_deinit();
+    return 0;
+}
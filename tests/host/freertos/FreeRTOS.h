@@ -0,0 +1,33 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Host stand-in for the few FreeRTOS calls of the storage supervisor and its
+ * writers, on pthreads (tests/host/freertos_shim.c). A tick is a millisecond.
+ * Not a scheduler: tasks are threads, priorities and stack sizes are ignored.
+ */
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFU)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+/** Milliseconds of CLOCK_MONOTONIC. */
+TickType_t xTaskGetTickCount(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_FREERTOS_H
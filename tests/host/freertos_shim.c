@@ -0,0 +1,192 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * FreeRTOS calls of the host tests on pthreads (see freertos/FreeRTOS.h).
+ * Build with -pthread and -Itests/host.
+ */
+
+struct host_sem {
+    pthread_mutex_t m;
+    pthread_cond_t c;
+    int count;
+};
+
+struct host_task {
+    pthread_t thread;
+    pthread_mutex_t m;
+    pthread_cond_t c;
+    uint32_t notes;
+    void (*fn)(void *);
+    void *arg;
+};
+
+static __thread struct host_task *s_current;
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/* CLOCK_REALTIME deadline @p ticks from now, for pthread_cond_timedwait */
+static void deadline(struct timespec *ts, TickType_t ticks)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ticks / 1000U;
+    ts->tv_nsec += (long)(ticks % 1000U) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/* Wait on @p c until signalled, or false once @p ts has passed */
+static bool wait(pthread_cond_t *c, pthread_mutex_t *m, TickType_t ticks,
+                 const struct timespec *ts)
+{
+    if (ticks == portMAX_DELAY) {
+        return pthread_cond_wait(c, m) == 0;
+    }
+    return ticks != 0 && pthread_cond_timedwait(c, m, ts) != ETIMEDOUT;
+}
+
+static SemaphoreHandle_t sem_create(int count)
+{
+    struct host_sem *s = calloc(1, sizeof(*s));
+    if (s) {
+        pthread_mutex_init(&s->m, NULL);
+        pthread_cond_init(&s->c, NULL);
+        s->count = count;
+    }
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return sem_create(1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return sem_create(0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait_ticks)
+{
+    struct timespec ts;
+    deadline(&ts, wait_ticks);
+    pthread_mutex_lock(&s->m);
+    while (s->count == 0 && wait(&s->c, &s->m, wait_ticks, &ts)) {
+    }
+    bool taken = s->count != 0;
+    s->count = 0;
+    pthread_mutex_unlock(&s->m);
+    return taken ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    pthread_mutex_lock(&s->m);
+    s->count = 1;
+    pthread_cond_signal(&s->c);
+    pthread_mutex_unlock(&s->m);
+    return pdTRUE;
+}
+
+static struct host_task *task_alloc(void (*fn)(void *), void *arg)
+{
+    struct host_task *t = calloc(1, sizeof(*t));
+    if (t) {
+        pthread_mutex_init(&t->m, NULL);
+        pthread_cond_init(&t->c, NULL);
+        t->fn = fn;
+        t->arg = arg;
+    }
+    return t;
+}
+
+static void *task_main(void *arg)
+{
+    s_current = arg;
+    s_current->fn(s_current->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(void (*fn)(void *), const char *name, uint32_t stack,
+                       void *arg, UBaseType_t prio, TaskHandle_t *out)
+{
+    (void)name;
+    (void)stack;
+    (void)prio;
+    struct host_task *t = task_alloc(fn, arg);
+    if (!t) {
+        return pdFALSE;
+    }
+    if (out) {
+        *out = t;
+    }
+    if (pthread_create(&t->thread, NULL, task_main, t) != 0) {
+        free(t);
+        return pdFALSE;
+    }
+    pthread_detach(t->thread);
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (!s_current) {
+        s_current = task_alloc(NULL, NULL); /* main thread of the test */
+        if (s_current) {
+            s_current->thread = pthread_self();
+        }
+    }
+    return s_current;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait_ticks)
+{
+    struct host_task *t = xTaskGetCurrentTaskHandle();
+    struct timespec ts;
+    deadline(&ts, wait_ticks);
+    pthread_mutex_lock(&t->m);
+    while (t->notes == 0 && wait(&t->c, &t->m, wait_ticks, &ts)) {
+    }
+    uint32_t v = t->notes;
+    if (v) {
+        t->notes = clear ? 0U : v - 1U;
+    }
+    pthread_mutex_unlock(&t->m);
+    return v;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t t)
+{
+    pthread_mutex_lock(&t->m);
+    t->notes++;
+    pthread_cond_signal(&t->c);
+    pthread_mutex_unlock(&t->m);
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = {(time_t)(ticks / 1000U),
+                          (long)(ticks % 1000U) * 1000000L};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+void vTaskDelete(TaskHandle_t t)
+{
+    (void)t;
+    pthread_exit(NULL);
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "game_mode.h"
+#include "sensors.h"
+#include "reptile_logic.h"
+#include "reptile_replay.h"
+#include "test_util.h"
+
+/*
+ * Record or replay a reptile input stream.
+ *
+ *   replay_reptile record <file> [ticks] [seed]   synthetic session
+ *   replay_reptile <file>                          verify + throughput
+ */
+
+static int record(const char *path, uint32_t ticks, uint32_t seed)
+{
+    reptile_t r;
+    reptile_tick_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    reptile_init(&r, true);
+    reptile_set_save_fn(NULL);
+    reptile_set_seed(&r, seed);
+    if (reptile_recorder_start(path, &r, &ctx) != ESP_OK) {
+        return 1;
+    }
+
+    /* Jittered tick lengths and a few actions, like a real session */
+    uint32_t lcg = seed;
+    for (uint32_t i = 0; i < ticks; ++i) {
+        lcg = lcg * 1664525U + 1013904223U;
+        uint32_t elapsed = 900U + (lcg >> 24);
+        reptile_tick_step(&r, &ctx, elapsed, NULL);
+        reptile_recorder_tick(elapsed, &r, &ctx);
+        if ((lcg & 0x3FU) == 0) {
+            reptile_action_t a = (reptile_action_t)((lcg >> 8) & 3U);
+            reptile_apply_action(&r, &ctx, a);
+            reptile_recorder_action(a, &r, &ctx);
+        }
+        /* Far faster than a game: let the task keep up with the buffer */
+        if ((i & 0x7FU) == 0x7FU && reptile_recorder_flush(1000) != ESP_OK) {
+            return 1;
+        }
+    }
+    reptile_recorder_stop();
+    printf("%" PRIu32 " ticks enregistres dans %s (graine %" PRIu32 ")\n",
+           ticks, path, seed);
+    return 0;
+}
+
+static int replay(const char *path)
+{
+    reptile_replay_stats_t st;
+    double t0 = now_s();
+    esp_err_t err = reptile_replay_file(path, &st);
+    double wall = now_s() - t0;
+
+    printf("ticks=%" PRIu32 " actions=%" PRIu32 " resync=%" PRIu32 "\n",
+           st.ticks, st.actions, st.syncs);
+    printf("etat final: faim=%" PRIu32 " eau=%" PRIu32 " humeur=%" PRIu32
+           " event=%d\n",
+           st.final_state.faim, st.final_state.eau, st.final_state.humeur,
+           (int)st.final_state.event);
+    if (wall > 0.0) {
+        printf("debit: %.3e etapes/s\n", (double)(st.ticks + st.actions) / wall);
+    }
+    if (err == ESP_ERR_INVALID_STATE) {
+        printf("DIVERGENCE a l'etape %" PRIu32 "\n", st.mismatch_step);
+        return 1;
+    }
+    if (err != ESP_OK) {
+        printf("flux illisible (%d)\n", err);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    game_mode_set(GAME_MODE_SIMULATION);
+    sensors_init();
+    int ret;
+    if (argc >= 3 && strcmp(argv[1], "record") == 0) {
+        uint32_t ticks = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 10) : 100000U;
+        uint32_t seed = (argc > 4) ? (uint32_t)strtoul(argv[4], NULL, 0) : 1U;
+        ret = record(argv[2], ticks, seed);
+    } else if (argc == 2) {
+        ret = replay(argv[1]);
+    } else {
+        fprintf(stderr, "usage: %s record <file> [ticks] [seed] | %s <file>\n",
+                argv[0], argv[0]);
+        ret = 1;
+    }
+    sensors_deinit();
+    return ret;
+}
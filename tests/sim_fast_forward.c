@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "game_mode.h"
+#include "gpio.h"
+#include "sensors.h"
+#include "reptile_logic.h"
+#include "test_util.h"
+
+/*
+ * Headless fast-forward of the reptile model for balancing.
+ *
+ * Usage: sim_fast_forward [-d duration] [-t tick_ms] [-s seed]
+ *                         [-e species] [-f feed_every] [-w water_every]
+ *                         [-h heat_every] [-m soothe_every]
+ *
+ * Durations accept an s/m/h/d suffix (seconds by default); 0 disables the
+ * corresponding action. Ticks and actions go through reptile_tick_step and
+ * reptile_apply_action, like the game loop, so the soothe bonus applies.
+ * Saves are disabled so the loop stays CPU-bound.
+ */
+
+typedef struct {
+    uint64_t every_ms;
+    uint64_t next_ms;
+    reptile_action_t action;
+    const char *name;
+    uint64_t count;
+} policy_t;
+
+/* Summary label of each event, in reptile_event_t order */
+static const char *const k_event_names[] = {
+    "sain", "malade", "croissance", "mue", "deshydratation",
+    "coup de chaleur", "ennui",
+};
+_Static_assert(sizeof(k_event_names) / sizeof(k_event_names[0]) ==
+                   REPTILE_EVENT_COUNT,
+               "one label per event");
+
+static uint64_t parse_duration_ms(const char *s)
+{
+    char *end = NULL;
+    double v = strtod(s, &end);
+    double mult = 1000.0;
+    switch (end ? *end : '\0') {
+    case 'm': mult = 60.0 * 1000.0; break;
+    case 'h': mult = 3600.0 * 1000.0; break;
+    case 'd': mult = 86400.0 * 1000.0; break;
+    default: break;
+    }
+    return (v > 0.0) ? (uint64_t)(v * mult) : 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t duration_ms = parse_duration_ms("30d");
+    uint32_t tick_ms = 1000;
+    uint32_t seed = 1;
+    unsigned species = REPTILE_SPECIES_GENERIQUE;
+    policy_t policy[] = {
+        { 0, 0, REPTILE_ACTION_FEED, "nourrir", 0 },
+        { 0, 0, REPTILE_ACTION_WATER, "hydrater", 0 },
+        { 0, 0, REPTILE_ACTION_HEAT, "chauffer", 0 },
+        { 0, 0, REPTILE_ACTION_SOOTHE, "caresser", 0 },
+    };
+    const size_t n_policy = sizeof(policy) / sizeof(policy[0]);
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *opt = argv[i];
+        const char *val = argv[i + 1];
+        if (strcmp(opt, "-d") == 0) {
+            duration_ms = parse_duration_ms(val);
+        } else if (strcmp(opt, "-t") == 0) {
+            tick_ms = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "-s") == 0) {
+            seed = (uint32_t)strtoul(val, NULL, 0);
+        } else if (strcmp(opt, "-e") == 0) {
+            species = (unsigned)strtoul(val, NULL, 10);
+        } else if (strcmp(opt, "-f") == 0) {
+            policy[0].every_ms = parse_duration_ms(val);
+        } else if (strcmp(opt, "-w") == 0) {
+            policy[1].every_ms = parse_duration_ms(val);
+        } else if (strcmp(opt, "-h") == 0) {
+            policy[2].every_ms = parse_duration_ms(val);
+        } else if (strcmp(opt, "-m") == 0) {
+            policy[3].every_ms = parse_duration_ms(val);
+        } else {
+            fprintf(stderr, "option inconnue: %s\n", opt);
+            return 1;
+        }
+    }
+    if (tick_ms == 0) {
+        fprintf(stderr, "tick_ms doit etre > 0\n");
+        return 1;
+    }
+    if (species >= REPTILE_SPECIES_COUNT) {
+        fprintf(stderr, "espece inconnue: %u\n", species);
+        return 1;
+    }
+
+    game_mode_set(GAME_MODE_SIMULATION);
+    sensors_init();
+    reptile_actuators_init();
+
+    reptile_t r;
+    reptile_tick_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    reptile_init(&r, true);
+    reptile_set_save_fn(NULL);
+    reptile_set_seed(&r, seed);
+    reptile_set_species(&r, (reptile_species_t)species);
+    for (size_t p = 0; p < n_policy; ++p) {
+        policy[p].next_ms = policy[p].every_ms;
+    }
+
+    uint64_t ticks_in_event[REPTILE_EVENT_COUNT] = { 0 };
+    uint64_t transitions = 0;
+    uint64_t sum_faim = 0, sum_eau = 0, sum_humeur = 0;
+    uint32_t min_faim = UINT32_MAX, min_eau = UINT32_MAX,
+             min_humeur = UINT32_MAX;
+    uint64_t ticks = 0;
+    reptile_event_t prev = r.event;
+
+    double t0 = now_s();
+    for (uint64_t t = 0; t < duration_ms; t += tick_ms) {
+        for (size_t p = 0; p < n_policy; ++p) {
+            if (policy[p].every_ms && t >= policy[p].next_ms) {
+                reptile_apply_action(&r, &ctx, policy[p].action);
+                policy[p].next_ms += policy[p].every_ms;
+                policy[p].count++;
+            }
+        }
+        reptile_tick_step(&r, &ctx, tick_ms, NULL);
+        reptile_event_t evt = r.event;
+        transitions += (evt != prev);
+        prev = evt;
+        ticks_in_event[evt]++;
+        sum_faim += r.faim;
+        sum_eau += r.eau;
+        sum_humeur += r.humeur;
+        min_faim = (r.faim < min_faim) ? r.faim : min_faim;
+        min_eau = (r.eau < min_eau) ? r.eau : min_eau;
+        min_humeur = (r.humeur < min_humeur) ? r.humeur : min_humeur;
+        ticks++;
+    }
+    double wall = now_s() - t0;
+
+    if (ticks == 0) {
+        fprintf(stderr, "duree nulle\n");
+        return 1;
+    }
+    double n = (double)ticks;
+    printf("duree simulee : %.2f jours (%" PRIu64 " ticks de %" PRIu32 " ms, graine %" PRIu32 ")\n",
+           (double)duration_ms / 86400000.0, ticks, tick_ms, seed);
+    printf("espece : %s\n", reptile_species_profile(r.species)->name);
+    for (size_t p = 0; p < n_policy; ++p) {
+        printf("action %-9s: %" PRIu64 "\n", policy[p].name, policy[p].count);
+    }
+    printf("faim   moy %6.2f min %3" PRIu32 "\n", (double)sum_faim / n, min_faim);
+    printf("eau    moy %6.2f min %3" PRIu32 "\n", (double)sum_eau / n, min_eau);
+    printf("humeur moy %6.2f min %3" PRIu32 "\n", (double)sum_humeur / n, min_humeur);
+    printf("temps");
+    for (int e = 0; e < REPTILE_EVENT_COUNT; ++e) {
+        printf("%s %s %.2f%%", e ? "," : "", k_event_names[e],
+               100.0 * (double)ticks_in_event[e] / n);
+    }
+    printf(" (%" PRIu64 " transitions)\n", transitions);
+    printf("age %u jours poids %u g%s%s\n", (unsigned)r.age_jours,
+           (unsigned)r.poids_g, (r.cycle & REPTILE_CYCLE_MUE) ? " (en mue)" : "",
+           (r.cycle & REPTILE_CYCLE_MALADE) ? " (malade)" : "");
+    printf("debit : %.3e ticks/s (%.3f s)\n", n / wall, wall);
+
+    reptile_actuators_deinit();
+    sensors_deinit();
+    return 0;
+}
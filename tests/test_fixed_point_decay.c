@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "game_mode.h"
+#include "reptile_logic.h"
+#include "sensors.h"
+#include "test_util.h"
+
+/*
+ * Fixed-point decay checks: one long update, random tick splits and a
+ * wake-up catch-up must land on the same stats for every species, and
+ * reptile_next_event_ms must point at the exact ms where the rules'
+ * inputs change.
+ */
+
+static void fresh(reptile_t *r, reptile_species_t sp)
+{
+    reptile_init(r, true);
+    reptile_set_seed(r, 1);
+    reptile_set_species(r, sp);
+    r->last_update = 1000;
+}
+
+static int same_stats(const reptile_t *a, const reptile_t *b)
+{
+    return a->faim_q == b->faim_q && a->eau_q == b->eau_q &&
+           a->humeur_q == b->humeur_q && a->last_update == b->last_update &&
+           a->clock_ms == b->clock_ms;
+}
+
+static int check_split(reptile_species_t sp, uint32_t total_ms, uint32_t seed)
+{
+    reptile_t one, split, wake;
+    fresh(&one, sp);
+    fresh(&split, sp);
+    fresh(&wake, sp);
+
+    reptile_update(&one, total_ms);
+    for (uint32_t left = total_ms; left > 0;) {
+        uint32_t step = 1U + lcg_next(&seed) % 1500U;
+        step = (step > left) ? left : step;
+        reptile_update(&split, step);
+        left -= step;
+    }
+    reptile_catch_up(&wake, wake.last_update + total_ms / 1000U);
+    reptile_update(&wake, total_ms % 1000U);
+
+    if (!same_stats(&one, &split) || !same_stats(&one, &wake)) {
+        printf("FAIL: espece %d, %" PRIu32 " ms: decoupage divergent\n",
+               (int)sp, total_ms);
+        return 1;
+    }
+    return 0;
+}
+
+static int check_next_event(reptile_species_t sp)
+{
+    reptile_t r, before, after;
+    fresh(&r, sp);
+    reptile_check_events(&r);
+    uint32_t next = reptile_next_event_ms(&r);
+    if (next == UINT32_MAX || next == 0) {
+        printf("FAIL: espece %d: pas de prochain seuil\n", (int)sp);
+        return 1;
+    }
+    reptile_peek(&r, next - 1U, &before);
+    reptile_peek(&r, next, &after);
+    const reptile_species_profile_t *p = reptile_species_profile(sp);
+    uint32_t a = reptile_rules_preds(p, before.faim, before.eau, before.humeur,
+                                     r.temperature, r.humidite, r.cycle);
+    uint32_t b = reptile_rules_preds(p, after.faim, after.eau, after.humeur,
+                                     r.temperature, r.humidite, r.cycle);
+    uint32_t ref = reptile_rules_preds(p, r.faim, r.eau, r.humeur,
+                                       r.temperature, r.humidite, r.cycle);
+    if (a != ref || b == ref) {
+        printf("FAIL: espece %d: seuil annonce a %" PRIu32 " ms\n", (int)sp,
+               next);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    game_mode_set(GAME_MODE_SIMULATION);
+    sensors_init();
+
+    int fails = 0;
+    uint32_t seed = 42;
+    for (int sp = 0; sp < REPTILE_SPECIES_COUNT; ++sp) {
+        for (int i = 0; i < 50; ++i) {
+            uint32_t total = lcg_next(&seed) % 120000U;
+            fails += check_split((reptile_species_t)sp, total, seed);
+        }
+        fails += check_next_event((reptile_species_t)sp);
+    }
+    printf("%s\n", fails ? "FAIL" : "OK");
+    sensors_deinit();
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,35 @@
+#ifndef TEST_LOG_FEED_H
+#define TEST_LOG_FEED_H
+
+#include "log_writer.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Samples handed to log_writer.h as the ring of logging.c does: set @c s and
+ * @c n, then call log_writer_flush() with a log_writer_io_t made by
+ * ::test_log_feed_io.
+ */
+typedef struct {
+    const log_sample_t *s;
+    size_t n;
+} test_log_feed_t;
+
+static inline bool test_log_feed_next(void *ctx, log_sample_t *s)
+{
+    test_log_feed_t *f = (test_log_feed_t *)ctx;
+    if (f->n == 0) {
+        return false;
+    }
+    *s = *f->s++;
+    f->n--;
+    return true;
+}
+
+/** Writer environment reading @p f, with the card always mounted. */
+static inline log_writer_io_t test_log_feed_io(test_log_feed_t *f)
+{
+    return (log_writer_io_t){.next = test_log_feed_next, .ctx = f};
+}
+
+#endif // TEST_LOG_FEED_H
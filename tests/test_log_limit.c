@@ -0,0 +1,159 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOG_LOCAL_LEVEL ESP_LOG_INFO /* debug call sites compile out */
+#include "log_limit.h"
+
+/*
+ * Rate-limited logging (components/log_limit) on the host.
+ *
+ * The token bucket of a call site is driven by a fake clock: a burst, then
+ * one message per period, a full bucket after a long idle time and across
+ * the wrap of the millisecond clock. Several threads then race on one call
+ * site at the same instant and must share exactly one burst. Finally the
+ * LOG_LIMIT_x macros, with ESP_LOG_LEVEL_LOCAL captured, must let a burst
+ * through, carry the suppressed count on the next message and leave debug
+ * call sites uncompiled, arguments included.
+ *
+ * Usage: test_log_limit
+ * Build: gcc -O2 -pthread -Icomponents/log_limit tests/test_log_limit.c \
+ *            components/log_limit/log_limit.c -o test_log_limit
+ */
+
+#define THREADS 4
+#define BURST CONFIG_LOG_LIMIT_BURST
+#define PERIOD CONFIG_LOG_LIMIT_PERIOD_MS
+
+static int s_lines;
+static char s_last[160];
+
+#undef ESP_LOG_LEVEL_LOCAL
+#define ESP_LOG_LEVEL_LOCAL(level, tag, format, ...)                           \
+    do {                                                                       \
+        (void)(level);                                                         \
+        snprintf(s_last, sizeof(s_last), "%s: " format, tag, ##__VA_ARGS__);   \
+        s_lines++;                                                             \
+    } while (0)
+
+/* Messages let through at now_ms out of n tries */
+static int take_n(log_limit_t *site, uint32_t now_ms, int n, uint32_t *last)
+{
+    int ok = 0;
+    for (int i = 0; i < n; ++i) {
+        uint32_t suppressed;
+        if (log_limit_take_at(site, now_ms, &suppressed)) {
+            ok++;
+            *last = suppressed;
+        }
+    }
+    return ok;
+}
+
+static int check_bucket(uint32_t t0)
+{
+    int fails = 0;
+    log_limit_t site = {0};
+    uint32_t sup = 0;
+    int ok = take_n(&site, t0, 100, &sup);
+    fails += ok != BURST;
+    /* Half a period later still nothing, one period later one message */
+    ok = take_n(&site, t0 + PERIOD / 2, 10, &sup);
+    fails += ok != 0;
+    ok = take_n(&site, t0 + PERIOD, 10, &sup);
+    fails += ok != 1 || sup != 100 - BURST + 10;
+    /* Steady rate: one per period */
+    ok = 0;
+    for (uint32_t k = 2; k < 50; ++k) {
+        ok += take_n(&site, t0 + k * PERIOD, 3, &sup);
+    }
+    fails += ok != 48 || sup != 2;
+    /* Idle: a full burst again */
+    ok = take_n(&site, t0 + 1000U * PERIOD, 100, &sup);
+    fails += ok != BURST;
+    if (fails) {
+        printf("seau faux à partir de %" PRIu32 " ms\n", t0);
+    }
+    return fails;
+}
+
+typedef struct {
+    log_limit_t *site;
+    int ok;
+    uint32_t suppressed;
+} race_t;
+
+static void *racer(void *arg)
+{
+    race_t *r = arg;
+    for (int i = 0; i < 100000; ++i) {
+        uint32_t sup;
+        if (log_limit_take_at(r->site, 5000, &sup)) {
+            r->ok++;
+            r->suppressed += sup;
+        }
+    }
+    return NULL;
+}
+
+static int s_evaluated;
+
+static int side_effect(void)
+{
+    return ++s_evaluated;
+}
+
+static void hot_error(int i)
+{
+    LOG_LIMIT_E("test", "erreur %d", i);
+}
+
+int main(void)
+{
+    int fails = 0;
+    fails += check_bucket(1000);
+    fails += check_bucket(UINT32_MAX - 3U * PERIOD); /* clock wraps inside */
+
+    log_limit_t site = {0};
+    race_t races[THREADS];
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; ++i) {
+        races[i] = (race_t){&site, 0, 0};
+        pthread_create(&threads[i], NULL, racer, &races[i]);
+    }
+    int ok = 0;
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+        ok += races[i].ok;
+    }
+    uint32_t left = atomic_load(&site.suppressed);
+    if (ok != BURST || left + (uint32_t)BURST != THREADS * 100000U) {
+        printf("course : %d messages, %" PRIu32 " supprimés\n", ok, left);
+        fails++;
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        hot_error(i);
+        LOG_LIMIT_D("test", "jamais %d", side_effect());
+    }
+    if (s_lines != BURST || s_evaluated != 0) {
+        printf("%d lignes au lieu de %d, %d arguments évalués\n", s_lines, BURST,
+               s_evaluated);
+        fails++;
+    }
+    usleep((PERIOD + 50) * 1000);
+    hot_error(1000);
+    char expect[64];
+    snprintf(expect, sizeof(expect), "test: erreur 1000 (+%d supprimés)",
+             1000 - BURST);
+    if (s_lines != BURST + 1 || strcmp(s_last, expect)) {
+        printf("dernière ligne : %s\n", s_last);
+        fails++;
+    }
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,209 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log_segment.h"
+#include "storage_fake.h"
+#include "test_log_feed.h"
+#include "test_util.h"
+
+/*
+ * Time range queries on the daily log segments (components/logging/
+ * log_segment.c), on the fake SD card.
+ *
+ * A month of samples is written by the writer of the logging task
+ * (log_writer.c): one segment per day, closed blocks appended, the open
+ * block rewritten in place at each sync, the index kept next to each
+ * segment. One day loses its index and one restarts the writer after an
+ * unused block, as after a reboot. Random ranges
+ * must return exactly the samples of a linear scan, in order, and the end
+ * of each day must be its last sample; the bytes read for the last 24 h are
+ * compared with the size of the whole log.
+ *
+ * Usage: test_log_query [days] [period_s]
+ * Build: gcc -O2 -Icomponents/logging -Icomponents/storage \
+ *            -Icomponents/metrics -Icomponents/trace \
+ *            tests/test_log_query.c components/logging/log_codec.c \
+ *            components/logging/log_segment.c components/logging/log_rollup.c \
+ *            components/logging/log_writer.c components/metrics/metrics.c \
+ *            components/storage/storage.c components/storage/storage_posix.c \
+ *            components/storage/storage_fake.c -o test_log_query
+ */
+
+#define T_START 1760000000U
+#define QUERIES 500
+
+static log_sample_t *s_samples;
+static uint32_t s_count;
+
+typedef struct {
+    uint32_t next; /* index in s_samples of the next expected sample */
+    uint32_t got;
+    bool bad;
+} check_t;
+
+static bool check_cb(const log_sample_t *s, void *ctx)
+{
+    check_t *c = ctx;
+    if (c->next >= s_count || memcmp(s, &s_samples[c->next], sizeof(*s))) {
+        c->bad = true;
+        return false;
+    }
+    c->next++;
+    c->got++;
+    return true;
+}
+
+/* Index of the first sample at or after t */
+static uint32_t first_at(uint32_t t)
+{
+    uint32_t lo = 0, hi = s_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2U;
+        if (s_samples[mid].timestamp < t) {
+            lo = mid + 1U;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int check_range(uint32_t t0, uint32_t t1, uint64_t *read)
+{
+    check_t c = {.next = first_at(t0)};
+    uint32_t expected = first_at(t1 + 1U) - c.next;
+    storage_fake_stats_t before, after;
+    storage_fake_get_stats(&before);
+    esp_err_t err = log_query(t0, t1, check_cb, &c);
+    storage_fake_get_stats(&after);
+    if (read) {
+        *read = after.bytes_read - before.bytes_read;
+    }
+    if (err != ESP_OK || c.bad || c.got != expected) {
+        printf("requête [%" PRIu32 ", %" PRIu32 "] : %" PRIu32 " sur %" PRIu32
+               "%s (err %d)\n", t0, t1, c.got, expected,
+               c.bad ? ", désordre" : "", (int)err);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t days = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 30;
+    uint32_t period = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 10;
+    uint32_t span = days * LOG_SEGMENT_S;
+    storage_fake_init(NULL);
+    storage_set_backend(&storage_fake_backend);
+
+    s_samples = malloc(sizeof(*s_samples) * (span / period + 1U));
+    if (!s_samples) {
+        printf("mémoire insuffisante\n");
+        return 1;
+    }
+    uint32_t seed = 7;
+    test_log_feed_t feed = {0};
+    const log_writer_io_t io = test_log_feed_io(&feed);
+    static uint8_t block[4 * LOG_BLOCK_SIZE];
+    static log_bucket_t buckets[64];
+    log_writer_t w;
+    int fails = log_writer_init(&w, &io, sizeof(block), block, buckets, 64) !=
+                ESP_OK;
+    for (uint32_t t = 0; t < span; t += period) {
+        log_sample_t *s = &s_samples[s_count++];
+        s->timestamp = T_START + t;
+        for (int c = 0; c < LOG_VALUES; ++c) {
+            s->values[c] = (int32_t)(50U + (t / 3600U + (uint32_t)c) % 20U +
+                                     (lcg_next(&seed) % 50U == 0U));
+        }
+        feed = (test_log_feed_t){s, 1};
+        bool sync = (t / period) % 6U == 5U;
+        log_writer_flush(&w, sync);
+        if (sync) {
+            log_writer_sync(&w);
+        }
+        if (t == 5U * LOG_SEGMENT_S + 7200U) {
+            /* Reboot right after a sync: the open block stays as synced,
+             * an unused block follows and a new writer goes after it */
+            log_writer_flush(&w, true);
+            log_writer_sync(&w);
+            log_writer_close(&w);
+            storage_file_t *f;
+            uint32_t size = 0;
+            static const uint8_t unused[LOG_BLOCK_SIZE];
+            fails += log_segment_open(log_segment_of(s->timestamp), "bin",
+                                      &f) != ESP_OK;
+            fails += storage_size(f, &size) != ESP_OK;
+            fails += storage_pwrite(f, unused, sizeof(unused), size) != ESP_OK;
+            fails += storage_close(f) != ESP_OK;
+            fails += log_writer_init(&w, &io, sizeof(block), block, buckets,
+                                     64) != ESP_OK;
+        }
+    }
+    log_writer_flush(&w, true);
+    log_writer_sync(&w);
+    log_writer_close(&w);
+    fails += w.stats.write_errors != 0;
+
+    char path[48];
+    log_segment_path(log_segment_of(T_START + 3U * LOG_SEGMENT_S), "idx",
+                     path, sizeof(path));
+    fails += storage_remove(path) != ESP_OK;
+
+    uint64_t total = 0;
+    for (uint32_t seg = log_segment_of(T_START);
+         seg <= log_segment_of(T_START + span); ++seg) {
+        uint32_t size;
+        log_segment_path(seg, "bin", path, sizeof(path));
+        if (storage_stat(path, &size) == ESP_OK) {
+            total += size;
+        }
+    }
+
+    /* Whole log, edges, then random ranges */
+    fails += check_range(T_START, T_START + span, NULL);
+    fails += check_range(T_START + 3U * LOG_SEGMENT_S + 100U,
+                         T_START + 3U * LOG_SEGMENT_S + 200U, NULL);
+    fails += check_range(T_START + span + 10U, T_START + span + 1000U, NULL);
+    for (int q = 0; q < QUERIES && !fails; ++q) {
+        uint32_t t0 = T_START - 1000U + lcg_next(&seed) % (span + 2000U);
+        uint32_t len = lcg_next(&seed) % ((q % 4 == 0) ? 4U * LOG_SEGMENT_S : 3600U);
+        fails += check_range(t0, t0 + len, NULL);
+    }
+    /* End of each day, as the logging task reads it back after a restart;
+     * day 5 ends after its reboot block, the unused one is skipped */
+    for (uint32_t i = 0, d = 0; i < s_count; ++i) {
+        bool end = i + 1U == s_count ||
+                   log_segment_of(s_samples[i + 1U].timestamp) !=
+                       log_segment_of(s_samples[i].timestamp);
+        uint32_t last = 0;
+        if (end && (log_segment_last(log_segment_of(s_samples[i].timestamp),
+                                     &last) != ESP_OK ||
+                    last != s_samples[i].timestamp)) {
+            printf("jour %" PRIu32 " : fin %" PRIu32 " au lieu de %" PRIu32
+                   "\n", d, last, s_samples[i].timestamp);
+            fails++;
+        }
+        d += end;
+    }
+    if (log_segment_last(log_segment_of(T_START) - 1U, &(uint32_t){0}) !=
+        ESP_ERR_NOT_FOUND) {
+        printf("segment absent trouvé\n");
+        fails++;
+    }
+
+    uint64_t last_day = 0;
+    fails += check_range(T_START + span - LOG_SEGMENT_S, T_START + span,
+                         &last_day);
+
+    printf("%" PRIu32 " échantillons sur %" PRIu32 " jours, journal %" PRIu64
+           " o\n", s_count, days, total);
+    printf("dernières 24 h : %" PRIu64 " o lus (%.1f %% du journal)\n",
+           last_day, 100.0 * (double)last_day / (double)total);
+    printf("%s\n", fails ? "FAIL" : "OK");
+    storage_fake_deinit();
+    free(s_samples);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log_ring.h"
+
+/*
+ * Stress test of the lock-free log ring (components/logging/log_ring.c).
+ *
+ * Several producer threads push numbered lines of varying length while the
+ * consumer pops them with random buffer sizes, splitting records across
+ * pops. Every accepted line must come out exactly once, whole, in the order
+ * of its producer; refused lines must match the dropped counter. A small
+ * ring makes the producers wrap and overflow it constantly.
+ *
+ * Usage: test_log_ring [lines per producer]
+ * Build: gcc -O2 -pthread -Icomponents/logging tests/test_log_ring.c \
+ *            components/logging/log_ring.c -o test_log_ring
+ */
+
+#define PRODUCERS 4
+#define RING_SIZE 4096
+#define LINE_MAX_LEN 200
+
+static log_ring_t s_ring;
+static uint32_t s_ring_buf[RING_SIZE / 4];
+static int s_lines = 200000;
+static uint32_t s_accepted[PRODUCERS];
+static uint32_t s_refused[PRODUCERS];
+static atomic_int s_running;
+
+static void *producer(void *arg)
+{
+    int id = (int)(intptr_t)arg;
+    uint32_t seed = 0x9E3779B9U * (uint32_t)(id + 1);
+    char line[LINE_MAX_LEN];
+    for (int seq = 0; seq < s_lines; ++seq) {
+        seed = seed * 1664525U + 1013904223U;
+        int pad = (int)((seed >> 8) % 120U);
+        int len = snprintf(line, sizeof(line), "%d %d %.*s\n", id, seq, pad,
+                           "................................................"
+                           "................................................"
+                           "........................");
+        if (log_ring_push(&s_ring, line, (size_t)len) == ESP_OK) {
+            s_accepted[id]++;
+        } else {
+            s_refused[id]++;
+        }
+        if (seq % 8 == 0) {
+            sched_yield(); /* let the consumer keep up now and then */
+        }
+    }
+    atomic_fetch_sub(&s_running, 1);
+    return NULL;
+}
+
+/* Parse complete lines from the stream; returns false on a bad line */
+static bool check_lines(char *buf, size_t *len, int *next, uint32_t *seen)
+{
+    size_t start = 0;
+    for (size_t i = 0; i < *len; ++i) {
+        if (buf[i] != '\n') {
+            continue;
+        }
+        buf[i] = '\0';
+        int id, seq, dots = 0;
+        if (sscanf(buf + start, "%d %d %n", &id, &seq, &dots) != 2 ||
+            id < 0 || id >= PRODUCERS || seq < next[id]) {
+            printf("ligne invalide: %s\n", buf + start);
+            return false;
+        }
+        for (const char *p = buf + start + dots; *p; ++p) {
+            if (*p != '.') {
+                printf("ligne mélangée: %s\n", buf + start);
+                return false;
+            }
+        }
+        next[id] = seq + 1;
+        seen[id]++;
+        start = i + 1;
+    }
+    memmove(buf, buf + start, *len - start);
+    *len -= start;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        s_lines = atoi(argv[1]);
+    }
+    if (log_ring_init(&s_ring, s_ring_buf, sizeof(s_ring_buf)) != ESP_OK) {
+        printf("init impossible\n");
+        return 1;
+    }
+
+    pthread_t th[PRODUCERS];
+    atomic_store(&s_running, PRODUCERS);
+    for (int i = 0; i < PRODUCERS; ++i) {
+        pthread_create(&th[i], NULL, producer, (void *)(intptr_t)i);
+    }
+
+    static char stream[2 * LINE_MAX_LEN + RING_SIZE];
+    size_t len = 0;
+    int next[PRODUCERS] = {0};
+    uint32_t seen[PRODUCERS] = {0};
+    uint32_t seed = 12345;
+    int fails = 0;
+    for (;;) {
+        bool done = atomic_load(&s_running) == 0;
+        seed = seed * 1664525U + 1013904223U;
+        size_t max = 1 + (seed >> 8) % 300U;
+        size_t n = log_ring_pop(&s_ring, stream + len, max);
+        len += n;
+        if (!check_lines(stream, &len, next, seen)) {
+            fails++;
+            break;
+        }
+        if (done && n == 0) {
+            break; /* producers gone and ring drained */
+        }
+    }
+    for (int i = 0; i < PRODUCERS; ++i) {
+        pthread_join(th[i], NULL);
+    }
+
+    uint32_t accepted = 0, refused = 0;
+    for (int i = 0; i < PRODUCERS; ++i) {
+        if (seen[i] != s_accepted[i]) {
+            printf("producteur %d: %u lues sur %u acceptées\n", i,
+                   (unsigned)seen[i], (unsigned)s_accepted[i]);
+            fails++;
+        }
+        accepted += s_accepted[i];
+        refused += s_refused[i];
+    }
+    if (len || log_ring_used(&s_ring)) {
+        printf("reste %zu octets, anneau %u\n", len,
+               (unsigned)log_ring_used(&s_ring));
+        fails++;
+    }
+    if (atomic_load(&s_ring.dropped) != refused ||
+        atomic_load(&s_ring.records) != accepted) {
+        printf("compteurs %u/%u, attendu %u/%u\n",
+               (unsigned)atomic_load(&s_ring.records),
+               (unsigned)atomic_load(&s_ring.dropped), (unsigned)accepted,
+               (unsigned)refused);
+        fails++;
+    }
+    printf("%u acceptées, %u refusées, pic %u/%u o\n", (unsigned)accepted,
+           (unsigned)refused, (unsigned)atomic_load(&s_ring.peak),
+           (unsigned)s_ring.size);
+    printf("%s\n", fails ? "FAIL" : "OK");
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,225 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "log_rollup.h"
+#include "log_segment.h"
+#include "storage_fake.h"
+#include "test_log_feed.h"
+#include "test_util.h"
+
+/*
+ * Minute, hour and day rollups (components/logging/log_rollup.c) on the
+ * fake SD card.
+ *
+ * Samples with irregular gaps over a year boundary go through the writer of
+ * the logging task (log_writer.c), which stores the closed buckets and
+ * rewrites the open ones in place at each sync; halfway, the writer restarts
+ * from the card as after a reboot. Every stored bucket must match min, max,
+ * count and mean (to the tenth) recomputed from the raw samples. A record of
+ * the version 1 layout must read as an empty slot. The time per sample
+ * written and the cost of reading a year of days are printed.
+ *
+ * Usage: test_log_rollup [days]
+ * Build: gcc -O2 -Icomponents/logging -Icomponents/storage \
+ *            -Icomponents/metrics -Icomponents/trace \
+ *            tests/test_log_rollup.c components/logging/log_codec.c \
+ *            components/logging/log_segment.c components/logging/log_rollup.c \
+ *            components/logging/log_writer.c components/metrics/metrics.c \
+ *            components/storage/storage.c components/storage/storage_posix.c \
+ *            components/storage/storage_fake.c -o test_log_rollup
+ */
+
+#define T_START 1766880000U /* 28 December 2025, 00:00 UTC */
+#define SYNC_EVERY 97
+#define BLOCK_SIZE (8U * LOG_BLOCK_SIZE)
+#define MAX_BUCKETS 64
+
+static const log_column_t k_column[LOG_ROLLUP_FIELDS] = {
+    LOG_COL_TEMPERATURE, LOG_COL_HUMIDITE, LOG_COL_FAIM, LOG_COL_EAU,
+    LOG_COL_HUMEUR,
+};
+
+static log_sample_t *s_samples;
+static uint32_t s_count;
+
+/* Compare a stored bucket with the raw samples it covers */
+static int check_bucket(const log_bucket_t *b)
+{
+    uint32_t end = b->start + log_rollup_span((log_rollup_level_t)b->level);
+    uint32_t count = 0;
+    int32_t min[LOG_ROLLUP_FIELDS], max[LOG_ROLLUP_FIELDS];
+    int64_t sum[LOG_ROLLUP_FIELDS] = {0};
+    uint32_t lo = 0, hi = s_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2U;
+        if (s_samples[mid].timestamp < b->start) {
+            lo = mid + 1U;
+        } else {
+            hi = mid;
+        }
+    }
+    for (uint32_t i = lo; i < s_count && s_samples[i].timestamp < end; ++i) {
+        const log_sample_t *s = &s_samples[i];
+        for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+            int32_t v = s->values[k_column[f]];
+            min[f] = (count == 0 || v < min[f]) ? v : min[f];
+            max[f] = (count == 0 || v > max[f]) ? v : max[f];
+            sum[f] += v;
+        }
+        count++;
+    }
+    if (count != b->count) {
+        printf("niveau %u, %" PRIu32 " : %" PRIu32 " échantillons au lieu de %"
+               PRIu32 "\n", b->level, b->start, b->count, count);
+        return 1;
+    }
+    for (int f = 0; f < LOG_ROLLUP_FIELDS; ++f) {
+        int64_t tenths = sum[f] * 10 / count;
+        int64_t got = b->sum[f] * 10 / count;
+        if (b->min[f] != min[f] || b->max[f] != max[f] ||
+            llabs(got - tenths) > 1) {
+            printf("niveau %u, %" PRIu32 ", champ %d : %" PRId32 "/%" PRId32
+                   "/%" PRId64 " au lieu de %" PRId32 "/%" PRId32 "/%" PRId64
+                   "\n", b->level, b->start, f, b->min[f], b->max[f], got,
+                   min[f], max[f], tenths);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* A version 1 record (i16 min/max, no tag) is not read back */
+static int check_old_layout(void)
+{
+    const uint32_t start = 1577836800U; /* 1 January 2020 */
+    uint8_t rec[LOG_ROLLUP_RECORD_SIZE] = {0};
+    rec[0] = (uint8_t)start;
+    rec[1] = (uint8_t)(start >> 8);
+    rec[2] = (uint8_t)(start >> 16);
+    rec[3] = (uint8_t)(start >> 24);
+    rec[4] = 10; /* count */
+    for (int f = 0; f < 4; ++f) {
+        rec[8 + 6 * f] = 20;      /* min */
+        rec[8 + 6 * f + 2] = 40;  /* max */
+        rec[8 + 6 * f + 4] = 44;  /* mean, 30.0 */
+        rec[8 + 6 * f + 5] = 1;
+    }
+    char path[48];
+    snprintf(path, sizeof(path), "%s/2020.day", LOG_SEGMENT_DIR);
+    storage_file_t *f;
+    log_bucket_t b;
+    if (storage_mkdir(LOG_SEGMENT_DIR) != ESP_OK ||
+        storage_open(path, STORAGE_CREATE, &f) != ESP_OK) {
+        return 1;
+    }
+    int fails = storage_pwrite(f, rec, sizeof(rec), 0) != ESP_OK;
+    fails += storage_close(f) != ESP_OK;
+    if (log_rollup_load(LOG_ROLLUP_DAY, start, &b) != ESP_ERR_NOT_FOUND) {
+        printf("enregistrement de version 1 relu\n");
+        fails++;
+    }
+    return fails;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t days = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 8;
+    uint32_t span = days * 86400U;
+    storage_fake_init(NULL);
+    storage_set_backend(&storage_fake_backend);
+    /* Every minute of the span, and of the day before it */
+    size_t max_read = (days + 1U) * 1440U;
+    s_samples = malloc(sizeof(*s_samples) * span);
+    log_bucket_t *buckets = malloc(sizeof(*buckets) * max_read);
+    if (!s_samples || !buckets) {
+        printf("mémoire insuffisante\n");
+        return 1;
+    }
+
+    uint32_t seed = 3;
+    for (uint32_t t = T_START; t < T_START + span;) {
+        log_sample_t *s = &s_samples[s_count++];
+        s->timestamp = t;
+        for (int c = 0; c < LOG_VALUES; ++c) {
+            s->values[c] = (int32_t)((t / 600U + (uint32_t)c * 7U) % 60U) +
+                           (int32_t)(lcg_next(&seed) % 5U) - 2;
+        }
+        /* Mostly 1 Hz, with gaps up to two hours */
+        uint32_t k = lcg_next(&seed) % 10000U;
+        t += (k < 9990U) ? 1U + k % 3U : 60U * (k % 120U);
+    }
+
+    static uint8_t block[BLOCK_SIZE];
+    static log_bucket_t queue[MAX_BUCKETS];
+    static log_writer_t w;
+    test_log_feed_t feed = {0};
+    const log_writer_io_t io = test_log_feed_io(&feed);
+    int fails = log_writer_init(&w, &io, BLOCK_SIZE, block, queue,
+                                MAX_BUCKETS) != ESP_OK;
+    double add_s = 0.0;
+    for (uint32_t i = 0; i < s_count && !fails; i += SYNC_EVERY) {
+        feed = (test_log_feed_t){&s_samples[i], s_count - i};
+        if (feed.n > SYNC_EVERY) {
+            feed.n = SYNC_EVERY;
+        }
+        double t0 = now_s();
+        log_writer_flush(&w, true);
+        log_writer_sync(&w);
+        add_s += now_s() - t0;
+        fails += feed.n != 0 || log_writer_pending(&w);
+        if (i < s_count / 2U && i + SYNC_EVERY >= s_count / 2U) {
+            /* Reboot right after a sync: continue the stored buckets */
+            log_writer_close(&w);
+            fails += log_writer_init(&w, &io, BLOCK_SIZE, block, queue,
+                                     MAX_BUCKETS) != ESP_OK;
+        }
+    }
+    log_writer_close(&w);
+    fails += w.stats.write_errors != 0 || w.stats.out_of_order != 0;
+
+    for (int l = 0; l < LOG_ROLLUP_LEVELS && !fails; ++l) {
+        size_t n = 0;
+        uint32_t total = 0;
+        if (log_rollup_read((log_rollup_level_t)l, T_START - 86400U,
+                            T_START + span, buckets, max_read, &n) != ESP_OK) {
+            fails++;
+            break;
+        }
+        for (size_t i = 0; i < n && !fails; ++i) {
+            fails += check_bucket(&buckets[i]);
+            fails += (i && buckets[i].start <= buckets[i - 1].start);
+            total += buckets[i].count;
+        }
+        if (total != s_count) {
+            printf("niveau %d : %" PRIu32 " échantillons sur %" PRIu32 "\n", l,
+                   total, s_count);
+            fails++;
+        }
+        printf("niveau %d : %zu seaux\n", l, n);
+    }
+
+    storage_fake_stats_t before, after;
+    storage_fake_get_stats(&before);
+    size_t n = 0;
+    double t0 = now_s();
+    fails += log_rollup_read(LOG_ROLLUP_DAY, T_START + span - 365U * 86400U,
+                             T_START + span, buckets, 366, &n) != ESP_OK;
+    double read_s = now_s() - t0;
+    storage_fake_get_stats(&after);
+    fails += check_old_layout();
+
+    printf("%" PRIu32 " échantillons, %.0f ns/échantillon écrit\n", s_count,
+           add_s * 1e9 / s_count);
+    printf("une année de jours : %zu seaux, %" PRIu64 " o lus, %.0f us "
+           "(carte simulée %" PRIu64 " us)\n", n,
+           after.bytes_read - before.bytes_read, read_s * 1e6,
+           after.busy_us - before.busy_us);
+    printf("%s\n", fails ? "FAIL" : "OK");
+    storage_fake_deinit();
+    free(buckets);
+    free(s_samples);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "metrics.h"
+#include "test_util.h"
+
+/*
+ * Metrics registry (components/metrics/metrics.c) on the host.
+ *
+ * Checks the log-linear buckets over all of uint32_t, then has several
+ * threads update the same counters, gauge and histogram at once: no update
+ * may be lost. The binary snapshot is parsed back and must match the
+ * registry, the text snapshot must hold one line per metric, and too small
+ * buffers must be refused with the size needed. The cost of an update is
+ * printed.
+ *
+ * Usage: test_metrics [updates per thread]
+ * Build: gcc -O2 -pthread -Icomponents/metrics tests/test_metrics.c \
+ *            components/metrics/metrics.c -o test_metrics
+ */
+
+#define THREADS 4
+#define METRICS_TOTAL (METRIC_COUNTERS + METRIC_GAUGES + METRIC_HISTOGRAMS)
+
+static int s_updates = 200000;
+
+static int check_buckets(void)
+{
+    int fails = 0;
+    unsigned prev = 0;
+    /* Every value up to 2^16, then a sweep of the rest */
+    for (uint64_t v = 0; v <= UINT32_MAX; v += (v < 65536) ? 1 : v / 97 + 1) {
+        unsigned b = metrics_bucket((uint32_t)v);
+        uint32_t low = metrics_bucket_low(b);
+        uint64_t next = (b + 1U < METRICS_BUCKETS)
+                            ? metrics_bucket_low(b + 1U)
+                            : (uint64_t)UINT32_MAX + 1U;
+        if (b >= METRICS_BUCKETS || b < prev || v < low || v >= next ||
+            (low >= 4 && next - low > low / 4)) {
+            printf("seau %u pour %" PRIu64 " : [%" PRIu32 ", %" PRIu64 ")\n", b,
+                   v, low, next);
+            if (++fails > 5) {
+                break;
+            }
+        }
+        prev = b;
+    }
+    fails += metrics_bucket(UINT32_MAX) != METRICS_BUCKETS - 1;
+    return fails;
+}
+
+static void *worker(void *arg)
+{
+    uint32_t seed = (uint32_t)(uintptr_t)arg;
+    for (int i = 0; i < s_updates; ++i) {
+        seed = seed * 1664525U + 1013904223U;
+        metrics_inc(METRIC_CAN_TX);
+        metrics_add(METRIC_PUMP_ON_MS, 3);
+        metrics_set(METRIC_SD_STATE, (int32_t)(seed >> 30));
+        metrics_record(METRIC_LOG_WRITE_US, seed >> 12);
+    }
+    return NULL;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Parse a binary snapshot and compare it to the registry */
+static int check_binary(const uint8_t *p, size_t len)
+{
+    const uint8_t *end = p + len;
+    if (len < 16 || memcmp(p, "MTRC", 4) || p[4] != 1 ||
+        p[6] != METRICS_SUB_BITS) {
+        printf("en-tête binaire invalide\n");
+        return 1;
+    }
+    int n = p[8] | (p[9] << 8);
+    p += 16;
+    int counters = 0, gauges = 0, hists = 0;
+    for (int m = 0; m < n; ++m) {
+        if (p + 2 > end || p + 2 + p[1] + 4 > end) {
+            printf("métrique %d tronquée\n", m);
+            return 1;
+        }
+        int kind = p[0];
+        char name[64];
+        memcpy(name, p + 2, p[1]);
+        name[p[1]] = '\0';
+        p += 2 + p[1];
+        if (kind == 0) {
+            if (get_u32(p) != metrics_counter((metric_counter_t)counters++)) {
+                printf("compteur %s différent\n", name);
+                return 1;
+            }
+            p += 4;
+        } else if (kind == 1) {
+            if ((int32_t)get_u32(p) != metrics_gauge((metric_gauge_t)gauges++)) {
+                printf("jauge %s différente\n", name);
+                return 1;
+            }
+            p += 4;
+        } else {
+            metrics_histogram_t h;
+            metrics_histogram((metric_histogram_t)hists++, &h);
+            uint32_t max = get_u32(p);
+            int used = p[4];
+            p += 5;
+            uint32_t count = 0;
+            for (int k = 0; k < used && p + 5 <= end; ++k, p += 5) {
+                if (h.buckets[p[0]] != get_u32(p + 1)) {
+                    printf("histogramme %s, seau %u différent\n", name, p[0]);
+                    return 1;
+                }
+                count += get_u32(p + 1);
+            }
+            if (max != h.max || count != h.count) {
+                printf("histogramme %s différent\n", name);
+                return 1;
+            }
+        }
+    }
+    if (p != end || counters != METRIC_COUNTERS || gauges != METRIC_GAUGES ||
+        hists != METRIC_HISTOGRAMS) {
+        printf("snapshot binaire incohérent\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    s_updates = (argc > 1) ? atoi(argv[1]) : s_updates;
+    int fails = check_buckets();
+
+    pthread_t threads[THREADS];
+    double t0 = now_s();
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_create(&threads[i], NULL, worker, (void *)(uintptr_t)(i + 1));
+    }
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    double update_s = (now_s() - t0) / (4.0 * THREADS * s_updates);
+
+    uint32_t total = (uint32_t)THREADS * (uint32_t)s_updates;
+    metrics_histogram_t h;
+    metrics_histogram(METRIC_LOG_WRITE_US, &h);
+    if (metrics_counter(METRIC_CAN_TX) != total ||
+        metrics_counter(METRIC_PUMP_ON_MS) != 3 * total || h.count != total) {
+        printf("mises à jour perdues : %" PRIu32 " %" PRIu32 " %" PRIu32
+               " au lieu de %" PRIu32 "\n",
+               metrics_counter(METRIC_CAN_TX), metrics_counter(METRIC_PUMP_ON_MS),
+               h.count, total);
+        fails++;
+    }
+    /* Uniform values below 2^20: the median near 2^19 within a bucket */
+    uint32_t p50 = metrics_quantile(&h, 0.5f);
+    if (h.max >= (1U << 20) || p50 < (1U << 19) * 3 / 4 ||
+        p50 > (1U << 19) * 5 / 4 || metrics_quantile(&h, 1.0f) != h.max) {
+        printf("quantiles : p50 %" PRIu32 " max %" PRIu32 "\n", p50, h.max);
+        fails++;
+    }
+
+    size_t need = 0;
+    fails += metrics_export_binary(NULL, 0, &need) != ESP_ERR_INVALID_SIZE;
+    uint8_t *bin = malloc(need);
+    size_t len = 0;
+    fails += metrics_export_binary(bin, need, &len) != ESP_OK || len != need;
+    fails += check_binary(bin, len);
+    size_t bin_len = len;
+
+    char small[16];
+    fails += metrics_export_text(small, sizeof(small), &need) !=
+             ESP_ERR_INVALID_SIZE || small[0] != '\0';
+    char *text = malloc(need + 1);
+    fails += metrics_export_text(text, need + 1, &len) != ESP_OK || len != need;
+    int lines = 0;
+    for (const char *c = text; *c; ++c) {
+        lines += *c == '\n';
+    }
+    char expect[64];
+    snprintf(expect, sizeof(expect), "can_tx counter %" PRIu32 "\n", total);
+    if (lines != METRICS_TOTAL || !strstr(text, expect) ||
+        !strstr(text, "log_write_us histogram count=")) {
+        printf("snapshot texte :\n%s", text);
+        fails++;
+    }
+
+    metrics_reset();
+    metrics_histogram(METRIC_LOG_WRITE_US, &h);
+    fails += metrics_counter(METRIC_CAN_TX) != 0 || h.count != 0 || h.max != 0;
+
+    printf("%s", text);
+    printf("snapshot : %zu o binaire, %zu o texte\n", bin_len, len);
+    printf("mise à jour : %.1f ns sur %d threads\n", update_s * 1e9, THREADS);
+    printf("%s\n", fails ? "FAIL" : "OK");
+    free(bin);
+    free(text);
+    return fails ? 1 : 0;
+}
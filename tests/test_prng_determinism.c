@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "game_mode.h"
+#include "prng.h"
+#include "reptile_logic.h"
+#include "sensors.h"
+
+#define TRAJ_STEPS 100000U
+
+/* FNV-1a over every value of the trajectory */
+static uint32_t fnv1a(uint32_t h, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) {
+        h ^= (v >> (8 * i)) & 0xFFU;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static uint32_t run_trajectory(uint32_t seed)
+{
+    reptile_t r;
+    reptile_init(&r, true);
+    r.last_update = 0;
+    reptile_set_seed(&r, seed);
+
+    uint32_t h = 2166136261U;
+    for (uint32_t i = 0; i < TRAJ_STEPS; ++i) {
+        if ((i % 50U) == 0) {
+            r.faim_q = r.eau_q = r.humeur_q = 100 * REPTILE_Q_ONE;
+        }
+        reptile_update(&r, 1000);
+        reptile_check_events(&r);
+        float t = sensors_read_temperature();
+        float hu = sensors_read_humidity();
+        h = fnv1a(h, r.faim);
+        h = fnv1a(h, r.temperature);
+        h = fnv1a(h, r.humidite);
+        h = fnv1a(h, (uint32_t)r.event);
+        h = fnv1a(h, (uint32_t)(t * 10.0f));
+        h = fnv1a(h, (uint32_t)(hu * 10.0f));
+    }
+    return h;
+}
+
+int main(void)
+{
+    game_mode_set(GAME_MODE_SIMULATION);
+    sensors_init();
+
+    uint32_t a = run_trajectory(0xC0FFEEU);
+    uint32_t b = run_trajectory(0xC0FFEEU);
+    uint32_t c = run_trajectory(0xBADF00DU);
+
+    printf("seed 0xC0FFEE : %08" PRIx32 " / %08" PRIx32 "\n", a, b);
+    printf("seed 0xBADF00D: %08" PRIx32 "\n", c);
+    if (a != b) {
+        printf("FAIL: trajectoires differentes pour une meme graine\n");
+        return 1;
+    }
+    if (a == c) {
+        printf("FAIL: graines differentes, trajectoires identiques\n");
+        return 1;
+    }
+    printf("OK\n");
+    sensors_deinit();
+    return 0;
+}
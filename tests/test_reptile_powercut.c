@@ -0,0 +1,195 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game_mode.h"
+#include "reptile_journal.h"
+#include "reptile_logic.h"
+#include "sensors.h"
+#include "storage_fake.h"
+#include "test_util.h"
+
+/*
+ * Power-cut test of the save files (reptile_journal.c).
+ *
+ * The files live on the fake SD card (storage_fake.c), which lets a random
+ * number of bytes reach the card, then tears that write and fails every
+ * later call, like a power cut in the middle of a save, compaction or
+ * migration. After power-on the files are reloaded
+ * as at boot: the state must be the last completed save or the interrupted
+ * one, never a mix of both, and saving must resume normally afterwards.
+ * Trials start from no file, a headerless file of the current layout or a
+ * layout 1 file.
+ *
+ * Usage: test_reptile_powercut [trials]
+ * Build: same sources as tests/bench_reptile_batch.c (README)
+ */
+
+#define SNAP_PATH "reptile_powercut.bin"
+#define JNL_PATH "reptile_powercut.jnl"
+#define SAVES_PER_TRIAL 300
+#define BUDGET_MAX 90000U /* about the bytes written by one trial */
+
+/* Copy of layout 1 (see reptile_journal.c), to write old files */
+typedef struct {
+    uint32_t faim, eau, temperature, humidite, humeur;
+    reptile_event_t event;
+    time_t last_update;
+    uint16_t clock_ms;
+    uint32_t faim_q, eau_q, humeur_q, seed;
+    reptile_species_t species;
+    struct {
+        uint64_t active, pending;
+        uint32_t since[11];
+    } rules;
+} state_v1_t;
+
+static void write_raw(const void *data, size_t len)
+{
+    storage_file_t *f;
+    if (storage_open(SNAP_PATH, STORAGE_CREATE, &f) == ESP_OK) {
+        storage_append(f, data, len);
+        storage_close(f);
+    }
+}
+
+/* Advance the game by one second, with an action now and then */
+static void step(reptile_t *r, uint32_t *seed)
+{
+    const reptile_env_t env = {.temperature = 28, .humidite = 55};
+    reptile_update_with_env(r, 1000, &env);
+    switch (lcg_next(seed) % 16U) {
+    case 0:
+        reptile_feed(r);
+        break;
+    case 1:
+        reptile_give_water(r);
+        break;
+    case 2:
+        reptile_soothe(r);
+        break;
+    default:
+        break;
+    }
+}
+
+static bool load(reptile_t *out)
+{
+    reptile_journal_close();
+    return reptile_journal_load(SNAP_PATH, JNL_PATH, out) == ESP_OK;
+}
+
+/* One trial; returns 1 on failure, sets *cut when the power was cut */
+static int trial(uint32_t seed, int *cut)
+{
+    reptile_journal_close();
+    storage_fake_init(NULL);
+
+    reptile_t r, committed, inflight;
+    reptile_init(&r, true);
+    reptile_set_seed(&r, seed);
+    r.last_update = 1000;
+    bool has_committed = false;
+
+    switch (seed % 3U) {
+    case 1:
+        write_raw(&r, sizeof(r));
+        break;
+    case 2: {
+        state_v1_t v1;
+        memset(&v1, 0, sizeof(v1));
+        v1.faim = v1.eau = v1.humeur = 60;
+        v1.faim_q = v1.eau_q = v1.humeur_q = 60U * REPTILE_Q_ONE;
+        v1.last_update = 1000;
+        v1.seed = seed;
+        v1.species = REPTILE_SPECIES_GECKO;
+        write_raw(&v1, sizeof(v1));
+        break;
+    }
+    default:
+        break;
+    }
+    if (seed % 3U) {
+        if (!load(&r)) {
+            printf("seed %u: ancien format illisible\n", (unsigned)seed);
+            return 1;
+        }
+        committed = r;
+        has_committed = true;
+    }
+
+    uint32_t rng = seed;
+    storage_fake_cut_after(lcg_next(&rng) % BUDGET_MAX);
+    for (int i = 0; i < SAVES_PER_TRIAL && !storage_fake_is_cut(); ++i) {
+        step(&r, &rng);
+        inflight = r;
+        esp_err_t err = reptile_journal_save(SNAP_PATH, JNL_PATH, &r);
+        if (err == ESP_OK && !storage_fake_is_cut()) {
+            committed = r;
+            has_committed = true;
+        } else if (!storage_fake_is_cut()) {
+            printf("seed %u: sauvegarde %d échouée sans coupure\n",
+                   (unsigned)seed, i);
+            return 1;
+        }
+    }
+    *cut = storage_fake_is_cut();
+
+    /* Boot after the cut */
+    storage_fake_power_on();
+    reptile_t l;
+    bool ok = load(&l);
+    bool same = ok && ((has_committed &&
+                        memcmp(&l, &committed, sizeof(l)) == 0) ||
+                       (*cut && memcmp(&l, &inflight, sizeof(l)) == 0));
+    if (!same && !(!ok && !has_committed)) {
+        printf("seed %u: état rechargé incohérent (chargé=%d)\n",
+               (unsigned)seed, ok);
+        return 1;
+    }
+
+    /* Saving resumes from whatever survived */
+    if (!ok) {
+        l = r;
+    }
+    for (int i = 0; i < 40; ++i) {
+        step(&l, &rng);
+        if (reptile_journal_save(SNAP_PATH, JNL_PATH, &l) != ESP_OK) {
+            printf("seed %u: reprise impossible\n", (unsigned)seed);
+            return 1;
+        }
+    }
+    reptile_t again;
+    if (!load(&again) || memcmp(&again, &l, sizeof(l)) != 0) {
+        printf("seed %u: reprise perdue\n", (unsigned)seed);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int trials = (argc > 1) ? atoi(argv[1]) : 600;
+    game_mode_set(GAME_MODE_SIMULATION);
+    sensors_init();
+    storage_set_backend(&storage_fake_backend);
+    reptile_set_save_fn(NULL);
+    /* Compact every 30 s of game time so cuts also land in snapshots */
+    reptile_journal_set_compact_period(30);
+
+    int fails = 0, cuts = 0;
+    for (int t = 0; t < trials; ++t) {
+        int cut = 0;
+        fails += trial((uint32_t)t, &cut);
+        cuts += cut;
+    }
+    reptile_journal_stats_t st;
+    reptile_journal_get_stats(&st);
+    printf("%d essais, %d coupures, %u compactions, %d échecs\n", trials, cuts,
+           (unsigned)st.compactions, fails);
+    printf("%s\n", fails ? "FAIL" : "OK");
+    reptile_journal_close();
+    storage_fake_deinit();
+    sensors_deinit();
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Host test of the lifecycle timer wheel (reptile_wheel.c).
+ *
+ * Periodic timers from 1 s to a year, some beyond the wheel span, are
+ * advanced in random steps: every timer must fire at its expiry, in time
+ * order, the expected number of times, and next_expiry must predict the
+ * firings. Timers reschedule themselves from the callback like the
+ * lifecycle does. Setting the clock back a year must keep the time left on
+ * every timer.
+ *
+ * Build: gcc -O2 -Icomponents/reptile_logic tests/test_reptile_wheel.c \
+ *        components/reptile_logic/reptile_wheel.c
+ */
+#include "reptile_wheel.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    reptile_wheel_t *w;
+    uint32_t clock;      /* advance target, the callback must not exceed it */
+    uint32_t last;       /* expiry of the previous firing */
+    uint32_t fired;
+    uint32_t errors;
+    uint32_t period[REPTILE_WHEEL_POOL];
+} ctx_t;
+
+static uint32_t rng = 12345U;
+
+static uint32_t next_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static void on_timer(void *p, uint8_t kind, uint16_t arg, uint32_t expires)
+{
+    ctx_t *c = p;
+    (void)arg;
+    if (expires < c->last || expires > c->clock) {
+        printf("FAIL: timer %u a %" PRIu32 " (precedent %" PRIu32
+               ", horloge %" PRIu32 ")\n",
+               kind, expires, c->last, c->clock);
+        c->errors++;
+    }
+    c->last = expires;
+    c->fired++;
+    if (reptile_wheel_schedule(c->w, expires + c->period[kind], kind, 0) !=
+        ESP_OK) {
+        printf("FAIL: replanification impossible\n");
+        c->errors++;
+    }
+}
+
+/* Periodic timers, one per kind, checked by counting firings per period */
+static int run(uint32_t start, uint32_t duration, uint32_t max_step)
+{
+    static reptile_wheel_t w;
+    ctx_t c;
+    memset(&c, 0, sizeof(c));
+    c.w = &w;
+    c.last = start;
+    reptile_wheel_init(&w, start);
+
+    uint64_t expected = 0;
+    for (uint8_t k = 0; k < REPTILE_WHEEL_POOL; ++k) {
+        /* From seconds up to a year, past the 2^24 s span of the wheel */
+        static const uint32_t periods[] = { 1, 7, 63, 64, 65, 4095, 4097,
+                                            86400, 262143, 262144, 3600,
+                                            2592000, 16777215, 16777216,
+                                            31536000, 5 };
+        c.period[k] = periods[k];
+        reptile_wheel_schedule(&w, start + periods[k], k, 0);
+        expected += duration / periods[k];
+    }
+
+    uint32_t t = start;
+    while (t - start < duration) {
+        uint32_t step = 1U + next_rand() % max_step;
+        if (duration - (t - start) < step) {
+            step = duration - (t - start);
+        }
+        t += step;
+        c.clock = t;
+        uint32_t next = reptile_wheel_next_expiry(&w);
+        uint32_t before = c.fired;
+        reptile_wheel_advance(&w, t, on_timer, &c);
+        if (c.fired != before && next > t) {
+            printf("FAIL: prochaine echeance %" PRIu32 " apres %" PRIu32 "\n",
+                   next, t);
+            c.errors++;
+        }
+        if (c.fired == before && next <= t) {
+            printf("FAIL: echeance %" PRIu32 " manquee\n", next);
+            c.errors++;
+        }
+    }
+    if (c.fired != expected || w.count != REPTILE_WHEEL_POOL) {
+        printf("FAIL: %" PRIu32 " declenchements, %" PRIu64 " attendus\n",
+               c.fired, expected);
+        c.errors++;
+    }
+    printf("debut %" PRIu32 " duree %" PRIu32 " s pas <= %" PRIu32
+           " s : %" PRIu32 " declenchements\n",
+           start, duration, max_step, c.fired);
+    return c.errors != 0;
+}
+
+static int check_cancel(void)
+{
+    static reptile_wheel_t w;
+    reptile_wheel_init(&w, 1000);
+    reptile_wheel_schedule(&w, 1010, 1, 0);
+    reptile_wheel_schedule(&w, 1000 + 86400, 2, 0);
+    reptile_wheel_schedule(&w, 1020, 1, 0);
+    reptile_wheel_schedule(&w, 500, 3, 0); /* already past: next second */
+    if (reptile_wheel_cancel(&w, 1) != 2 || w.count != 2 ||
+        reptile_wheel_next_expiry(&w) != 1001) {
+        printf("FAIL: annulation\n");
+        return 1;
+    }
+    for (int i = 0; i < REPTILE_WHEEL_POOL; ++i) {
+        reptile_wheel_schedule(&w, 2000, 4, 0);
+    }
+    if (w.count != REPTILE_WHEEL_POOL ||
+        reptile_wheel_schedule(&w, 2000, 4, 0) != ESP_ERR_NO_MEM) {
+        printf("FAIL: reserve pleine\n");
+        return 1;
+    }
+    return 0;
+}
+
+typedef struct {
+    uint32_t fired;
+    uint32_t expires[REPTILE_WHEEL_POOL];
+} rebase_ctx_t;
+
+static void on_rebased(void *p, uint8_t kind, uint16_t arg, uint32_t expires)
+{
+    rebase_ctx_t *c = p;
+    (void)arg;
+    c->expires[kind] = expires;
+    c->fired++;
+}
+
+/* Clock set back: nothing fires, then each timer after the time it had left */
+static int check_rebase(void)
+{
+    static reptile_wheel_t w;
+    static const uint32_t left[] = {10, 5000, 30U * 86400U, 1U << 25};
+    const uint32_t n = sizeof(left) / sizeof(left[0]);
+    const uint32_t start = 1700000000U, back = start - 365U * 86400U;
+    rebase_ctx_t c;
+    memset(&c, 0, sizeof(c));
+    reptile_wheel_init(&w, start - 100U);
+    for (uint8_t k = 0; k < n; ++k) {
+        reptile_wheel_schedule(&w, start + left[k], k, 0);
+    }
+    reptile_wheel_advance(&w, start, on_rebased, &c);
+    reptile_wheel_rebase(&w, back);
+    if (c.fired || w.count != n || reptile_wheel_next_expiry(&w) != back + 10U) {
+        printf("FAIL: recalage, prochaine echeance %" PRIu32 "\n",
+               reptile_wheel_next_expiry(&w));
+        return 1;
+    }
+    reptile_wheel_advance(&w, back + 9U, on_rebased, &c);
+    int fail = c.fired != 0;
+    reptile_wheel_advance(&w, back + (1U << 25), on_rebased, &c);
+    fail |= c.fired != n;
+    for (uint8_t k = 0; k < n; ++k) {
+        if (c.expires[k] != back + left[k]) {
+            printf("FAIL: minuterie %u recalee a %" PRIu32 " au lieu de %" PRIu32
+                   "\n", k, c.expires[k], back + left[k]);
+            fail = 1;
+        }
+    }
+    return fail;
+}
+
+int main(void)
+{
+    int fail = 0;
+    fail |= check_cancel();
+    fail |= check_rebase();
+    fail |= run(1700000000U, 3U * 86400U, 10U);
+    fail |= run(1700000000U, 400U * 86400U, 3600U);
+    fail |= run(1700000000U, 2U * 31536000U, 40U * 86400U);
+    fail |= run((1U << 24) - 5U, 30U * 86400U, 7200U); /* top level wraps */
+    printf("%s\n", fail ? "ECHEC" : "OK");
+    return fail;
+}
@@ -0,0 +1,234 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "storage_fake.h"
+#include "storage_supervisor.h"
+
+/*
+ * Hot removal of the SD card under the storage supervisor.
+ *
+ * Log lines are written straight to the fake backend, as reptile_persist
+ * does, while the card is pulled out (every call fails, mounts fail) and put
+ * back. A failed write is reported to the supervisor, which must find the
+ * card gone, make bounded waits time out, and remount it with a new epoch
+ * once it is back; reporting must never wait on the card. Every line written
+ * while the card answered must be in the file exactly once and in order. A
+ * suspend and resume, as around light sleep, ends the run.
+ *
+ * Usage: test_storage_supervisor
+ * Build: same sources as tests/bench_reptile_batch.c (README) plus
+ *        components/storage/storage_supervisor.c,
+ *        components/metrics/metrics.c and the FreeRTOS host shim
+ *        tests/host/freertos_shim.c, with -pthread -Itests/host
+ *        -Icomponents/metrics
+ */
+
+#define LOG_PATH "/sdcard/test_log.csv"
+#define MAX_LINES 1000
+
+static volatile bool s_card_in = true;
+static int s_accepted[MAX_LINES];
+static int s_accepted_n;
+static int s_refused;
+static double s_max_report_ms;
+
+static esp_err_t fake_mount(void)
+{
+    return s_card_in ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t fake_unmount(void)
+{
+    return ESP_OK;
+}
+
+static esp_err_t fake_probe(void)
+{
+    return s_card_in ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+static void card_set(bool in)
+{
+    s_card_in = in;
+    storage_fake_set_fail_rate(in ? 0 : 1000000U, 1);
+}
+
+static esp_err_t log_write(const void *data, size_t len)
+{
+    storage_file_t *f;
+    if (storage_open(LOG_PATH, STORAGE_APPEND, &f) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    esp_err_t err = storage_append(f, data, len);
+    if (storage_close(f) != ESP_OK) {
+        err = ESP_FAIL;
+    }
+    return err;
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/* One line, skipped while the card is not ready, reported when it fails */
+static void submit(int id)
+{
+    if (!storage_supervisor_card_ready()) {
+        s_refused++;
+        return;
+    }
+    char line[32];
+    int len = snprintf(line, sizeof(line), "ligne %d\n", id);
+    if (log_write(line, (size_t)len) == ESP_OK) {
+        s_accepted[s_accepted_n++] = id;
+        return;
+    }
+    s_refused++;
+    double t0 = now_ms();
+    storage_supervisor_report_error();
+    double ms = now_ms() - t0;
+    if (ms > s_max_report_ms) {
+        s_max_report_ms = ms;
+    }
+}
+
+static bool check_file(void)
+{
+    storage_fake_set_fail_rate(0, 0);
+    storage_file_t *f;
+    uint32_t size = 0;
+    if (storage_open(LOG_PATH, STORAGE_READ, &f) != ESP_OK ||
+        storage_size(f, &size) != ESP_OK) {
+        printf("journal illisible\n");
+        return false;
+    }
+    char *buf = malloc(size + 1U);
+    bool ok = buf && storage_pread(f, buf, size, 0, NULL) == ESP_OK;
+    storage_close(f);
+    if (!ok) {
+        free(buf);
+        return false;
+    }
+    buf[size] = '\0';
+    int n = 0;
+    for (char *line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) {
+        int id;
+        if (n >= s_accepted_n || sscanf(line, "ligne %d", &id) != 1 ||
+            id != s_accepted[n]) {
+            printf("ligne %d inattendue: %s\n", n, line);
+            free(buf);
+            return false;
+        }
+        ++n;
+    }
+    free(buf);
+    if (n != s_accepted_n) {
+        printf("%d lignes écrites sur %d acceptées\n", n, s_accepted_n);
+        return false;
+    }
+    return true;
+}
+
+int main(void)
+{
+    storage_fake_init(NULL);
+    storage_set_backend(&storage_fake_backend);
+    storage_supervisor_config_t cfg = STORAGE_SUPERVISOR_CONFIG_DEFAULT();
+    cfg.mount = fake_mount;
+    cfg.unmount = fake_unmount;
+    cfg.probe = fake_probe;
+    cfg.backoff_min_ms = 5;
+    cfg.backoff_max_ms = 40;
+    cfg.probe_ms = 10;
+    int fails = 0;
+    if (storage_supervisor_start(&cfg) != ESP_OK ||
+        storage_supervisor_wait_ready(1000) != ESP_OK) {
+        printf("montage initial impossible\n");
+        return 1;
+    }
+    uint32_t epoch = storage_supervisor_epoch();
+
+    int id = 0;
+    for (; id < 50; ++id) {
+        submit(id);
+    }
+    if (s_accepted_n != 50) {
+        printf("%d lignes écrites sur 50, carte présente\n", s_accepted_n);
+        fails++;
+    }
+
+    /* Pulled out: the first failed write is reported, the card is dropped */
+    card_set(false);
+    for (int i = 0; i < 300; ++i, ++id) {
+        submit(id);
+        if (i == 10) {
+            vTaskDelay(pdMS_TO_TICKS(100)); /* let the probe confirm */
+        }
+    }
+    if (storage_supervisor_card_ready()) {
+        printf("carte retirée non détectée\n");
+        fails++;
+    }
+    if (storage_supervisor_wait_ready(50) != ESP_ERR_TIMEOUT) {
+        printf("attente bornée non respectée\n");
+        fails++;
+    }
+    vTaskDelay(pdMS_TO_TICKS(200)); /* a few remount attempts */
+
+    card_set(true);
+    if (storage_supervisor_wait_ready(1000) != ESP_OK ||
+        storage_supervisor_epoch() == epoch) {
+        printf("carte non remontée après réinsertion\n");
+        fails++;
+    }
+    int before = s_accepted_n;
+    for (int i = 0; i < 50; ++i, ++id) {
+        submit(id);
+    }
+    if (s_accepted_n != before + 50) {
+        printf("écritures refusées après réinsertion\n");
+        fails++;
+    }
+
+    /* Light sleep: unmounted while suspended, mounted again after resume */
+    if (storage_supervisor_suspend(1000) != ESP_OK ||
+        storage_supervisor_state() != STORAGE_CARD_SUSPENDED) {
+        printf("suspension impossible\n");
+        fails++;
+    }
+    for (int i = 0; i < 20; ++i, ++id) {
+        submit(id);
+    }
+    storage_supervisor_resume();
+    if (storage_supervisor_wait_ready(1000) != ESP_OK) {
+        printf("carte non remontée après reprise\n");
+        fails++;
+    }
+    for (int i = 0; i < 20; ++i, ++id) {
+        submit(id);
+    }
+
+    storage_supervisor_stats_t st;
+    storage_supervisor_get_stats(&st);
+    if (st.mounts < 3 || st.losses < 1) {
+        printf("%u montages, %u pertes\n", (unsigned)st.mounts,
+               (unsigned)st.losses);
+        fails++;
+    }
+    if (!check_file()) {
+        fails++;
+    }
+    printf("%d écrites, %d refusées, %u montages, %u pertes, "
+           "signalement max %.3f ms\n",
+           s_accepted_n, s_refused, (unsigned)st.mounts, (unsigned)st.losses,
+           s_max_report_ms);
+    printf("%s\n", fails ? "FAIL" : "OK");
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "storage_fake.h"
+#include "test_util.h"
+
+#define CONFIG_TRACE_ENABLE 1 /* sdkconfig.h on the board */
+#include "trace.h"
+
+/*
+ * Trace recorder (components/trace/trace.c) on the host, where one ring
+ * stands for the rings of the cores and a nanosecond clock for the cycle
+ * counter.
+ *
+ * Several threads record nested spans and counters at once into a ring
+ * large enough to keep everything: the Chrome JSON dump must hold every
+ * event once, with balanced spans and non-decreasing timestamps per thread.
+ * The ring is then overrun and must keep exactly its newest events, and a
+ * dump to the fake SD card must match the one in memory. The cost of an
+ * event is printed.
+ *
+ * Usage: test_trace [spans per thread]
+ * Build: gcc -O2 -pthread -Icomponents/trace -Icomponents/storage \
+ *            tests/test_trace.c components/trace/trace.c \
+ *            components/storage/storage.c components/storage/storage_posix.c \
+ *            components/storage/storage_fake.c -o test_trace
+ */
+
+#define THREADS 4
+#define RING_EVENTS 65536
+
+static int s_spans = 2000;
+
+typedef struct {
+    char *buf;
+    size_t len, cap;
+} text_t;
+
+static esp_err_t write_text(const char *buf, size_t len, void *ctx)
+{
+    text_t *t = ctx;
+    if (t->len + len + 1 > t->cap) {
+        t->cap = (t->len + len + 1) * 2;
+        t->buf = realloc(t->buf, t->cap);
+        if (!t->buf) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    memcpy(t->buf + t->len, buf, len);
+    t->len += len;
+    t->buf[t->len] = '\0';
+    return ESP_OK;
+}
+
+/* 3 events per span: begin, counter, end; one span in two holds another */
+static void *worker(void *arg)
+{
+    (void)arg;
+    for (int i = 0; i < s_spans; ++i) {
+        TRACE_BEGIN("outer");
+        TRACE_COUNTER("i", i);
+        if (i & 1) {
+            TRACE_BEGIN("inner \"quoted\"");
+            TRACE_END("inner \"quoted\"");
+        }
+        TRACE_END("outer");
+    }
+    return NULL;
+}
+
+typedef struct {
+    uintptr_t tid;
+    int depth;
+    double last_ts;
+} thread_state_t;
+
+/* Check a dump line by line; returns the number of events, -1 if bad */
+static long check_dump(const char *text)
+{
+    thread_state_t th[THREADS + 1] = {{0}};
+    int n_th = 0;
+    long events = 0;
+    if (strncmp(text, "{\"displayTimeUnit\"", 18) || !strstr(text, "\n]}\n")) {
+        printf("en-tête ou fin JSON manquant\n");
+        return -1;
+    }
+    for (const char *p = strstr(text, "{\"ph\""); p; p = strstr(p + 1, "{\"ph\"")) {
+        char ph, head[64];
+        int pid;
+        uintptr_t tid;
+        /* sscanf runs strlen over its input: scan a copy of the start */
+        snprintf(head, sizeof(head), "%.*s", (int)sizeof(head) - 1, p);
+        if (sscanf(head, "{\"ph\":\"%c\",\"pid\":%d,\"tid\":%" SCNuPTR ",",
+                   &ph, &pid, &tid) != 3) {
+            printf("événement illisible : %.60s\n", p);
+            return -1;
+        }
+        if (ph == 'M') {
+            continue;
+        }
+        const char *ts = strstr(p, "\"ts\":");
+        if (!ts) {
+            printf("événement sans ts : %.60s\n", p);
+            return -1;
+        }
+        double t = strtod(ts + 5, NULL);
+        thread_state_t *s = NULL;
+        for (int k = 0; k < n_th && !s; ++k) {
+            s = (th[k].tid == tid) ? &th[k] : NULL;
+        }
+        if (!s) {
+            if (n_th == THREADS + 1) {
+                printf("trop de threads\n");
+                return -1;
+            }
+            s = &th[n_th++];
+            s->tid = tid;
+        }
+        if (t < s->last_ts) {
+            printf("temps en arrière sur %" PRIuPTR " : %.3f < %.3f\n", tid, t,
+                   s->last_ts);
+            return -1;
+        }
+        s->last_ts = t;
+        s->depth += (ph == 'B') ? 1 : (ph == 'E') ? -1 : 0;
+        if (s->depth < 0) {
+            printf("fin sans début sur %" PRIuPTR "\n", tid);
+            return -1;
+        }
+        events++;
+    }
+    return events;
+}
+
+int main(int argc, char **argv)
+{
+    s_spans = (argc > 1) ? atoi(argv[1]) : s_spans;
+    int fails = 0;
+    text_t text = {0};
+
+    fails += trace_dump(write_text, &text) != ESP_ERR_INVALID_STATE;
+    fails += trace_start(RING_EVENTS) != ESP_OK;
+
+    pthread_t threads[THREADS];
+    double t0 = now_s();
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_create(&threads[i], NULL, worker, NULL);
+    }
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    double record_s = now_s() - t0;
+    long per_thread = 3L * s_spans + 2L * (s_spans / 2);
+    long total = per_thread * THREADS;
+
+    fails += trace_dump(write_text, &text) != ESP_OK;
+    long got = check_dump(text.buf);
+    if (total <= RING_EVENTS && got != total) {
+        printf("%ld événements au lieu de %ld\n", got, total);
+        fails++;
+    }
+    if (!strstr(text.buf, "\"name\":\"inner \\\"quoted\\\"\"")) {
+        printf("nom mal échappé\n");
+        fails++;
+    }
+
+    /* Overrun: only the newest RING_EVENTS remain */
+    for (long i = 0; i < RING_EVENTS + 1000; ++i) {
+        TRACE_INSTANT("tick");
+    }
+    text.len = 0;
+    fails += trace_dump(write_text, &text) != ESP_OK;
+    got = check_dump(text.buf);
+    if (got != RING_EVENTS || strstr(text.buf, "\"outer\"")) {
+        printf("anneau plein : %ld événements au lieu de %d\n", got, RING_EVENTS);
+        fails++;
+    }
+
+    /* Same dump on the card */
+    storage_fake_init(NULL);
+    storage_set_backend(&storage_fake_backend);
+    uint32_t size = 0;
+    fails += trace_dump_file("/sdcard/trace.json") != ESP_OK;
+    fails += storage_stat("/sdcard/trace.json", &size) != ESP_OK;
+    if (size != text.len) {
+        printf("fichier de %" PRIu32 " o au lieu de %zu\n", size, text.len);
+        fails++;
+    }
+    storage_fake_deinit();
+
+    /* Cost of an event, recording and stopped */
+    t0 = now_s();
+    for (int i = 0; i < 1000000; ++i) {
+        TRACE_COUNTER("cost", i);
+    }
+    double on_s = now_s() - t0;
+    trace_stop();
+    t0 = now_s();
+    for (int i = 0; i < 1000000; ++i) {
+        TRACE_COUNTER("cost", i);
+    }
+    double off_s = now_s() - t0;
+
+    printf("%ld événements de %d threads en %.1f ms, dump %zu o\n", total,
+           THREADS, record_s * 1e3, text.len);
+    printf("événement : %.1f ns, arrêté : %.1f ns\n", on_s * 1e3, off_s * 1e3);
+    printf("%s\n", fails ? "FAIL" : "OK");
+    free(text.buf);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Helpers shared by the host tests and benchmarks of tests/, included
+ * straight from their directory.
+ */
+
+/** Monotonic time in seconds, for timings. */
+static inline double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/** Numerical Recipes LCG: same sequence on every host, top 24 bits. */
+static inline uint32_t lcg_next(uint32_t *s)
+{
+    *s = *s * 1664525U + 1013904223U;
+    return *s >> 8;
+}
+
+#endif // TEST_UTIL_H
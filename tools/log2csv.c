@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "log_codec.h"
+
+/*
+ * Convert reptile log segments written by components/logging
+ * (log/AAAAMMJJ.bin, columnar blocks of log_codec.h) back to CSV on stdout.
+ *
+ * Blocks that fail their check (torn write, unused space) are skipped and
+ * counted on stderr; the other blocks are decoded in file order.
+ *
+ * Usage: log2csv log/2024*.bin > log.csv
+ * Build: gcc -O2 -Icomponents/logging tools/log2csv.c \
+ *            components/logging/log_codec.c -o log2csv
+ */
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s file.bin [file.bin ...]\n", argv[0]);
+        return 2;
+    }
+    fputs(LOG_CSV_HEADER, stdout);
+    unsigned long samples = 0;
+    unsigned long skipped = 0;
+    int status = 0;
+    for (int i = 1; i < argc; ++i) {
+        FILE *f = fopen(argv[i], "rb");
+        if (!f) {
+            perror(argv[i]);
+            status = 1;
+            continue;
+        }
+        uint8_t block[LOG_BLOCK_SIZE];
+        size_t n;
+        while ((n = fread(block, 1, sizeof(block), f)) > 0) {
+            log_block_reader_t r;
+            if (n < sizeof(block) || !log_block_open(&r, block)) {
+                skipped++;
+                continue;
+            }
+            log_sample_t s;
+            char line[128];
+            while (log_block_next(&r, &s)) {
+                log_sample_format(&s, line, sizeof(line));
+                fputs(line, stdout);
+                samples++;
+            }
+        }
+        fclose(f);
+    }
+    fprintf(stderr, "%lu échantillons, %lu blocs ignorés\n", samples, skipped);
+    return status;
+}
@@ -0,0 +1,611 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "log_codec.h"
+
+/*
+ * Aggregate queries over reptile logs written by components/logging, on the
+ * host: daily segments (log/AAAAMMJJ.bin, columnar blocks of log_codec.h)
+ * and CSV logs (LOG_CSV_HEADER columns, e.g. the output of tools/log2csv.c).
+ * The header line of a CSV file gives its columns, so the older
+ * reptile_log.csv without humidity (timestamp,faim,eau,temperature,humeur,
+ * event) is read too; a file without header has the LOG_CSV_HEADER columns.
+ *
+ * Files are mapped with mmap and cut into chunks of about 16 MB, on block
+ * boundaries for segments and line boundaries for CSV, that a pool of threads
+ * reads at once. CSV fields are 1 to 10 digits: they are converted in the
+ * same pass that finds the separators, one byte at a time, which beats
+ * locating separators with SIMD compares and converting 8 digits per word
+ * (1.8 s against 3.2 s for a year at 1 Hz). memchr, vectorized by the C
+ * library, finds the chunk boundaries and skips damaged lines. Each chunk
+ * keeps per-day sums plus its first and last sample; the chunks are then
+ * merged in time order, so the intervals that cross a chunk or a file are
+ * counted once.
+ *
+ * Printed on stdout as CSV, per UTC day then in total: samples, mean
+ * temperature, humidity, hunger, water and mood, seconds measured, seconds
+ * with the temperature out of the band, feedings. Mean humidity only counts
+ * the samples that have one (0 when none do). Time is counted between
+ * consecutive samples, from the earlier one, when they are at most --gap
+ * seconds apart (the card was out otherwise). There is no feeding event in
+ * the log: a feeding adds 10 points of hunger (reptile_feed) while the hunger
+ * otherwise only decays, so each rise of the faim column counts as one.
+ * A summary, with the mean interval between feedings, goes to stderr.
+ *
+ * Usage: log_stats [-j threads] [--band min:max] [--gap s] file|dir ...
+ *        (directories: their .bin and .csv files)
+ * Build: g++ -O2 -std=c++17 -pthread -Icomponents/logging tools/log_stats.cpp \
+ *            components/logging/log_codec.c -o log_stats
+ */
+
+namespace {
+
+constexpr size_t CHUNK = 16U << 20;
+constexpr int64_t DAY_S = 86400;
+constexpr int MEANS = LOG_COL_EVENT; /* faim to humeur */
+
+struct Options {
+    int32_t band_min = 25;
+    int32_t band_max = 35;
+    uint32_t gap_s = 300;
+    unsigned threads = 0;
+};
+
+struct Day {
+    uint64_t samples = 0;
+    uint64_t humid_samples = 0;
+    int64_t sum[MEANS] = {};
+    uint64_t measured_s = 0;
+    uint64_t out_s = 0;
+    uint32_t feedings = 0;
+};
+
+struct Point {
+    uint32_t ts;
+    int32_t faim;
+    int32_t temperature;
+};
+
+/* What one chunk holds; merged in time order */
+struct Part {
+    std::map<int64_t, Day> days;
+    bool any = false;
+    Point first{}, last{};
+    uint32_t first_feed = 0, last_feed = 0; /* 0: none */
+    uint64_t samples = 0;
+    uint64_t skipped = 0; /* bad blocks or lines */
+};
+
+struct Mapped {
+    std::string path;
+    const char *data = nullptr;
+    size_t size = 0;
+    bool csv = false;
+    /* CSV: log column of each field after the timestamp */
+    int fields = LOG_VALUES;
+    int col[LOG_VALUES] = {LOG_COL_FAIM, LOG_COL_EAU, LOG_COL_TEMPERATURE,
+                           LOG_COL_HUMIDITE, LOG_COL_HUMEUR, LOG_COL_EVENT};
+    bool humidity = true;
+};
+
+struct Work {
+    const Mapped *file;
+    size_t begin, end;
+};
+
+class Accumulator {
+public:
+    Accumulator(Part &part, const Options &opt) : part_(part), opt_(opt) {}
+
+    /* @p v[LOG_COL_HUMIDITE] must be 0 when @p humidity is false */
+    void add(uint32_t ts, const int32_t *v, bool humidity)
+    {
+        Day *day = day_of(ts);
+        day->samples++;
+        day->humid_samples += humidity;
+        for (int c = 0; c < MEANS; ++c) {
+            day->sum[c] += v[c];
+        }
+        Point p{ts, v[LOG_COL_FAIM], v[LOG_COL_TEMPERATURE]};
+        if (part_.any) {
+            link(part_, prev_day_, part_.last, day, p, opt_);
+        } else {
+            part_.any = true;
+            part_.first = p;
+        }
+        part_.last = p;
+        part_.samples++;
+        prev_day_ = day;
+    }
+
+    /* Interval from @p a, in @p day_a, to the next sample @p b, in @p day_b */
+    static void link(Part &part, Day *day_a, const Point &a, Day *day_b,
+                     const Point &b, const Options &opt)
+    {
+        if (b.ts <= a.ts) {
+            return; /* clock set back or duplicate sample */
+        }
+        uint32_t dt = b.ts - a.ts;
+        if (dt <= opt.gap_s) {
+            day_a->measured_s += dt;
+            if (a.temperature < opt.band_min || a.temperature > opt.band_max) {
+                day_a->out_s += dt;
+            }
+        }
+        if (b.faim > a.faim) {
+            day_b->feedings++;
+            if (!part.first_feed) {
+                part.first_feed = b.ts;
+            }
+            part.last_feed = b.ts;
+        }
+    }
+
+private:
+    Day *day_of(uint32_t ts)
+    {
+        int64_t key = ts / DAY_S;
+        if (!day_ || key != key_) {
+            day_ = &part_.days[key];
+            key_ = key;
+        }
+        return day_;
+    }
+
+    Part &part_;
+    const Options &opt_;
+    Day *day_ = nullptr;
+    Day *prev_day_ = nullptr;
+    int64_t key_ = 0;
+};
+
+/* Blocks of a segment from @p begin to @p end, multiples of LOG_BLOCK_SIZE */
+void scan_bin(const Work &w, Accumulator &acc, Part &part)
+{
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(w.file->data);
+    for (size_t off = w.begin; off < w.end; off += LOG_BLOCK_SIZE) {
+        log_block_reader_t r;
+        if (w.end - off < LOG_BLOCK_SIZE || !log_block_open(&r, data + off)) {
+            part.skipped++;
+            continue;
+        }
+        log_sample_t s;
+        while (log_block_next(&r, &s)) {
+            acc.add(s.timestamp, s.values, true);
+        }
+    }
+}
+
+/* Unsigned decimal at @p p, 10 digits at most; returns its end */
+const char *parse_uint(const char *p, const char *end, uint64_t *out)
+{
+    const char *stop = (end - p > 10) ? p + 10 : end;
+    uint64_t v = 0;
+    while (p < stop && (unsigned)(*p - '0') < 10U) {
+        v = v * 10U + (unsigned)(*p++ - '0');
+    }
+    *out = v;
+    return p;
+}
+
+/*
+ * One CSV line at @p p, fields as in @p f; returns the start of the next
+ * line, or nullptr if this one is not a sample (header, damaged).
+ */
+const char *parse_line(const char *p, const char *end, const Mapped &f,
+                       uint32_t *ts, int32_t *v)
+{
+    uint64_t u;
+    const char *q = parse_uint(p, end, &u);
+    if (q == p || u > UINT32_MAX) {
+        return nullptr;
+    }
+    *ts = (uint32_t)u;
+    for (int c = 0; c < f.fields; ++c) {
+        if (q == end || *q != ',') {
+            return nullptr;
+        }
+        ++q;
+        bool neg = q < end && *q == '-';
+        q += neg;
+        const char *start = q;
+        q = parse_uint(q, end, &u);
+        if (q == start || u > (uint64_t)INT32_MAX + neg) {
+            return nullptr;
+        }
+        v[f.col[c]] = (int32_t)(neg ? -(int64_t)u : (int64_t)u);
+    }
+    if (q == end) {
+        return q;
+    }
+    q += *q == '\r';
+    return (q < end && *q == '\n') ? q + 1 : nullptr;
+}
+
+/* Lines starting from @p begin to @p end, cut at line starts */
+void scan_csv(const Work &w, Accumulator &acc, Part &part)
+{
+    const char *data = w.file->data;
+    const char *file_end = data + w.file->size;
+    const char *p = data + w.begin;
+    const char *stop = data + w.end;
+    while (p < stop) {
+        uint32_t ts;
+        int32_t v[LOG_VALUES] = {0};
+        const char *next = parse_line(p, file_end, *w.file, &ts, v);
+        if (next) {
+            acc.add(ts, v, w.file->humidity);
+            p = next;
+            continue;
+        }
+        if (p != data) {
+            part.skipped++; /* not the header */
+        }
+        const char *nl =
+            static_cast<const char *>(memchr(p, '\n', (size_t)(file_end - p)));
+        p = nl ? nl + 1 : file_end;
+    }
+}
+
+/*
+ * Columns of a CSV file from its header line. Every LOG_CSV_HEADER column
+ * but humidite is required, in any order; no header means LOG_CSV_HEADER.
+ */
+bool read_header(Mapped &f)
+{
+    static const char *const k_names[LOG_VALUES] = {
+        "faim", "eau", "temperature", "humidite", "humeur", "event"};
+    if (!f.size || (unsigned)(f.data[0] - '0') < 10U) {
+        return true;
+    }
+    const char *nl = static_cast<const char *>(memchr(f.data, '\n', f.size));
+    std::string line(f.data, nl ? (size_t)(nl - f.data) : f.size);
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    bool seen[LOG_VALUES] = {};
+    int fields = -1;
+    size_t pos = 0;
+    for (;;) {
+        size_t comma = line.find(',', pos);
+        std::string name = line.substr(pos, comma - pos);
+        if (fields < 0) {
+            if (name != "timestamp") {
+                break;
+            }
+        } else {
+            const char *const *it =
+                std::find(k_names, k_names + LOG_VALUES, name);
+            int c = (int)(it - k_names);
+            if (c == LOG_VALUES || seen[c] || fields == LOG_VALUES) {
+                break;
+            }
+            seen[c] = true;
+            f.col[fields] = c;
+        }
+        fields++;
+        if (comma == std::string::npos) {
+            f.fields = fields;
+            f.humidity = seen[LOG_COL_HUMIDITE];
+            seen[LOG_COL_HUMIDITE] = true;
+            return std::count(seen, seen + LOG_VALUES, true) == LOG_VALUES;
+        }
+        pos = comma + 1;
+    }
+    return false;
+}
+
+/* Chunks of @p f, on block or line boundaries */
+void split(const Mapped &f, std::vector<Work> &out)
+{
+    size_t begin = 0;
+    while (begin < f.size) {
+        size_t end = std::min(f.size, begin + CHUNK);
+        if (f.csv && end < f.size) {
+            const void *nl = memchr(f.data + end, '\n', f.size - end);
+            end = nl ? (size_t)(static_cast<const char *>(nl) - f.data) + 1
+                     : f.size;
+        }
+        out.push_back(Work{&f, begin, end});
+        begin = end;
+    }
+}
+
+bool has_suffix(const std::string &s, const char *suffix)
+{
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+/* Files named on the command line, directories expanded */
+bool list_files(const std::vector<std::string> &args,
+                std::vector<std::string> &out)
+{
+    bool ok = true;
+    for (const std::string &a : args) {
+        struct stat st;
+        if (stat(a.c_str(), &st) != 0) {
+            perror(a.c_str());
+            ok = false;
+            continue;
+        }
+        if (!S_ISDIR(st.st_mode)) {
+            out.push_back(a);
+            continue;
+        }
+        DIR *d = opendir(a.c_str());
+        if (!d) {
+            perror(a.c_str());
+            ok = false;
+            continue;
+        }
+        std::vector<std::string> found;
+        while (struct dirent *e = readdir(d)) {
+            std::string name = e->d_name;
+            if (has_suffix(name, ".bin") || has_suffix(name, ".csv")) {
+                found.push_back(a + "/" + name);
+            }
+        }
+        closedir(d);
+        std::sort(found.begin(), found.end());
+        out.insert(out.end(), found.begin(), found.end());
+    }
+    return ok;
+}
+
+bool map_file(Mapped &f)
+{
+    int fd = open(f.path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(f.path.c_str());
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    f.size = (size_t)st.st_size;
+    f.csv = has_suffix(f.path, ".csv");
+    if (f.size) {
+        void *p = mmap(nullptr, f.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            perror(f.path.c_str());
+            close(fd);
+            return false;
+        }
+        madvise(p, f.size, MADV_SEQUENTIAL);
+        f.data = static_cast<const char *>(p);
+    }
+    close(fd);
+    return true;
+}
+
+/* Chunk results in time order, into @p total */
+void merge(std::vector<Part> &parts, Part &total, const Options &opt)
+{
+    std::sort(parts.begin(), parts.end(), [](const Part &a, const Part &b) {
+        return a.any != b.any ? a.any : a.first.ts < b.first.ts;
+    });
+    for (Part &p : parts) {
+        total.samples += p.samples;
+        total.skipped += p.skipped;
+        if (!p.any) {
+            continue;
+        }
+        if (total.any) {
+            Day *day_a = &total.days[total.last.ts / DAY_S];
+            Day *day_b = &p.days[p.first.ts / DAY_S];
+            Accumulator::link(total, day_a, total.last, day_b, p.first, opt);
+        } else {
+            total.any = true;
+            total.first = p.first;
+        }
+        total.last = p.last;
+        if (p.first_feed) {
+            if (!total.first_feed) {
+                total.first_feed = p.first_feed;
+            }
+            total.last_feed = p.last_feed;
+        }
+        for (const auto &kv : p.days) {
+            Day &d = total.days[kv.first];
+            d.samples += kv.second.samples;
+            d.humid_samples += kv.second.humid_samples;
+            for (int c = 0; c < MEANS; ++c) {
+                d.sum[c] += kv.second.sum[c];
+            }
+            d.measured_s += kv.second.measured_s;
+            d.out_s += kv.second.out_s;
+            d.feedings += kv.second.feedings;
+        }
+    }
+}
+
+void print_row(const char *label, const Day &d)
+{
+    static const int k_order[MEANS] = {LOG_COL_TEMPERATURE, LOG_COL_HUMIDITE,
+                                       LOG_COL_FAIM, LOG_COL_EAU,
+                                       LOG_COL_HUMEUR};
+    printf("%s,%" PRIu64, label, d.samples);
+    for (int c : k_order) {
+        uint64_t n = (c == LOG_COL_HUMIDITE) ? d.humid_samples : d.samples;
+        printf(",%.2f", n ? (double)d.sum[c] / (double)n : 0.0);
+    }
+    printf(",%" PRIu64 ",%" PRIu64 ",%" PRIu32 "\n", d.measured_s, d.out_s,
+           d.feedings);
+}
+
+bool parse_band(const char *s, Options &opt)
+{
+    char *end;
+    long lo = strtol(s, &end, 10);
+    if (*end != ':') {
+        return false;
+    }
+    long hi = strtol(end + 1, &end, 10);
+    if (*end || lo > hi) {
+        return false;
+    }
+    opt.band_min = (int32_t)lo;
+    opt.band_max = (int32_t)hi;
+    return true;
+}
+
+int usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-j threads] [--band min:max] [--gap s] file|dir ...\n",
+            prog);
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool value = i + 1 < argc;
+        if (a == "-j" && value) {
+            opt.threads = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (a == "--band" && value) {
+            if (!parse_band(argv[++i], opt)) {
+                return usage(argv[0]);
+            }
+        } else if (a == "--gap" && value) {
+            opt.gap_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (a[0] == '-') {
+            return usage(argv[0]);
+        } else {
+            args.push_back(a);
+        }
+    }
+    if (args.empty()) {
+        return usage(argv[0]);
+    }
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<std::string> paths;
+    int status = list_files(args, paths) ? 0 : 1;
+    std::vector<Mapped> files(paths.size());
+    std::vector<Work> work;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        files[i].path = paths[i];
+        if (!map_file(files[i])) {
+            status = 1;
+            continue;
+        }
+        if (files[i].csv && !read_header(files[i])) {
+            fprintf(stderr, "%s : en-tête CSV inconnu\n", paths[i].c_str());
+            munmap(const_cast<char *>(files[i].data), files[i].size);
+            files[i].data = nullptr;
+            files[i].size = 0;
+            status = 1;
+            continue;
+        }
+        bytes += files[i].size;
+    }
+    for (const Mapped &f : files) {
+        split(f, work);
+    }
+
+    /* Largest chunks first so that the threads finish together */
+    std::sort(work.begin(), work.end(), [](const Work &a, const Work &b) {
+        return a.end - a.begin > b.end - b.begin;
+    });
+    std::vector<Part> parts(work.size());
+    std::atomic<size_t> next{0};
+    unsigned n_threads = opt.threads ? opt.threads
+                                     : std::thread::hardware_concurrency();
+    n_threads = (unsigned)std::min<size_t>(std::max(1U, n_threads),
+                                           std::max<size_t>(1, work.size()));
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next.fetch_add(1)) < work.size()) {
+            Accumulator acc(parts[i], opt);
+            if (work[i].file->csv) {
+                scan_csv(work[i], acc, parts[i]);
+            } else {
+                scan_bin(work[i], acc, parts[i]);
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < n_threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &t : pool) {
+        t.join();
+    }
+
+    Part total;
+    merge(parts, total, opt);
+    for (const Mapped &f : files) {
+        if (f.data) {
+            munmap(const_cast<char *>(f.data), f.size);
+        }
+    }
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - t0)
+                         .count();
+
+    printf("jour,echantillons,temperature,humidite,faim,eau,humeur,"
+           "mesure_s,hors_plage_s,repas\n");
+    Day sum;
+    for (const auto &kv : total.days) {
+        time_t t = (time_t)(kv.first * DAY_S);
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        char label[16];
+        strftime(label, sizeof(label), "%Y-%m-%d", &tm);
+        print_row(label, kv.second);
+        sum.samples += kv.second.samples;
+        sum.humid_samples += kv.second.humid_samples;
+        for (int c = 0; c < MEANS; ++c) {
+            sum.sum[c] += kv.second.sum[c];
+        }
+        sum.measured_s += kv.second.measured_s;
+        sum.out_s += kv.second.out_s;
+        sum.feedings += kv.second.feedings;
+    }
+    print_row("total", sum);
+
+    size_t n_days = total.days.size();
+    fprintf(stderr, "hors de [%" PRId32 ", %" PRId32 "] : %.1f h sur %.1f h "
+            "mesurées (%.2f %%)\n",
+            opt.band_min, opt.band_max, (double)sum.out_s / 3600.0,
+            (double)sum.measured_s / 3600.0,
+            sum.measured_s ? 100.0 * (double)sum.out_s / (double)sum.measured_s
+                           : 0.0);
+    fprintf(stderr, "repas : %" PRIu32 ", %.2f par jour", sum.feedings,
+            n_days ? (double)sum.feedings / (double)n_days : 0.0);
+    if (sum.feedings > 1) {
+        fprintf(stderr, ", un toutes les %.1f h",
+                (double)(total.last_feed - total.first_feed) /
+                    (double)(sum.feedings - 1) / 3600.0);
+    }
+    fprintf(stderr,
+            "\n%zu fichiers, %.1f Mo, %" PRIu64 " échantillons, %" PRIu64
+            " blocs ou lignes ignorés en %.2f s sur %u threads\n",
+            files.size(), (double)bytes / 1e6, total.samples, total.skipped,
+            elapsed, n_threads);
+    return status;
+}